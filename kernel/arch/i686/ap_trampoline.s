@@ -0,0 +1,74 @@
+.section .note.GNU-stack,"",%progbits
+.section .text
+
+#
+# Application processor startup trampoline.
+#
+# Copied to AP_TRAMPOLINE_BASE (0x8000) below 1MB and entered in real mode
+# through a STARTUP IPI with vector 0x08. It loads a flat temporary GDT,
+# switches to protected mode, enables paging with the kernel page
+# directory and calls ap_entry on the stack the BSP placed in the
+# parameter block at the end of the trampoline.
+#
+.set TRAMPOLINE_BASE, 0x8000
+
+.global ap_trampoline_start
+.global ap_trampoline_end
+.global ap_trampoline_cr3
+.global ap_trampoline_stack
+.global ap_trampoline_entry
+
+.code16
+ap_trampoline_start:
+    cli
+    cld
+    xorw %ax, %ax
+    movw %ax, %ds
+    lgdtl (ap_gdt_desc - ap_trampoline_start + TRAMPOLINE_BASE)
+
+    movl %cr0, %eax
+    orl $0x1, %eax
+    movl %eax, %cr0
+    ljmpl $0x08, $(ap_protected - ap_trampoline_start + TRAMPOLINE_BASE)
+
+.code32
+ap_protected:
+    movw $0x10, %ax
+    movw %ax, %ds
+    movw %ax, %es
+    movw %ax, %fs
+    movw %ax, %gs
+    movw %ax, %ss
+
+    movl (ap_trampoline_cr3 - ap_trampoline_start + TRAMPOLINE_BASE), %eax
+    movl %eax, %cr3
+    movl %cr0, %eax
+    orl $0x80000000, %eax
+    movl %eax, %cr0
+
+    movl (ap_trampoline_stack - ap_trampoline_start + TRAMPOLINE_BASE), %esp
+    movl (ap_trampoline_entry - ap_trampoline_start + TRAMPOLINE_BASE), %eax
+    call *%eax
+
+1:
+    cli
+    hlt
+    jmp 1b
+
+.align 8
+ap_gdt:
+    .quad 0x0000000000000000
+    .quad 0x00CF9A000000FFFF
+    .quad 0x00CF92000000FFFF
+ap_gdt_desc:
+    .word ap_gdt_desc - ap_gdt - 1
+    .long (ap_gdt - ap_trampoline_start + TRAMPOLINE_BASE)
+
+.align 4
+ap_trampoline_cr3:
+    .long 0
+ap_trampoline_stack:
+    .long 0
+ap_trampoline_entry:
+    .long 0
+ap_trampoline_end:
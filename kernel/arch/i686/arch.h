@@ -165,6 +165,41 @@ static inline void invlpg(uint32_t addr)
     __asm__ volatile ("invlpg (%0)" : : "r"(addr) : "memory");
 }
 
+/**
+ * @brief Read the time stamp counter
+ * @return The 64-bit TSC value
+ */
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo;
+    uint32_t hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * @brief Write a model specific register
+ * @param msr The MSR index
+ * @param value The 64-bit value to write
+ */
+static inline void wrmsr(uint32_t msr, uint64_t value)
+{
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+/**
+ * @brief Execute the CPUID instruction
+ * @param leaf The CPUID leaf (EAX input)
+ * @param eax Pointer to store EAX output
+ * @param ebx Pointer to store EBX output
+ * @param ecx Pointer to store ECX output
+ * @param edx Pointer to store EDX output
+ */
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx)
+{
+    __asm__ volatile ("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
 /**
  * @brief Get the current values of CPU registers
  * @param eax Pointer to store EAX value
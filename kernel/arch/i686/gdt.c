@@ -3,9 +3,19 @@
 #include "../include/config.h"
 #include "../include/cast.h"
 
-static struct gdt_entry gdt_entries[6];
+#define GDT_ENTRIES (GDT_FIRST_TSS + 2 * MAX_CPUS)
+#define IO_BITMAP_BYTES (IO_PORT_COUNT / 8)
+
+// the I/O permission bitmap follows the TSS; a set bit denies the port
+struct tss_io
+{
+    struct tss_entry tss;
+    uint8_t iomap[IO_BITMAP_BYTES + 1];
+} PACKED;
+
+static struct gdt_entry gdt_entries[GDT_ENTRIES];
 static struct gdt_ptr   gdt_pointer;
-static struct tss_entry tss;
+static struct tss_io    tss[MAX_CPUS];
 
 void gdt_set_gate(const int num, const uint32_t base, const uint32_t limit, const uint8_t access, const uint8_t gran)
 {
@@ -18,23 +28,34 @@ void gdt_set_gate(const int num, const uint32_t base, const uint32_t limit, cons
     gdt_entries[num].access      = access;
 }
 
-static void tss_write(const int num, const uint32_t ss0, const uint32_t esp0)
+static void tss_write(const uint32_t cpu, const uint32_t ss0, const uint32_t esp0)
 {
-    const uint32_t base = PTR_TO_U32(&tss);
-    const uint32_t limit = base + sizeof(tss);
+    struct tss_entry* t = &tss[cpu].tss;
+    const uint32_t base = PTR_TO_U32(&tss[cpu]);
+    const uint32_t limit = sizeof(struct tss_io) - 1;
+
+    gdt_set_gate(GDT_FIRST_TSS + 2 * cpu, base, limit, 0xE9, 0x00);
+    memset(&tss[cpu], 0, sizeof(struct tss_io));
+    t->ss0  = ss0;
+    t->esp0 = esp0;
+    t->cs   = KERNEL_CS;
+    t->ss   = t->ds = t->es = t->fs = t->gs = KERNEL_DS;
 
-    gdt_set_gate(num, base, limit, 0xE9, 0x00);
-    memset(&tss, 0, sizeof(tss));
-    tss.ss0  = ss0;
-    tss.esp0 = esp0;
-    tss.cs   = KERNEL_CS;
-    tss.ss   = tss.ds = tss.es = tss.fs = tss.gs = KERNEL_DS;
-    tss.iomap_base = sizeof(tss);
+    // every port denied to ring 3; the trailing byte must stay all ones
+    t->iomap_base = __builtin_offsetof(struct tss_io, iomap);
+    memset(tss[cpu].iomap, 0xFF, sizeof(tss[cpu].iomap));
+}
+
+static uint32_t current_cpu_index(void)
+{
+    uint16_t sel;
+    __asm__ volatile ("str %0" : "=r"(sel));
+    return ((sel >> 3) - GDT_FIRST_TSS) / 2;
 }
 
 void gdt_init(void)
 {
-    gdt_pointer.limit = (sizeof(struct gdt_entry) * 6) - 1;
+    gdt_pointer.limit = (sizeof(struct gdt_entry) * GDT_ENTRIES) - 1;
     gdt_pointer.base = PTR_TO_U32(gdt_entries);
 
     gdt_set_gate(0, 0, 0, 0, 0);                // Null segment
@@ -42,13 +63,50 @@ void gdt_init(void)
     gdt_set_gate(2, 0, 0xFFFFFFFF, 0x92, 0xCF); // Kernel data
     gdt_set_gate(3, 0, 0xFFFFFFFF, 0xFA, 0xCF); // User code
     gdt_set_gate(4, 0, 0xFFFFFFFF, 0xF2, 0xCF); // User data
-    tss_write(5, KERNEL_DS, 0);                  // TSS
+
+    // one TSS and one per-CPU data segment for GS per processor
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        tss_write(cpu, KERNEL_DS, 0);
+        gdt_set_gate(GDT_FIRST_TSS + 2 * cpu + 1, 0, 0xFFFFFFFF, 0x92, 0xCF);
+    }
 
     gdt_flush(PTR_TO_U32(&gdt_pointer));
-    tss_flush();
+    tss_flush(GDT_TSS_SEL(0));
+}
+
+void gdt_init_cpu(const uint32_t cpu, const uint32_t percpu_base)
+{
+    gdt_set_gate(GDT_FIRST_TSS + 2 * cpu + 1, percpu_base, 0xFFFFFFFF, 0x92, 0xCF);
+
+    if (cpu != 0)
+    {
+        gdt_flush(PTR_TO_U32(&gdt_pointer));
+        tss_flush(GDT_TSS_SEL(cpu));
+    }
+
+    const uint16_t sel = GDT_PERCPU_SEL(cpu);
+    __asm__ volatile ("mov %0, %%gs" : : "r"(sel));
 }
 
 void tss_set_kernel_stack(const uint32_t stack)
 {
-    tss.esp0 = stack;
+    tss[current_cpu_index()].tss.esp0 = stack;
+}
+
+void tss_set_io_range(const uint16_t base, const uint32_t count, const bool allow)
+{
+    uint8_t* map = tss[current_cpu_index()].iomap;
+    const uint32_t end = base + count < IO_PORT_COUNT ? base + count : IO_PORT_COUNT;
+    for (uint32_t port = base; port < end; port++)
+    {
+        if (allow)
+        {
+            map[port >> 3] &= (uint8_t)~(1u << (port & 7));
+        }
+        else
+        {
+            map[port >> 3] |= (uint8_t)(1u << (port & 7));
+        }
+    }
 }
@@ -60,8 +60,22 @@ struct tss_entry
 /**
  * @brief Initialize the GDT
  */
+/**
+ * @brief GDT index of CPU 0's TSS; each CPU owns a TSS and a GS segment after it
+ */
+#define GDT_FIRST_TSS 5
+#define GDT_TSS_SEL(cpu) ((GDT_FIRST_TSS + 2 * (cpu)) * 8)
+#define GDT_PERCPU_SEL(cpu) (GDT_TSS_SEL(cpu) + 8)
+
 void gdt_init(void);
 
+/**
+ * @brief Load the GDT, task register and per-CPU GS segment on a CPU
+ * @param cpu Logical CPU index
+ * @param percpu_base Linear address of the CPU's per-CPU data block
+ */
+void gdt_init_cpu(uint32_t cpu, uint32_t percpu_base);
+
 /**
  * @brief Set a GDT entry
  *
@@ -80,6 +94,21 @@ void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_
  */
 void tss_set_kernel_stack(uint32_t stack);
 
+/**
+ * @brief Number of x86 I/O ports
+ */
+#define IO_PORT_COUNT 0x10000
+
+/**
+ * @brief Allow or deny ring 3 access to I/O ports on the calling CPU
+ * @details Edits the I/O permission bitmap of this CPU's TSS, which
+ *          starts out denying every port.
+ * @param base First port
+ * @param count Number of ports
+ * @param allow true to allow, false to deny
+ */
+void tss_set_io_range(uint16_t base, uint32_t count, bool allow);
+
 /**
  * @brief Flush the GDT
  *
@@ -89,8 +118,10 @@ extern void gdt_flush(uint32_t);
 
 /**
  * @brief Flush the TSS
+ *
+ * @param sel The TSS selector to load into the task register
  */
-extern void tss_flush(void);
+extern void tss_flush(uint16_t sel);
 
 #ifdef __cplusplus
 }
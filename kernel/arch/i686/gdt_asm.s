@@ -18,6 +18,6 @@ gdt_flush:
     ret
 
 tss_flush:
-    mov $0x2B, %ax
+    mov 4(%esp), %ax
     ltr %ax
     ret
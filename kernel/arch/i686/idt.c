@@ -6,10 +6,43 @@
 #include "../../lib/log.h"
 #include "../sched/sched.h"
 #include "../include/cast.h"
+#include "../include/spinlock.h"
+#include "lapic.h"
+#include "ioapic.h"
+#include "smp.h"
+#include "../../sys/softirq.h"
+#include "../../mm/vmm.h"
+
+#define PIC1_COMMAND 0x20
+#define PIC1_DATA    0x21
+#define PIC2_COMMAND 0xA0
+#define PIC2_DATA    0xA1
+#define PIC_EOI      0x20
+#define EOI_BENCH_ROUNDS 64
 
 static struct idt_entry idt_entries[256];
 static struct idt_ptr   idt_pointer;
 static isr_handler_t    handlers[256];
+static uint8_t          irq_mode = IRQ_MODE_PIC;
+static struct irq_latency irq_stats[2];
+static spinlock_t       irq_stats_lock = SPINLOCK_INIT;
+
+/// @brief Handler chained on a hardware interrupt vector \struct irq_action
+struct irq_action
+{
+    struct irq_action* volatile next;
+    irq_handler_t handler;
+    void* dev_id;
+    const char* name;
+    bool used;
+};
+
+static struct irq_action irq_actions[IRQ_MAX_ACTIONS];
+static struct irq_action* volatile irq_chains[256];
+static volatile uint32_t irq_in_progress[256];
+static struct irq_vector_stats irq_vectors[256];
+static spinlock_t       irq_desc_lock = SPINLOCK_INIT;
+static spinlock_t       irq_mask_lock = SPINLOCK_INIT;
 static void exception_handler(struct registers* regs);
 static void page_fault_handler(const struct registers* regs);
 
@@ -32,8 +65,8 @@ static void pic_remap(void)
     outb(0xA1, 0x02); io_wait();
     outb(0x21, 0x01); io_wait();
     outb(0xA1, 0x01); io_wait();
-    outb(0x21, 0x0);  io_wait();
-    outb(0xA1, 0x0);  io_wait();
+    outb(PIC1_DATA, 0x0);  io_wait();
+    outb(PIC2_DATA, 0x0);  io_wait();
 }
 
 void idt_init(void)
@@ -98,9 +131,18 @@ void idt_init(void)
     idt_set_gate(46, PTR_TO_U32(irq14), KERNEL_CS, 0x8E);
     idt_set_gate(47, PTR_TO_U32(irq15), KERNEL_CS, 0x8E);
 
+    // Local APIC timer, acknowledged like the IRQs above
+    idt_set_gate(48, PTR_TO_U32(irq16), KERNEL_CS, 0x8E);
+
     // Syscall interrupt - user accessible (DPL=3)
     idt_set_gate(128, PTR_TO_U32(isr128), KERNEL_CS, 0xEE);
 
+    // Local APIC vectors (IPIs and spurious)
+    idt_set_gate(240, PTR_TO_U32(isr240), KERNEL_CS, 0x8E);
+    idt_set_gate(241, PTR_TO_U32(isr241), KERNEL_CS, 0x8E);
+    idt_set_gate(242, PTR_TO_U32(isr242), KERNEL_CS, 0x8E);
+    idt_set_gate(255, PTR_TO_U32(isr255), KERNEL_CS, 0x8E);
+
     idt_flush(PTR_TO_U32(&idt_pointer));
 
     for (int i = 0; i < 32; i++)
@@ -109,6 +151,11 @@ void idt_init(void)
     }
 }
 
+void idt_load(void)
+{
+    idt_flush(PTR_TO_U32(&idt_pointer));
+}
+
 void register_interrupt_handler(const uint8_t n, const isr_handler_t handler)
 {
     handlers[n] = handler;
@@ -124,13 +171,27 @@ static void page_fault_handler(const struct registers* regs)
     const int reserved = BIT_FLAG(regs->err_code, 0x8);
     const int fetch = BIT_FLAG(regs->err_code, 0x10);
 
+    // write to a copy-on-write page: give the writer its own frame
+    if (present && write && vmm_handle_cow(vmm_get_current_directory(), faulting_address) == 0)
+    {
+        // other CPUs may still cache the shared frame; only shoot down when
+        // the faulting code could take interrupts, so no spinlock is held
+        if (regs->eflags & 0x200)
+        {
+            sti();
+            smp_flush_tlb();
+            cli();
+        }
+        return;
+    }
+
     if (user)
     {
         const struct task* current = sched_get_current();
         if (current)
         {
             task_exit(current->id, -1);
-            schedule();
+            sched_set_need_resched();
         }
         return;
     }
@@ -211,7 +272,7 @@ static void exception_handler(struct registers* regs)
         if (current)
         {
             task_exit(current->id, -1);
-            schedule();
+            sched_set_need_resched();
         }
         return;
     }
@@ -242,17 +303,300 @@ void isr_handler(struct registers* regs)
     }
 }
 
-void irq_handler(struct registers* regs)
+static void pic_eoi(const uint32_t int_no)
 {
-    // Send EOI
-    if (regs->int_no >= 40)
+    if (int_no >= 40)
     {
-        outb(0xA0, 0x20);
+        outb(PIC2_COMMAND, PIC_EOI);
     }
-    outb(0x20, 0x20);
+    outb(PIC1_COMMAND, PIC_EOI);
+}
 
-    if (handlers[regs->int_no])
+static void irq_account(const uint8_t vector, const uint32_t latency, const uint32_t cycles, const bool handled)
+{
+    spin_lock(&irq_stats_lock);
+    struct irq_latency* stats = &irq_stats[irq_mode];
+    if (stats->count == 0 || latency < stats->min_cycles)
     {
-        handlers[regs->int_no](regs);
+        stats->min_cycles = latency;
+    }
+    if (latency > stats->max_cycles)
+    {
+        stats->max_cycles = latency;
+    }
+    stats->total_cycles += latency;
+    stats->count++;
+
+    struct irq_vector_stats* v = &irq_vectors[vector];
+    v->count++;
+    if (!handled)
+    {
+        v->unhandled++;
+    }
+    if (latency > v->max_latency)
+    {
+        v->max_latency = latency;
+    }
+    if (cycles > v->max_handler_cycles)
+    {
+        v->max_handler_cycles = cycles;
     }
+    v->handler_cycles += cycles;
+    spin_unlock(&irq_stats_lock);
+}
+
+// runs every handler on the chain: any device on a shared line may have fired
+static bool irq_dispatch(const uint8_t vector, struct registers* regs)
+{
+    bool handled = false;
+
+    __sync_fetch_and_add(&irq_in_progress[vector], 1);
+    for (const struct irq_action* a = irq_chains[vector]; a; a = a->next)
+    {
+        if (a->handler(regs, a->dev_id) == IRQ_HANDLED)
+        {
+            handled = true;
+        }
+    }
+    __sync_fetch_and_sub(&irq_in_progress[vector], 1);
+
+    if (!handled && handlers[vector])
+    {
+        handlers[vector](regs);
+        handled = true;
+    }
+    return handled;
+}
+
+int request_irq(const uint8_t vector, const irq_handler_t handler, void* dev_id, const char* name)
+{
+    if (vector < 32 || !handler)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&irq_desc_lock);
+
+    struct irq_action* volatile* link = &irq_chains[vector];
+    while (*link)
+    {
+        if ((*link)->dev_id == dev_id)
+        {
+            spin_unlock_irqrestore(&irq_desc_lock, flags);
+            return -1;
+        }
+        link = &(*link)->next;
+    }
+
+    struct irq_action* action = NULL;
+    for (uint32_t i = 0; i < IRQ_MAX_ACTIONS; i++)
+    {
+        if (!irq_actions[i].used)
+        {
+            action = &irq_actions[i];
+            break;
+        }
+    }
+    if (!action)
+    {
+        spin_unlock_irqrestore(&irq_desc_lock, flags);
+        return -1;
+    }
+
+    action->used = true;
+    action->next = NULL;
+    action->handler = handler;
+    action->dev_id = dev_id;
+    action->name = name;
+
+    // fully set up before it becomes visible to irq_dispatch
+    __sync_synchronize();
+    *link = action;
+
+    spin_unlock_irqrestore(&irq_desc_lock, flags);
+    return 0;
+}
+
+int free_irq(const uint8_t vector, const void* dev_id)
+{
+    uint32_t flags = spin_lock_irqsave(&irq_desc_lock);
+
+    struct irq_action* volatile* link = &irq_chains[vector];
+    while (*link && (*link)->dev_id != dev_id)
+    {
+        link = &(*link)->next;
+    }
+
+    struct irq_action* action = *link;
+    if (!action)
+    {
+        spin_unlock_irqrestore(&irq_desc_lock, flags);
+        return -1;
+    }
+    *link = action->next;
+    spin_unlock_irqrestore(&irq_desc_lock, flags);
+
+    // a CPU may still be walking the chain through the removed entry
+    while (irq_in_progress[vector])
+    {
+        __asm__ volatile ("pause");
+    }
+
+    flags = spin_lock_irqsave(&irq_desc_lock);
+    action->used = false;
+    spin_unlock_irqrestore(&irq_desc_lock, flags);
+    return 0;
+}
+
+uint32_t irq_get_action_count(const uint8_t vector)
+{
+    uint32_t count = 0;
+    const uint32_t flags = spin_lock_irqsave(&irq_desc_lock);
+    for (const struct irq_action* a = irq_chains[vector]; a; a = a->next)
+    {
+        count++;
+    }
+    spin_unlock_irqrestore(&irq_desc_lock, flags);
+    return count;
+}
+
+const char* irq_get_name(const uint8_t vector)
+{
+    const struct irq_action* a = irq_chains[vector];
+    return a ? a->name : NULL;
+}
+
+void irq_get_vector_stats(const uint8_t vector, struct irq_vector_stats* out)
+{
+    if (!out)
+    {
+        return;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&irq_stats_lock);
+    *out = irq_vectors[vector];
+    spin_unlock_irqrestore(&irq_stats_lock, flags);
+}
+
+void irq_set_mode(const uint8_t mode)
+{
+    if (mode == IRQ_MODE_APIC)
+    {
+        outb(PIC1_DATA, 0xFF);
+        outb(PIC2_DATA, 0xFF);
+    }
+    else
+    {
+        outb(PIC1_DATA, 0x00);
+        outb(PIC2_DATA, 0x00);
+    }
+    irq_mode = mode;
+}
+
+static void irq_set_line_masked(const uint8_t irq, const bool masked)
+{
+    if (irq >= 16)
+    {
+        return;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&irq_mask_lock);
+    if (irq_mode == IRQ_MODE_APIC)
+    {
+        if (masked)
+        {
+            ioapic_mask_irq(irq);
+        }
+        else
+        {
+            ioapic_unmask_irq(irq);
+        }
+    }
+    else
+    {
+        const uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+        const uint8_t bit = (uint8_t)(1u << (irq & 7));
+        const uint8_t mask = inb(port);
+        outb(port, masked ? (uint8_t)(mask | bit) : (uint8_t)(mask & ~bit));
+    }
+    spin_unlock_irqrestore(&irq_mask_lock, flags);
+}
+
+void irq_mask_line(const uint8_t irq)
+{
+    irq_set_line_masked(irq, true);
+}
+
+void irq_unmask_line(const uint8_t irq)
+{
+    irq_set_line_masked(irq, false);
+}
+
+uint8_t irq_get_mode(void)
+{
+    return irq_mode;
+}
+
+void irq_get_latency(const uint8_t mode, struct irq_latency* out)
+{
+    if (!out || mode > IRQ_MODE_APIC)
+    {
+        return;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&irq_stats_lock);
+    *out = irq_stats[mode];
+    spin_unlock_irqrestore(&irq_stats_lock, flags);
+}
+
+uint32_t irq_measure_eoi(const uint8_t mode)
+{
+    if (mode == IRQ_MODE_APIC && !lapic_is_enabled())
+    {
+        return 0;
+    }
+
+    const uint32_t flags = read_eflags();
+    cli();
+    const uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < EOI_BENCH_ROUNDS; i++)
+    {
+        if (mode == IRQ_MODE_APIC)
+        {
+            lapic_eoi();
+        }
+        else
+        {
+            pic_eoi(40);
+        }
+    }
+    const uint64_t cycles = rdtsc() - start;
+    if (flags & 0x200)
+    {
+        sti();
+    }
+    return (uint32_t)(cycles / EOI_BENCH_ROUNDS);
+}
+
+void irq_handler(struct registers* regs)
+{
+    const uint64_t entry = this_cpu()->irq_entry_tsc;
+    const uint8_t vector = (uint8_t)regs->int_no;
+
+    // MMIO write to the local APIC instead of port I/O to one or both PICs
+    if (irq_mode == IRQ_MODE_APIC)
+    {
+        lapic_eoi();
+    }
+    else
+    {
+        pic_eoi(regs->int_no);
+    }
+
+    const uint64_t start = rdtsc();
+
+    irq_enter();
+    const bool handled = irq_dispatch(vector, regs);
+    irq_account(vector, (uint32_t)(start - entry), (uint32_t)(rdtsc() - start), handled);
+    irq_exit();
 }
@@ -38,6 +38,25 @@ struct registers
  */
 typedef void (*isr_handler_t)(struct registers*);
 
+/**
+ * @brief Return values of shared IRQ handlers
+ */
+#define IRQ_NONE    0
+#define IRQ_HANDLED 1
+
+/**
+ * @brief Maximum number of handlers registered with request_irq
+ */
+#define IRQ_MAX_ACTIONS 32
+
+/**
+ * @brief Hardware interrupt handler that may share its vector
+ * @param regs Interrupted register state
+ * @param dev_id Cookie given to request_irq
+ * @return IRQ_HANDLED if the device raised the interrupt, IRQ_NONE otherwise
+ */
+typedef int (*irq_handler_t)(struct registers* regs, void* dev_id);
+
 /**
  * @brief Initialize the IDT
  */
@@ -52,6 +71,88 @@ void idt_init(void);
  */
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
 
+/**
+ * @brief Interrupt controller modes
+ */
+#define IRQ_MODE_PIC  0
+#define IRQ_MODE_APIC 1
+
+/**
+ * @brief Entry-to-handler latency of hardware interrupts \struct irq_latency
+ * @details Cycles from the IRQ entry stub to the driver handler call,
+ *          which includes the controller EOI.
+ */
+struct irq_latency
+{
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+};
+
+/**
+ * @brief Per-vector hardware interrupt statistics \struct irq_vector_stats
+ * @details latency is measured from the IRQ entry stub to the handler
+ *          chain, handler cycles cover the whole chain.
+ */
+struct irq_vector_stats
+{
+    uint32_t count;
+    uint32_t unhandled;
+    uint32_t max_latency;
+    uint32_t max_handler_cycles;
+    uint64_t handler_cycles;
+};
+
+/**
+ * @brief Switch between 8259 PIC and local APIC interrupt delivery
+ * @details Selects how irq_handler acknowledges interrupts. Switching to
+ *          IRQ_MODE_APIC masks every line of both PICs; the I/O APIC must
+ *          already route the ISA IRQs.
+ * @param mode IRQ_MODE_PIC or IRQ_MODE_APIC
+ */
+void irq_set_mode(uint8_t mode);
+
+/**
+ * @brief Mask an ISA IRQ line at the active interrupt controller
+ * @param irq ISA IRQ number (0-15)
+ */
+void irq_mask_line(uint8_t irq);
+
+/**
+ * @brief Unmask an ISA IRQ line at the active interrupt controller
+ * @param irq ISA IRQ number (0-15)
+ */
+void irq_unmask_line(uint8_t irq);
+
+/**
+ * @brief Get the current interrupt controller mode
+ * @return IRQ_MODE_PIC or IRQ_MODE_APIC
+ */
+uint8_t irq_get_mode(void);
+
+/**
+ * @brief Get the interrupt latency recorded while in a controller mode
+ * @param mode IRQ_MODE_PIC or IRQ_MODE_APIC
+ * @param out Pointer to store the statistics
+ */
+void irq_get_latency(uint8_t mode, struct irq_latency* out);
+
+/**
+ * @brief Measure the cost of one end-of-interrupt for a controller
+ * @details Issues a batch of EOIs with no interrupt in service, which both
+ *          controllers ignore, and times them with the TSC.
+ * @param mode IRQ_MODE_PIC or IRQ_MODE_APIC
+ * @return Average cycles per EOI, 0 if the controller is not available
+ */
+uint32_t irq_measure_eoi(uint8_t mode);
+
+/**
+ * @brief Load the IDT on the calling CPU
+ * @details Application processors share the table built by idt_init.
+ */
+void idt_load(void);
+
 /**
  * @brief Register an interrupt handler
  * @param n The interrupt number
@@ -59,6 +160,50 @@ void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
  */
 void register_interrupt_handler(uint8_t n, isr_handler_t handler);
 
+/**
+ * @brief Add a handler to the chain of a hardware interrupt vector
+ * @details Every handler on the chain runs for each interrupt, so devices
+ *          sharing a legacy line can each check their own status.
+ * @param vector Interrupt vector, 32 or above
+ * @param handler The handler function
+ * @param dev_id Cookie passed to the handler and used by free_irq
+ * @param name Short device name shown by irqstat
+ * @return 0 on success, -1 if the vector is invalid, the cookie is already
+ *         registered on it, or all action slots are in use
+ */
+int request_irq(uint8_t vector, irq_handler_t handler, void* dev_id, const char* name);
+
+/**
+ * @brief Remove a handler registered with request_irq
+ * @details Waits for handlers of the vector still running on other CPUs,
+ *          so it must not be called from the handler itself.
+ * @param vector Interrupt vector
+ * @param dev_id Cookie given to request_irq
+ * @return 0 on success, -1 if no handler with that cookie is registered
+ */
+int free_irq(uint8_t vector, const void* dev_id);
+
+/**
+ * @brief Get the number of handlers chained on a vector
+ * @param vector Interrupt vector
+ * @return Number of registered handlers
+ */
+uint32_t irq_get_action_count(uint8_t vector);
+
+/**
+ * @brief Get the name of the first handler chained on a vector
+ * @param vector Interrupt vector
+ * @return Device name, or NULL if no handler is registered
+ */
+const char* irq_get_name(uint8_t vector);
+
+/**
+ * @brief Get the statistics of a hardware interrupt vector
+ * @param vector Interrupt vector
+ * @param out Pointer to store the statistics
+ */
+void irq_get_vector_stats(uint8_t vector, struct irq_vector_stats* out);
+
 /**
  * @brief ISR handler called from assembly
  */
@@ -114,11 +259,16 @@ extern void irq12(void);
 extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
+extern void irq16(void);
 
 /**
  * @brief Syscall ISR handler called from assembly
  */
 extern void isr128(void);
+extern void isr240(void);
+extern void isr241(void);
+extern void isr242(void);
+extern void isr255(void);
 
 /**
  * @brief Load the IDT
@@ -77,6 +77,7 @@ IRQ 12, 44
 IRQ 13, 45
 IRQ 14, 46
 IRQ 15, 47
+IRQ 16, 48
 
 .global isr128
 isr128:
@@ -85,8 +86,36 @@ isr128:
     push $128
     jmp isr_common_stub
 
+# inter-processor interrupts and the local APIC spurious vector
+ISR_NOERRCODE 240
+ISR_NOERRCODE 241
+ISR_NOERRCODE 242
+ISR_NOERRCODE 255
+
+# GS holds the per-CPU segment in the kernel; its selector follows this
+# CPU's TSS selector in the GDT
+.macro LOAD_PERCPU_GS
+    str %ax
+    add $8, %ax
+    mov %ax, %gs
+.endm
+
+# restore the interrupted data segments; GS only goes back to the saved
+# selector when returning to user mode
+.macro RESTORE_SEGMENTS
+    pop %eax
+    mov %ax, %ds
+    mov %ax, %es
+    mov %ax, %fs
+    test $3, %al
+    jz 1f
+    mov %ax, %gs
+1:
+.endm
+
 .extern isr_handler
 .extern irq_handler
+.extern sched_preempt_irq
 
 isr_common_stub:
     pusha
@@ -96,17 +125,16 @@ isr_common_stub:
     mov %ax, %ds
     mov %ax, %es
     mov %ax, %fs
-    mov %ax, %gs
+    LOAD_PERCPU_GS
 
     push %esp
     call isr_handler
     add $4, %esp
 
-    pop %eax
-    mov %ax, %ds
-    mov %ax, %es
-    mov %ax, %fs
-    mov %ax, %gs
+    # single reschedule point on interrupt/syscall return
+    call sched_preempt_irq
+
+    RESTORE_SEGMENTS
     popa
     add $8, %esp
     iret
@@ -119,17 +147,21 @@ irq_common_stub:
     mov %ax, %ds
     mov %ax, %es
     mov %ax, %fs
-    mov %ax, %gs
+    LOAD_PERCPU_GS
+
+    # entry timestamp for the IRQ latency statistics (cpu->irq_entry_tsc)
+    rdtsc
+    mov %eax, %gs:4
+    mov %edx, %gs:8
 
     push %esp
     call irq_handler
     add $4, %esp
 
-    pop %eax
-    mov %ax, %ds
-    mov %ax, %es
-    mov %ax, %fs
-    mov %ax, %gs
+    # single reschedule point on interrupt/syscall return
+    call sched_preempt_irq
+
+    RESTORE_SEGMENTS
     popa
     add $8, %esp
     iret
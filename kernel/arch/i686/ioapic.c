@@ -0,0 +1,145 @@
+#include "ioapic.h"
+#include "../../mm/vmm.h"
+#include "../../drivers/bus/acpi.h"
+#include "../../lib/log.h"
+#include "../include/cast.h"
+
+#define IOAPIC_ISA_IRQS 16
+
+static volatile uint32_t* ioapic_base = NULL;
+static uint32_t ioapic_gsi_base = 0;
+static uint32_t ioapic_inputs = 0;
+
+static uint32_t ioapic_read(const uint8_t reg)
+{
+    ioapic_base[IOAPIC_REGSEL / 4] = reg;
+    return ioapic_base[IOAPIC_WINDOW / 4];
+}
+
+static void ioapic_write(const uint8_t reg, const uint32_t value)
+{
+    ioapic_base[IOAPIC_REGSEL / 4] = reg;
+    ioapic_base[IOAPIC_WINDOW / 4] = value;
+}
+
+static bool ioapic_pin(const uint8_t irq, uint32_t* pin)
+{
+    uint32_t gsi;
+    acpi_get_irq_override(irq, &gsi, NULL);
+    if (gsi < ioapic_gsi_base || gsi - ioapic_gsi_base >= ioapic_inputs)
+    {
+        return false;
+    }
+    *pin = gsi - ioapic_gsi_base;
+    return true;
+}
+
+static void ioapic_set_entry(const uint32_t pin, const uint32_t low, const uint32_t high)
+{
+    // write the high half first so the entry never fires half-programmed
+    ioapic_write((uint8_t)(IOAPIC_REG_REDTBL + pin * 2 + 1), high);
+    ioapic_write((uint8_t)(IOAPIC_REG_REDTBL + pin * 2), low);
+}
+
+bool ioapic_init(const uint32_t phys_base, const uint32_t gsi_base)
+{
+    if (phys_base == 0)
+    {
+        return false;
+    }
+
+    vmm_map_page(vmm_get_kernel_directory(), phys_base, phys_base,
+                 PAGE_PRESENT | PAGE_WRITE | PAGE_CACHE_DISABLE);
+    ioapic_base = PTR_FROM_U32_TYPED(volatile uint32_t, phys_base);
+    ioapic_gsi_base = gsi_base;
+
+    const uint32_t version = ioapic_read(IOAPIC_REG_VERSION);
+    if (version == 0xFFFFFFFF)
+    {
+        ioapic_base = NULL;
+        log_warn("IOAPIC: No I/O APIC responding");
+        return false;
+    }
+    ioapic_inputs = ((version >> 16) & 0xFF) + 1;
+
+    for (uint32_t pin = 0; pin < ioapic_inputs; pin++)
+    {
+        ioapic_set_entry(pin, IOAPIC_RED_MASKED, 0);
+    }
+
+    log_info_fmt("IOAPIC: Enabled at 0x%x, %d inputs from GSI %d",
+                 phys_base, ioapic_inputs, gsi_base);
+    return true;
+}
+
+bool ioapic_is_enabled(void)
+{
+    return ioapic_base != NULL;
+}
+
+void ioapic_route_isa_irqs(const uint8_t base_vector, const uint8_t dest_apic_id)
+{
+    if (!ioapic_base)
+    {
+        return;
+    }
+
+    for (uint8_t irq = 0; irq < IOAPIC_ISA_IRQS; irq++)
+    {
+        uint32_t gsi;
+        uint16_t flags;
+        acpi_get_irq_override(irq, &gsi, &flags);
+
+        // the cascade input has no device behind it
+        if (irq == 2 && gsi == 2)
+        {
+            continue;
+        }
+
+        uint32_t pin;
+        if (!ioapic_pin(irq, &pin))
+        {
+            continue;
+        }
+
+        uint32_t low = (uint32_t)(base_vector + irq);
+        if ((flags & ACPI_INT_POLARITY_MASK) == ACPI_INT_POLARITY_LOW)
+        {
+            low |= IOAPIC_RED_ACTIVE_LOW;
+        }
+        if ((flags & ACPI_INT_TRIGGER_MASK) == ACPI_INT_TRIGGER_LEVEL)
+        {
+            low |= IOAPIC_RED_LEVEL;
+        }
+        ioapic_set_entry(pin, low, (uint32_t)dest_apic_id << 24);
+    }
+}
+
+static void ioapic_set_mask(const uint8_t irq, const bool masked)
+{
+    uint32_t pin;
+    if (!ioapic_base || !ioapic_pin(irq, &pin))
+    {
+        return;
+    }
+
+    const uint8_t reg = (uint8_t)(IOAPIC_REG_REDTBL + pin * 2);
+    uint32_t low = ioapic_read(reg);
+    low = masked ? (low | IOAPIC_RED_MASKED) : (low & ~IOAPIC_RED_MASKED);
+    ioapic_write(reg, low);
+}
+
+void ioapic_mask_irq(const uint8_t irq)
+{
+    ioapic_set_mask(irq, true);
+}
+
+void ioapic_unmask_irq(const uint8_t irq)
+{
+    ioapic_set_mask(irq, false);
+}
+
+uint32_t ioapic_get_input_count(void)
+{
+    return ioapic_inputs;
+}
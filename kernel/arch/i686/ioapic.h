@@ -0,0 +1,76 @@
+#ifndef KERNEL_IOAPIC_H
+#define KERNEL_IOAPIC_H
+
+#include "../../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief I/O APIC register select and data window offsets
+ */
+#define IOAPIC_REGSEL       0x00
+#define IOAPIC_WINDOW       0x10
+
+/**
+ * @brief I/O APIC registers
+ */
+#define IOAPIC_REG_ID       0x00
+#define IOAPIC_REG_VERSION  0x01
+#define IOAPIC_REG_REDTBL   0x10
+
+/**
+ * @brief Redirection entry bits
+ */
+#define IOAPIC_RED_ACTIVE_LOW  0x00002000
+#define IOAPIC_RED_LEVEL       0x00008000
+#define IOAPIC_RED_MASKED      0x00010000
+
+/**
+ * @brief Map the I/O APIC and mask all of its inputs
+ * @param phys_base Physical MMIO base from the MADT
+ * @param gsi_base First global system interrupt served by this I/O APIC
+ * @return true if an I/O APIC was found at phys_base
+ */
+bool ioapic_init(uint32_t phys_base, uint32_t gsi_base);
+
+/**
+ * @brief Check whether the I/O APIC is in use
+ * @return true once ioapic_init succeeded
+ */
+bool ioapic_is_enabled(void);
+
+/**
+ * @brief Route the legacy ISA IRQs to vectors base_vector + irq
+ * @details Honors the MADT interrupt source overrides (e.g. the PIT on
+ *          GSI 2) and their polarity/trigger flags. All routes target the
+ *          local APIC given by dest_apic_id and start unmasked.
+ * @param base_vector Vector of ISA IRQ 0
+ * @param dest_apic_id Local APIC ID that receives the interrupts
+ */
+void ioapic_route_isa_irqs(uint8_t base_vector, uint8_t dest_apic_id);
+
+/**
+ * @brief Mask an ISA IRQ at the I/O APIC
+ * @param irq ISA IRQ number (0-15)
+ */
+void ioapic_mask_irq(uint8_t irq);
+
+/**
+ * @brief Unmask an ISA IRQ at the I/O APIC
+ * @param irq ISA IRQ number (0-15)
+ */
+void ioapic_unmask_irq(uint8_t irq);
+
+/**
+ * @brief Get the number of redirection entries
+ * @return Number of inputs of the I/O APIC, 0 if not initialized
+ */
+uint32_t ioapic_get_input_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
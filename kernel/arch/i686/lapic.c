@@ -0,0 +1,279 @@
+#include "lapic.h"
+#include "arch.h"
+#include "idt.h"
+#include "smp.h"
+#include "../../mm/vmm.h"
+#include "../../lib/log.h"
+#include "../../sys/timer.h"
+#include "../../sys/clock.h"
+#include "../include/cast.h"
+
+#define CPUID_FEAT_EDX_APIC (1u << 9)
+#define CPUID_FEAT_ECX_TSC_DEADLINE (1u << 24)
+#define LAPIC_CALIBRATE_TICKS 5
+
+static volatile uint32_t* lapic_base = NULL;
+static uint32_t timer_counts_per_tick = 0;
+static uint64_t timer_tsc_per_tick = 0;
+static bool timer_deadline = false;
+static uint32_t oneshot_count = 0;
+static uint64_t oneshot_start_tsc = 0;
+
+uint32_t lapic_read(const uint32_t reg)
+{
+    return lapic_base[reg / 4];
+}
+
+void lapic_write(const uint32_t reg, const uint32_t value)
+{
+    lapic_base[reg / 4] = value;
+}
+
+static void lapic_spurious_handler(struct registers* regs)
+{
+    (void)regs;
+    // spurious interrupts must not be acknowledged
+}
+
+static void lapic_enable(void)
+{
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_VECTOR_SPURIOUS);
+    lapic_eoi();
+}
+
+bool lapic_init(const uint32_t phys_base)
+{
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_FEAT_EDX_APIC))
+    {
+        log_warn("LAPIC: CPU has no local APIC");
+        return false;
+    }
+
+    const uint32_t base = phys_base ? phys_base : LAPIC_DEFAULT_BASE;
+    vmm_map_page(vmm_get_kernel_directory(), base, base, PAGE_PRESENT | PAGE_WRITE | PAGE_CACHE_DISABLE);
+    lapic_base = PTR_FROM_U32_TYPED(volatile uint32_t, base);
+
+    register_interrupt_handler(LAPIC_VECTOR_SPURIOUS, lapic_spurious_handler);
+    lapic_enable();
+
+    log_info_fmt("LAPIC: Enabled at 0x%x, ID %d, version 0x%x",
+                 base, lapic_get_id(), lapic_read(LAPIC_REG_VERSION) & 0xFF);
+    return true;
+}
+
+void lapic_init_ap(void)
+{
+    if (lapic_base)
+    {
+        lapic_enable();
+    }
+}
+
+bool lapic_is_enabled(void)
+{
+    return lapic_base != NULL;
+}
+
+uint8_t lapic_get_id(void)
+{
+    return lapic_base ? (uint8_t)(lapic_read(LAPIC_REG_ID) >> 24) : 0;
+}
+
+void lapic_eoi(void)
+{
+    if (lapic_base)
+    {
+        lapic_write(LAPIC_REG_EOI, 0);
+    }
+}
+
+static void lapic_wait_icr(void)
+{
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)
+    {
+        __asm__ volatile ("pause");
+    }
+}
+
+static void lapic_send(const uint8_t apic_id, const uint32_t command)
+{
+    if (!lapic_base) return;
+
+    const uint32_t flags = read_eflags();
+    cli();
+    lapic_wait_icr();
+    lapic_write(LAPIC_REG_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, command);
+    lapic_wait_icr();
+    if (flags & 0x200)
+    {
+        sti();
+    }
+}
+
+void lapic_send_ipi(const uint8_t apic_id, const uint8_t vector)
+{
+    lapic_send(apic_id, LAPIC_ICR_ASSERT | vector);
+}
+
+void lapic_send_ipi_all_but_self(const uint8_t vector)
+{
+    lapic_send(0, LAPIC_ICR_ALL_BUT_SELF | LAPIC_ICR_ASSERT | vector);
+}
+
+void lapic_send_init(const uint8_t apic_id)
+{
+    lapic_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL | LAPIC_ICR_ASSERT);
+    lapic_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+}
+
+void lapic_send_startup(const uint8_t apic_id, const uint8_t page)
+{
+    lapic_send(apic_id, LAPIC_ICR_STARTUP | page);
+}
+
+bool lapic_timer_calibrate(const uint32_t hz)
+{
+    if (!lapic_base || hz == 0)
+    {
+        return false;
+    }
+
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if ((ecx & CPUID_FEAT_ECX_TSC_DEADLINE) && clock_get_source() == CLOCKSOURCE_TSC)
+    {
+        timer_deadline = true;
+        timer_tsc_per_tick = clock_get_frequency() / hz;
+        log_info_fmt("LAPIC: Timer in TSC-deadline mode, %d cycles per tick",
+                     (uint32_t)timer_tsc_per_tick);
+        return timer_tsc_per_tick != 0;
+    }
+
+    // count the divided bus clock across a few PIT ticks
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFF);
+    timer_delay(LAPIC_CALIBRATE_TICKS);
+    const uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    timer_deadline = false;
+    timer_counts_per_tick = elapsed / LAPIC_CALIBRATE_TICKS;
+    log_info_fmt("LAPIC: Timer calibrated, %d counts per tick", timer_counts_per_tick);
+    return timer_counts_per_tick != 0;
+}
+
+bool lapic_timer_is_deadline(void)
+{
+    return timer_deadline;
+}
+
+// the next tick is one period after the last deadline, so ticks do not drift
+// by the interrupt latency; a deadline still ahead was a cancelled one-shot,
+// and one more than a period behind would replay missed ticks back to back
+static void deadline_advance(void)
+{
+    struct cpu* c = this_cpu();
+    const uint64_t now = rdtsc();
+    uint64_t next = c->tsc_deadline + timer_tsc_per_tick;
+    if (c->tsc_deadline > now || next <= now)
+    {
+        next = now + timer_tsc_per_tick;
+    }
+    c->tsc_deadline = next;
+    wrmsr(MSR_IA32_TSC_DEADLINE, next);
+}
+
+void lapic_timer_periodic(void)
+{
+    if (timer_deadline)
+    {
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_DEADLINE | LAPIC_VECTOR_TIMER);
+        deadline_advance();
+        return;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_VECTOR_TIMER);
+    lapic_write(LAPIC_REG_TIMER_INIT, timer_counts_per_tick);
+}
+
+void lapic_timer_rearm(void)
+{
+    if (timer_deadline)
+    {
+        deadline_advance();
+    }
+}
+
+void lapic_timer_oneshot(const uint32_t ticks)
+{
+    oneshot_start_tsc = rdtsc();
+    if (timer_deadline)
+    {
+        this_cpu()->tsc_deadline = oneshot_start_tsc + (uint64_t)ticks * timer_tsc_per_tick;
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_DEADLINE | LAPIC_VECTOR_TIMER);
+        wrmsr(MSR_IA32_TSC_DEADLINE, this_cpu()->tsc_deadline);
+        return;
+    }
+
+    oneshot_count = ticks * timer_counts_per_tick;
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_ONESHOT | LAPIC_VECTOR_TIMER);
+    lapic_write(LAPIC_REG_TIMER_INIT, oneshot_count);
+}
+
+uint32_t lapic_timer_elapsed(uint32_t* rest)
+{
+    if (timer_deadline)
+    {
+        const uint64_t elapsed = rdtsc() - oneshot_start_tsc;
+        const uint64_t part = elapsed % timer_tsc_per_tick;
+        *rest = part ? (uint32_t)(timer_tsc_per_tick - part) : 0;
+        return (uint32_t)(elapsed / timer_tsc_per_tick);
+    }
+
+    const uint32_t remaining = lapic_read(LAPIC_REG_TIMER_CUR);
+    const uint32_t elapsed = remaining < oneshot_count ? oneshot_count - remaining : oneshot_count;
+    const uint32_t part = elapsed % timer_counts_per_tick;
+    *rest = part ? timer_counts_per_tick - part : 0;
+    return elapsed / timer_counts_per_tick;
+}
+
+void lapic_timer_oneshot_rest(const uint32_t rest)
+{
+    if (timer_deadline)
+    {
+        this_cpu()->tsc_deadline = rdtsc() + rest;
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_DEADLINE | LAPIC_VECTOR_TIMER);
+        wrmsr(MSR_IA32_TSC_DEADLINE, this_cpu()->tsc_deadline);
+        return;
+    }
+
+    oneshot_count = rest;
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_ONESHOT | LAPIC_VECTOR_TIMER);
+    lapic_write(LAPIC_REG_TIMER_INIT, rest);
+}
+
+uint32_t lapic_timer_max_ticks(void)
+{
+    if (timer_deadline)
+    {
+        return 0xFFFF;
+    }
+    return timer_counts_per_tick ? 0xFFFFFFFF / timer_counts_per_tick : 1;
+}
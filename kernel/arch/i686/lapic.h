@@ -0,0 +1,188 @@
+#ifndef KERNEL_LAPIC_H
+#define KERNEL_LAPIC_H
+
+#include "../../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Default local APIC physical base
+ */
+#define LAPIC_DEFAULT_BASE 0xFEE00000
+
+/**
+ * @brief Local APIC register offsets
+ */
+#define LAPIC_REG_ID        0x020
+#define LAPIC_REG_VERSION   0x030
+#define LAPIC_REG_TPR       0x080
+#define LAPIC_REG_EOI       0x0B0
+#define LAPIC_REG_SVR       0x0F0
+#define LAPIC_REG_ESR       0x280
+#define LAPIC_REG_ICR_LOW   0x300
+#define LAPIC_REG_ICR_HIGH  0x310
+#define LAPIC_REG_LVT_TIMER 0x320
+#define LAPIC_REG_LVT_LINT0 0x350
+#define LAPIC_REG_LVT_LINT1 0x360
+#define LAPIC_REG_LVT_ERROR 0x370
+#define LAPIC_REG_TIMER_INIT 0x380
+#define LAPIC_REG_TIMER_CUR  0x390
+#define LAPIC_REG_TIMER_DIV  0x3E0
+
+#define LAPIC_SVR_ENABLE    0x100
+#define LAPIC_LVT_MASKED    0x10000
+#define LAPIC_TIMER_ONESHOT  0x00000
+#define LAPIC_TIMER_PERIODIC 0x20000
+#define LAPIC_TIMER_DEADLINE 0x40000
+#define LAPIC_TIMER_DIV_16   0x3
+
+#define MSR_IA32_TSC_DEADLINE 0x6E0
+
+#define LAPIC_ICR_INIT        0x00000500
+#define LAPIC_ICR_STARTUP     0x00000600
+#define LAPIC_ICR_PENDING     0x00001000
+#define LAPIC_ICR_ASSERT      0x00004000
+#define LAPIC_ICR_LEVEL       0x00008000
+#define LAPIC_ICR_ALL_BUT_SELF 0x000C0000
+
+/**
+ * @brief Interrupt vectors owned by the local APIC
+ */
+#define LAPIC_VECTOR_TIMER    0x30
+#define LAPIC_VECTOR_RESCHED  0xF0
+#define LAPIC_VECTOR_TICK     0xF1
+#define LAPIC_VECTOR_TLB      0xF2
+#define LAPIC_VECTOR_SPURIOUS 0xFF
+
+/**
+ * @brief Map and enable the local APIC of the boot processor
+ * @param phys_base Physical MMIO base from the MADT, or 0 for the default
+ * @return true if the CPU has an APIC and it was enabled
+ */
+bool lapic_init(uint32_t phys_base);
+
+/**
+ * @brief Enable the local APIC of an application processor
+ */
+void lapic_init_ap(void);
+
+/**
+ * @brief Check whether the local APIC is in use
+ * @return true once lapic_init succeeded
+ */
+bool lapic_is_enabled(void);
+
+/**
+ * @brief Get the APIC ID of the calling CPU
+ * @return The local APIC ID
+ */
+uint8_t lapic_get_id(void);
+
+/**
+ * @brief Signal end of interrupt to the local APIC
+ */
+void lapic_eoi(void);
+
+/**
+ * @brief Send a fixed interrupt to another CPU
+ * @param apic_id Destination APIC ID
+ * @param vector Interrupt vector
+ */
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+
+/**
+ * @brief Send a fixed interrupt to every CPU except the caller
+ * @param vector Interrupt vector
+ */
+void lapic_send_ipi_all_but_self(uint8_t vector);
+
+/**
+ * @brief Send an INIT IPI to reset an application processor
+ * @param apic_id Destination APIC ID
+ */
+void lapic_send_init(uint8_t apic_id);
+
+/**
+ * @brief Send a STARTUP IPI pointing at a real-mode trampoline
+ * @param apic_id Destination APIC ID
+ * @param page Physical page number of the trampoline (address >> 12)
+ */
+void lapic_send_startup(uint8_t apic_id, uint8_t page);
+
+/**
+ * @brief Calibrate the local APIC timer against the PIT
+ * @details Picks TSC-deadline mode when the CPU supports it and the TSC is
+ *          the calibrated clocksource, otherwise the divided bus clock.
+ * @param hz Tick frequency the timer will run at; the PIT must already run
+ *           at the same rate for timer_delay
+ * @return true if the timer can be used as tick source
+ */
+bool lapic_timer_calibrate(uint32_t hz);
+
+/**
+ * @brief Check whether the local APIC timer uses TSC-deadline mode
+ * @return true in TSC-deadline mode
+ */
+bool lapic_timer_is_deadline(void);
+
+/**
+ * @brief Start periodic ticks on the calling CPU
+ */
+void lapic_timer_periodic(void);
+
+/**
+ * @brief Re-arm the next periodic tick
+ * @details Needed after each tick in TSC-deadline mode, a no-op otherwise.
+ *          The new deadline is one period after the last one, or one
+ *          period from now if that has already passed.
+ */
+void lapic_timer_rearm(void);
+
+/**
+ * @brief Fire once after a number of ticks on the calling CPU
+ * @param ticks Ticks until the interrupt, at most lapic_timer_max_ticks()
+ */
+void lapic_timer_oneshot(uint32_t ticks);
+
+/**
+ * @brief Get the ticks elapsed since lapic_timer_oneshot armed the timer
+ * @param rest Set to the timer units left until the next whole tick, 0 if
+ *        the timer stopped on a tick boundary
+ * @return Whole ticks elapsed
+ */
+uint32_t lapic_timer_elapsed(uint32_t* rest);
+
+/**
+ * @brief Fire once at the end of a tick cut short by an early wake
+ * @param rest Timer units left in the tick, as reported by
+ *        lapic_timer_elapsed
+ */
+void lapic_timer_oneshot_rest(uint32_t rest);
+
+/**
+ * @brief Get the longest one-shot period
+ * @return Maximum ticks for lapic_timer_oneshot
+ */
+uint32_t lapic_timer_max_ticks(void);
+
+/**
+ * @brief Read a local APIC register
+ * @param reg Register offset
+ * @return Register value
+ */
+uint32_t lapic_read(uint32_t reg);
+
+/**
+ * @brief Write a local APIC register
+ * @param reg Register offset
+ * @param value Value to write
+ */
+void lapic_write(uint32_t reg, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
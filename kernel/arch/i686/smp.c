@@ -0,0 +1,297 @@
+#include "smp.h"
+#include "lapic.h"
+#include "gdt.h"
+#include "idt.h"
+#include "arch.h"
+#include "../../drivers/bus/acpi.h"
+#include "../../sched/sched.h"
+#include "../../mm/stack.h"
+#include "../../sys/timer.h"
+#include "../../lib/log.h"
+#include "../include/spinlock.h"
+#include "../include/string.h"
+#include "../include/cast.h"
+
+#define AP_STARTUP_TIMEOUT_TICKS 10
+
+_Static_assert(__builtin_offsetof(struct cpu, irq_entry_tsc) == CPU_IRQ_ENTRY_TSC,
+               "idt_asm.s stamps irq_entry_tsc at a fixed offset");
+
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+extern uint8_t ap_trampoline_cr3[];
+extern uint8_t ap_trampoline_stack[];
+extern uint8_t ap_trampoline_entry[];
+
+static struct cpu cpus[MAX_CPUS];
+static volatile uint32_t online_count = 0;
+static volatile bool ap_released = false;
+static struct cpu* volatile ap_booting = NULL;
+
+// one shootdown at a time; tlb_acks counts the CPUs yet to flush
+static spinlock_t tlb_lock = SPINLOCK_INIT;
+static volatile uint32_t tlb_acks = 0;
+
+static void resched_ipi_handler(struct registers* regs)
+{
+    (void)regs;
+    struct cpu* c = this_cpu();
+    c->ipis++;
+    sched_set_need_resched();
+    lapic_eoi();
+}
+
+static void tick_ipi_handler(struct registers* regs)
+{
+    (void)regs;
+    sched_tick();
+    lapic_eoi();
+}
+
+// answers a shootdown request raised by another CPU, if there is one
+static void tlb_flush_local(struct cpu* c)
+{
+    if (c->tlb_flush)
+    {
+        c->tlb_flush = false;
+        write_cr3(read_cr3());
+        __sync_fetch_and_sub(&tlb_acks, 1);
+    }
+}
+
+static void tlb_ipi_handler(struct registers* regs)
+{
+    (void)regs;
+    tlb_flush_local(this_cpu());
+    lapic_eoi();
+}
+
+void smp_early_init(void)
+{
+    memset(cpus, 0, sizeof(cpus));
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        cpus[i].self = &cpus[i];
+        cpus[i].id = i;
+        spin_init(&cpus[i].rq_lock);
+    }
+
+    cpus[0].online = true;
+    online_count = 1;
+    gdt_init_cpu(0, PTR_TO_U32(&cpus[0]));
+}
+
+/*
+ * First C code on an application processor, entered from the trampoline
+ * with paging on and the boot stack the BSP handed over.
+ */
+static void ap_entry(void)
+{
+    struct cpu* c = ap_booting;
+
+    gdt_init_cpu(c->id, PTR_TO_U32(c));
+    idt_load();
+    lapic_init_ap();
+    timer_init_ap();
+
+    __sync_fetch_and_add(&online_count, 1);
+    c->online = true;
+
+    while (!ap_released)
+    {
+        __asm__ volatile ("pause");
+    }
+
+    sched_start_cpu();
+}
+
+static void trampoline_set(const uint8_t* field, const uint32_t value)
+{
+    const uint32_t offset = PTR_TO_U32(field) - PTR_TO_U32(ap_trampoline_start);
+    *(volatile uint32_t*)PTR_FROM_U32(AP_TRAMPOLINE_BASE + offset) = value;
+}
+
+static bool wait_online(const struct cpu* c)
+{
+    for (uint32_t i = 0; i < AP_STARTUP_TIMEOUT_TICKS && !c->online; i++)
+    {
+        timer_delay(1);
+    }
+    return c->online;
+}
+
+static bool start_ap(struct cpu* c)
+{
+    const uint32_t stack = stack_alloc(STACK_KERNEL);
+    if (!stack)
+    {
+        return false;
+    }
+    c->kernel_stack = stack;
+
+    trampoline_set(ap_trampoline_cr3, read_cr3());
+    trampoline_set(ap_trampoline_stack, stack + KERNEL_STACK_SIZE);
+    trampoline_set(ap_trampoline_entry, FUNC_PTR_TO_U32(ap_entry));
+    ap_booting = c;
+
+    // INIT-SIPI-SIPI; the second STARTUP is only needed if the first is missed
+    lapic_send_init(c->apic_id);
+    timer_delay(1);
+    lapic_send_startup(c->apic_id, (uint8_t)(AP_TRAMPOLINE_BASE >> 12));
+    if (wait_online(c))
+    {
+        return true;
+    }
+    lapic_send_startup(c->apic_id, (uint8_t)(AP_TRAMPOLINE_BASE >> 12));
+    return wait_online(c);
+}
+
+uint32_t smp_init(void (*idle_entry)(void))
+{
+    if (!lapic_is_enabled())
+    {
+        log_info("SMP: No local APIC, running on the boot CPU only");
+        return 1;
+    }
+
+    register_interrupt_handler(LAPIC_VECTOR_RESCHED, resched_ipi_handler);
+    register_interrupt_handler(LAPIC_VECTOR_TICK, tick_ipi_handler);
+    register_interrupt_handler(LAPIC_VECTOR_TLB, tlb_ipi_handler);
+
+    const uint8_t bsp_apic_id = lapic_get_id();
+    cpus[0].apic_id = bsp_apic_id;
+
+    const uint32_t trampoline_size = PTR_TO_U32(ap_trampoline_end) - PTR_TO_U32(ap_trampoline_start);
+    memcpy(PTR_FROM_U32(AP_TRAMPOLINE_BASE), ap_trampoline_start, trampoline_size);
+
+    uint32_t next_id = 1;
+    const uint32_t madt_count = acpi_get_cpu_count();
+    for (uint32_t i = 0; i < madt_count && next_id < MAX_CPUS; i++)
+    {
+        const uint8_t apic_id = acpi_get_cpu_apic_id(i);
+        if (apic_id == bsp_apic_id || apic_id == 0xFF)
+        {
+            continue;
+        }
+
+        struct cpu* c = &cpus[next_id];
+        c->apic_id = apic_id;
+
+        struct task* idle = task_create(idle_entry, 0, true);
+        if (!idle)
+        {
+            log_warn("SMP: Out of tasks for idle threads");
+            break;
+        }
+        sched_set_idle_task(c->id, idle);
+
+        if (!start_ap(c))
+        {
+            log_warn_fmt("SMP: CPU with APIC ID %d did not start", apic_id);
+            task_destroy(idle->id);
+            c->idle = NULL;
+            continue;
+        }
+
+        log_info_fmt("SMP: CPU %d online (APIC ID %d)", c->id, apic_id);
+        next_id++;
+    }
+
+    ap_booting = NULL;
+    log_info_fmt("SMP: %d CPUs online", online_count);
+    return online_count;
+}
+
+void smp_release(void)
+{
+    ap_released = true;
+}
+
+struct cpu* smp_get_cpu(const uint32_t id)
+{
+    return id < MAX_CPUS ? &cpus[id] : NULL;
+}
+
+uint32_t smp_get_online_count(void)
+{
+    return online_count;
+}
+
+void smp_send_resched(const uint32_t id)
+{
+    struct cpu* self = this_cpu();
+    if (id == self->id)
+    {
+        sched_set_need_resched();
+        return;
+    }
+
+    const struct cpu* c = smp_get_cpu(id);
+    if (c && c->online)
+    {
+        lapic_send_ipi(c->apic_id, LAPIC_VECTOR_RESCHED);
+    }
+}
+
+void smp_broadcast_tick(void)
+{
+    if (online_count < 2)
+    {
+        return;
+    }
+
+    const uint32_t self = this_cpu()->id;
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        if (i != self && cpus[i].online)
+        {
+            lapic_send_ipi(cpus[i].apic_id, LAPIC_VECTOR_TICK);
+        }
+    }
+}
+
+void smp_flush_tlb(void)
+{
+    write_cr3(read_cr3());
+    if (online_count < 2)
+    {
+        return;
+    }
+
+    preempt_disable();
+    struct cpu* self = this_cpu();
+
+    // a CPU waiting for the lock may itself be the target of the holder
+    while (!spin_trylock(&tlb_lock))
+    {
+        tlb_flush_local(self);
+        __asm__ volatile ("pause");
+    }
+
+    // the count is set before any flag, a polling target may ack at once
+    uint32_t targets = 0;
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        if (i != self->id && cpus[i].online)
+        {
+            targets++;
+        }
+    }
+    tlb_acks = targets;
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        if (i != self->id && cpus[i].online)
+        {
+            cpus[i].tlb_flush = true;
+            lapic_send_ipi(cpus[i].apic_id, LAPIC_VECTOR_TLB);
+        }
+    }
+
+    while (tlb_acks)
+    {
+        __asm__ volatile ("pause");
+    }
+
+    spin_unlock(&tlb_lock);
+    preempt_enable();
+}
@@ -0,0 +1,126 @@
+#ifndef KERNEL_SMP_H
+#define KERNEL_SMP_H
+
+#include "../../include/types.h"
+#include "../../include/config.h"
+#include "../../include/spinlock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct task;
+struct tasklet;
+
+/**
+ * @brief Offset of irq_entry_tsc in struct cpu, used by the IRQ stubs
+ */
+#define CPU_IRQ_ENTRY_TSC 4
+
+/**
+ * @brief Per-CPU data, reached through the GS segment \struct cpu
+ *
+ * The first field points at the structure itself so this_cpu() is a
+ * single GS-relative load. irq_entry_tsc is stamped by the IRQ entry
+ * stub and must stay at offset CPU_IRQ_ENTRY_TSC. tsc_deadline is the last
+ * deadline programmed into the local APIC timer in TSC-deadline mode.
+ * rq_head lists the READY tasks queued on this CPU; rq_lock guards that
+ * list, the state of those tasks and current, and is held across a
+ * context switch on this CPU.
+ */
+struct cpu
+{
+    struct cpu* self;
+    uint64_t irq_entry_tsc;
+    uint32_t id;
+    uint8_t apic_id;
+    volatile bool online;
+    struct task* current;
+    struct task* idle;
+    struct task* prev;
+    uint32_t ticks;
+    uint32_t steals;
+    uint32_t ipis;
+    uint32_t kernel_stack;
+    uint32_t irq_depth;
+    volatile uint32_t softirq_pending;
+    bool in_softirq;
+    struct tasklet* tasklet_head;
+    struct tasklet* tasklet_tail;
+    volatile bool tlb_flush;
+    uint64_t tsc_deadline;
+    spinlock_t rq_lock;
+    struct task* rq_head;
+    volatile uint32_t rq_count;
+};
+
+/**
+ * @brief Get the per-CPU data of the calling CPU
+ * @return Pointer to this CPU's struct cpu
+ */
+static inline struct cpu* this_cpu(void)
+{
+    struct cpu* c;
+    __asm__ volatile ("movl %%gs:0, %0" : "=r"(c));
+    return c;
+}
+
+/**
+ * @brief Set up per-CPU data for the boot processor
+ *
+ * Must run right after gdt_init, before anything uses this_cpu().
+ */
+void smp_early_init(void);
+
+/**
+ * @brief Start all application processors listed in the MADT
+ *
+ * Each AP gets a pinned idle task running idle_entry. Started APs spin
+ * until the boot processor calls smp_release().
+ * @param idle_entry Entry point for the per-CPU idle tasks
+ * @return Number of CPUs online, including the boot processor
+ */
+uint32_t smp_init(void (*idle_entry)(void));
+
+/**
+ * @brief Let the started application processors enter the scheduler
+ */
+void smp_release(void);
+
+/**
+ * @brief Get the per-CPU data of a CPU
+ * @param id Logical CPU index
+ * @return Pointer to the struct cpu, or NULL if out of range
+ */
+struct cpu* smp_get_cpu(uint32_t id);
+
+/**
+ * @brief Get the number of CPUs that are online
+ * @return Online CPU count
+ */
+uint32_t smp_get_online_count(void);
+
+/**
+ * @brief Ask a CPU to reschedule
+ * @param id Logical CPU index; the call is local if it is the caller
+ */
+void smp_send_resched(uint32_t id);
+
+/**
+ * @brief Forward the scheduler tick to all other online CPUs
+ */
+void smp_broadcast_tick(void);
+
+/**
+ * @brief Flush the TLB of every online CPU
+ * @details Used after a mapping lost rights or moved to another frame. Waits
+ *          until all other CPUs have flushed. The caller must hold no
+ *          spinlocks, since the other CPUs have to take the IPI.
+ */
+void smp_flush_tlb(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
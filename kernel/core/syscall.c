@@ -3,7 +3,10 @@
 #include "../fs/fs.h"
 #include "../ui/vterm.h"
 #include "../sched/sched.h"
+#include "../sched/futex.h"
 #include "../ipc/ipc.h"
+#include "../ipc/channel.h"
+#include "../ipc/pipe.h"
 #include "../ui/console.h"
 #include "../drivers/input/keyboard.h"
 #include "../mm/vmm.h"
@@ -11,6 +14,9 @@
 #include "../include/string.h"
 #include "../include/config.h"
 #include "../drivers/char/rtc.h"
+#include "../sys/timer.h"
+#include "../sys/clock.h"
+#include "../sys/udrv.h"
 #include "../drivers/bus/acpi.h"
 #include "../drivers/bus/pci.h"
 #include "../drivers/video/vesa.h"
@@ -70,12 +76,32 @@ static int do_exec(const char* path)
     return 0;
 }
 
+// copies a port name, checking each page it touches is readable
+static int copy_port_name(char* dst, const uint32_t src)
+{
+    for (uint32_t i = 0; i < PORT_NAME_MAX; i++)
+    {
+        const char* c = CONST_CHAR_FROM_U32(src + i);
+        if ((i == 0 || ((src + i) & 0xFFF) == 0) && !vmm_check_user_ptr(c, 1, false))
+        {
+            return -1;
+        }
+        dst[i] = *c;
+        if (*c == '\0')
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
 int syscall_handler(const struct registers* regs)
 {
     const uint32_t syscall_num = regs->eax;
     const uint32_t arg1 = regs->ebx;
     const uint32_t arg2 = regs->ecx;
     const uint32_t arg3 = regs->edx;
+    const uint32_t arg4 = regs->esi;
 
     switch (syscall_num)
     {
@@ -84,9 +110,10 @@ int syscall_handler(const struct registers* regs)
             struct task* t = sched_get_current();
             if (t)
             {
-                task_exit(t->id, (int32_t)arg1);
+                const struct task* leader = task_find(t->pid);
+                task_exit(leader ? leader->id : t->id, (int32_t)arg1);
             }
-            schedule();
+            sched_set_need_resched();
             return 0;
         }
         case SYS_WRITE:
@@ -127,7 +154,7 @@ int syscall_handler(const struct registers* regs)
         }
         case SYS_YIELD:
         {
-            sched_yield();
+            sched_dl_yield();
             return 0;
         }
         case SYS_GETPID:
@@ -160,18 +187,36 @@ int syscall_handler(const struct registers* regs)
             if (!vmm_check_user_ptr(path, 1, false)) return -1;
             return do_exec(path);
         }
+        case SYS_CLOSE:
+        {
+            const struct task* t = sched_get_current();
+            return t ? pipe_close(t->pid, (int)arg1) : -1;
+        }
         case SYS_SEND:
         {
             const int port_id = (int)arg1;
-            struct message* msg = PTR_FROM_U32_TYPED(struct message, arg2);
-            if (!vmm_check_user_ptr(msg, sizeof(struct message), false)) return -1;
-            return msg_send(port_id, msg, arg3);
+            const struct message* user_msg = PTR_FROM_U32_TYPED(const struct message, arg2);
+            if (!vmm_check_user_ptr(user_msg, sizeof(struct message), false)) return -1;
+
+            // read once: another thread of the sender may rewrite the original
+            struct message msg;
+            memcpy(&msg, user_msg, sizeof(struct message));
+            if (arg3 & (IPC_MOVE | IPC_SHARE))
+            {
+                if (msg.page_count == 0 || msg.page_count > IPC_MAX_PAGES) return -1;
+                if (!vmm_check_user_ptr(PTR_FROM_U32(msg.page_addr), msg.page_count * PAGE_SIZE, false)) return -1;
+            }
+            return msg_send(port_id, &msg, arg3);
         }
         case SYS_RECV:
         {
             const int port_id = (int)arg1;
             struct message* msg = PTR_FROM_U32_TYPED(struct message, arg2);
             if (!vmm_check_user_ptr(msg, sizeof(struct message), true)) return -1;
+            // the window is unmapped by design, so only its bounds are checked
+            if (msg->page_count > IPC_MAX_PAGES) return -1;
+            if (msg->page_count && (msg->page_addr == 0 ||
+                                    msg->page_addr > KERNEL_VIRTUAL_BASE - msg->page_count * PAGE_SIZE)) return -1;
             return msg_receive(port_id, msg, arg3);
         }
         case SYS_PORT_CREATE:
@@ -181,6 +226,12 @@ int syscall_handler(const struct registers* regs)
         }
         case SYS_PORT_DESTROY:
         {
+            // only the owner may destroy a port, or its registry name
+            const struct task* t = sched_get_current();
+            if (!t || port_get_owner((int)arg1) != t->pid)
+            {
+                return -1;
+            }
             return port_destroy((int)arg1);
         }
         case SYS_IOCTL:
@@ -225,7 +276,9 @@ int syscall_handler(const struct registers* regs)
         {
             struct rtc_time* time = PTR_FROM_U32_TYPED(struct rtc_time, arg1);
             if (!vmm_check_user_ptr(time, sizeof(struct rtc_time), true)) return -1;
-            rtc_read_time(time);
+            struct timespec now;
+            clock_get_realtime(&now);
+            rtc_timestamp_to_time((uint32_t)now.tv_sec, time);
             return 0;
         }
         case SYS_SETTIME:
@@ -233,8 +286,275 @@ int syscall_handler(const struct registers* regs)
             struct rtc_time* time = PTR_FROM_U32_TYPED(struct rtc_time, arg1);
             if (!vmm_check_user_ptr(time, sizeof(struct rtc_time), false)) return -1;
             rtc_write_time(time);
+            clock_set_realtime(rtc_time_to_timestamp(time));
+            return 0;
+        }
+        case SYS_THREAD_CREATE:
+        {
+            const struct task* t = sched_get_current();
+            if (!t) return -1;
+            const struct task* thread = thread_create(arg1, arg2, t->base_priority);
+            return thread ? (int)thread->id : -1;
+        }
+        case SYS_THREAD_EXIT:
+        {
+            thread_exit((int32_t)arg1);
             return 0;
         }
+        case SYS_THREAD_JOIN:
+        {
+            int32_t status = 0;
+            const int result = thread_join((tid_t)arg1, &status);
+            if (result == 0 && arg2)
+            {
+                void* user_status_ptr = PTR_FROM_U32(arg2);
+                if (vmm_check_user_ptr(user_status_ptr, sizeof(int32_t), true))
+                {
+                    int32_t* p = PTR_FROM_U32_TYPED(int32_t, arg2);
+                    *p = status;
+                }
+            }
+            return result;
+        }
+        case SYS_GETTID:
+        {
+            const struct task* t = sched_get_current();
+            return t ? (int)t->id : -1;
+        }
+        case SYS_SLEEP:
+        {
+            timer_sleep_ms(arg1);
+            return 0;
+        }
+        case SYS_NANOSLEEP:
+        {
+            const struct timespec* req = PTR_FROM_U32_TYPED(const struct timespec, arg1);
+            if (!vmm_check_user_ptr(req, sizeof(struct timespec), false)) return -1;
+            if (req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000) return -1;
+
+            // round up to whole ticks so the task never wakes early
+            const uint32_t hz = timer_get_frequency();
+            const uint32_t ns_per_tick = 1000000000 / hz;
+            const uint64_t ticks = (uint64_t)req->tv_sec * hz +
+                                   ((uint32_t)req->tv_nsec + ns_per_tick - 1) / ns_per_tick;
+            timer_sleep(ticks > 0x7FFFFFFF ? 0x7FFFFFFF : (uint32_t)ticks);
+
+            if (arg2)
+            {
+                struct timespec* rem = PTR_FROM_U32_TYPED(struct timespec, arg2);
+                if (!vmm_check_user_ptr(rem, sizeof(struct timespec), true)) return -1;
+                rem->tv_sec = 0;
+                rem->tv_nsec = 0;
+            }
+            return 0;
+        }
+        case SYS_CLOCK_GETTIME:
+        {
+            struct timespec* ts = PTR_FROM_U32_TYPED(struct timespec, arg2);
+            if (!vmm_check_user_ptr(ts, sizeof(struct timespec), true)) return -1;
+            return clock_gettime(arg1, ts);
+        }
+        case SYS_SCHED_DEADLINE:
+        {
+            const struct task* t = sched_get_current();
+            return t ? sched_set_deadline(t->id, arg1, arg2, arg3) : -1;
+        }
+        case SYS_CALL:
+        {
+            struct message* msg = PTR_FROM_U32_TYPED(struct message, arg2);
+            struct message* reply = PTR_FROM_U32_TYPED(struct message, arg3);
+            if (!vmm_check_user_ptr(msg, sizeof(struct message), true)) return -1;
+            if (!vmm_check_user_ptr(reply, sizeof(struct message), true)) return -1;
+            return ipc_call((int)arg1, msg, reply);
+        }
+        case SYS_REPLY:
+        {
+            struct message* msg = PTR_FROM_U32_TYPED(struct message, arg2);
+            if (!vmm_check_user_ptr(msg, sizeof(struct message), false)) return -1;
+            return ipc_reply((int)arg1, msg);
+        }
+        case SYS_PORT_LIMITS:
+        {
+            const struct task* t = sched_get_current();
+            return t ? port_set_limits((int)arg1, arg2, arg3, t->pid) : -1;
+        }
+        case SYS_SEND_BATCH:
+        {
+            struct message* msgs = PTR_FROM_U32_TYPED(struct message, arg2);
+            if (arg3 == 0 || arg3 > IPC_BATCH_MAX) return -1;
+            if (!vmm_check_user_ptr(msgs, arg3 * sizeof(struct message), false)) return -1;
+            return msg_send_batch((int)arg1, msgs, arg3, arg4);
+        }
+        case SYS_RECV_BATCH:
+        {
+            struct message* msgs = PTR_FROM_U32_TYPED(struct message, arg2);
+            if (arg3 == 0 || arg3 > IPC_BATCH_MAX) return -1;
+            if (!vmm_check_user_ptr(msgs, arg3 * sizeof(struct message), true)) return -1;
+            return msg_receive_batch((int)arg1, msgs, arg3, arg4);
+        }
+        case SYS_PORTSET_CREATE:
+        {
+            const struct task* t = sched_get_current();
+            return t ? portset_create(t->pid) : -1;
+        }
+        case SYS_PORTSET_DESTROY:
+        {
+            const struct task* t = sched_get_current();
+            return t ? portset_destroy((int)arg1, t->pid) : -1;
+        }
+        case SYS_PORTSET_ADD:
+        {
+            const struct task* t = sched_get_current();
+            return t ? portset_add((int)arg1, (int)arg2, t->pid) : -1;
+        }
+        case SYS_PORTSET_REMOVE:
+        {
+            const struct task* t = sched_get_current();
+            return t ? portset_remove((int)arg1, (int)arg2, t->pid) : -1;
+        }
+        case SYS_PORT_WAIT:
+        {
+            int* ready = PTR_FROM_U32_TYPED(int, arg2);
+            if (arg3 == 0 || arg3 > MAX_PORTS) return -1;
+            if (!vmm_check_user_ptr(ready, arg3 * sizeof(int), true)) return -1;
+            const struct task* t = sched_get_current();
+            if (!t) return -1;
+            return portset_wait((int)arg1, ready, arg3, arg4, t->pid);
+        }
+        case SYS_NOTIFY:
+        {
+            return port_notify((int)arg1, arg2);
+        }
+        case SYS_CHAN_CREATE:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_create(t->pid, arg1, arg2) : -1;
+        }
+        case SYS_CHAN_MAP:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_map((int)arg1, arg2, t->pid) : -1;
+        }
+        case SYS_CHAN_UNMAP:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_unmap((int)arg1, arg2, t->pid) : -1;
+        }
+        case SYS_CHAN_DESTROY:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_destroy((int)arg1, t->pid) : -1;
+        }
+        case SYS_CHAN_WAIT:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_wait((int)arg1, arg2, arg3, arg4, t->pid) : -1;
+        }
+        case SYS_CHAN_WAKE:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_wake((int)arg1, arg2, t->pid) : -1;
+        }
+        case SYS_PORT_REGISTER:
+        {
+            char name[PORT_NAME_MAX];
+            const struct task* t = sched_get_current();
+            if (!t || copy_port_name(name, arg1) != 0) return -1;
+            return port_register(name, (int)arg2, t->pid);
+        }
+        case SYS_PORT_LOOKUP:
+        {
+            char name[PORT_NAME_MAX];
+            if (copy_port_name(name, arg1) != 0) return -1;
+            return port_lookup(name);
+        }
+        case SYS_PORT_UNREGISTER:
+        {
+            char name[PORT_NAME_MAX];
+            const struct task* t = sched_get_current();
+            if (!t || copy_port_name(name, arg1) != 0) return -1;
+            return port_unregister(name, t->pid);
+        }
+        case SYS_PIPE:
+        {
+            int* fds = PTR_FROM_U32_TYPED(int, arg1);
+            const struct task* t = sched_get_current();
+            if (!t || !vmm_check_user_ptr(fds, 2 * sizeof(int), true)) return -1;
+            return pipe_create(t->pid, fds, arg2);
+        }
+        case SYS_FD_READ:
+        {
+            // no call moves more than the pipe holds
+            const uint32_t len = arg3 > PIPE_SIZE ? PIPE_SIZE : arg3;
+            const struct task* t = sched_get_current();
+            if (!t || !vmm_check_user_ptr(PTR_FROM_U32(arg2), len, true)) return -1;
+            return pipe_read(t->pid, (int)arg1, PTR_FROM_U32(arg2), len);
+        }
+        case SYS_FD_WRITE:
+        {
+            const uint32_t len = arg3 > PIPE_SIZE ? PIPE_SIZE : arg3;
+            const struct task* t = sched_get_current();
+            if (!t || !vmm_check_user_ptr(PTR_FROM_U32(arg2), len, false)) return -1;
+            return pipe_write(t->pid, (int)arg1, PTR_FROM_U32(arg2), len);
+        }
+        case SYS_FUTEX_WAIT:
+        {
+            // checked for write so a copy-on-write page is split before it is keyed
+            if (!vmm_check_user_ptr(PTR_FROM_U32(arg1), sizeof(uint32_t), true)) return -1;
+            return futex_wait(arg1, arg2, arg3);
+        }
+        case SYS_FUTEX_WAKE:
+        {
+            if (!vmm_check_user_ptr(PTR_FROM_U32(arg1), sizeof(uint32_t), true)) return -1;
+            return futex_wake(arg1, arg2);
+        }
+        case SYS_IRQ_BIND:
+        {
+            const struct task* t = sched_get_current();
+            if (!t || arg1 > 0xFF) return -1;
+            return udrv_irq_bind((uint8_t)arg1, (int)arg2, arg3, t->pid);
+        }
+        case SYS_IRQ_ACK:
+        {
+            const struct task* t = sched_get_current();
+            if (!t || arg1 > 0xFF) return -1;
+            return udrv_irq_ack((uint8_t)arg1, t->pid);
+        }
+        case SYS_IRQ_UNBIND:
+        {
+            const struct task* t = sched_get_current();
+            if (!t || arg1 > 0xFF) return -1;
+            return udrv_irq_unbind((uint8_t)arg1, t->pid);
+        }
+        case SYS_IO_GRANT:
+        {
+            const struct task* t = sched_get_current();
+            if (!t || arg2 > 0xFFFF) return -1;
+            return udrv_io_grant(t->pid, (pid_t)arg1, (uint16_t)arg2, arg3);
+        }
+        case SYS_MMIO_MAP:
+        {
+            const struct task* t = sched_get_current();
+            if (!t) return -1;
+            return udrv_mmio_map(t->pid, arg1, arg2, arg3);
+        }
+        case SYS_MMIO_UNMAP:
+        {
+            const struct task* t = sched_get_current();
+            if (!t) return -1;
+            return udrv_mmio_unmap(t->pid, arg1);
+        }
+        case SYS_DRV_AUTHORIZE:
+        {
+            const struct task* t = sched_get_current();
+            if (!t) return -1;
+            return udrv_authorize(t->pid, (pid_t)arg1);
+        }
+        case SYS_CHAN_GRANT:
+        {
+            const struct task* t = sched_get_current();
+            return t ? channel_grant((int)arg1, t->pid, (pid_t)arg2) : -1;
+        }
         default:
             return -1;
     }
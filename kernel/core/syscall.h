@@ -29,6 +29,47 @@ extern "C" {
 #define SYS_MMAP 15
 #define SYS_GETTIME 16
 #define SYS_SETTIME 17
+#define SYS_THREAD_CREATE 18
+#define SYS_THREAD_EXIT 19
+#define SYS_THREAD_JOIN 20
+#define SYS_GETTID 21
+#define SYS_SLEEP 22
+#define SYS_NANOSLEEP 23
+#define SYS_CLOCK_GETTIME 24
+#define SYS_SCHED_DEADLINE 25
+#define SYS_CALL 26
+#define SYS_REPLY 27
+#define SYS_PORT_LIMITS 28
+#define SYS_SEND_BATCH 29
+#define SYS_RECV_BATCH 30
+#define SYS_PORTSET_CREATE 31
+#define SYS_PORTSET_DESTROY 32
+#define SYS_PORTSET_ADD 33
+#define SYS_PORTSET_REMOVE 34
+#define SYS_PORT_WAIT 35
+#define SYS_NOTIFY 36
+#define SYS_CHAN_CREATE 37
+#define SYS_CHAN_MAP 38
+#define SYS_CHAN_UNMAP 39
+#define SYS_CHAN_DESTROY 40
+#define SYS_CHAN_WAIT 41
+#define SYS_CHAN_WAKE 42
+#define SYS_PORT_REGISTER 43
+#define SYS_PORT_LOOKUP 44
+#define SYS_PORT_UNREGISTER 45
+#define SYS_FUTEX_WAIT 46
+#define SYS_FUTEX_WAKE 47
+#define SYS_PIPE 48
+#define SYS_FD_READ 49
+#define SYS_FD_WRITE 50
+#define SYS_IRQ_BIND 51
+#define SYS_IRQ_ACK 52
+#define SYS_IRQ_UNBIND 53
+#define SYS_IO_GRANT 54
+#define SYS_MMIO_MAP 55
+#define SYS_MMIO_UNMAP 56
+#define SYS_DRV_AUTHORIZE 57
+#define SYS_CHAN_GRANT 58
 
 /**
  * @brief Initialize the syscall handler
@@ -105,6 +105,26 @@ struct acpi_madt_io_apic
     uint32_t global_system_interrupt_base;
 } __attribute__((packed));
 
+/**
+ * @brief MADT interrupt source override entry \struct acpi_madt_int_override
+ */
+struct acpi_madt_int_override
+{
+    struct acpi_madt_entry header;
+    uint8_t bus;
+    uint8_t source;
+    uint32_t global_system_interrupt;
+    uint16_t flags;
+} __attribute__((packed));
+
+/**
+ * @brief MPS INTI flags of an interrupt source override
+ */
+#define ACPI_INT_POLARITY_MASK  0x03
+#define ACPI_INT_POLARITY_LOW   0x03
+#define ACPI_INT_TRIGGER_MASK   0x0C
+#define ACPI_INT_TRIGGER_LEVEL  0x0C
+
 /**
  * @brief FADT structure (Fixed ACPI Description Table) \struct acpi_fadt
  */
@@ -121,6 +141,23 @@ struct acpi_fadt
     uint8_t acpi_disable;
 } __attribute__((packed));
 
+/**
+ * @brief HPET description table \struct acpi_hpet
+ */
+struct acpi_hpet
+{
+    struct acpi_sdt_header header;
+    uint32_t event_timer_block_id;
+    uint8_t address_space_id;
+    uint8_t register_bit_width;
+    uint8_t register_bit_offset;
+    uint8_t reserved;
+    uint64_t address;
+    uint8_t hpet_number;
+    uint16_t minimum_tick;
+    uint8_t page_protection;
+} __attribute__((packed));
+
 /**
  * @brief Initialize ACPI subsystem and parse tables
  */
@@ -151,12 +188,36 @@ uint32_t acpi_get_cpu_count(void);
  */
 uint32_t acpi_get_local_apic_address(void);
 
+/**
+ * @brief Get the local APIC ID of an enabled CPU from the MADT
+ * @param index CPU index in MADT order, 0 .. acpi_get_cpu_count() - 1
+ * @return The APIC ID, or 0xFF if the index is out of range
+ */
+uint8_t acpi_get_cpu_apic_id(uint32_t index);
+
 /**
  * @brief Get I/O APIC base address from MADT
  * @return uint32_t Physical address of I/O APIC, 0 if not found
  */
 uint32_t acpi_get_io_apic_address(void);
 
+/**
+ * @brief Get the first global system interrupt handled by the I/O APIC
+ * @return uint32_t GSI base of the I/O APIC
+ */
+uint32_t acpi_get_io_apic_gsi_base(void);
+
+/**
+ * @brief Look up how an ISA IRQ is wired to the I/O APIC
+ * @details Without an interrupt source override the ISA IRQ maps 1:1 to
+ *          the GSI with edge trigger and active-high polarity.
+ * @param irq ISA IRQ number (0-15)
+ * @param gsi Pointer to store the global system interrupt
+ * @param flags Pointer to store the MPS INTI flags (ACPI_INT_*)
+ * @return bool true if the MADT has an override for the IRQ
+ */
+bool acpi_get_irq_override(uint8_t irq, uint32_t* gsi, uint16_t* flags);
+
 /**
  * @brief Print all detected ACPI tables
  */
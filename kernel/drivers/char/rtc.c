@@ -68,11 +68,18 @@ static bool rtc_wait_uip_clear(const unsigned int max_loops)
     return false;
 }
 
-void rtc_interrupt_handler(struct registers* regs)
+static int rtc_interrupt_handler(struct registers* regs, void* dev_id)
 {
     (void)regs;
-    rtc_read_register(RTC_REG_STATUS_C);
+    (void)dev_id;
+
+    // reading status C acknowledges the interrupt; IRQF says it was ours
+    if (!(rtc_read_register(RTC_REG_STATUS_C) & 0x80))
+    {
+        return IRQ_NONE;
+    }
     rtc_ticks++;
+    return IRQ_HANDLED;
 }
 
 static void rtc_unmask_irq(void)
@@ -271,7 +278,7 @@ void rtc_init(void)
     rtc_write_register(RTC_REG_STATUS_B, (uint8_t)(status_b | RTC_STATUS_B_24HOUR));
 
     rtc_unmask_irq();
-    register_interrupt_handler(40, rtc_interrupt_handler);
+    request_irq(40, rtc_interrupt_handler, NULL, "rtc");
 
     struct rtc_time t;
     rtc_read_time(&t);
@@ -285,3 +292,77 @@ uint32_t rtc_get_ticks(void)
 {
     return rtc_ticks;
 }
+
+static bool is_leap_year(const uint32_t year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static const uint16_t days_before_month[12] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+uint32_t rtc_time_to_timestamp(const struct rtc_time* time)
+{
+    if (!time || time->year < 1970 || time->month < 1 || time->month > 12) return 0;
+
+    uint32_t days = 0;
+    for (uint32_t y = 1970; y < time->year; y++)
+    {
+        days += is_leap_year(y) ? 366 : 365;
+    }
+    days += days_before_month[time->month - 1];
+    if (time->month > 2 && is_leap_year(time->year))
+    {
+        days++;
+    }
+    days += time->day - 1;
+
+    return days * 86400u + time->hour * 3600u + time->minute * 60u + time->second;
+}
+
+void rtc_timestamp_to_time(const uint32_t timestamp, struct rtc_time* time)
+{
+    if (!time) return;
+
+    uint32_t days = timestamp / 86400u;
+    const uint32_t rem = timestamp % 86400u;
+    time->hour = (uint8_t)(rem / 3600u);
+    time->minute = (uint8_t)((rem % 3600u) / 60u);
+    time->second = (uint8_t)(rem % 60u);
+    // 1970-01-01 was a Thursday; RTC weekday 1 is Sunday
+    time->weekday = (uint8_t)((days + 4) % 7 + 1);
+
+    uint32_t year = 1970;
+    while (days >= (is_leap_year(year) ? 366u : 365u))
+    {
+        days -= is_leap_year(year) ? 366u : 365u;
+        year++;
+    }
+    time->year = (uint16_t)year;
+
+    uint8_t month = 12;
+    while (month > 1)
+    {
+        uint32_t start = days_before_month[month - 1];
+        if (month > 2 && is_leap_year(year))
+        {
+            start++;
+        }
+        if (days >= start)
+        {
+            days -= start;
+            break;
+        }
+        month--;
+    }
+    time->month = month;
+    time->day = (uint8_t)(days + 1);
+}
+
+uint32_t rtc_get_timestamp(void)
+{
+    struct rtc_time t;
+    rtc_read_time(&t);
+    return rtc_time_to_timestamp(&t);
+}
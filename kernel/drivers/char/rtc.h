@@ -61,6 +61,20 @@ void rtc_write_time(struct rtc_time* time);
  */
 uint32_t rtc_get_timestamp(void);
 
+/**
+ * @brief Convert a calendar time to seconds since the Unix epoch
+ * @param time The time to convert
+ * @return Seconds since 1970-01-01 00:00:00 UTC
+ */
+uint32_t rtc_time_to_timestamp(const struct rtc_time* time);
+
+/**
+ * @brief Convert seconds since the Unix epoch to a calendar time
+ * @param timestamp Seconds since 1970-01-01 00:00:00 UTC
+ * @param time Pointer to rtc_time struct to fill
+ */
+void rtc_timestamp_to_time(uint32_t timestamp, struct rtc_time* time);
+
 /**
  * @brief Enable periodic interrupts from the RTC
  * @param rate Interrupt rate (0-15)
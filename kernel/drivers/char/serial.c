@@ -1,11 +1,22 @@
 #include "serial.h"
 #include "../../include/types.h"
+#include "../../include/spinlock.h"
+#include "../../sys/softirq.h"
 
 #define SERIAL_PORT 0x3F8
 #define SERIAL_BUFFER_SIZE 256
+#define SERIAL_FIFO_SIZE 16
 
+/*
+ * Output is staged in a ring and pushed to the UART at most one FIFO
+ * load per lock hold, so interrupts are never off for a whole line.
+ * Writers in interrupt context only queue; a tasklet drains the ring.
+ */
 static char serial_buffer[SERIAL_BUFFER_SIZE];
-static uint32_t serial_buf_pos = 0;
+static uint32_t serial_head = 0;
+static uint32_t serial_tail = 0;
+static spinlock_t serial_lock = SPINLOCK_INIT;
+static struct tasklet serial_tasklet;
 
 static inline void serial_out(uint16_t port, uint8_t value)
 {
@@ -19,6 +30,36 @@ static inline uint8_t serial_in(uint16_t port)
     return ret;
 }
 
+static void serial_drain(void)
+{
+    while (1)
+    {
+        const uint32_t flags = spin_lock_irqsave(&serial_lock);
+        if (serial_head == serial_tail)
+        {
+            spin_unlock_irqrestore(&serial_lock, flags);
+            return;
+        }
+
+        // transmitter empty means the whole FIFO is free
+        if (serial_in(SERIAL_PORT + 5) & 0x20)
+        {
+            for (uint32_t i = 0; i < SERIAL_FIFO_SIZE && serial_head != serial_tail; i++)
+            {
+                serial_out(SERIAL_PORT, (uint8_t)serial_buffer[serial_head]);
+                serial_head = (serial_head + 1) % SERIAL_BUFFER_SIZE;
+            }
+        }
+        spin_unlock_irqrestore(&serial_lock, flags);
+    }
+}
+
+static void serial_tasklet_func(const uint32_t data)
+{
+    (void)data;
+    serial_drain();
+}
+
 void serial_init(void)
 {
     serial_out(SERIAL_PORT + 1, 0x00); // Disable all interrupts
@@ -28,25 +69,34 @@ void serial_init(void)
     serial_out(SERIAL_PORT + 3, 0x03); // 8 bits, no parity, one stop bit
     serial_out(SERIAL_PORT + 2, 0xC7); // FIFO, clear, 14-byte threshold
     serial_out(SERIAL_PORT + 4, 0x0B); // IRQs, RTS/DSR set
-}
 
-static void serial_flush_buffer(void)
-{
-    for (uint32_t i = 0; i < serial_buf_pos; i++)
-    {
-        while (!(serial_in(SERIAL_PORT + 5) & 0x20)) {}
-        serial_out(SERIAL_PORT, serial_buffer[i]);
-    }
-    serial_buf_pos = 0;
+    tasklet_init(&serial_tasklet, serial_tasklet_func, 0);
 }
 
 void serial_write(const char c)
 {
-    serial_buffer[serial_buf_pos++] = c;
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    while ((serial_tail + 1) % SERIAL_BUFFER_SIZE == serial_head)
+    {
+        // ring full: nobody else will make room, even in interrupt context
+        spin_unlock_irqrestore(&serial_lock, flags);
+        serial_drain();
+        flags = spin_lock_irqsave(&serial_lock);
+    }
+    serial_buffer[serial_tail] = c;
+    serial_tail = (serial_tail + 1) % SERIAL_BUFFER_SIZE;
+    spin_unlock_irqrestore(&serial_lock, flags);
 
-    if (serial_buf_pos >= SERIAL_BUFFER_SIZE || c == '\n')
+    if (c == '\n')
     {
-        serial_flush_buffer();
+        if (in_irq())
+        {
+            tasklet_schedule(&serial_tasklet);
+        }
+        else
+        {
+            serial_drain();
+        }
     }
 }
 
@@ -60,8 +110,5 @@ void serial_write_str(const char* str)
 
 void serial_flush(void)
 {
-    if (serial_buf_pos > 0)
-    {
-        serial_flush_buffer();
-    }
+    serial_drain();
 }
@@ -2,11 +2,22 @@
 #include "../../ui/vterm.h"
 #include "../../arch/i686/arch.h"
 #include "../../arch/i686/idt.h"
+#include "../../sys/softirq.h"
+#include "../../sched/sched.h"
 
 static unsigned char key_buffer[KEYBOARD_BUFFER_SIZE];
 static volatile uint32_t buffer_head = 0;
 static volatile uint32_t buffer_tail = 0;
 
+// scancodes queued by the interrupt handler for the keyboard tasklet
+static uint8_t raw_buffer[KEYBOARD_RAW_SIZE];
+static volatile uint32_t raw_head = 0;
+static volatile uint32_t raw_tail = 0;
+static struct tasklet keyboard_tasklet;
+
+// task sleeping in keyboard_getchar; the console has one reader at a time
+static volatile tid_t reader = 0;
+
 static const char scancode_ascii[] =
 {
     0, 27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
@@ -28,11 +39,8 @@ static const char scancode_shift[] =
 static uint8_t shift_pressed = 0;
 static uint8_t extended_scancode = 0;
 
-static void keyboard_callback(struct registers* regs)
+static void keyboard_process(const uint8_t scancode)
 {
-    (void)regs;
-    const uint8_t scancode = inb(KEYBOARD_DATA_PORT);
-
     if (scancode == 0xE0)
     {
         extended_scancode = 1;
@@ -108,11 +116,56 @@ static void keyboard_callback(struct registers* regs)
     }
 }
 
+// bottom half: decoding and terminal switching, with interrupts enabled
+static void keyboard_tasklet_func(const uint32_t data)
+{
+    (void)data;
+    while (raw_head != raw_tail)
+    {
+        const uint8_t scancode = raw_buffer[raw_head];
+        raw_head = (raw_head + 1) % KEYBOARD_RAW_SIZE;
+        keyboard_process(scancode);
+    }
+
+    // pairs with the buffer check after sched_prepare_block in the reader
+    __sync_synchronize();
+    const tid_t waiter = reader;
+    if (waiter && buffer_head != buffer_tail)
+    {
+        sched_unblock(waiter);
+    }
+}
+
+// top half: drain the controller and defer the rest
+static int keyboard_callback(struct registers* regs, void* dev_id)
+{
+    (void)regs;
+    (void)dev_id;
+    if (!(inb(KEYBOARD_STATUS_PORT) & 0x01))
+    {
+        return IRQ_NONE;
+    }
+
+    const uint8_t scancode = inb(KEYBOARD_DATA_PORT);
+
+    const uint32_t next_tail = (raw_tail + 1) % KEYBOARD_RAW_SIZE;
+    if (next_tail != raw_head)
+    {
+        raw_buffer[raw_tail] = scancode;
+        raw_tail = next_tail;
+    }
+    tasklet_schedule(&keyboard_tasklet);
+    return IRQ_HANDLED;
+}
+
 void keyboard_init(void)
 {
     buffer_head = 0;
     buffer_tail = 0;
-    register_interrupt_handler(33, keyboard_callback);
+    raw_head = 0;
+    raw_tail = 0;
+    tasklet_init(&keyboard_tasklet, keyboard_tasklet_func, 0);
+    request_irq(33, keyboard_callback, NULL, "keyboard");
 }
 
 int keyboard_has_data(void)
@@ -122,10 +175,26 @@ int keyboard_has_data(void)
 
 unsigned char keyboard_getchar(void)
 {
+    const struct task* current = sched_get_current();
     while (buffer_head == buffer_tail)
     {
-        hlt();
+        // before the scheduler runs there is nobody to wake us
+        if (!current)
+        {
+            hlt();
+            continue;
+        }
+
+        reader = current->id;
+        sched_prepare_block();
+        if (buffer_head != buffer_tail)
+        {
+            sched_cancel_block();
+            break;
+        }
+        schedule();
     }
+    reader = 0;
     const unsigned char c = key_buffer[buffer_head];
     buffer_head = (buffer_head + 1) % KEYBOARD_BUFFER_SIZE;
     return c;
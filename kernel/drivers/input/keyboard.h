@@ -10,6 +10,7 @@ extern "C" {
 #define KEYBOARD_DATA_PORT    0x60
 #define KEYBOARD_STATUS_PORT  0x64
 #define KEYBOARD_BUFFER_SIZE  256
+#define KEYBOARD_RAW_SIZE     64
 
 /*+
  * @brief Special key codes for navigating
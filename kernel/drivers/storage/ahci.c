@@ -4,6 +4,7 @@
 #include "../../include/string.h"
 #include "../../mm/heap.h"
 #include "../../arch/i686/arch.h"
+#include "../../sys/udrv.h"
 #include "../include/cast.h"
 
 static int ahci_identify_device(uint8_t port, const uint16_t* buffer);
@@ -178,6 +179,8 @@ int ahci_init(void)
 
     abar = PTR_CAST(struct hba_mem*, bar5 & 0xFFFFFFF0);
     log_info_fmt("AHCI ABAR at 0x%x", PTR_TO_U32(abar));
+    // a user mapping of the ABAR could program DMA anywhere in memory
+    udrv_reserve_mmio(PTR_TO_U32(abar), sizeof(struct hba_mem));
 
     uint16_t command = pci_config_read_word(pci_dev->bus, pci_dev->device, pci_dev->function, PCI_REG_COMMAND);
     command |= 0x04;
@@ -1,6 +1,7 @@
 #include "vesa.h"
 #include "../../lib/log.h"
 #include "../../mm/vmm.h"
+#include "../../sys/udrv.h"
 #include "string.h"
 #include "../include/cast.h"
 
@@ -75,6 +76,7 @@ void vesa_init(void* mboot_info)
     }
 
 
+    udrv_reserve_mmio(current_mode.framebuffer, fb_pages * 0x1000);
     framebuffer_ptr = PTR_FROM_U32(current_mode.framebuffer);
     vesa_available = true;
 
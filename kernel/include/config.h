@@ -10,6 +10,10 @@
 #define MAX_PROCESSES       64
 #define MAX_THREADS         256
 #define MAX_PORTS           256
+#define MAX_PORT_SETS       32
+#define MAX_CHANNELS        32
+#define MAX_PIPES           32
+#define MAX_FDS             16
 #define MAX_MSG_SIZE        256
 #define TICK_FREQUENCY_HZ   100
 
@@ -19,7 +23,15 @@
 #define USER_DS             0x23
 #define TSS_SEG             0x28
 
+#define MAX_CPUS            8
+#define AP_TRAMPOLINE_BASE  0x8000
+
 #define KERNEL_HEAP_START   0x00400000
 #define KERNEL_HEAP_SIZE    0x00400000
 
+#define KERNEL_STACK_REGION 0xD0000000
+#define USER_STACK_REGION   0xB0000000
+#define STACK_GUARD_SIZE    0x1000
+#define STACK_CACHE_PREWARM 8
+
 #endif
@@ -0,0 +1,95 @@
+#ifndef KERNEL_SPINLOCK_H
+#define KERNEL_SPINLOCK_H
+
+#include "types.h"
+#include "../arch/i686/arch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Test-and-set spinlock \struct spinlock
+ */
+typedef struct spinlock
+{
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+/**
+ * @brief Initialize a spinlock to the unlocked state
+ * @param lock The lock to initialize
+ */
+static inline void spin_init(spinlock_t* lock)
+{
+    lock->locked = 0;
+}
+
+/**
+ * @brief Acquire a spinlock, spinning on a plain read while it is held
+ * @param lock The lock to acquire
+ */
+static inline void spin_lock(spinlock_t* lock)
+{
+    while (__sync_lock_test_and_set(&lock->locked, 1))
+    {
+        while (lock->locked)
+        {
+            __asm__ volatile ("pause");
+        }
+    }
+}
+
+/**
+ * @brief Try to acquire a spinlock without spinning
+ * @param lock The lock to acquire
+ * @return true if the lock was taken
+ */
+static inline bool spin_trylock(spinlock_t* lock)
+{
+    return !__sync_lock_test_and_set(&lock->locked, 1);
+}
+
+/**
+ * @brief Release a spinlock
+ * @param lock The lock to release
+ */
+static inline void spin_unlock(spinlock_t* lock)
+{
+    __sync_lock_release(&lock->locked);
+}
+
+/**
+ * @brief Disable local interrupts and acquire a spinlock
+ * @param lock The lock to acquire
+ * @return The previous EFLAGS, to pass to spin_unlock_irqrestore
+ */
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock)
+{
+    const uint32_t flags = read_eflags();
+    cli();
+    spin_lock(lock);
+    return flags;
+}
+
+/**
+ * @brief Release a spinlock and restore the saved interrupt state
+ * @param lock The lock to release
+ * @param flags The value returned by spin_lock_irqsave
+ */
+static inline void spin_unlock_irqrestore(spinlock_t* lock, const uint32_t flags)
+{
+    spin_unlock(lock);
+    if (flags & 0x200)
+    {
+        sti();
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,330 @@
+#include "channel.h"
+#include "../mm/vmm.h"
+#include "../mm/pmm.h"
+#include "../sched/sched.h"
+#include "../arch/i686/smp.h"
+#include "../include/spinlock.h"
+#include "../include/string.h"
+#include "../include/cast.h"
+
+/*
+ * Shared-memory channels. A channel is a header page plus a power of two
+ * data pages that both ends map writable, forming a single-producer,
+ * single-consumer byte ring. The ends move head and tail with plain stores
+ * and only enter the kernel to sleep: an end that finds the ring empty or
+ * full raises its waiting flag, rechecks and calls channel_wait; the other
+ * end calls channel_wake when it moves its index and sees the flag.
+ *
+ * The channel holds one reference to each frame and every mapping another,
+ * so the pages outlive the channel until the last end unmaps them.
+ *
+ * Only two processes use a channel: the owner and one peer, either the one
+ * the owner granted it to or else the first other process that maps it.
+ * Only the owner may destroy it.
+ */
+struct channel
+{
+    pid_t owner;
+    pid_t peer;
+    uint32_t pages;
+    uint32_t phys[CHANNEL_MAX_PAGES + 1];
+    tid_t waiter[2];
+};
+
+static struct channel channels[MAX_CHANNELS];
+static spinlock_t chan_lock = SPINLOCK_INIT;
+
+static bool window_valid(const uint32_t addr, const uint32_t frames)
+{
+    if (addr == 0 || (addr & 0xFFF))
+    {
+        return false;
+    }
+    if (addr > USER_SPACE_END + 1 - frames * PAGE_SIZE)
+    {
+        return false;
+    }
+
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        if (vmm_get_physical_address(dir, addr + i * PAGE_SIZE))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// caller holds chan_lock
+static int map_frames(const struct channel* c, const uint32_t addr)
+{
+    page_directory_t* dir = vmm_get_current_directory();
+    const uint32_t frames = c->pages + 1;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        if (vmm_ref_frame(c->phys[i]) != 0)
+        {
+            for (uint32_t j = 0; j < i; j++)
+            {
+                vmm_free_page(dir, addr + j * PAGE_SIZE);
+            }
+            return -1;
+        }
+        if (vmm_map_page(dir, addr + i * PAGE_SIZE, c->phys[i], PAGE_PRESENT | PAGE_WRITE | PAGE_USER) != 0)
+        {
+            vmm_release_frame(c->phys[i]);
+            for (uint32_t j = 0; j < i; j++)
+            {
+                vmm_free_page(dir, addr + j * PAGE_SIZE);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// caller holds chan_lock; checks the header page of the channel is at addr
+static bool mapped_at(const struct channel* c, const uint32_t addr)
+{
+    if (addr & 0xFFF)
+    {
+        return false;
+    }
+    const uint32_t phys = vmm_get_physical_address(vmm_get_current_directory(), addr);
+    return phys && (phys & ~0xFFF) == c->phys[0];
+}
+
+// caller holds chan_lock
+static bool channel_allows(const struct channel* c, const pid_t caller)
+{
+    return c->owner != 0 && caller != 0 && (caller == c->owner || caller == c->peer);
+}
+
+void channel_init(void)
+{
+    spin_init(&chan_lock);
+    memset(channels, 0, sizeof(channels));
+}
+
+int channel_create(const pid_t owner, const uint32_t pages, const uint32_t addr)
+{
+    if (pages == 0 || pages > CHANNEL_MAX_PAGES || (pages & (pages - 1))) return -1;
+    if (!window_valid(addr, pages + 1)) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    struct channel* c = NULL;
+    int id = -1;
+    for (uint32_t i = 0; i < MAX_CHANNELS; i++)
+    {
+        if (channels[i].owner == 0)
+        {
+            c = &channels[i];
+            id = (int)i;
+            break;
+        }
+    }
+    if (!c)
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i <= pages; i++)
+    {
+        void* frame = pmm_alloc_block();
+        if (!frame)
+        {
+            for (uint32_t j = 0; j < i; j++)
+            {
+                pmm_free_block(PTR_FROM_U32(c->phys[j]));
+            }
+            spin_unlock_irqrestore(&chan_lock, irq);
+            return -1;
+        }
+        c->phys[i] = PTR_TO_U32(frame);
+    }
+    c->pages = pages;
+
+    if (map_frames(c, addr) != 0)
+    {
+        for (uint32_t i = 0; i <= pages; i++)
+        {
+            pmm_free_block(PTR_FROM_U32(c->phys[i]));
+        }
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+
+    // the frames are only reachable through the new window
+    memset(PTR_FROM_U32(addr), 0, (pages + 1) * PAGE_SIZE);
+    struct channel_header* h = PTR_FROM_U32_TYPED(struct channel_header, addr);
+    h->size = pages * PAGE_SIZE;
+
+    c->owner = owner;
+    c->peer = 0;
+    c->waiter[CHAN_PRODUCER] = 0;
+    c->waiter[CHAN_CONSUMER] = 0;
+    spin_unlock_irqrestore(&chan_lock, irq);
+    return id;
+}
+
+int channel_grant(const int id, const pid_t caller, const pid_t peer)
+{
+    if (id < 0 || (uint32_t)id >= MAX_CHANNELS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    struct channel* c = &channels[id];
+    if (c->owner == 0 || c->owner != caller || peer == 0 || peer == caller || c->peer != 0)
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+    c->peer = peer;
+    spin_unlock_irqrestore(&chan_lock, irq);
+    return 0;
+}
+
+int channel_map(const int id, const uint32_t addr, const pid_t caller)
+{
+    if (id < 0 || (uint32_t)id >= MAX_CHANNELS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    struct channel* c = &channels[id];
+    if (c->owner != 0 && c->peer == 0 && caller != c->owner)
+    {
+        // no peer was granted: the first other process to map becomes it
+        c->peer = caller;
+    }
+    if (!channel_allows(c, caller) || !window_valid(addr, c->pages + 1))
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+    const int ret = map_frames(c, addr);
+    spin_unlock_irqrestore(&chan_lock, irq);
+    return ret;
+}
+
+int channel_unmap(const int id, const uint32_t addr, const pid_t caller)
+{
+    if (id < 0 || (uint32_t)id >= MAX_CHANNELS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    const struct channel* c = &channels[id];
+    if (!channel_allows(c, caller) || !mapped_at(c, addr))
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i <= c->pages; i++)
+    {
+        const uint32_t virt = addr + i * PAGE_SIZE;
+        if ((vmm_get_physical_address(dir, virt) & ~0xFFF) == c->phys[i])
+        {
+            vmm_free_page(dir, virt);
+        }
+    }
+    spin_unlock_irqrestore(&chan_lock, irq);
+
+    smp_flush_tlb();
+    return 0;
+}
+
+int channel_destroy(const int id, const pid_t caller)
+{
+    if (id < 0 || (uint32_t)id >= MAX_CHANNELS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    struct channel* c = &channels[id];
+    if (c->owner == 0 || c->owner != caller)
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+
+    uint32_t phys[CHANNEL_MAX_PAGES + 1];
+    const uint32_t frames = c->pages + 1;
+    memcpy(phys, c->phys, sizeof(phys));
+    for (uint32_t side = 0; side < 2; side++)
+    {
+        if (c->waiter[side])
+        {
+            sched_unblock(c->waiter[side]);
+        }
+    }
+    memset(c, 0, sizeof(struct channel));
+    spin_unlock_irqrestore(&chan_lock, irq);
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        vmm_release_frame(phys[i]);
+    }
+    return 0;
+}
+
+int channel_wait(const int id, const uint32_t addr, const uint32_t side, const uint32_t expected,
+                 const pid_t caller)
+{
+    if (id < 0 || (uint32_t)id >= MAX_CHANNELS) return -1;
+    if (side > CHAN_CONSUMER) return -1;
+
+    const struct task* current = sched_get_current();
+    if (!current) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    struct channel* c = &channels[id];
+    if (!channel_allows(c, caller) || !mapped_at(c, addr))
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+
+    // the other end moves its index before it takes the lock to wake us
+    const struct channel_header* h = PTR_FROM_U32_TYPED(const struct channel_header, addr);
+    const uint32_t now = side == CHAN_CONSUMER ? h->head : h->tail;
+    if (now != expected)
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return 0;
+    }
+
+    c->waiter[side] = current->id;
+    sched_prepare_block();
+    spin_unlock_irqrestore(&chan_lock, irq);
+    schedule();
+
+    // woken by destroy, or the slot would wake us again later
+    const uint32_t again = spin_lock_irqsave(&chan_lock);
+    if (c->waiter[side] == current->id)
+    {
+        c->waiter[side] = 0;
+    }
+    spin_unlock_irqrestore(&chan_lock, again);
+    return 0;
+}
+
+int channel_wake(const int id, const uint32_t side, const pid_t caller)
+{
+    if (id < 0 || (uint32_t)id >= MAX_CHANNELS) return -1;
+    if (side > CHAN_CONSUMER) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&chan_lock);
+    struct channel* c = &channels[id];
+    if (!channel_allows(c, caller))
+    {
+        spin_unlock_irqrestore(&chan_lock, irq);
+        return -1;
+    }
+
+    const tid_t waiter = c->waiter[side];
+    c->waiter[side] = 0;
+    if (waiter)
+    {
+        sched_unblock(waiter);
+    }
+    spin_unlock_irqrestore(&chan_lock, irq);
+    return waiter ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+#ifndef KERNEL_CHANNEL_H
+#define KERNEL_CHANNEL_H
+
+#include "../include/types.h"
+#include "../include/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Most data pages of a channel ring (64 KB)
+ */
+#define CHANNEL_MAX_PAGES 16
+
+/**
+ * @brief Sides of a channel, named by who sleeps on them
+ */
+#define CHAN_PRODUCER 0
+#define CHAN_CONSUMER 1
+
+/**
+ * @brief First page of a channel, shared by both ends \struct channel_header
+ * @details head and tail count bytes ever written and read; the data pages
+ *          follow the header page and are indexed modulo size. Each index
+ *          sits on its own cache line next to the sleep flag of the side
+ *          that writes it, so the two ends never write the same line.
+ */
+struct channel_header
+{
+    volatile uint32_t head;
+    volatile uint32_t producer_waiting;
+    uint8_t pad0[56];
+    volatile uint32_t tail;
+    volatile uint32_t consumer_waiting;
+    uint8_t pad1[56];
+    uint32_t size;
+};
+
+/**
+ * @brief Initialize the channel table
+ */
+void channel_init(void);
+
+/**
+ * @brief Create a channel and map it into the current address space
+ * @details Maps one header page and pages data pages at addr, writable.
+ * @param owner The PID of the channel owner
+ * @param pages Data pages, a power of two up to CHANNEL_MAX_PAGES
+ * @param addr Page aligned user address of a free window of pages + 1 pages
+ * @return The channel ID on success, -1 on failure
+ */
+int channel_create(pid_t owner, uint32_t pages, uint32_t addr);
+
+/**
+ * @brief Name the one process besides the owner that may use a channel
+ * @details Without a grant the first other process to map the channel
+ *          becomes its peer.
+ * @param id The channel ID
+ * @param caller The PID asking, must own the channel
+ * @param peer The PID of the other end
+ * @return 0 on success, -1 if caller is not the owner or a peer is set
+ */
+int channel_grant(int id, pid_t caller, pid_t peer);
+
+/**
+ * @brief Map an existing channel into the current address space
+ * @details The mapping shares the frames with every other mapping of the
+ *          channel. A forked child gets a private copy instead.
+ * @param id The channel ID
+ * @param addr Page aligned user address of a free window
+ * @param caller The PID asking, the owner or the peer
+ * @return 0 on success, -1 on failure or if caller may not use the channel
+ */
+int channel_map(int id, uint32_t addr, pid_t caller);
+
+/**
+ * @brief Unmap a channel from the current address space
+ * @param id The channel ID
+ * @param addr Address the channel was mapped at
+ * @param caller The PID asking, the owner or the peer
+ * @return 0 on success, -1 if the channel is not mapped there
+ */
+int channel_unmap(int id, uint32_t addr, pid_t caller);
+
+/**
+ * @brief Destroy a channel
+ * @details Wakes both sides. The pages stay valid until every mapping is
+ *          gone.
+ * @param id The channel ID
+ * @param caller The PID asking, must own the channel
+ * @return 0 on success, -1 on failure
+ */
+int channel_destroy(int id, pid_t caller);
+
+/**
+ * @brief Sleep until the other end moves its index
+ * @details The producer waits for tail and the consumer for head to differ
+ *          from expected. The index is read under the channel lock, so a
+ *          wake issued after the other end moved it is never lost; the
+ *          caller rechecks the ring on return.
+ * @param id The channel ID
+ * @param addr Address the caller mapped the channel at
+ * @param side CHAN_PRODUCER or CHAN_CONSUMER
+ * @param expected Value of the watched index the caller last saw
+ * @param caller The PID asking, the owner or the peer
+ * @return 0 after a wakeup or if the index already moved, -1 on failure
+ */
+int channel_wait(int id, uint32_t addr, uint32_t side, uint32_t expected, pid_t caller);
+
+/**
+ * @brief Wake the task sleeping on one side of a channel
+ * @param id The channel ID
+ * @param side CHAN_PRODUCER or CHAN_CONSUMER
+ * @param caller The PID asking, the owner or the peer
+ * @return 1 if a task was woken, 0 if none was waiting, -1 on failure
+ */
+int channel_wake(int id, uint32_t side, pid_t caller);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,153 +2,1492 @@
 #include "../mm/heap.h"
 #include "../include/string.h"
 #include "../sched/sched.h"
+#include "../include/spinlock.h"
+#include "../mm/vmm.h"
+#include "../arch/i686/smp.h"
+#include "../arch/i686/arch.h"
+#include "../sys/timer.h"
+#include "../sys/ktimer.h"
 
-#define MSG_QUEUE_SIZE 16
+/*
+ * Queued messages live in a per-port byte ring as records of the message
+ * header followed by len payload bytes, padded to a word, so a notification
+ * costs a few dozen bytes instead of a full struct message. The ring is
+ * allocated on the first send; ports that never receive own no queue
+ * memory. Per-message bookkeeping (priority, call, frames) sits in slot
+ * arrays indexed in the order the records were queued.
+ */
+#define MSG_HEADER_SIZE __builtin_offsetof(struct message, data)
+#define MSG_RECORD_SIZE(len) ((MSG_HEADER_SIZE + (len) + 3) & ~3u)
+
+#define CALL_PENDING 1
+
+/*
+ * Synchronous calls. The caller waits on its own stack: the queued request
+ * records where the reply goes, and the server copies its answer there and
+ * switches straight back. Neither direction needs a reply port, a second
+ * queue copy or a run queue scan.
+ */
+struct ipc_call_wait
+{
+    tid_t caller;
+    struct message* reply;
+    volatile int status;
+};
 
 static struct port ports[MAX_PORTS];
+static struct port_set sets[MAX_PORT_SETS];
 static uint32_t port_count = 0;
 
-void ipc_init(void)
+// free port IDs in FIFO order, so a destroyed ID is reused as late as possible
+static int free_next[MAX_PORTS];
+static int free_head = -1;
+static int free_tail = -1;
+
+/*
+ * Port registry. Names hash into an open-addressed table twice the size of
+ * the port table, so probe runs stay short with every port named. A port
+ * has at most one name and remembers its slot, so port_destroy drops the
+ * name without a lookup.
+ */
+#define PORT_NAME_SLOTS (2 * MAX_PORTS)
+
+struct port_name
+{
+    char name[PORT_NAME_MAX];
+    int port;
+};
+
+static struct port_name names[PORT_NAME_SLOTS];
+static spinlock_t ipc_lock = SPINLOCK_INIT;
+
+/*
+ * Priority inheritance. Every port remembers the priority each queued
+ * message was sent at, the priority of a sender blocked on the full queue
+ * and the priority of the request being served. The highest of these is
+ * lent to the server thread: the thread waiting in msg_receive, else the
+ * last one that received, else the owner's main thread. Senders lend their
+ * effective priority, so a boost carries on along a chain of servers.
+ */
+static uint8_t current_priority(void)
+{
+    const struct task* current = sched_get_current();
+    return current ? current->priority : 0;
+}
+
+// caller holds ipc_lock
+static uint8_t port_inherit_level(const struct port* p)
+{
+    uint8_t level = p->blocked_prio > p->serving_prio ? p->blocked_prio : p->serving_prio;
+    for (uint32_t i = 0; i < p->queue_count; i++)
+    {
+        const uint8_t prio = p->queue_prio[(p->queue_head + i) % MSG_QUEUE_SIZE];
+        if (prio > level)
+        {
+            level = prio;
+        }
+    }
+    return level;
+}
+
+// caller holds ipc_lock; a thread serving several ports runs at the highest loan
+static void server_update_boost(const tid_t server)
+{
+    if (!server)
+    {
+        return;
+    }
+
+    uint8_t level = 0;
+    for (uint32_t i = 0; i < MAX_PORTS; i++)
+    {
+        if (ports[i].owner != 0 && ports[i].server == server && ports[i].lent_prio > level)
+        {
+            level = ports[i].lent_prio;
+        }
+    }
+    sched_set_inherited_priority(server, level);
+}
+
+// caller holds ipc_lock; recomputes the loan after the port state changed
+static void port_lend(struct port* p, const tid_t server)
+{
+    const tid_t old_server = p->server;
+    const uint8_t old_level = p->lent_prio;
+    p->lent_prio = port_inherit_level(p);
+    p->server = server;
+
+    if (old_server != server)
+    {
+        server_update_boost(old_server);
+        server_update_boost(server);
+    }
+    else if (p->lent_prio != old_level)
+    {
+        server_update_boost(server);
+    }
+}
+
+/*
+ * Page transfer. The frames behind the pages of a message are taken from
+ * the sender before the message is queued: IPC_MOVE unmaps them, IPC_SHARE
+ * leaves them mapped copy-on-write and takes a reference. The receiver
+ * maps the same frames, so a 64 KB payload costs sixteen PTE updates and
+ * no copy. Frames of a message that never gets received are released.
+ */
+static int frames_attach(const struct message* msg, const uint32_t flags, struct msg_frames* frames)
+{
+    frames->count = 0;
+    if (!(flags & (IPC_MOVE | IPC_SHARE)))
+    {
+        return 0;
+    }
+    if ((msg->page_addr & 0xFFF) || msg->page_count == 0 || msg->page_count > IPC_MAX_PAGES ||
+        msg->page_addr > USER_SPACE_END + 1 - msg->page_count * PAGE_SIZE)
+    {
+        return -1;
+    }
+
+    // only pages the sender can reach itself leave its address space
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < msg->page_count; i++)
+    {
+        if (!vmm_is_user_mapped(dir, msg->page_addr + i * PAGE_SIZE))
+        {
+            return -1;
+        }
+    }
+
+    for (uint32_t i = 0; i < msg->page_count; i++)
+    {
+        const uint32_t virt = msg->page_addr + i * PAGE_SIZE;
+        if (flags & IPC_MOVE)
+        {
+            frames->phys[i] = vmm_detach_page(dir, virt, &frames->flags[i]);
+            if (!frames->phys[i])
+            {
+                break;
+            }
+        }
+        else if (vmm_share_page(dir, virt, &frames->phys[i], &frames->flags[i]) != 0)
+        {
+            break;
+        }
+        frames->count++;
+    }
+
+    if (frames->count == msg->page_count)
+    {
+        // other CPUs must stop writing through the old mappings
+        smp_flush_tlb();
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < frames->count; i++)
+    {
+        if (flags & IPC_MOVE)
+        {
+            vmm_map_page(dir, msg->page_addr + i * PAGE_SIZE, frames->phys[i], frames->flags[i]);
+        }
+        else
+        {
+            vmm_release_frame(frames->phys[i]);
+        }
+    }
+    frames->count = 0;
+    return -1;
+}
+
+// undoes frames_attach for a message that was not queued
+static void frames_return(const struct message* msg, const uint32_t flags, struct msg_frames* frames)
+{
+    for (uint32_t i = 0; i < frames->count; i++)
+    {
+        if (flags & IPC_MOVE)
+        {
+            vmm_map_page(vmm_get_current_directory(), msg->page_addr + i * PAGE_SIZE,
+                         frames->phys[i], frames->flags[i]);
+        }
+        else
+        {
+            vmm_release_frame(frames->phys[i]);
+        }
+    }
+    frames->count = 0;
+}
+
+// caller holds ipc_lock; -3 if the window cannot take the frames
+static int frames_map(const struct msg_frames* frames, const uint32_t window, const uint32_t window_pages)
+{
+    if ((window & 0xFFF) || window_pages < frames->count ||
+        window > USER_SPACE_END + 1 - frames->count * PAGE_SIZE)
+    {
+        return -3;
+    }
+
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < frames->count; i++)
+    {
+        if (vmm_get_physical_address(dir, window + i * PAGE_SIZE))
+        {
+            return -3;
+        }
+    }
+
+    for (uint32_t i = 0; i < frames->count; i++)
+    {
+        if (vmm_map_page(dir, window + i * PAGE_SIZE, frames->phys[i], frames->flags[i]) != 0)
+        {
+            for (uint32_t j = 0; j < i; j++)
+            {
+                vmm_detach_page(dir, window + j * PAGE_SIZE, NULL);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// caller holds ipc_lock; ends the call in service and returns its caller
+static tid_t call_complete(struct port* p, const struct message* reply)
+{
+    struct ipc_call_wait* w = p->call;
+    p->call = NULL;
+    if (reply)
+    {
+        memcpy(w->reply, reply, MSG_HEADER_SIZE + reply->len);
+        w->reply->page_addr = 0;
+        w->reply->page_count = 0;
+        w->status = 0;
+    }
+    else
+    {
+        w->status = -1;
+    }
+
+    // the boost ends with the answer
+    p->serving_prio = 0;
+    p->serving = 0;
+    port_lend(p, p->server);
+    return w->caller;
+}
+
+// caller holds ipc_lock; offsets wrap around the end of the ring
+static void ring_write(struct port* p, uint32_t offset, const void* src, const uint32_t len)
+{
+    offset %= p->ring_size;
+    const uint32_t first = len < p->ring_size - offset ? len : p->ring_size - offset;
+    memcpy(p->ring + offset, src, first);
+    memcpy(p->ring, (const uint8_t*)src + first, len - first);
+}
+
+// caller holds ipc_lock
+static void ring_read(const struct port* p, uint32_t offset, void* dst, const uint32_t len)
+{
+    offset %= p->ring_size;
+    const uint32_t first = len < p->ring_size - offset ? len : p->ring_size - offset;
+    memcpy(dst, p->ring + offset, first);
+    memcpy((uint8_t*)dst + first, p->ring, len - first);
+}
+
+// allocates the ring of a port on its first send
+static int port_alloc_ring(struct port* p)
+{
+    uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    const uint32_t size = p->ring_size;
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    if (size == 0)
+    {
+        return -1;
+    }
+
+    uint8_t* ring = (uint8_t*)kmalloc(size);
+    if (!ring)
+    {
+        return -1;
+    }
+
+    irq = spin_lock_irqsave(&ipc_lock);
+    if (p->owner != 0 && !p->ring && p->ring_size == size)
+    {
+        p->ring = ring;
+        ring = NULL;
+    }
+    spin_unlock_irqrestore(&ipc_lock, irq);
+
+    // lost a race with another sender or a limit change; the caller retries
+    if (ring)
+    {
+        kfree(ring);
+    }
+    return 0;
+}
+
+/*
+ * Port sets. Each set keeps a doubly linked list of its ready members,
+ * threaded through the ports. A port joins the list on the first message
+ * after it was last reported and leaves it when a wait reports it, so the
+ * list is edge triggered and a wait costs O(ready) however many ports the
+ * set holds.
+ */
+
+// caller holds ipc_lock
+static void ready_unlink(struct port* p)
+{
+    struct port_set* s = &sets[p->set];
+    if (p->ready_prev >= 0)
+    {
+        ports[p->ready_prev].ready_next = p->ready_next;
+    }
+    else
+    {
+        s->ready_head = p->ready_next;
+    }
+    if (p->ready_next >= 0)
+    {
+        ports[p->ready_next].ready_prev = p->ready_prev;
+    }
+    else
+    {
+        s->ready_tail = p->ready_prev;
+    }
+    p->ready_prev = -1;
+    p->ready_next = -1;
+    p->ready = false;
+}
+
+// caller holds ipc_lock; a message arrived on the port
+static void port_mark_ready(struct port* p)
+{
+    if (p->set < 0 || p->ready)
+    {
+        return;
+    }
+
+    struct port_set* s = &sets[p->set];
+    p->ready = true;
+    p->ready_prev = s->ready_tail;
+    p->ready_next = -1;
+    if (s->ready_tail >= 0)
+    {
+        ports[s->ready_tail].ready_next = (int)p->id;
+    }
+    else
+    {
+        s->ready_head = (int)p->id;
+    }
+    s->ready_tail = (int)p->id;
+
+    if (s->waiter)
+    {
+        sched_unblock(s->waiter);
+        s->waiter = 0;
+    }
+}
+
+// FNV-1a
+static uint32_t name_hash(const char* name)
+{
+    uint32_t h = 2166136261u;
+    while (*name)
+    {
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+    return h & (PORT_NAME_SLOTS - 1);
+}
+
+// caller holds ipc_lock; returns the slot of name or -1
+static int name_find(const char* name)
+{
+    uint32_t i = name_hash(name);
+    while (names[i].name[0])
+    {
+        if (strcmp(names[i].name, name) == 0)
+        {
+            return (int)i;
+        }
+        i = (i + 1) & (PORT_NAME_SLOTS - 1);
+    }
+    return -1;
+}
+
+// caller holds ipc_lock; the table never fills, a port has one name at most
+static void name_place(const char* name, const int port)
+{
+    uint32_t i = name_hash(name);
+    while (names[i].name[0])
+    {
+        i = (i + 1) & (PORT_NAME_SLOTS - 1);
+    }
+    strncpy(names[i].name, name, PORT_NAME_MAX - 1);
+    names[i].name[PORT_NAME_MAX - 1] = '\0';
+    names[i].port = port;
+    ports[port].name_slot = (int)i;
+}
+
+// caller holds ipc_lock; the rest of the probe run is placed again so
+// lookups never stop early at the hole
+static void name_remove(const int slot)
+{
+    ports[names[slot].port].name_slot = -1;
+    memset(&names[slot], 0, sizeof(struct port_name));
+
+    uint32_t i = ((uint32_t)slot + 1) & (PORT_NAME_SLOTS - 1);
+    while (names[i].name[0])
+    {
+        const struct port_name moved = names[i];
+        memset(&names[i], 0, sizeof(struct port_name));
+        name_place(moved.name, moved.port);
+        i = (i + 1) & (PORT_NAME_SLOTS - 1);
+    }
+}
+
+void ipc_init(void)
+{
+    spin_init(&ipc_lock);
+    memset(ports, 0, sizeof(ports));
+    memset(sets, 0, sizeof(sets));
+    memset(names, 0, sizeof(names));
+    for (int i = 0; i < MAX_PORTS; i++)
+    {
+        free_next[i] = i + 1 < MAX_PORTS ? i + 1 : -1;
+    }
+    free_head = 0;
+    free_tail = MAX_PORTS - 1;
+    port_count = 0;
+}
+
+int port_create(const pid_t owner)
+{
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    const int id = free_head;
+    if (id < 0)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+    free_head = free_next[id];
+    if (free_head < 0)
+    {
+        free_tail = -1;
+    }
+
+    struct port* p = &ports[id];
+    p->owner = owner;
+    p->id = (uint32_t)id;
+    p->flags = 0;
+    p->ring = NULL;
+    p->ring_size = PORT_RING_DEFAULT;
+    p->ring_head = 0;
+    p->ring_used = 0;
+    p->frames = NULL;
+    p->queue_head = 0;
+    p->queue_count = 0;
+    p->queue_limit = MSG_QUEUE_SIZE;
+    p->waiting_sender = 0;
+    p->waiting_receiver = 0;
+    p->blocked_prio = 0;
+    p->serving_prio = 0;
+    p->lent_prio = 0;
+    p->serving = 0;
+    p->server = (tid_t)owner;
+    p->notify_pending = 0;
+    p->set = -1;
+    p->ready_prev = -1;
+    p->ready_next = -1;
+    p->ready = false;
+    p->name_slot = -1;
+    port_count++;
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return id;
+}
+
+int port_set_limits(const int port_id, const uint32_t bytes, const uint32_t messages, const pid_t caller)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+    if (bytes < PORT_RING_MIN || bytes > PORT_RING_MAX) return -1;
+    if (messages == 0 || messages > MSG_QUEUE_SIZE) return -1;
+
+    struct port* p = &ports[port_id];
+    uint8_t* old_ring = NULL;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    if (p->owner == 0 || p->owner != caller || (p->queue_count && bytes != p->ring_size))
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+
+    // a resized ring is allocated again by the next send
+    if (bytes != p->ring_size)
+    {
+        old_ring = p->ring;
+        p->ring = NULL;
+        p->ring_size = bytes;
+        p->ring_head = 0;
+    }
+    p->queue_limit = messages;
+
+    // more room may let a blocked sender through
+    if (p->waiting_sender)
+    {
+        sched_unblock(p->waiting_sender);
+        p->waiting_sender = 0;
+    }
+    spin_unlock_irqrestore(&ipc_lock, irq);
+
+    if (old_ring)
+    {
+        kfree(old_ring);
+    }
+    return 0;
+}
+
+uint32_t ipc_get_queue_memory(void)
+{
+    uint32_t bytes = 0;
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    for (uint32_t i = 0; i < MAX_PORTS; i++)
+    {
+        if (ports[i].ring)
+        {
+            bytes += ports[i].ring_size;
+        }
+        if (ports[i].frames)
+        {
+            bytes += sizeof(struct msg_frames) * MSG_QUEUE_SIZE;
+        }
+    }
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return bytes;
+}
+
+int port_destroy(const int port_id)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    if (ports[port_id].owner == 0)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+
+    if (ports[port_id].waiting_sender)
+    {
+        sched_unblock(ports[port_id].waiting_sender);
+    }
+
+    if (ports[port_id].waiting_receiver)
+    {
+        sched_unblock(ports[port_id].waiting_receiver);
+    }
+
+    // callers still waiting on the port fail
+    for (uint32_t i = 0; i < ports[port_id].queue_count; i++)
+    {
+        struct ipc_call_wait* w = ports[port_id].queue_call[(ports[port_id].queue_head + i) % MSG_QUEUE_SIZE];
+        if (w)
+        {
+            w->status = -1;
+            sched_unblock(w->caller);
+        }
+    }
+    if (ports[port_id].call)
+    {
+        sched_unblock(call_complete(&ports[port_id], NULL));
+    }
+    if (ports[port_id].set >= 0)
+    {
+        if (ports[port_id].ready)
+        {
+            ready_unlink(&ports[port_id]);
+        }
+        sets[ports[port_id].set].members--;
+    }
+    if (ports[port_id].name_slot >= 0)
+    {
+        name_remove(ports[port_id].name_slot);
+    }
+
+    uint8_t* ring = ports[port_id].ring;
+    struct msg_frames* frames = ports[port_id].frames;
+    const uint32_t head = ports[port_id].queue_head;
+    const uint32_t count = ports[port_id].queue_count;
+    const tid_t server = ports[port_id].server;
+    memset(&ports[port_id], 0, sizeof(struct port));
+    port_count--;
+    free_next[port_id] = -1;
+    if (free_tail >= 0)
+    {
+        free_next[free_tail] = port_id;
+    }
+    else
+    {
+        free_head = port_id;
+    }
+    free_tail = port_id;
+    server_update_boost(server);
+    spin_unlock_irqrestore(&ipc_lock, irq);
+
+    if (frames)
+    {
+        // pages of messages nobody received go back to the allocator
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const struct msg_frames* f = &frames[(head + i) % MSG_QUEUE_SIZE];
+            for (uint32_t j = 0; j < f->count; j++)
+            {
+                vmm_release_frame(f->phys[j]);
+            }
+        }
+        kfree(frames);
+    }
+    if (ring)
+    {
+        kfree(ring);
+    }
+    return 0;
+}
+
+// caller holds ipc_lock
+static bool port_has_room(const struct port* p, const uint32_t len)
+{
+    return p->queue_count < p->queue_limit && p->ring_used + MSG_RECORD_SIZE(len) <= p->ring_size;
+}
+
+// caller holds ipc_lock and checked port_has_room
+static void port_enqueue(struct port* p, const struct message* msg, const struct msg_frames* frames,
+                         struct ipc_call_wait* call, const uint8_t prio)
+{
+    const uint32_t page_count = frames ? frames->count : 0;
+    const uint32_t offset = p->ring_head + p->ring_used;
+    ring_write(p, offset, msg, MSG_HEADER_SIZE + msg->len);
+    ring_write(p, offset + __builtin_offsetof(struct message, page_count), &page_count, sizeof(uint32_t));
+    p->ring_used += MSG_RECORD_SIZE(msg->len);
+
+    const uint32_t slot = (p->queue_head + p->queue_count) % MSG_QUEUE_SIZE;
+    if (p->frames)
+    {
+        p->frames[slot].count = 0;
+        if (frames)
+        {
+            p->frames[slot] = *frames;
+        }
+    }
+    p->queue_prio[slot] = prio;
+    p->queue_call[slot] = call;
+    p->queue_count++;
+    port_mark_ready(p);
+}
+
+// caller holds ipc_lock; reads the length and page count of the oldest record
+static void port_peek(const struct port* p, uint32_t* len, uint32_t* page_count)
+{
+    ring_read(p, p->ring_head + __builtin_offsetof(struct message, len), len, sizeof(uint32_t));
+    ring_read(p, p->ring_head + __builtin_offsetof(struct message, page_count), page_count, sizeof(uint32_t));
+}
+
+// caller holds ipc_lock and mapped the frames of the oldest record; returns its slot
+static uint32_t port_dequeue(struct port* p, struct message* msg, const uint32_t len)
+{
+    const uint32_t slot = p->queue_head;
+    ring_read(p, p->ring_head, msg, MSG_HEADER_SIZE + len);
+    p->ring_head = (p->ring_head + MSG_RECORD_SIZE(len)) % p->ring_size;
+    p->ring_used -= MSG_RECORD_SIZE(len);
+    p->queue_head = (slot + 1) % MSG_QUEUE_SIZE;
+    p->queue_count--;
+    return slot;
+}
+
+// caller holds ipc_lock and found the queue full; drops the lock and sleeps
+static void sender_wait(struct port* p, const struct task* current, const uint32_t irq)
+{
+    if (current->priority > p->blocked_prio)
+    {
+        p->blocked_prio = current->priority;
+        port_lend(p, p->server);
+    }
+
+    // blocked before the lock drops, so the wakeup cannot be lost
+    p->waiting_sender = current->id;
+    sched_prepare_block();
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    schedule();
+}
+
+/*
+ * Waits for a message on the port. Returns 0 with ipc_lock held and the
+ * interrupt state in *irq, or an error with the lock released. Receiving
+ * again ends the service of the previous request.
+ */
+static int port_wait_message(struct port* p, const uint32_t flags, uint32_t* irq)
+{
+    while (1)
+    {
+        *irq = spin_lock_irqsave(&ipc_lock);
+        if (p->owner == 0)
+        {
+            spin_unlock_irqrestore(&ipc_lock, *irq);
+            return -1;
+        }
+
+        const struct task* current = sched_get_current();
+        if (current && p->server == current->id && p->serving_prio)
+        {
+            p->serving_prio = 0;
+            p->serving = 0;
+            port_lend(p, current->id);
+        }
+        if (p->call && p->queue_count)
+        {
+            // one call is served at a time; the one left unanswered fails
+            sched_unblock(call_complete(p, NULL));
+        }
+
+        if (p->queue_count || p->notify_pending)
+        {
+            return 0;
+        }
+
+        if (flags & IPC_NONBLOCK)
+        {
+            spin_unlock_irqrestore(&ipc_lock, *irq);
+            return -2;
+        }
+
+        if (current)
+        {
+            // blocked before the lock drops, so the wakeup cannot be lost
+            p->waiting_receiver = current->id;
+            port_lend(p, current->id);
+            sched_prepare_block();
+            spin_unlock_irqrestore(&ipc_lock, *irq);
+            schedule();
+            continue;
+        }
+        spin_unlock_irqrestore(&ipc_lock, *irq);
+        return -2;
+    }
+}
+
+// caller holds ipc_lock and saw badges pending; hands them over as one message
+static void notify_take(struct port* p, struct message* msg)
+{
+    const uint32_t badges = p->notify_pending;
+    p->notify_pending = 0;
+    msg->sender = 0;
+    msg->receiver = 0;
+    msg->type = MSG_NOTIFY;
+    msg->len = sizeof(uint32_t);
+    msg->page_addr = 0;
+    msg->page_count = 0;
+    memcpy(msg->data, &badges, sizeof(uint32_t));
+}
+
+// caller holds ipc_lock and took messages off the queue; drops the lock
+static void port_received(struct port* p, const uint32_t irq)
+{
+    const struct task* current = sched_get_current();
+    preempt_disable();
+    if (p->waiting_sender)
+    {
+        // the sender lends again when it retries or blocks once more
+        sched_unblock(p->waiting_sender);
+        p->waiting_sender = 0;
+        p->blocked_prio = 0;
+    }
+    port_lend(p, current ? current->id : p->server);
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    preempt_enable();
+}
+
+/*
+ * Queues msg on the port. A call blocks the sender for the reply before
+ * ipc_lock drops, then gives its CPU straight to a waiting receiver; the
+ * lock is released without enabling interrupts so no tick can preempt
+ * the blocked caller before the receiver is running. A reply lends
+ * nothing: the priority a server borrowed stays with the request.
+ */
+static int port_send(const int port_id, struct message* msg, const uint32_t flags, struct ipc_call_wait* call,
+                     const bool reply)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+    if (ports[port_id].owner == 0) return -1;
+    if (!msg || msg->len > MAX_MSG_SIZE) return -1;
+
+    struct port* p = &ports[port_id];
+
+    // the frame table of a port is only allocated once pages go through it
+    struct msg_frames frames;
+    if (frames_attach(msg, flags, &frames) != 0) return -1;
+    if (frames.count && !p->frames)
+    {
+        struct msg_frames* table = (struct msg_frames*)kmalloc(sizeof(struct msg_frames) * MSG_QUEUE_SIZE);
+        if (!table)
+        {
+            frames_return(msg, flags, &frames);
+            return -1;
+        }
+        memset(table, 0, sizeof(struct msg_frames) * MSG_QUEUE_SIZE);
+
+        const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+        if (!p->frames && p->owner != 0)
+        {
+            p->frames = table;
+            table = NULL;
+        }
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        if (table)
+        {
+            kfree(table);
+        }
+    }
+
+    while (1)
+    {
+        if (!p->ring && port_alloc_ring(p) != 0)
+        {
+            frames_return(msg, flags, &frames);
+            return -1;
+        }
+
+        const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+        if (p->owner == 0 || (frames.count && !p->frames))
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            frames_return(msg, flags, &frames);
+            return -1;
+        }
+        if (!p->ring)
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            continue;
+        }
+
+        if (!port_has_room(p, msg->len))
+        {
+            if (flags & IPC_NONBLOCK)
+            {
+                spin_unlock_irqrestore(&ipc_lock, irq);
+                frames_return(msg, flags, &frames);
+                return -2;
+            }
+
+            const struct task* current = sched_get_current();
+            if (current)
+            {
+                sender_wait(p, current, irq);
+                continue;
+            }
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            frames_return(msg, flags, &frames);
+            return -2;
+        }
+
+        if (!call)
+        {
+            preempt_disable();
+        }
+        port_enqueue(p, msg, &frames, call, reply ? 0 : current_priority());
+
+        // the receiver is boosted before it is woken, so it cannot be
+        // overtaken by a medium priority task on the way out of the wait
+        const tid_t receiver = p->waiting_receiver;
+        if (!reply)
+        {
+            port_lend(p, receiver ? receiver : p->server);
+        }
+        if (call)
+        {
+            p->waiting_receiver = 0;
+            sched_prepare_block();
+            spin_unlock(&ipc_lock);
+            if (receiver)
+            {
+                sched_handoff(receiver);
+            }
+            else
+            {
+                schedule();
+            }
+            if (irq & 0x200)
+            {
+                sti();
+            }
+            return 0;
+        }
+        if (receiver)
+        {
+            sched_unblock(receiver);
+            p->waiting_receiver = 0;
+        }
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        preempt_enable();
+
+        return 0;
+    }
+}
+
+int msg_send(const int port_id, struct message* msg, const uint32_t flags)
 {
-    memset(ports, 0, sizeof(ports));
-    port_count = 0;
+    return port_send(port_id, msg, flags, NULL, false);
 }
 
-int port_create(const pid_t owner)
+int ipc_call(const int port_id, struct message* msg, struct message* reply)
 {
-    if (port_count >= MAX_PORTS) return -1;
+    const struct task* current = sched_get_current();
+    if (!current || !msg || !reply) return -1;
+    if (msg->len > MAX_MSG_SIZE) return -1;
 
-    for (uint32_t i = 0; i < MAX_PORTS; i++)
+    struct ipc_call_wait wait;
+    wait.caller = current->id;
+    wait.reply = reply;
+    wait.status = CALL_PENDING;
+
+    // the server answers whoever is named as sender
+    msg->sender = current->pid;
+    msg->page_count = 0;
+    if (port_send(port_id, msg, IPC_BLOCK, &wait, false) != 0)
     {
-        if (ports[i].owner == 0)
-        {
-            ports[i].owner = owner;
-            ports[i].id = i;
-            ports[i].flags = 0;
-            ports[i].queue = (struct message*)kmalloc(sizeof(struct message) * MSG_QUEUE_SIZE);
-            if (!ports[i].queue) return -1;
-            memset(ports[i].queue, 0, sizeof(struct message) * MSG_QUEUE_SIZE);
-            ports[i].queue_head = 0;
-            ports[i].queue_tail = 0;
-            ports[i].queue_size = MSG_QUEUE_SIZE;
-            ports[i].waiting_sender = 0;
-            ports[i].waiting_receiver = 0;
-            port_count++;
-            return (int)i;
+        return -1;
+    }
+
+    while (1)
+    {
+        const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+        if (wait.status != CALL_PENDING)
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            return wait.status;
         }
+        sched_prepare_block();
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        schedule();
     }
-    return -1;
 }
 
-int port_destroy(const int port_id)
+int ipc_reply(const int port_id, struct message* reply)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+    if (!reply || reply->len > MAX_MSG_SIZE) return -1;
+
+    const struct task* current = sched_get_current();
+    if (!current) return -1;
+
+    // only the thread serving the call may answer it
+    struct port* p = &ports[port_id];
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    if (p->owner == 0 || !p->call || p->server != current->id)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+
+    const tid_t caller = call_complete(p, reply);
+    spin_unlock(&ipc_lock);
+    sched_handoff(caller);
+    if (irq & 0x200)
+    {
+        sti();
+    }
+    return 0;
+}
+
+int msg_receive(const int port_id, struct message* msg, const uint32_t flags)
 {
     if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
     if (ports[port_id].owner == 0) return -1;
+    if (!msg) return -1;
 
-    if (ports[port_id].waiting_sender)
+    struct port* p = &ports[port_id];
+    uint32_t irq;
+    const int ret = port_wait_message(p, flags, &irq);
+    if (ret != 0)
     {
-        sched_unblock(ports[port_id].waiting_sender);
+        return ret;
     }
 
-    if (ports[port_id].waiting_receiver)
+    if (p->notify_pending)
     {
-        sched_unblock(ports[port_id].waiting_receiver);
+        notify_take(p, msg);
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return 0;
     }
 
-    if (ports[port_id].queue)
+    uint32_t len;
+    uint32_t page_count;
+    port_peek(p, &len, &page_count);
+
+    const uint32_t window = msg->page_addr;
+    const uint32_t window_pages = msg->page_count;
+    if (page_count)
     {
-        kfree(ports[port_id].queue);
+        // the message stays queued, so a retry with a proper window works
+        const int mapped = frames_map(&p->frames[p->queue_head], window, window_pages);
+        if (mapped != 0)
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            return mapped;
+        }
+        p->frames[p->queue_head].count = 0;
     }
-    memset(&ports[port_id], 0, sizeof(struct port));
-    port_count--;
+
+    const uint32_t slot = port_dequeue(p, msg, len);
+    msg->page_addr = page_count ? window : 0;
+    p->serving_prio = p->queue_prio[slot];
+    p->serving = msg->sender;
+    p->call = p->queue_call[slot];
+    p->queue_call[slot] = NULL;
+    port_received(p, irq);
     return 0;
 }
 
-int msg_send(const int port_id, struct message* msg, const uint32_t flags)
+int msg_send_batch(const int port_id, struct message* msgs, const uint32_t count, const uint32_t flags)
 {
     if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
     if (ports[port_id].owner == 0) return -1;
-    if (!msg) return -1;
+    if (!msgs || count == 0 || (flags & (IPC_MOVE | IPC_SHARE))) return -1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (msgs[i].len > MAX_MSG_SIZE) return -1;
+    }
 
     struct port* p = &ports[port_id];
+    const struct task* current = sched_get_current();
+    const uint8_t prio = current_priority();
+    uint32_t sent = 0;
 
     while (1)
     {
-        const uint32_t next_tail = (p->queue_tail + 1) % p->queue_size;
+        if (!p->ring && port_alloc_ring(p) != 0)
+        {
+            return sent ? (int)sent : -1;
+        }
 
-        if (next_tail == p->queue_head)
+        const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+        if (p->owner == 0)
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            return sent ? (int)sent : -1;
+        }
+        if (!p->ring)
         {
-            if (flags & IPC_NONBLOCK) return -2;
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            continue;
+        }
 
-            struct task* current = sched_get_current();
-            if (current)
+        const uint32_t before = sent;
+        while (sent < count && port_has_room(p, msgs[sent].len))
+        {
+            port_enqueue(p, &msgs[sent], NULL, NULL, prio);
+            sent++;
+        }
+
+        // the whole run costs the receiver one wakeup
+        preempt_disable();
+        if (sent > before)
+        {
+            const tid_t receiver = p->waiting_receiver;
+            port_lend(p, receiver ? receiver : p->server);
+            if (receiver)
             {
-                p->waiting_sender = current->id;
-                sched_block(0);  // Block and reschedule
-                continue;
+                sched_unblock(receiver);
+                p->waiting_receiver = 0;
             }
-            return -2;
         }
 
-        memcpy(&p->queue[p->queue_tail], msg, sizeof(struct message));
-        p->queue_tail = next_tail;
+        if (sent < count && !(flags & IPC_NONBLOCK) && current)
+        {
+            preempt_enable();
+            sender_wait(p, current, irq);
+            continue;
+        }
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        preempt_enable();
+        return sent ? (int)sent : -2;
+    }
+}
+
+int msg_receive_batch(const int port_id, struct message* msgs, const uint32_t max, const uint32_t flags)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+    if (ports[port_id].owner == 0) return -1;
+    if (!msgs || max == 0) return -1;
+
+    struct port* p = &ports[port_id];
+    uint32_t irq;
+    const int ret = port_wait_message(p, flags, &irq);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    uint32_t got = 0;
+    if (p->notify_pending)
+    {
+        notify_take(p, &msgs[got++]);
+    }
+
+    const uint32_t first = got;
+    uint8_t prio = 0;
+    while (got < max && p->queue_count)
+    {
+        uint32_t len;
+        uint32_t page_count;
+        port_peek(p, &len, &page_count);
 
-        if (p->waiting_receiver)
+        // pages need a window and a call is served alone: both end the batch
+        if (page_count || (got > first && p->queue_call[p->queue_head]))
         {
-            sched_unblock(p->waiting_receiver);
-            p->waiting_receiver = 0;
+            break;
         }
 
-        return 0;
+        const uint32_t slot = port_dequeue(p, &msgs[got], len);
+        msgs[got].page_addr = 0;
+        prio = p->queue_prio[slot] > prio ? p->queue_prio[slot] : prio;
+        p->call = p->queue_call[slot];
+        p->queue_call[slot] = NULL;
+        got++;
+        if (p->call)
+        {
+            break;
+        }
+    }
+
+    if (got == first)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return got ? (int)got : -3;
     }
+
+    p->serving_prio = prio;
+    p->serving = msgs[got - 1].sender;
+    port_received(p, irq);
+    return (int)got;
 }
 
-int msg_receive(const int port_id, struct message* msg, const uint32_t flags)
+static bool name_valid(const char* name)
+{
+    if (!name || !name[0])
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < PORT_NAME_MAX; i++)
+    {
+        if (name[i] == '\0')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int port_register(const char* name, const int port_id, const pid_t caller)
 {
     if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
-    if (ports[port_id].owner == 0) return -1;
-    if (!msg) return -1;
+    if (!name_valid(name)) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    const struct port* p = &ports[port_id];
+    if (p->owner == 0 || p->owner != caller || p->name_slot >= 0 || name_find(name) >= 0)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+    name_place(name, port_id);
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return 0;
+}
+
+int port_lookup(const char* name)
+{
+    if (!name_valid(name)) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    const int slot = name_find(name);
+    const int port = slot >= 0 ? names[slot].port : -1;
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return port;
+}
+
+int port_unregister(const char* name, const pid_t caller)
+{
+    if (!name_valid(name)) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    const int slot = name_find(name);
+    if (slot < 0 || ports[names[slot].port].owner != caller)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+    name_remove(slot);
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return 0;
+}
+
+int port_notify(const int port_id, const uint32_t badge)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+    if (badge == 0) return -1;
 
     struct port* p = &ports[port_id];
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    if (p->owner == 0)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
 
-    while (1)
+    p->notify_pending |= badge;
+    if (p->waiting_receiver)
     {
-        if (p->queue_head == p->queue_tail)
+        sched_unblock(p->waiting_receiver);
+        p->waiting_receiver = 0;
+    }
+    port_mark_ready(p);
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return 0;
+}
+
+pid_t port_get_owner(const int port_id)
+{
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return 0;
+    return ports[port_id].owner;
+}
+
+int portset_create(const pid_t owner)
+{
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    for (uint32_t i = 0; i < MAX_PORT_SETS; i++)
+    {
+        if (sets[i].owner == 0)
         {
-            if (flags & IPC_NONBLOCK) return -2;
+            sets[i].owner = owner;
+            sets[i].members = 0;
+            sets[i].ready_head = -1;
+            sets[i].ready_tail = -1;
+            sets[i].waiter = 0;
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            return (int)i;
+        }
+    }
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return -1;
+}
 
-            struct task* current = sched_get_current();
-            if (current)
+int portset_destroy(const int set_id, const pid_t caller)
+{
+    if (set_id < 0 || (uint32_t)set_id >= MAX_PORT_SETS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    struct port_set* s = &sets[set_id];
+    if (s->owner == 0 || s->owner != caller)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < MAX_PORTS && s->members; i++)
+    {
+        if (ports[i].owner && ports[i].set == set_id)
+        {
+            if (ports[i].ready)
             {
-                p->waiting_receiver = current->id;
-                sched_block(0);  // Block and reschedule
-                continue;
+                ready_unlink(&ports[i]);
             }
-            return -2;
+            ports[i].set = -1;
+            s->members--;
+        }
+    }
+    if (s->waiter)
+    {
+        sched_unblock(s->waiter);
+    }
+    memset(s, 0, sizeof(struct port_set));
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return 0;
+}
+
+int portset_add(const int set_id, const int port_id, const pid_t caller)
+{
+    if (set_id < 0 || (uint32_t)set_id >= MAX_PORT_SETS) return -1;
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    struct port* p = &ports[port_id];
+    if (sets[set_id].owner == 0 || sets[set_id].owner != caller || p->owner != caller || p->set >= 0)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+
+    p->set = set_id;
+    sets[set_id].members++;
+    if (p->queue_count)
+    {
+        // messages queued before the port joined count as one edge
+        port_mark_ready(p);
+    }
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return 0;
+}
+
+int portset_remove(const int set_id, const int port_id, const pid_t caller)
+{
+    if (set_id < 0 || (uint32_t)set_id >= MAX_PORT_SETS) return -1;
+    if (port_id < 0 || (uint32_t)port_id >= MAX_PORTS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    struct port* p = &ports[port_id];
+    if (sets[set_id].owner == 0 || sets[set_id].owner != caller || p->owner != caller || p->set != set_id)
+    {
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        return -1;
+    }
+
+    if (p->ready)
+    {
+        ready_unlink(p);
+    }
+    p->set = -1;
+    sets[set_id].members--;
+    spin_unlock_irqrestore(&ipc_lock, irq);
+    return 0;
+}
+
+static void portset_timeout(const uint32_t data)
+{
+    sched_unblock((tid_t)data);
+}
+
+int portset_wait(const int set_id, int* ready, const uint32_t max, const uint32_t timeout_ms, const pid_t caller)
+{
+    if (set_id < 0 || (uint32_t)set_id >= MAX_PORT_SETS) return -1;
+    if (!ready || max == 0) return -1;
+    if (sets[set_id].owner != caller) return -1;
+
+    struct port_set* s = &sets[set_id];
+    struct task* current = sched_get_current();
+    const bool timed = current && timeout_ms != 0 && timeout_ms != PORT_WAIT_FOREVER;
+    if (timed)
+    {
+        timer_setup(&current->sleep_timer, portset_timeout, current->id);
+        mod_timer(&current->sleep_timer, timer_get_ticks() + timer_ms_to_ticks(timeout_ms));
+    }
+
+    int ret = 0;
+    while (1)
+    {
+        const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+        if (current && s->waiter == current->id)
+        {
+            // woken by the timer or the set going away, not by a port
+            s->waiter = 0;
+        }
+        if (s->owner == 0 || s->owner != caller)
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            ret = -1;
+            break;
         }
 
-        memcpy(msg, &p->queue[p->queue_head], sizeof(struct message));
-        p->queue_head = (p->queue_head + 1) % p->queue_size;
+        uint32_t n = 0;
+        while (n < max && s->ready_head >= 0)
+        {
+            ready[n++] = s->ready_head;
+            ready_unlink(&ports[s->ready_head]);
+        }
+        if (n || timeout_ms == 0 || !current)
+        {
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            ret = (int)n;
+            break;
+        }
 
-        if (p->waiting_sender)
+        // blocked before the expiry check, so a timer firing now is not lost
+        s->waiter = current->id;
+        sched_prepare_block();
+        if (timed && !timer_pending(&current->sleep_timer))
         {
-            sched_unblock(p->waiting_sender);
-            p->waiting_sender = 0;
+            sched_cancel_block();
+            s->waiter = 0;
+            spin_unlock_irqrestore(&ipc_lock, irq);
+            break;
         }
+        spin_unlock_irqrestore(&ipc_lock, irq);
+        schedule();
+    }
 
-        return 0;
+    if (timed)
+    {
+        del_timer(&current->sleep_timer);
+    }
+    return ret;
+}
+
+// drops the priority the caller borrowed while serving dest
+static void reply_release(const pid_t dest)
+{
+    const struct task* current = sched_get_current();
+    if (!current)
+    {
+        return;
     }
+
+    const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+    for (uint32_t i = 0; i < MAX_PORTS; i++)
+    {
+        struct port* p = &ports[i];
+        if (p->owner != 0 && p->server == current->id && p->serving_prio && p->serving == dest)
+        {
+            p->serving_prio = 0;
+            p->serving = 0;
+            port_lend(p, current->id);
+        }
+    }
+    spin_unlock_irqrestore(&ipc_lock, irq);
 }
 
 int msg_reply(const pid_t dest, struct message* msg)
 {
+    int ret = -1;
+
+    // a caller blocked in ipc_call gets the answer directly
+    const struct task* current = sched_get_current();
+    if (current && msg && msg->len <= MAX_MSG_SIZE)
+    {
+        const uint32_t irq = spin_lock_irqsave(&ipc_lock);
+        for (uint32_t i = 0; i < MAX_PORTS; i++)
+        {
+            struct port* p = &ports[i];
+            if (p->owner != 0 && p->call && p->server == current->id && p->serving == dest)
+            {
+                const tid_t caller = call_complete(p, msg);
+                spin_unlock(&ipc_lock);
+                sched_handoff(caller);
+                if (irq & 0x200)
+                {
+                    sti();
+                }
+                return 0;
+            }
+        }
+        spin_unlock_irqrestore(&ipc_lock, irq);
+    }
+
     // finds port owned by dest process
     for (uint32_t i = 0; i < MAX_PORTS; i++)
     {
         if (ports[i].owner == dest)
         {
-            return msg_send((int)i, msg, IPC_NONBLOCK);
+            ret = port_send((int)i, msg, IPC_NONBLOCK, NULL, true);
+            break;
         }
     }
-    return -1;
+
+    // the boost lasts until the reply is queued, not just until it is built
+    reply_release(dest);
+    return ret;
 }
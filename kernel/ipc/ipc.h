@@ -10,6 +10,9 @@ extern "C" {
 
 /**
  * @brief IPC message types
+ * @details A MSG_NOTIFY message is made up by the receive call from the
+ *          pending notification badges of the port; its data holds the
+ *          OR of all badges as a uint32_t.
  */
 #define MSG_SEND     0
 #define MSG_RECEIVE  1
@@ -18,29 +21,125 @@ extern "C" {
 
 #define IPC_BLOCK    0x01
 #define IPC_NONBLOCK 0x02
+#define IPC_MOVE     0x04
+#define IPC_SHARE    0x08
 
-/// @brief IPC message structure \struct message
+/**
+ * @brief Most messages a port can queue
+ */
+#define MSG_QUEUE_SIZE 16
+
+/**
+ * @brief Byte capacity of a port queue
+ * @details A queued message takes its header plus len bytes, rounded up to
+ *          a word, so the ring holds many small messages or a few full
+ *          ones. The minimum fits one message of MAX_MSG_SIZE bytes.
+ */
+#define PORT_RING_DEFAULT 2048
+#define PORT_RING_MIN     (__builtin_offsetof(struct message, data) + MAX_MSG_SIZE)
+#define PORT_RING_MAX     65536
+
+/**
+ * @brief Most pages one message can carry (64 KB)
+ */
+#define IPC_MAX_PAGES 16
+
+/**
+ * @brief Most messages one batch syscall moves
+ */
+#define IPC_BATCH_MAX 64
+
+/**
+ * @brief Longest port name, including the terminating NUL
+ */
+#define PORT_NAME_MAX 32
+
+/**
+ * @brief Timeout of portset_wait that never expires
+ */
+#define PORT_WAIT_FOREVER 0xFFFFFFFF
+
+/**
+ * @brief IPC message structure \struct message
+ * @details Up to MAX_MSG_SIZE bytes travel inline in data. Larger payloads
+ *          are passed as whole pages: the sender names page_count pages at
+ *          the page aligned page_addr and sends with IPC_MOVE or IPC_SHARE.
+ *          The receiver sets page_addr/page_count to an unmapped window
+ *          before it receives and gets back where the pages were mapped.
+ */
 struct message
 {
     pid_t   sender;
     pid_t   receiver;
     uint32_t type;
     uint32_t len;
+    uint32_t page_addr;
+    uint32_t page_count;
     uint8_t  data[MAX_MSG_SIZE];
 };
 
-/// @brief IPC port structure \struct port
+/**
+ * @brief Frames attached to a queued message \struct msg_frames
+ */
+struct msg_frames
+{
+    uint32_t count;
+    uint32_t phys[IPC_MAX_PAGES];
+    uint32_t flags[IPC_MAX_PAGES];
+};
+
+struct ipc_call_wait;
+
+/**
+ * @brief IPC port structure \struct port
+ * @details Messages queue in ring, which is allocated on the first send.
+ *          Senders lend their priority to the server thread of the port
+ *          while their message is queued, while they are blocked on a full
+ *          queue and, once received, until the server replies to them.
+ */
 struct port
 {
     pid_t    owner;
     uint32_t id;
     uint32_t flags;
-    struct message* queue;
+    uint8_t* ring;
+    uint32_t ring_size;
+    uint32_t ring_head;
+    uint32_t ring_used;
+    struct msg_frames* frames;
     uint32_t queue_head;
-    uint32_t queue_tail;
-    uint32_t queue_size;
+    uint32_t queue_count;
+    uint32_t queue_limit;
     tid_t waiting_sender;
     tid_t waiting_receiver;
+    uint8_t queue_prio[MSG_QUEUE_SIZE];
+    uint8_t blocked_prio;
+    uint8_t serving_prio;
+    uint8_t lent_prio;
+    pid_t serving;
+    tid_t server;
+    struct ipc_call_wait* queue_call[MSG_QUEUE_SIZE];
+    struct ipc_call_wait* call;
+    uint32_t notify_pending;
+    int set;
+    int ready_prev;
+    int ready_next;
+    bool ready;
+    int name_slot;
+};
+
+/**
+ * @brief Set of ports waited on together \struct port_set
+ * @details Member ports link themselves into the ready list when a message
+ *          arrives, so a wait only looks at the ports that have work.
+ */
+struct port_set
+{
+    pid_t owner;
+    uint32_t members;
+    int ready_head;
+    int ready_tail;
+    tid_t waiter;
 };
 
 /**
@@ -55,6 +154,24 @@ void ipc_init(void);
  */
 int port_create(pid_t owner);
 
+/**
+ * @brief Set how much a port can queue
+ * @details The byte size can only change while the queue is empty.
+ * @param port_id The ID of the port
+ * @param bytes Ring capacity, PORT_RING_MIN to PORT_RING_MAX
+ * @param messages Most queued messages, 1 to MSG_QUEUE_SIZE
+ * @param caller The PID asking, must own the port
+ * @return 0 on success, -1 on invalid limits, a busy queue or a port not
+ *         owned by caller
+ */
+int port_set_limits(int port_id, uint32_t bytes, uint32_t messages, pid_t caller);
+
+/**
+ * @brief Get the heap memory held by port queues
+ * @return Bytes of allocated rings and frame tables over all ports
+ */
+uint32_t ipc_get_queue_memory(void);
+
 /**
  * @brief Destroy an IPC port
  * @param port_id The ID of the port to destroy
@@ -64,24 +181,198 @@ int port_destroy(int port_id);
 
 /**
  * @brief Send a message to an IPC port
+ * @details With IPC_MOVE the pages named by the message are unmapped from
+ *          the sender; with IPC_SHARE they stay mapped and both sides see
+ *          them copy-on-write. Either way no payload bytes are copied.
  * @param port_id The ID of the destination port
  * @param msg Pointer to the message to send
  * @param flags Message sending flags
- * @return 0 on success, -1 on failure
+ * @return 0 on success, -1 on failure, -2 if the queue is full and the
+ *         call would block
  */
 int msg_send(int port_id, struct message* msg, uint32_t flags);
 
 /**
  * @brief Receive a message from an IPC port
+ * @details Pages carried by the message are mapped at msg->page_addr, which
+ *          must name at least as many unmapped pages as were sent. Pending
+ *          notification badges are received first, as one MSG_NOTIFY
+ *          message.
  * @param port_id The ID of the port to receive from
  * @param msg Pointer to the message structure to fill
  * @param flags Message receiving flags
- * @return 0 on success, -1 on failure
+ * @return 0 on success, -1 on failure, -2 if no message is queued and the
+ *         call would block, -3 if the page window does not fit the message,
+ *         which stays queued
  */
 int msg_receive(int port_id, struct message* msg, uint32_t flags);
 
+/**
+ * @brief Send several inline messages to an IPC port
+ * @details Queues as many messages as fit under one lock hold and wakes the
+ *          receiver once for them. With IPC_BLOCK the caller waits for room
+ *          until all are queued. Pages cannot be sent in a batch.
+ * @param port_id The ID of the destination port
+ * @param msgs Array of messages, sent in order
+ * @param count Number of messages in msgs
+ * @param flags Message sending flags
+ * @return Number of messages queued, -1 on failure, -2 if the queue is full
+ *         and nothing could be sent without blocking
+ */
+int msg_send_batch(int port_id, struct message* msgs, uint32_t count, uint32_t flags);
+
+/**
+ * @brief Receive every queued message of an IPC port, up to a limit
+ * @details Waits like msg_receive for the first message, then drains the
+ *          queue without blocking again. The batch stops before a message
+ *          that carries pages, which must be taken with msg_receive, and a
+ *          call is always returned alone so ipc_reply answers the right one.
+ *          Pending notification badges come first as one MSG_NOTIFY message.
+ * @param port_id The ID of the port to receive from
+ * @param msgs Array to fill
+ * @param max Number of entries in msgs
+ * @param flags Message receiving flags
+ * @return Number of messages received, -1 on failure, -2 if no message is
+ *         queued and the call would block, -3 if the oldest message carries
+ *         pages
+ */
+int msg_receive_batch(int port_id, struct message* msgs, uint32_t max, uint32_t flags);
+
+/**
+ * @brief Publish a port under a name
+ * @details Only the owner of the port can name it, and a port has at most
+ *          one name. The name goes away with the port.
+ * @param name NUL terminated name, 1 to PORT_NAME_MAX - 1 characters
+ * @param port_id The ID of the port
+ * @param caller The PID asking, must own the port
+ * @return 0 on success, -1 if the name is taken or invalid, the port is
+ *         already named or not owned by caller
+ */
+int port_register(const char* name, int port_id, pid_t caller);
+
+/**
+ * @brief Find the port published under a name
+ * @param name NUL terminated name
+ * @return The port ID, or -1 if no port has that name
+ */
+int port_lookup(const char* name);
+
+/**
+ * @brief Withdraw a port name
+ * @param name NUL terminated name
+ * @param caller The PID asking, must own the named port
+ * @return 0 on success, -1 if the name is unknown or caller does not own
+ *         the port
+ */
+int port_unregister(const char* name, pid_t caller);
+
+/**
+ * @brief Post notification badges to a port
+ * @details ORs badge into the pending mask of the port in O(1) without
+ *          taking a queue slot, so it never blocks and never fails on a full
+ *          queue. Badges posted before the next receive coalesce into one
+ *          MSG_NOTIFY message, which is received ahead of queued messages.
+ *          Safe to call from interrupt handlers and timer callbacks.
+ * @param port_id The ID of the port
+ * @param badge Bits to post, not 0
+ * @return 0 on success, -1 on an invalid port or badge
+ */
+int port_notify(int port_id, uint32_t badge);
+
+/**
+ * @brief Get the owner of a port
+ * @param port_id The port ID
+ * @return The PID of the owner, or 0 if the port is not in use
+ */
+pid_t port_get_owner(int port_id);
+
+/**
+ * @brief Create an empty port set
+ * @param owner The PID of the set owner
+ * @return The set ID on success, -1 on failure
+ */
+int portset_create(pid_t owner);
+
+/**
+ * @brief Destroy a port set
+ * @details Member ports leave the set and a task waiting on it returns -1.
+ * @param set_id The ID of the set
+ * @param caller The PID asking, must own the set
+ * @return 0 on success, -1 on failure
+ */
+int portset_destroy(int set_id, pid_t caller);
+
+/**
+ * @brief Add a port to a port set
+ * @details A port belongs to at most one set. A port that already has
+ *          messages queued is reported by the next wait.
+ * @param set_id The ID of the set
+ * @param port_id The ID of the port
+ * @param caller The PID asking, must own both the set and the port
+ * @return 0 on success, -1 if either is invalid or not owned by caller, or
+ *         the port is in a set
+ */
+int portset_add(int set_id, int port_id, pid_t caller);
+
+/**
+ * @brief Remove a port from its port set
+ * @param set_id The ID of the set
+ * @param port_id The ID of the port
+ * @param caller The PID asking, must own both the set and the port
+ * @return 0 on success, -1 if the port is not a member of the set or
+ *         either is not owned by caller
+ */
+int portset_remove(int set_id, int port_id, pid_t caller);
+
+/**
+ * @brief Wait until ports of a set have messages
+ * @details Readiness is edge triggered: a port is reported once for the
+ *          messages that arrived since it was last reported, so the caller
+ *          should drain it with IPC_NONBLOCK receives. Ports come back in
+ *          the order they became ready.
+ * @param set_id The ID of the set
+ * @param ready Filled with the IDs of ready ports
+ * @param max Number of entries in ready
+ * @param timeout_ms How long to wait, 0 to poll, PORT_WAIT_FOREVER to wait
+ *        without a limit
+ * @param caller The PID asking, must own the set
+ * @return Number of ready ports, 0 on timeout, -1 on failure or a set not
+ *         owned by caller
+ */
+int portset_wait(int set_id, int* ready, uint32_t max, uint32_t timeout_ms, pid_t caller);
+
+/**
+ * @brief Send a request and wait for its reply
+ * @details The caller blocks until the server answers with ipc_reply or
+ *          msg_reply. A server already waiting in msg_receive gets the CPU
+ *          directly, and the reply hands it straight back. Only the inline
+ *          part of the message is sent, with msg->sender set to the
+ *          caller's PID so msg_reply finds it.
+ * @param port_id The ID of the server port
+ * @param msg The request
+ * @param reply Filled with the reply
+ * @return 0 on success, -1 on failure or if the port went away or the
+ *         server dropped the request
+ */
+int ipc_call(int port_id, struct message* msg, struct message* reply);
+
+/**
+ * @brief Answer the request in service on a port
+ * @details Copies the reply straight into the waiting caller and switches
+ *          to it. The caller of ipc_reply stays runnable. Only the thread
+ *          that received the call can answer it.
+ * @param port_id The port the request was received on
+ * @param reply The reply
+ * @return 0 on success, -1 if no call is being served on the port or the
+ *         caller is not serving it
+ */
+int ipc_reply(int port_id, struct message* reply);
+
 /**
  * @brief Reply to a received message
+ * @details Ends the priority the sender lent to the caller while its
+ *          message was being served. The reply is queued at the lowest
+ *          priority, so the sender does not keep the caller's boost.
  * @param dest The PID of the message sender
  * @param msg Pointer to the reply message
  * @return 0 on success, -1 on failure
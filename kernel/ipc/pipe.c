@@ -0,0 +1,433 @@
+#include "pipe.h"
+#include "../sched/futex.h"
+#include "../mm/heap.h"
+#include "../include/spinlock.h"
+#include "../include/string.h"
+#include "../include/cast.h"
+
+/*
+ * Anonymous pipes. Each pipe is a PIPE_SIZE byte ring in the kernel heap;
+ * head and tail count bytes ever written and read. Descriptors live in a
+ * table per process, shared by its threads and copied on fork, and name a
+ * pipe and an end.
+ *
+ * Sleepers wait on futexes over read_seq and write_seq, which move under
+ * the pipe lock whenever the other side should look again. A sleeper reads
+ * the sequence under the lock and waits for that value, so an event landing
+ * between the unlock and the wait is never lost. Writers only wake readers
+ * once PIPE_WAKE_THRESHOLD bytes are in, when the ring fills or when the
+ * write call ends, and readers wake writers once as much space is free, so
+ * a long transfer costs a wakeup per chunk rather than per call.
+ */
+#define FD_NONE   (-1)
+#define END_READ  0
+#define END_WRITE 1
+
+struct pipe
+{
+    uint8_t* buf;
+    uint32_t head;
+    uint32_t tail;
+    uint16_t readers;
+    uint16_t writers;
+    uint16_t refs;
+    uint16_t readers_sleeping;
+    uint16_t writers_sleeping;
+    volatile uint32_t read_seq;
+    volatile uint32_t write_seq;
+};
+
+struct fd_table
+{
+    pid_t pid;
+    int16_t fd[MAX_FDS];
+    uint8_t flags[MAX_FDS];
+};
+
+static struct pipe pipes[MAX_PIPES];
+static struct fd_table tables[MAX_PROCESSES];
+static spinlock_t pipe_lock = SPINLOCK_INIT;
+
+// caller holds pipe_lock
+static struct fd_table* table_find(const pid_t pid)
+{
+    for (uint32_t i = 0; i < MAX_PROCESSES; i++)
+    {
+        if (tables[i].pid == pid)
+        {
+            return &tables[i];
+        }
+    }
+    return NULL;
+}
+
+// caller holds pipe_lock
+static struct fd_table* table_get(const pid_t pid)
+{
+    struct fd_table* t = table_find(pid);
+    if (t || pid == 0)
+    {
+        return t;
+    }
+    t = table_find(0);
+    if (t)
+    {
+        t->pid = pid;
+        for (uint32_t i = 0; i < MAX_FDS; i++)
+        {
+            t->fd[i] = FD_NONE;
+        }
+    }
+    return t;
+}
+
+// caller holds pipe_lock
+static int fd_alloc(struct fd_table* t, const int16_t obj, const uint8_t flags)
+{
+    for (uint32_t i = 0; i < MAX_FDS; i++)
+    {
+        if (t->fd[i] == FD_NONE)
+        {
+            t->fd[i] = obj;
+            t->flags[i] = flags;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// caller holds pipe_lock
+static void wake_side(volatile uint32_t* seq, const uint32_t count)
+{
+    (*seq)++;
+    futex_wake(PTR_TO_U32(seq), count);
+}
+
+// caller holds pipe_lock; returns the buffer to free once the lock is gone
+static uint8_t* pipe_put(struct pipe* p)
+{
+    if (--p->refs)
+    {
+        return NULL;
+    }
+    uint8_t* buf = p->buf;
+    memset(p, 0, sizeof(struct pipe));
+    return buf;
+}
+
+// caller holds pipe_lock; drops one end and returns the buffer to free, if any
+static uint8_t* end_close(const int16_t obj)
+{
+    struct pipe* p = &pipes[obj >> 1];
+    if ((obj & 1) == END_READ)
+    {
+        if (--p->readers == 0 && p->writers_sleeping)
+        {
+            wake_side(&p->write_seq, FUTEX_WAKE_ALL);
+        }
+    }
+    else if (--p->writers == 0 && p->readers_sleeping)
+    {
+        wake_side(&p->read_seq, FUTEX_WAKE_ALL);
+    }
+    return pipe_put(p);
+}
+
+// caller holds pipe_lock; takes a reference that keeps the pipe across a sleep
+static struct pipe* fd_pipe(const pid_t pid, const int fd, const uint32_t end, bool* nonblock)
+{
+    if (fd < 0 || fd >= MAX_FDS) return NULL;
+
+    const struct fd_table* t = table_find(pid);
+    if (!t || pid == 0 || t->fd[fd] == FD_NONE || (uint32_t)(t->fd[fd] & 1) != end)
+    {
+        return NULL;
+    }
+    struct pipe* p = &pipes[t->fd[fd] >> 1];
+    p->refs++;
+    *nonblock = (t->flags[fd] & PIPE_NONBLOCK) != 0;
+    return p;
+}
+
+void pipe_init(void)
+{
+    spin_init(&pipe_lock);
+    memset(pipes, 0, sizeof(pipes));
+    memset(tables, 0, sizeof(tables));
+}
+
+int pipe_create(const pid_t pid, int fds[2], const uint32_t flags)
+{
+    if (!fds || pid == 0) return -1;
+
+    // allocated up front, the heap is not used under pipe_lock
+    uint8_t* buf = (uint8_t*)kmalloc(PIPE_SIZE);
+    if (!buf) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&pipe_lock);
+    struct fd_table* t = table_get(pid);
+    int id = -1;
+    for (uint32_t i = 0; i < MAX_PIPES && t; i++)
+    {
+        if (pipes[i].refs == 0)
+        {
+            id = (int)i;
+            break;
+        }
+    }
+    if (id < 0)
+    {
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        kfree(buf);
+        return -1;
+    }
+
+    const uint8_t fd_flags = (uint8_t)(flags & PIPE_NONBLOCK);
+    const int rfd = fd_alloc(t, (int16_t)(id << 1 | END_READ), fd_flags);
+    const int wfd = rfd < 0 ? -1 : fd_alloc(t, (int16_t)(id << 1 | END_WRITE), fd_flags);
+    if (wfd < 0)
+    {
+        if (rfd >= 0)
+        {
+            t->fd[rfd] = FD_NONE;
+        }
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        kfree(buf);
+        return -1;
+    }
+
+    struct pipe* p = &pipes[id];
+    memset(p, 0, sizeof(struct pipe));
+    p->buf = buf;
+    p->readers = 1;
+    p->writers = 1;
+    p->refs = 2;
+    spin_unlock_irqrestore(&pipe_lock, irq);
+
+    fds[0] = rfd;
+    fds[1] = wfd;
+    return 0;
+}
+
+int pipe_read(const pid_t pid, const int fd, void* buf, const uint32_t len)
+{
+    if (!buf && len) return -1;
+
+    uint32_t irq = spin_lock_irqsave(&pipe_lock);
+    bool nonblock = false;
+    struct pipe* p = fd_pipe(pid, fd, END_READ, &nonblock);
+    if (!p)
+    {
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        return -1;
+    }
+
+    int ret;
+    while (1)
+    {
+        const uint32_t used = p->head - p->tail;
+        if (used || len == 0)
+        {
+            const uint32_t n = len < used ? len : used;
+            const uint32_t off = p->tail % PIPE_SIZE;
+            const uint32_t first = n < PIPE_SIZE - off ? n : PIPE_SIZE - off;
+            memcpy(buf, p->buf + off, first);
+            memcpy((uint8_t*)buf + first, p->buf, n - first);
+            p->tail += n;
+            if (p->writers_sleeping && PIPE_SIZE - (p->head - p->tail) >= PIPE_WAKE_THRESHOLD)
+            {
+                wake_side(&p->write_seq, 1);
+            }
+            ret = (int)n;
+            break;
+        }
+        if (p->writers == 0)
+        {
+            ret = 0;
+            break;
+        }
+        if (nonblock)
+        {
+            ret = -3;
+            break;
+        }
+
+        const uint32_t seq = p->read_seq;
+        p->readers_sleeping++;
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        futex_wait(PTR_TO_U32(&p->read_seq), seq, FUTEX_WAIT_FOREVER);
+        irq = spin_lock_irqsave(&pipe_lock);
+        p->readers_sleeping--;
+    }
+
+    uint8_t* dead = pipe_put(p);
+    spin_unlock_irqrestore(&pipe_lock, irq);
+    if (dead)
+    {
+        kfree(dead);
+    }
+    return ret;
+}
+
+int pipe_write(const pid_t pid, const int fd, const void* buf, const uint32_t len)
+{
+    if (!buf && len) return -1;
+
+    uint32_t irq = spin_lock_irqsave(&pipe_lock);
+    bool nonblock = false;
+    struct pipe* p = fd_pipe(pid, fd, END_WRITE, &nonblock);
+    if (!p)
+    {
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        return -1;
+    }
+
+    const uint8_t* src = (const uint8_t*)buf;
+    uint32_t done = 0;
+    int ret;
+    while (1)
+    {
+        if (p->readers == 0)
+        {
+            ret = done ? (int)done : -2;
+            break;
+        }
+
+        const uint32_t space = PIPE_SIZE - (p->head - p->tail);
+        const uint32_t n = len - done < space ? len - done : space;
+        const uint32_t off = p->head % PIPE_SIZE;
+        const uint32_t first = n < PIPE_SIZE - off ? n : PIPE_SIZE - off;
+        memcpy(p->buf + off, src + done, first);
+        memcpy(p->buf, src + done + first, n - first);
+        p->head += n;
+        done += n;
+
+        const uint32_t used = p->head - p->tail;
+        if (p->readers_sleeping && n && (done == len || used >= PIPE_WAKE_THRESHOLD))
+        {
+            wake_side(&p->read_seq, 1);
+        }
+        if (done == len)
+        {
+            ret = (int)done;
+            break;
+        }
+        if (nonblock)
+        {
+            ret = done ? (int)done : -3;
+            break;
+        }
+
+        const uint32_t seq = p->write_seq;
+        p->writers_sleeping++;
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        futex_wait(PTR_TO_U32(&p->write_seq), seq, FUTEX_WAIT_FOREVER);
+        irq = spin_lock_irqsave(&pipe_lock);
+        p->writers_sleeping--;
+    }
+
+    uint8_t* dead = pipe_put(p);
+    spin_unlock_irqrestore(&pipe_lock, irq);
+    if (dead)
+    {
+        kfree(dead);
+    }
+    return ret;
+}
+
+int pipe_close(const pid_t pid, const int fd)
+{
+    if (fd < 0 || fd >= MAX_FDS) return -1;
+
+    const uint32_t irq = spin_lock_irqsave(&pipe_lock);
+    struct fd_table* t = table_find(pid);
+    if (!t || pid == 0 || t->fd[fd] == FD_NONE)
+    {
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        return -1;
+    }
+    const int16_t obj = t->fd[fd];
+    t->fd[fd] = FD_NONE;
+    uint8_t* dead = end_close(obj);
+    spin_unlock_irqrestore(&pipe_lock, irq);
+
+    if (dead)
+    {
+        kfree(dead);
+    }
+    return 0;
+}
+
+int pipe_fork(const pid_t parent, const pid_t child)
+{
+    const uint32_t irq = spin_lock_irqsave(&pipe_lock);
+    const struct fd_table* from = parent ? table_find(parent) : NULL;
+    if (!from)
+    {
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        return 0;
+    }
+    struct fd_table* to = table_get(child);
+    if (!to)
+    {
+        spin_unlock_irqrestore(&pipe_lock, irq);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < MAX_FDS; i++)
+    {
+        const int16_t obj = from->fd[i];
+        to->fd[i] = obj;
+        to->flags[i] = from->flags[i];
+        if (obj == FD_NONE)
+        {
+            continue;
+        }
+        struct pipe* p = &pipes[obj >> 1];
+        if ((obj & 1) == END_READ)
+        {
+            p->readers++;
+        }
+        else
+        {
+            p->writers++;
+        }
+        p->refs++;
+    }
+    spin_unlock_irqrestore(&pipe_lock, irq);
+    return 0;
+}
+
+void pipe_exit(const pid_t pid)
+{
+    if (pid == 0)
+    {
+        return;
+    }
+
+    uint8_t* dead[MAX_FDS];
+    uint32_t count = 0;
+    const uint32_t irq = spin_lock_irqsave(&pipe_lock);
+    struct fd_table* t = table_find(pid);
+    if (t)
+    {
+        for (uint32_t i = 0; i < MAX_FDS; i++)
+        {
+            if (t->fd[i] != FD_NONE)
+            {
+                uint8_t* buf = end_close(t->fd[i]);
+                if (buf)
+                {
+                    dead[count++] = buf;
+                }
+            }
+        }
+        t->pid = 0;
+    }
+    spin_unlock_irqrestore(&pipe_lock, irq);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        kfree(dead[i]);
+    }
+}
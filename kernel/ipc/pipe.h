@@ -0,0 +1,98 @@
+#ifndef KERNEL_PIPE_H
+#define KERNEL_PIPE_H
+
+#include "../include/types.h"
+#include "../include/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ring buffer of a pipe (16 KB)
+ */
+#define PIPE_SIZE (4 * PAGE_SIZE)
+
+/**
+ * @brief Fill level at which a writer wakes sleeping readers, and free
+ *        space at which a reader wakes sleeping writers
+ * @details A write call that completes always wakes a sleeping reader;
+ *          the threshold only applies while a long write is still copying.
+ */
+#define PIPE_WAKE_THRESHOLD (PIPE_SIZE / 4)
+
+/**
+ * @brief Flags for pipe_create
+ */
+#define PIPE_NONBLOCK 0x01
+
+/**
+ * @brief Initialize the pipe and file descriptor tables
+ */
+void pipe_init(void);
+
+/**
+ * @brief Create a pipe and open both ends in a process
+ * @param pid The process that gets the descriptors
+ * @param fds Filled with the read end in fds[0] and the write end in fds[1]
+ * @param flags PIPE_NONBLOCK to make both ends non-blocking
+ * @return 0 on success, -1 if no pipe, buffer or descriptor is free
+ */
+int pipe_create(pid_t pid, int fds[2], uint32_t flags);
+
+/**
+ * @brief Read from the read end of a pipe
+ * @details Blocks until at least one byte is there unless the descriptor
+ *          is non-blocking, then returns what is available up to len.
+ * @param pid The calling process
+ * @param fd A read end descriptor of the process
+ * @param buf Buffer to fill
+ * @param len Size of buf
+ * @return Bytes read, 0 at end of file once every write end is closed,
+ *         -1 on a bad descriptor, -3 if non-blocking and empty
+ */
+int pipe_read(pid_t pid, int fd, void* buf, uint32_t len);
+
+/**
+ * @brief Write to the write end of a pipe
+ * @details Blocks until every byte is in the pipe unless the descriptor is
+ *          non-blocking, in which case it writes what fits. A write cut
+ *          short by the last reader going away returns the bytes written.
+ * @param pid The calling process
+ * @param fd A write end descriptor of the process
+ * @param buf Bytes to write
+ * @param len Number of bytes
+ * @return Bytes written, -1 on a bad descriptor, -2 if no read end is open,
+ *         -3 if non-blocking and full
+ */
+int pipe_write(pid_t pid, int fd, const void* buf, uint32_t len);
+
+/**
+ * @brief Close a descriptor
+ * @details Closing the last write end wakes readers to see end of file;
+ *          closing the last read end wakes writers to fail.
+ * @param pid The calling process
+ * @param fd The descriptor
+ * @return 0 on success, -1 on a bad descriptor
+ */
+int pipe_close(pid_t pid, int fd);
+
+/**
+ * @brief Give a forked child copies of its parent's descriptors
+ * @param parent The forking process
+ * @param child The new process
+ * @return 0 on success, -1 if no descriptor table is free
+ */
+int pipe_fork(pid_t parent, pid_t child);
+
+/**
+ * @brief Close every descriptor of an exiting process
+ * @param pid The process
+ */
+void pipe_exit(pid_t pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,13 +3,24 @@
 #include "arch/i686/gdt.h"
 #include "arch/i686/idt.h"
 #include "arch/i686/arch.h"
+#include "arch/i686/lapic.h"
+#include "arch/i686/ioapic.h"
+#include "arch/i686/smp.h"
 #include "mm/pmm.h"
 #include "mm/heap.h"
 #include "mm/vmm.h"
+#include "mm/stack.h"
 #include "sched/sched.h"
+#include "sched/futex.h"
 #include "ipc/ipc.h"
+#include "ipc/channel.h"
+#include "ipc/pipe.h"
 #include "ui/console.h"
 #include "sys/timer.h"
+#include "sys/clock.h"
+#include "sys/softirq.h"
+#include "sys/workqueue.h"
+#include "sys/udrv.h"
 #include "core/syscall.h"
 #include "drivers/input/keyboard.h"
 #include "ui/shell.h"
@@ -19,6 +30,7 @@
 #include "drivers/storage/ata.h"
 #include "drivers/storage/ahci.h"
 #include "drivers/char/rtc.h"
+#include "drivers/char/serial.h"
 #include "drivers/bus/acpi.h"
 #include "drivers/bus/pci.h"
 #include "drivers/video/vesa.h"
@@ -26,6 +38,10 @@
 #include "../tests/test_task.h"
 #include "../include/cast.h"
 
+// the shell and TUI get a reserved share of the CPU for bounded input latency
+#define INIT_DL_RUNTIME_US 5000
+#define INIT_DL_PERIOD_US  20000
+
 extern uint32_t _kernel_end;
 
 static uint8_t kernel_heap_mem[KERNEL_HEAP_SIZE] __attribute__((aligned(4096)));
@@ -34,7 +50,7 @@ static void idle_task(void)
 {
     while (1)
     {
-        hlt();
+        timer_idle();
     }
 }
 
@@ -76,6 +92,7 @@ void kernel_panic(const char* msg)
     console_write_hex(read_cr3());
     console_write("\n\nSystem halted.\n");
     console_write("========================================\n");
+    serial_flush();
     while (1) hlt();
 }
 
@@ -131,7 +148,7 @@ void scan_drives(void)
         console_write("[boot] No storage drives detected\n");
         console_write("[boot] Continuing in RAM-only mode...\n");
         log_warn("No ATA drives found, using RAM-only filesystem");
-        for (volatile int i = 0; i < 50000000; i++);
+        timer_sleep_ms(2000);
     }
 }
 
@@ -154,12 +171,17 @@ void kernel_main(const uint32_t mboot_magic, const uint32_t mboot_info)
 
     console_write("[boot] Initializing GDT...\n");
     gdt_init();
+    smp_early_init();
     log_info("GDT initialized");
 
     console_write("[boot] Initializing IDT...\n");
     idt_init();
     log_info("IDT initialized");
 
+    console_write("[boot] Initializing softirqs...\n");
+    softirq_init();
+    log_info("Softirqs and tasklets initialized");
+
     console_write("[boot] Initializing memory...\n");
     const uint32_t mem_end = 128 * 1024 * 1024;
     pmm_init(mem_end, PTR_TO_U32(&_kernel_end));
@@ -192,18 +214,32 @@ void kernel_main(const uint32_t mboot_magic, const uint32_t mboot_info)
     vmm_init();
     log_info("Virtual memory manager initialized");
 
+    console_write("[boot] Initializing stack cache...\n");
+    stack_cache_init(STACK_CACHE_PREWARM);
+    log_info("Stack cache initialized");
+
     console_write("[boot] Initializing IPC...\n");
     ipc_init();
+    channel_init();
+    pipe_init();
     log_info("IPC subsystem initialized");
 
     console_write("[boot] Initializing scheduler...\n");
     sched_init();
+    futex_init();
     log_info("Scheduler initialized");
 
+    udrv_init();
+    log_info("User driver tables initialized");
+
     console_write("[boot] Initializing syscalls...\n");
     syscall_init();
     log_info("Syscall interface initialized");
 
+    console_write("[boot] Initializing timer...\n");
+    timer_init(TICK_FREQUENCY_HZ);
+    log_info("Timer initialized");
+
     console_write("[boot] Initializing framebuffer...\n");
     vesa_init(PTR_FROM_U32(mboot_info));
     log_info("VESA framebuffer initialized");
@@ -216,10 +252,37 @@ void kernel_main(const uint32_t mboot_magic, const uint32_t mboot_info)
     acpi_init();
     log_info("ACPI subsystem initialized");
 
+    console_write("[boot] Initializing local APIC...\n");
+    if (lapic_init(acpi_get_local_apic_address()))
+    {
+        log_info("Local APIC initialized");
+
+        // route the ISA IRQs through the I/O APIC; keep the PIC otherwise
+        if (ioapic_init(acpi_get_io_apic_address(), acpi_get_io_apic_gsi_base()))
+        {
+            ioapic_route_isa_irqs(32, lapic_get_id());
+            irq_set_mode(IRQ_MODE_APIC);
+            log_info("Interrupts delivered through the I/O APIC");
+        }
+    }
+    if (irq_get_mode() == IRQ_MODE_PIC)
+    {
+        log_info("Interrupts delivered through the 8259 PIC");
+    }
+
     console_write("[boot] Initializing RTC...\n");
     rtc_init();
     log_info("RTC driver initialized");
 
+    console_write("[boot] Initializing clocksource...\n");
+    clock_init();
+    log_info("Clocksource initialized");
+
+    if (irq_get_mode() == IRQ_MODE_APIC && timer_use_lapic())
+    {
+        log_info("Scheduler tick moved to the local APIC timer");
+    }
+
     console_write("[boot] Initializing keyboard...\n");
     keyboard_init();
     log_info("Keyboard driver initialized");
@@ -238,26 +301,39 @@ void kernel_main(const uint32_t mboot_magic, const uint32_t mboot_info)
     scan_drives();
     log_info("Filesystem initialized");
 
-    console_write("[boot] Initializing timer...\n");
-    timer_init(TICK_FREQUENCY_HZ);
-    log_info("Timer initialized");
-
     console_write("[boot] Creating tasks...\n");
-    const struct task* idle = task_create(idle_task, 0, true);
+    struct task* idle = task_create(idle_task, 0, true);
+    sched_set_idle_task(0, idle);
     vterm_set_owner(VTERM_CONSOLE, idle->pid);
     log_debug("Idle task created");
+    if (workqueue_init() != 0)
+    {
+        kernel_panic("Failed to create the kernel worker thread");
+    }
+    log_debug("Kernel worker thread created");
     const struct task* init = task_create(init_task, 1, true);
     vterm_set_owner(VTERM_CONSOLE, init->pid);
+    if (sched_set_deadline(init->id, INIT_DL_RUNTIME_US, INIT_DL_PERIOD_US, INIT_DL_PERIOD_US) != 0)
+    {
+        log_warn("Init task left at its fixed priority");
+    }
     log_debug("Init task created");
     const struct task* test = task_create(selftest_task, 2, true);
     vterm_set_owner(VTERM_USER1, test->pid);
     log_debug("Self-test task created (Alt+F3 to view)");
 
+    console_write("[boot] Starting application processors...\n");
+    const uint32_t cpus = smp_init(idle_task);
+    console_write("[boot] CPUs online: ");
+    console_write_dec(cpus);
+    console_write("\n");
+
     console_write("[boot] Boot complete!\n\n");
     log_info("Boot sequence complete");
 
     sti();
     log_info("Interrupts enabled");
+    smp_release();
     schedule();
 
     kernel_panic("Scheduler returned!");
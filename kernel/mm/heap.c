@@ -1,6 +1,7 @@
 #include "heap.h"
 #include "../include/string.h"
 #include "../include/cast.h"
+#include "../include/spinlock.h"
 
 /// @brief Heap block structure \struct heap_block
 struct heap_block
@@ -16,6 +17,7 @@ struct heap_block
 static struct heap_block* heap_start = NULL;
 static uint32_t heap_size = 0;
 static uint32_t heap_used = 0;
+static spinlock_t heap_lock = SPINLOCK_INIT;
 
 void* heap_init(const uint32_t start, const uint32_t size)
 {
@@ -103,14 +105,8 @@ static struct heap_block* find_best_fit(const size_t size)
     return best;
 }
 
-void* kmalloc(size_t size)
+static void* heap_alloc(const size_t size)
 {
-    if (size == 0)
-    {
-        return NULL;
-    }
-    size = (size + 3) & ~3;
-
     struct heap_block* block = find_best_fit(size);
     if (block)
     {
@@ -134,6 +130,20 @@ void* kmalloc(size_t size)
     return NULL;
 }
 
+void* kmalloc(size_t size)
+{
+    if (size == 0)
+    {
+        return NULL;
+    }
+    size = (size + 3) & ~3;
+
+    const uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* ptr = heap_alloc(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return ptr;
+}
+
 void* kmalloc_aligned(const size_t size, const size_t align)
 {
     if (align == 0 || (align & (align - 1)) != 0)
@@ -213,6 +223,7 @@ void kfree(void* ptr)
 
     struct heap_block* block = (struct heap_block*)((uint8_t*)ptr - sizeof(struct heap_block));
 
+    const uint32_t flags = spin_lock_irqsave(&heap_lock);
     if (block->used)
     {
         heap_used -= block->size + sizeof(struct heap_block);
@@ -220,6 +231,7 @@ void kfree(void* ptr)
         merge_free_blocks();
         heap_validate();
     }
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
 
 size_t heap_get_used(void)
@@ -282,5 +294,7 @@ void heap_get_fragmentation(uint32_t* free_blocks, uint32_t* largest_free)
 
 void heap_defragment(void)
 {
+    const uint32_t flags = spin_lock_irqsave(&heap_lock);
     merge_free_blocks();
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
@@ -1,6 +1,7 @@
 #include "pmm.h"
 #include "../include/string.h"
 #include "../include/cast.h"
+#include "../include/spinlock.h"
 
 /**
  * @brief Physical Memory Manager (PMM) constants
@@ -16,6 +17,7 @@ static uint32_t pmm_bitmap_size = 0;
 static uint32_t pmm_memory_size = 0;
 static uint32_t pmm_used_blocks = 0;
 static uint32_t pmm_max_blocks = 0;
+static spinlock_t pmm_lock = SPINLOCK_INIT;
 
 static inline void bitmap_set(const uint32_t bit)
 {
@@ -116,13 +118,17 @@ void pmm_deinit_region(const uint32_t base, const uint32_t size)
 
 void* pmm_alloc_block(void)
 {
-    if (pmm_get_free_block_count() == 0) return 0;
-
-    const int frame = bitmap_first_free();
-    if (frame == -1) return 0;
+    const uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    const int frame = (pmm_get_free_block_count() == 0) ? -1 : bitmap_first_free();
+    if (frame == -1)
+    {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return 0;
+    }
 
     bitmap_set(frame);
     pmm_used_blocks++;
+    spin_unlock_irqrestore(&pmm_lock, flags);
 
     const uint32_t addr = (uint32_t)(frame * PMM_BLOCK_SIZE);
     return PTR_FROM_U32(addr);
@@ -135,22 +141,28 @@ void pmm_free_block(void* p)
     const uint32_t frame_u = addr / PMM_BLOCK_SIZE;
     const int frame = (int)frame_u;
 
+    const uint32_t flags = spin_lock_irqsave(&pmm_lock);
     bitmap_unset(frame);
     pmm_used_blocks--;
+    spin_unlock_irqrestore(&pmm_lock, flags);
 }
 
 void* pmm_alloc_blocks(const uint32_t count)
 {
-    if (pmm_get_free_block_count() < count) return 0;
-
-    const int frame = bitmap_first_free_s(count);
-    if (frame == -1) return 0;
+    const uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    const int frame = (pmm_get_free_block_count() < count) ? -1 : bitmap_first_free_s(count);
+    if (frame == -1)
+    {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return 0;
+    }
 
     for (uint32_t i = 0; i < count; i++)
     {
         bitmap_set(frame + i);
     }
     pmm_used_blocks += count;
+    spin_unlock_irqrestore(&pmm_lock, flags);
 
     const uint32_t addr = (uint32_t)(frame * PMM_BLOCK_SIZE);
     return PTR_FROM_U32(addr);
@@ -163,11 +175,13 @@ void pmm_free_blocks(void* p, const uint32_t count)
     const uint32_t frame_u = addr / PMM_BLOCK_SIZE;
     const int frame = (int)frame_u;
 
+    const uint32_t flags = spin_lock_irqsave(&pmm_lock);
     for (uint32_t i = 0; i < count; i++)
     {
         bitmap_unset(frame + i);
     }
     pmm_used_blocks -= count;
+    spin_unlock_irqrestore(&pmm_lock, flags);
 }
 
 uint32_t pmm_get_memory_size(void) { return pmm_memory_size; }
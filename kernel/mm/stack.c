@@ -0,0 +1,172 @@
+#include "stack.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "../lib/log.h"
+#include "../include/spinlock.h"
+
+#define STACK_SLOT_NONE (-1)
+
+/// @brief Stack pool state \struct stack_pool
+struct stack_pool
+{
+    uint32_t region;
+    uint32_t stack_size;
+    uint32_t page_flags;
+    int16_t  free_head;
+    uint32_t next_unused;
+    int16_t  next[STACK_POOL_SLOTS];
+    struct stack_stats stats;
+};
+
+static struct stack_pool pools[2];
+static spinlock_t stack_lock = SPINLOCK_INIT;
+
+static inline uint32_t slot_size(const struct stack_pool* p)
+{
+    return STACK_GUARD_SIZE + p->stack_size;
+}
+
+static inline uint32_t slot_base(const struct stack_pool* p, const uint32_t slot)
+{
+    return p->region + slot * slot_size(p) + STACK_GUARD_SIZE;
+}
+
+static int map_slot(struct stack_pool* p, const uint32_t slot)
+{
+    page_directory_t* pd = vmm_get_kernel_directory();
+    const uint32_t base = slot_base(p, slot);
+
+    for (uint32_t off = 0; off < p->stack_size; off += PAGE_SIZE)
+    {
+        if (vmm_alloc_page(pd, base + off, p->page_flags) != 0)
+        {
+            while (off > 0)
+            {
+                off -= PAGE_SIZE;
+                vmm_free_page(pd, base + off);
+            }
+            return -1;
+        }
+    }
+
+    p->stats.mapped_pages += p->stack_size / PAGE_SIZE;
+    return 0;
+}
+
+static void pool_init(struct stack_pool* p, const uint32_t region, const uint32_t stack_size, const uint32_t flags)
+{
+    p->region = region;
+    p->stack_size = stack_size;
+    p->page_flags = flags;
+    p->free_head = STACK_SLOT_NONE;
+    p->next_unused = 0;
+    p->stats.in_use = 0;
+    p->stats.cached = 0;
+    p->stats.mapped_pages = 0;
+    p->stats.allocs = 0;
+    p->stats.cache_hits = 0;
+}
+
+static void pool_prewarm(struct stack_pool* p, const uint32_t count)
+{
+    for (uint32_t i = 0; i < count && p->next_unused < STACK_POOL_SLOTS; i++)
+    {
+        const uint32_t slot = p->next_unused;
+        if (map_slot(p, slot) != 0)
+        {
+            return;
+        }
+        p->next_unused++;
+        p->next[slot] = p->free_head;
+        p->free_head = (int16_t)slot;
+        p->stats.cached++;
+    }
+}
+
+void stack_cache_init(const uint32_t prewarm)
+{
+    pool_init(&pools[STACK_KERNEL], KERNEL_STACK_REGION, KERNEL_STACK_SIZE, PAGE_PRESENT | PAGE_WRITE);
+    pool_init(&pools[STACK_USER], USER_STACK_REGION, USER_STACK_SIZE, PAGE_PRESENT | PAGE_WRITE | PAGE_USER);
+
+    pool_prewarm(&pools[STACK_KERNEL], prewarm);
+    pool_prewarm(&pools[STACK_USER], prewarm);
+
+    log_info_fmt("Stack cache: %d kernel, %d user stacks pre-mapped",
+                 pools[STACK_KERNEL].stats.cached, pools[STACK_USER].stats.cached);
+}
+
+uint32_t stack_alloc(const uint8_t pool)
+{
+    if (pool > STACK_USER)
+    {
+        return 0;
+    }
+
+    struct stack_pool* p = &pools[pool];
+    uint32_t slot;
+
+    const uint32_t flags = spin_lock_irqsave(&stack_lock);
+    if (p->free_head != STACK_SLOT_NONE)
+    {
+        slot = (uint32_t)p->free_head;
+        p->free_head = p->next[slot];
+        p->stats.cached--;
+        p->stats.cache_hits++;
+    }
+    else
+    {
+        if (p->next_unused >= STACK_POOL_SLOTS || map_slot(p, p->next_unused) != 0)
+        {
+            spin_unlock_irqrestore(&stack_lock, flags);
+            return 0;
+        }
+        slot = p->next_unused;
+        p->next_unused++;
+    }
+
+    p->stats.in_use++;
+    p->stats.allocs++;
+    spin_unlock_irqrestore(&stack_lock, flags);
+    return slot_base(p, slot);
+}
+
+void stack_free(const uint8_t pool, const uint32_t base)
+{
+    if (pool > STACK_USER || base == 0)
+    {
+        return;
+    }
+
+    struct stack_pool* p = &pools[pool];
+    if (base < p->region + STACK_GUARD_SIZE)
+    {
+        return;
+    }
+
+    const uint32_t offset = base - p->region - STACK_GUARD_SIZE;
+    const uint32_t slot = offset / slot_size(p);
+
+    const uint32_t flags = spin_lock_irqsave(&stack_lock);
+    if (offset % slot_size(p) == 0 && slot < p->next_unused)
+    {
+        p->next[slot] = p->free_head;
+        p->free_head = (int16_t)slot;
+        p->stats.in_use--;
+        p->stats.cached++;
+    }
+    spin_unlock_irqrestore(&stack_lock, flags);
+}
+
+uint32_t stack_get_size(const uint8_t pool)
+{
+    return pool > STACK_USER ? 0 : pools[pool].stack_size;
+}
+
+void stack_get_stats(const uint8_t pool, struct stack_stats* stats)
+{
+    if (pool > STACK_USER || !stats)
+    {
+        return;
+    }
+    *stats = pools[pool].stats;
+}
@@ -0,0 +1,75 @@
+#ifndef KERNEL_STACK_H
+#define KERNEL_STACK_H
+
+#include "../include/types.h"
+#include "../include/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stack pool selectors
+ */
+#define STACK_KERNEL    0
+#define STACK_USER      1
+
+/**
+ * @brief Number of stack slots per pool (one per possible thread)
+ */
+#define STACK_POOL_SLOTS MAX_THREADS
+
+/// @brief Stack cache statistics \struct stack_stats
+struct stack_stats
+{
+    uint32_t in_use;
+    uint32_t cached;
+    uint32_t mapped_pages;
+    uint32_t allocs;
+    uint32_t cache_hits;
+};
+
+/**
+ * @brief Initialize the stack cache
+ * @details Each stack lives in its own virtual slot preceded by an unmapped
+ *          guard page, so an overflow faults instead of corrupting a neighbour.
+ *          Must be called after paging is enabled.
+ * @param prewarm Number of kernel and user stacks to map ahead of time
+ */
+void stack_cache_init(uint32_t prewarm);
+
+/**
+ * @brief Allocate a stack from a pool
+ * @details Freed stacks stay mapped on a per-pool free list and are handed
+ *          out again without touching the PMM or the kernel heap.
+ * @param pool STACK_KERNEL or STACK_USER
+ * @return Lowest usable address of the stack, or 0 on failure
+ */
+uint32_t stack_alloc(uint8_t pool);
+
+/**
+ * @brief Return a stack to its pool's cache
+ * @param pool STACK_KERNEL or STACK_USER
+ * @param base Address returned by stack_alloc
+ */
+void stack_free(uint8_t pool, uint32_t base);
+
+/**
+ * @brief Get the size of the stacks handed out by a pool
+ * @param pool STACK_KERNEL or STACK_USER
+ * @return Stack size in bytes
+ */
+uint32_t stack_get_size(uint8_t pool);
+
+/**
+ * @brief Get stack cache statistics for a pool
+ * @param pool STACK_KERNEL or STACK_USER
+ * @param stats Pointer to the stack_stats structure to fill
+ */
+void stack_get_stats(uint8_t pool, struct stack_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
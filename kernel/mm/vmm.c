@@ -4,8 +4,12 @@
 #include "../arch/i686/arch.h"
 #include "../lib/log.h"
 #include "../include/string.h"
+#include "../include/spinlock.h"
 #include "../include/cast.h"
 
+// power of two, kept at least one slot short of full for probing
+#define SHARED_FRAME_SLOTS 2048
+
 extern uint32_t kernel_start;
 extern uint32_t kernel_end;
 
@@ -14,6 +18,21 @@ static page_directory_t* current_directory = NULL;
 
 static uint32_t kernel_directory_phys = 0;
 
+/*
+ * Frames mapped more than once, or held by an IPC message in flight, are
+ * reference counted in an open-addressed table keyed by physical address.
+ * Frames that are not in the table have a single owner.
+ */
+struct shared_frame
+{
+    uint32_t phys;
+    uint32_t refs;
+};
+
+static struct shared_frame shared_frames[SHARED_FRAME_SLOTS];
+static uint32_t shared_count = 0;
+static spinlock_t share_lock = SPINLOCK_INIT;
+
 static inline void* phys_to_virt(uint32_t phys)
 {
     if (kernel_directory_phys == 0)
@@ -66,6 +85,76 @@ static void *get_page_table(page_directory_t *page_dir, const uint32_t virt_addr
     return NULL;
 }
 
+static uint32_t* get_pte(page_directory_t* page_dir, const uint32_t virt_addr)
+{
+    uint32_t* table = (uint32_t*)get_page_table(page_dir, virt_addr, false);
+    return table ? &table[PAGE_TABLE_INDEX(virt_addr)] : NULL;
+}
+
+static uint32_t shared_slot(const uint32_t phys)
+{
+    return (phys >> 12) & (SHARED_FRAME_SLOTS - 1);
+}
+
+// caller holds share_lock
+static struct shared_frame* shared_find(const uint32_t phys)
+{
+    uint32_t i = shared_slot(phys);
+    while (shared_frames[i].phys)
+    {
+        if (shared_frames[i].phys == phys)
+        {
+            return &shared_frames[i];
+        }
+        i = (i + 1) & (SHARED_FRAME_SLOTS - 1);
+    }
+    return NULL;
+}
+
+// caller holds share_lock
+static struct shared_frame* shared_place(const uint32_t phys, const uint32_t refs)
+{
+    uint32_t i = shared_slot(phys);
+    while (shared_frames[i].phys)
+    {
+        i = (i + 1) & (SHARED_FRAME_SLOTS - 1);
+    }
+    shared_frames[i].phys = phys;
+    shared_frames[i].refs = refs;
+    return &shared_frames[i];
+}
+
+// caller holds share_lock
+static struct shared_frame* shared_insert(const uint32_t phys, const uint32_t refs)
+{
+    if (shared_count >= SHARED_FRAME_SLOTS - 1)
+    {
+        return NULL;
+    }
+    shared_count++;
+    return shared_place(phys, refs);
+}
+
+// caller holds share_lock; the rest of the probe run is placed again so
+// lookups never stop early at the hole
+static void shared_remove(struct shared_frame* f)
+{
+    uint32_t i = (uint32_t)(f - shared_frames);
+    f->phys = 0;
+    f->refs = 0;
+    shared_count--;
+
+    i = (i + 1) & (SHARED_FRAME_SLOTS - 1);
+    while (shared_frames[i].phys)
+    {
+        const struct shared_frame moved = shared_frames[i];
+        shared_frames[i].phys = 0;
+        shared_frames[i].refs = 0;
+        shared_place(moved.phys, moved.refs);
+        i = (i + 1) & (SHARED_FRAME_SLOTS - 1);
+    }
+}
+
 int vmm_map_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t phys_addr, const uint32_t flags)
 {
     virt_addr &= ~0xFFF;
@@ -142,6 +231,12 @@ bool vmm_is_mapped(page_directory_t* page_dir, uint32_t virt_addr)
     return (table_ptr[table_index] & PAGE_PRESENT) != 0;
 }
 
+bool vmm_is_user_mapped(page_directory_t* page_dir, const uint32_t virt_addr)
+{
+    const uint32_t* pte = get_pte(page_dir, virt_addr);
+    return pte && (*pte & (PAGE_PRESENT | PAGE_USER)) == (PAGE_PRESENT | PAGE_USER);
+}
+
 int vmm_alloc_page(page_directory_t* page_dir, const uint32_t virt_addr, const uint32_t flags)
 {
     void* phys = pmm_alloc_block();
@@ -164,11 +259,170 @@ void vmm_free_page(page_directory_t* page_dir, const uint32_t virt_addr)
     const uint32_t phys = vmm_get_physical_address(page_dir, virt_addr);
     if (phys)
     {
-        pmm_free_block(PTR_FROM_U32(phys & ~0xFFF));
+        vmm_release_frame(phys);
     }
     vmm_unmap_page(page_dir, virt_addr);
 }
 
+uint32_t vmm_detach_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t* flags)
+{
+    virt_addr &= ~0xFFF;
+
+    uint32_t* pte = get_pte(page_dir, virt_addr);
+    if (!pte || !(*pte & PAGE_PRESENT))
+    {
+        return 0;
+    }
+
+    const uint32_t entry = *pte;
+    *pte = 0;
+    if (page_dir == current_directory)
+    {
+        invlpg(virt_addr);
+    }
+
+    if (flags)
+    {
+        *flags = entry & 0xFFF;
+    }
+    return entry & ~0xFFF;
+}
+
+int vmm_share_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t* phys, uint32_t* flags)
+{
+    virt_addr &= ~0xFFF;
+
+    uint32_t* pte = get_pte(page_dir, virt_addr);
+    if (!pte || !(*pte & PAGE_PRESENT))
+    {
+        return -1;
+    }
+
+    const uint32_t frame = *pte & ~0xFFF;
+    const uint32_t irq = spin_lock_irqsave(&share_lock);
+    struct shared_frame* f = shared_find(frame);
+    if (f)
+    {
+        f->refs++;
+    }
+    else if (!shared_insert(frame, 2))
+    {
+        spin_unlock_irqrestore(&share_lock, irq);
+        return -1;
+    }
+
+    if (*pte & PAGE_WRITE)
+    {
+        *pte = (*pte & ~PAGE_WRITE) | PAGE_COW;
+    }
+    *phys = frame;
+    *flags = *pte & 0xFFF;
+    spin_unlock_irqrestore(&share_lock, irq);
+
+    if (page_dir == current_directory)
+    {
+        invlpg(virt_addr);
+    }
+    return 0;
+}
+
+int vmm_ref_frame(uint32_t phys)
+{
+    phys &= ~0xFFF;
+
+    const uint32_t irq = spin_lock_irqsave(&share_lock);
+    struct shared_frame* f = shared_find(phys);
+    if (f)
+    {
+        f->refs++;
+    }
+    else if (!shared_insert(phys, 2))
+    {
+        spin_unlock_irqrestore(&share_lock, irq);
+        return -1;
+    }
+    spin_unlock_irqrestore(&share_lock, irq);
+    return 0;
+}
+
+void vmm_release_frame(uint32_t phys)
+{
+    phys &= ~0xFFF;
+
+    const uint32_t irq = spin_lock_irqsave(&share_lock);
+    struct shared_frame* f = shared_find(phys);
+    if (f)
+    {
+        // the last holder keeps the frame to itself
+        f->refs--;
+        if (f->refs <= 1)
+        {
+            shared_remove(f);
+        }
+        spin_unlock_irqrestore(&share_lock, irq);
+        return;
+    }
+    spin_unlock_irqrestore(&share_lock, irq);
+
+    pmm_free_block(PTR_FROM_U32(phys));
+}
+
+int vmm_handle_cow(page_directory_t* page_dir, uint32_t virt_addr)
+{
+    virt_addr &= ~0xFFF;
+
+    uint32_t* pte = get_pte(page_dir, virt_addr);
+    if (!pte || !(*pte & PAGE_PRESENT))
+    {
+        return -1;
+    }
+    if (*pte & PAGE_WRITE)
+    {
+        // another CPU broke the sharing first; our TLB entry was stale
+        invlpg(virt_addr);
+        return 0;
+    }
+    if (!(*pte & PAGE_COW))
+    {
+        return -1;
+    }
+
+    const uint32_t frame = *pte & ~0xFFF;
+    const uint32_t flags = (*pte & 0xFFF & ~PAGE_COW) | PAGE_WRITE;
+
+    const uint32_t irq = spin_lock_irqsave(&share_lock);
+    struct shared_frame* f = shared_find(frame);
+    if (!f)
+    {
+        // every other alias is gone: write to the frame in place
+        *pte = frame | flags;
+    }
+    else
+    {
+        void* copy = pmm_alloc_block();
+        if (!copy)
+        {
+            spin_unlock_irqrestore(&share_lock, irq);
+            return -1;
+        }
+        memcpy(phys_to_virt(PTR_TO_U32(copy)), phys_to_virt(frame), PAGE_SIZE);
+        *pte = PTR_TO_U32(copy) | flags;
+
+        f->refs--;
+        if (f->refs <= 1)
+        {
+            shared_remove(f);
+        }
+    }
+    spin_unlock_irqrestore(&share_lock, irq);
+
+    if (page_dir == current_directory)
+    {
+        invlpg(virt_addr);
+    }
+    return 0;
+}
+
 void *vmm_create_address_space(void)
 {
     page_directory_t* page_dir = PTR_FROM_U32_TYPED(page_directory_t, pmm_alloc_block());
@@ -212,7 +466,7 @@ void vmm_destroy_address_space(page_directory_t* page_dir)
             {
                 if (table_ptr[j] & PAGE_PRESENT)
                 {
-                    pmm_free_block(PTR_FROM_U32(table_ptr[j] & ~0xFFF));
+                    vmm_release_frame(table_ptr[j] & ~0xFFF);
                 }
             }
 
@@ -240,6 +494,11 @@ page_directory_t* vmm_get_current_directory(void)
     return current_directory;
 }
 
+page_directory_t* vmm_get_kernel_directory(void)
+{
+    return kernel_directory;
+}
+
 void* vmm_clone_address_space(page_directory_t *src)
 {
     page_directory_t *dst = vmm_create_address_space();
@@ -306,12 +565,12 @@ bool vmm_check_user_ptr(const void* ptr, size_t len, const bool write)
     if (len == 0) return true;
 
     const uint32_t start = PTR_TO_U32(ptr);
-    const uint32_t end = start + len - 1;
-
-    if (start > USER_SPACE_END || end > USER_SPACE_END)
+    // checked before end is formed, so a huge len cannot wrap it around
+    if (start > USER_SPACE_END || len > USER_SPACE_END - start + 1)
     {
         return false;
     }
+    const uint32_t end = start + len - 1;
 
     page_directory_t* pd = vmm_get_current_directory();
     if (!pd) return false;
@@ -329,7 +588,10 @@ bool vmm_check_user_ptr(const void* ptr, size_t len, const bool write)
         const uint32_t entry = table[table_index];
         if (!(entry & PAGE_PRESENT)) return false;
         if (!(entry & PAGE_USER)) return false;
-        if (write && !(entry & PAGE_WRITE)) return false;
+        if (write && !(entry & PAGE_WRITE))
+        {
+            if (!(entry & PAGE_COW) || vmm_handle_cow(pd, page) != 0) return false;
+        }
 
         page += PAGE_SIZE;
     }
@@ -41,6 +41,7 @@ extern "C" {
 #define PAGE_DIRTY      0x040  // Page was written to
 #define PAGE_SIZE_BIT   0x080  // 4MB page (if enabled)
 #define PAGE_GLOBAL     0x100  // Global page (not flushed from TLB)
+#define PAGE_COW        0x200  // Software bit: read-only alias of a copy-on-write frame
 
 /**
  * @brief Page directory entry type (1024 entries)
@@ -82,6 +83,12 @@ void vmm_switch_address_space(page_directory_t* page_dir);
  */
 page_directory_t* vmm_get_current_directory(void);
 
+/**
+ * @brief Get the kernel page directory
+ * @return Pointer to the kernel page directory
+ */
+page_directory_t* vmm_get_kernel_directory(void);
+
 /**
  * @brief Map a virtual page to a physical page
  * @param page_dir The page directory to map in
@@ -115,6 +122,14 @@ uint32_t vmm_get_physical_address(page_directory_t* page_dir, uint32_t virt_addr
  */
 bool vmm_is_mapped(page_directory_t* page_dir, uint32_t virt_addr);
 
+/**
+ * @brief Check if a virtual address is mapped for user mode access
+ * @param page_dir The page directory to check
+ * @param virt_addr Virtual address
+ * @return true if mapped with PAGE_USER, false otherwise
+ */
+bool vmm_is_user_mapped(page_directory_t* page_dir, uint32_t virt_addr);
+
 /**
  * @brief Allocate and map a page for a virtual address
  * @param page_dir The page directory to map in
@@ -131,6 +146,51 @@ int vmm_alloc_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t flag
  */
 void vmm_free_page(page_directory_t* page_dir, uint32_t virt_addr);
 
+/**
+ * @brief Unmap a page and hand its frame to the caller
+ * @param page_dir The page directory to unmap from
+ * @param virt_addr Virtual address
+ * @param flags Receives the flags the page was mapped with, may be NULL
+ * @return Physical address of the frame, or 0 if the page was not mapped
+ */
+uint32_t vmm_detach_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t* flags);
+
+/**
+ * @brief Take a shared reference to the frame behind a page
+ * @details A writable page becomes a copy-on-write alias; whoever writes to
+ *          it first gets a private copy. The reference is dropped with
+ *          vmm_release_frame() or handed over by mapping the frame elsewhere.
+ * @param page_dir The page directory the page is mapped in
+ * @param virt_addr Virtual address
+ * @param phys Receives the physical address of the frame
+ * @param flags Receives the flags for further mappings of the frame
+ * @return 0 on success, -1 if the page is not mapped or too many frames are shared
+ */
+int vmm_share_page(page_directory_t* page_dir, uint32_t virt_addr, uint32_t* phys, uint32_t* flags);
+
+/**
+ * @brief Take another reference to a frame for a writable shared mapping
+ * @details Unlike vmm_share_page the frame stays writable everywhere it is
+ *          mapped; every holder sees the writes of the others.
+ * @param phys Physical address of the frame
+ * @return 0 on success, -1 if too many frames are shared
+ */
+int vmm_ref_frame(uint32_t phys);
+
+/**
+ * @brief Drop one reference to a frame, freeing it with the last one
+ * @param phys Physical address of the frame
+ */
+void vmm_release_frame(uint32_t phys);
+
+/**
+ * @brief Resolve a write to a copy-on-write page
+ * @param page_dir The page directory the page is mapped in
+ * @param virt_addr Faulting virtual address
+ * @return 0 if the page is writable now, -1 if it is not copy-on-write or out of memory
+ */
+int vmm_handle_cow(page_directory_t* page_dir, uint32_t virt_addr);
+
 /**
  * @brief Clone a page directory (for fork())
  * @param src The source page directory to clone
@@ -140,6 +200,8 @@ void *vmm_clone_address_space(page_directory_t *src);
 
  /**
  * @brief Validate a user pointer range is mapped and accessible
+ * @details For writes, copy-on-write pages in the range are made private,
+ *          so kernel copies into the buffer never reach a shared frame.
  * @param ptr User pointer
  * @param len Length in bytes
  * @param write True if the caller intends to write to the buffer
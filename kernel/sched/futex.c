@@ -0,0 +1,267 @@
+#include "futex.h"
+#include "sched.h"
+#include "../mm/vmm.h"
+#include "../include/config.h"
+#include "../include/spinlock.h"
+#include "../include/string.h"
+#include "../include/cast.h"
+#include "../sys/timer.h"
+#include "../sys/ktimer.h"
+
+/*
+ * Futex wait queues. A waiter is keyed by the physical address of the word
+ * it sleeps on and queued in one of FUTEX_BUCKETS hashed buckets, each with
+ * its own lock, so unrelated futexes rarely contend. Waiter records come
+ * from a fixed pool of one per thread: a task sleeps on at most one futex.
+ *
+ * A waker only marks a record woken; the waiter unlinks its own record when
+ * it runs again. Records of tasks that died asleep stay linked until a wake
+ * on the same key or an allocation on the same bucket finds them gone.
+ */
+#define FUTEX_BUCKETS 64
+#define FUTEX_NONE    (-1)
+
+struct futex_waiter
+{
+    uint32_t key;
+    tid_t tid;
+    int16_t next;
+    bool woken;
+};
+
+struct futex_bucket
+{
+    spinlock_t lock;
+    int16_t head;
+};
+
+static struct futex_waiter waiters[MAX_THREADS];
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+static int16_t free_head;
+static spinlock_t pool_lock = SPINLOCK_INIT;
+static struct futex_stats stats;
+
+static struct futex_bucket* bucket_of(const uint32_t key)
+{
+    // Fibonacci hashing; the low two bits of a word address carry nothing
+    return &buckets[((key >> 2) * 2654435761u) >> 26];
+}
+
+static int16_t slot_alloc(void)
+{
+    const uint32_t irq = spin_lock_irqsave(&pool_lock);
+    const int16_t slot = free_head;
+    if (slot != FUTEX_NONE)
+    {
+        free_head = waiters[slot].next;
+    }
+    spin_unlock_irqrestore(&pool_lock, irq);
+    return slot;
+}
+
+static void slot_free(const int16_t slot)
+{
+    const uint32_t irq = spin_lock_irqsave(&pool_lock);
+    waiters[slot].next = free_head;
+    free_head = slot;
+    spin_unlock_irqrestore(&pool_lock, irq);
+}
+
+static bool waiter_gone(const tid_t tid)
+{
+    const struct task* t = thread_find(tid);
+    return !t || t->state == TASK_ZOMBIE;
+}
+
+// caller holds the bucket lock
+static void bucket_unlink(struct futex_bucket* b, const int16_t slot)
+{
+    int16_t* link = &b->head;
+    while (*link != FUTEX_NONE)
+    {
+        if (*link == slot)
+        {
+            *link = waiters[slot].next;
+            return;
+        }
+        link = &waiters[*link].next;
+    }
+}
+
+// caller holds the bucket lock; frees the records of tasks that died asleep
+static void bucket_reap(struct futex_bucket* b)
+{
+    int16_t* link = &b->head;
+    while (*link != FUTEX_NONE)
+    {
+        const int16_t slot = *link;
+        if (waiter_gone(waiters[slot].tid))
+        {
+            *link = waiters[slot].next;
+            slot_free(slot);
+            __sync_fetch_and_sub(&stats.sleeping, 1);
+            continue;
+        }
+        link = &waiters[slot].next;
+    }
+}
+
+void futex_init(void)
+{
+    spin_init(&pool_lock);
+    memset(waiters, 0, sizeof(waiters));
+    memset(&stats, 0, sizeof(stats));
+    for (uint32_t i = 0; i < FUTEX_BUCKETS; i++)
+    {
+        spin_init(&buckets[i].lock);
+        buckets[i].head = FUTEX_NONE;
+    }
+    for (uint32_t i = 0; i < MAX_THREADS; i++)
+    {
+        waiters[i].next = i + 1 < MAX_THREADS ? (int16_t)(i + 1) : FUTEX_NONE;
+    }
+    free_head = 0;
+}
+
+static void futex_timeout(const uint32_t data)
+{
+    sched_unblock((tid_t)data);
+}
+
+int futex_wait(const uint32_t addr, const uint32_t expected, const uint32_t timeout_ms)
+{
+    if (addr & 3) return -1;
+
+    struct task* current = sched_get_current();
+    if (!current) return -1;
+
+    const uint32_t key = vmm_get_physical_address(vmm_get_current_directory(), addr);
+    if (!key) return -1;
+
+    struct futex_bucket* b = bucket_of(key);
+    uint32_t irq = spin_lock_irqsave(&b->lock);
+    if (*PTR_FROM_U32_TYPED(const volatile uint32_t, addr) != expected)
+    {
+        spin_unlock_irqrestore(&b->lock, irq);
+        __sync_fetch_and_add(&stats.mismatches, 1);
+        return -2;
+    }
+
+    int16_t slot = slot_alloc();
+    if (slot == FUTEX_NONE)
+    {
+        bucket_reap(b);
+        slot = slot_alloc();
+    }
+    if (slot == FUTEX_NONE)
+    {
+        spin_unlock_irqrestore(&b->lock, irq);
+        return -1;
+    }
+
+    struct futex_waiter* w = &waiters[slot];
+    w->key = key;
+    w->tid = current->id;
+    w->woken = false;
+    w->next = FUTEX_NONE;
+
+    // queued at the tail so wakes go out in arrival order
+    int16_t* link = &b->head;
+    while (*link != FUTEX_NONE)
+    {
+        link = &waiters[*link].next;
+    }
+    *link = slot;
+    __sync_fetch_and_add(&stats.waits, 1);
+    __sync_fetch_and_add(&stats.sleeping, 1);
+    spin_unlock_irqrestore(&b->lock, irq);
+
+    // a wake landing before the timer is armed is seen by the loop below
+    const bool timed = timeout_ms != FUTEX_WAIT_FOREVER;
+    if (timed)
+    {
+        timer_setup(&current->sleep_timer, futex_timeout, current->id);
+        mod_timer(&current->sleep_timer, timer_get_ticks() + timer_ms_to_ticks(timeout_ms));
+    }
+
+    int ret = 0;
+    irq = spin_lock_irqsave(&b->lock);
+    while (!w->woken)
+    {
+        // blocked before the expiry check, so a timer firing now is not lost
+        sched_prepare_block();
+        if (timed && !timer_pending(&current->sleep_timer))
+        {
+            sched_cancel_block();
+            ret = -3;
+            break;
+        }
+        spin_unlock_irqrestore(&b->lock, irq);
+        schedule();
+        irq = spin_lock_irqsave(&b->lock);
+    }
+    bucket_unlink(b, slot);
+    spin_unlock_irqrestore(&b->lock, irq);
+
+    slot_free(slot);
+    __sync_fetch_and_sub(&stats.sleeping, 1);
+    if (ret == -3)
+    {
+        __sync_fetch_and_add(&stats.timeouts, 1);
+    }
+    if (timed)
+    {
+        del_timer(&current->sleep_timer);
+    }
+    return ret;
+}
+
+int futex_wake(const uint32_t addr, const uint32_t count)
+{
+    const uint32_t key = vmm_get_physical_address(vmm_get_current_directory(), addr);
+    if (!key || (addr & 3)) return -1;
+
+    struct futex_bucket* b = bucket_of(key);
+    uint32_t woken = 0;
+    const uint32_t irq = spin_lock_irqsave(&b->lock);
+    int16_t* link = &b->head;
+    while (*link != FUTEX_NONE && woken < count)
+    {
+        const int16_t slot = *link;
+        struct futex_waiter* w = &waiters[slot];
+        if (w->key != key || w->woken)
+        {
+            link = &w->next;
+            continue;
+        }
+        if (waiter_gone(w->tid))
+        {
+            // a dead waiter must not swallow the wake meant for a live one
+            *link = w->next;
+            slot_free(slot);
+            __sync_fetch_and_sub(&stats.sleeping, 1);
+            continue;
+        }
+        w->woken = true;
+        sched_unblock(w->tid);
+        woken++;
+        link = &w->next;
+    }
+    spin_unlock_irqrestore(&b->lock, irq);
+
+    __sync_fetch_and_add(&stats.wakes, woken);
+    return (int)woken;
+}
+
+void futex_get_stats(struct futex_stats* out)
+{
+    if (!out)
+    {
+        return;
+    }
+    out->waits = stats.waits;
+    out->wakes = stats.wakes;
+    out->mismatches = stats.mismatches;
+    out->timeouts = stats.timeouts;
+    out->sleeping = stats.sleeping;
+}
@@ -0,0 +1,72 @@
+#ifndef KERNEL_FUTEX_H
+#define KERNEL_FUTEX_H
+
+#include "../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Timeout meaning wait until woken
+ */
+#define FUTEX_WAIT_FOREVER 0xFFFFFFFF
+
+/**
+ * @brief Wake count meaning every waiter
+ */
+#define FUTEX_WAKE_ALL 0x7FFFFFFF
+
+/**
+ * @brief Futex counters \struct futex_stats
+ * @details sleeping is the number of tasks queued right now; the rest count
+ *          since boot.
+ */
+struct futex_stats
+{
+    uint32_t waits;
+    uint32_t wakes;
+    uint32_t mismatches;
+    uint32_t timeouts;
+    uint32_t sleeping;
+};
+
+/**
+ * @brief Initialize the futex hash table
+ */
+void futex_init(void);
+
+/**
+ * @brief Sleep while a word still holds an expected value
+ * @details The queue is keyed by the physical address of the word, so
+ *          threads and processes that map the same frame at different
+ *          addresses meet on the same queue. The word is read under the
+ *          bucket lock, so a wake issued after another task changed it is
+ *          never lost; callers recheck their condition on return.
+ * @param addr Word aligned address of the futex word, mapped in the caller
+ * @param expected Value the caller last saw in the word
+ * @param timeout_ms Most milliseconds to sleep, or FUTEX_WAIT_FOREVER
+ * @return 0 when woken, -1 on a bad address, -2 if the word no longer held
+ *         expected, -3 on timeout
+ */
+int futex_wait(uint32_t addr, uint32_t expected, uint32_t timeout_ms);
+
+/**
+ * @brief Wake tasks sleeping on a futex word
+ * @param addr Address of the futex word, mapped in the caller
+ * @param count Most tasks to wake, or FUTEX_WAKE_ALL
+ * @return The number of tasks woken, or -1 on a bad address
+ */
+int futex_wake(uint32_t addr, uint32_t count);
+
+/**
+ * @brief Get the futex counters
+ * @param out Filled with a snapshot of the counters
+ */
+void futex_get_stats(struct futex_stats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,441 +1,1806 @@
 #include "sched.h"
-#include "../mm/heap.h"
+#include "../ipc/pipe.h"
+#include "../sys/udrv.h"
+#include "../mm/stack.h"
 #include "../include/string.h"
+#include "../include/spinlock.h"
 #include "../arch/i686/gdt.h"
 #include "../arch/i686/arch.h"
+#include "../arch/i686/smp.h"
 #include "../include/cast.h"
-
+#include "../sys/clock.h"
+#include "../sys/timer.h"
+
+#define NSEC_PER_USEC 1000u
+#define NSEC_PER_SEC  1000000000u
+#define DL_BANDWIDTH_UNIT 1000000u
+
+/*
+ * All tasks live on one list for lookup. task_lock protects that list,
+ * the task pool, process bookkeeping (exit, wait, join) and the deadline
+ * admission totals. Each READY task is also queued on the run queue of
+ * the CPU named by its cpu field; that CPU's rq_lock protects the queue,
+ * the state, cpu and deadline fields of tasks on it, and is held across
+ * the context switch until the incoming task calls sched_finish_switch().
+ * Picking, ticking and stealing only take run queue locks. Lock order is
+ * task_lock -> rq_lock; a second run queue is only ever tried.
+ */
+static spinlock_t task_lock = SPINLOCK_INIT;
+static struct task task_pool[MAX_THREADS];
+static struct task* task_free_list = NULL;
 static struct task* task_queue = NULL;
-static struct task* current_task = NULL;
 static tid_t next_tid = 1;
 static uint32_t tick_count = 0;
+static uint32_t task_count = 0;
+static uint32_t process_count = 0;
+static struct sched_global_stats cpu_stats[MAX_CPUS];
+static uint32_t dl_bandwidth = 0;
+static uint32_t dl_count = 0;
 
-static void user_task_entry(void);
+static void task_bootstrap(void);
+static void schedule_locked(uint32_t flags);
 
 void sched_init(void)
 {
+    spin_init(&task_lock);
     task_queue = NULL;
-    current_task = NULL;
+    this_cpu()->current = NULL;
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        struct cpu* c = smp_get_cpu(i);
+        if (c)
+        {
+            spin_init(&c->rq_lock);
+            c->rq_head = NULL;
+            c->rq_count = 0;
+        }
+    }
     next_tid = 1;
     tick_count = 0;
+    task_count = 0;
+    process_count = 0;
+    memset(cpu_stats, 0, sizeof(cpu_stats));
+    dl_bandwidth = 0;
+    dl_count = 0;
+
+    task_free_list = NULL;
+    for (int i = MAX_THREADS - 1; i >= 0; i--)
+    {
+        task_pool[i].next = task_free_list;
+        task_free_list = &task_pool[i];
+    }
 }
 
-struct task* sched_get_task_list(void)
+static bool task_is_idle(const struct task* t)
 {
-    return task_queue;
+    const struct cpu* c = smp_get_cpu(t->cpu);
+    return c && c->idle == t;
+}
+
+static bool cpu_is_idle(const struct cpu* c)
+{
+    return !c->current || c->current == c->idle;
 }
 
-static void user_task_entry(void)
+static struct cpu* find_idle_cpu(void)
 {
-    struct task* t = current_task;
-    if (!t || t->kernel_mode)
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
     {
-        return;
+        struct cpu* c = smp_get_cpu(i);
+        if (c && c->online && cpu_is_idle(c))
+        {
+            return c;
+        }
     }
+    return NULL;
+}
+
+/*
+ * Run queues. Interrupts must be off whenever one is locked, since the
+ * lock of the running CPU is also taken from the tick.
+ */
 
-    enter_usermode(
-            t->context.eip,
-            t->user_stack_top,
-            USER_CS_SEL,
-            USER_DS_SEL
-    );
+// disables interrupts and locks the run queue of the calling CPU
+static struct cpu* this_rq_lock_irqsave(uint32_t* flags)
+{
+    *flags = read_eflags();
+    cli();
+    struct cpu* c = this_cpu();
+    spin_lock(&c->rq_lock);
+    return c;
 }
 
-struct task* task_create(void (*entry)(void), const uint8_t priority, const bool kernel_mode)
+// interrupts are off; t->cpu only changes with its run queue locked
+static struct cpu* task_rq_lock(const struct task* t)
 {
-    struct task* t = (struct task*)kmalloc(sizeof(struct task));
-    if (!t)
+    while (1)
     {
-        return NULL;
+        struct cpu* c = smp_get_cpu(t->cpu);
+        spin_lock(&c->rq_lock);
+        if (c->id == t->cpu)
+        {
+            return c;
+        }
+        spin_unlock(&c->rq_lock);
     }
+}
 
-    memset(t, 0, sizeof(struct task));
-    t->id = next_tid++;
-    t->pid = (pid_t)t->id;
-    t->parent_pid = current_task ? current_task->pid : 0;
-    t->state = TASK_READY;
-    t->priority = priority;
-    t->time_slice = 10;
-    t->kernel_mode = kernel_mode;
-    t->exit_code = 0;
-    t->waiting_for = 0;
-
-    t->kernel_stack = PTR_TO_U32(kmalloc(KERNEL_STACK_SIZE));
-    if (!t->kernel_stack)
+// caller holds c->rq_lock; idle tasks are never queued
+static void rq_enqueue(struct cpu* c, struct task* t)
+{
+    if (t->queued || c->idle == t)
     {
-        kfree(t);
-        return NULL;
+        return;
     }
-    t->kernel_stack_top = t->kernel_stack + KERNEL_STACK_SIZE;
-
-    uint32_t* kstack = (uint32_t*)PTR_FROM_U32(t->kernel_stack_top);
+    t->rq_next = c->rq_head;
+    c->rq_head = t;
+    t->queued = true;
+    c->rq_count++;
+}
 
-    if (kernel_mode)
+// caller holds c->rq_lock
+static void rq_dequeue(struct cpu* c, struct task* t)
+{
+    if (!t->queued)
     {
-        kstack[-1] = FUNC_PTR_TO_U32(entry);
-        kstack[-2] = 0;
-        kstack[-3] = 0;
-        kstack[-4] = 0;
-        kstack[-5] = 0;
+        return;
+    }
 
-        t->context.esp = PTR_TO_U32(&kstack[-5]);
-        t->context.eip = FUNC_PTR_TO_U32(entry);
-        t->context.eflags = 0x202;
+    struct task** link = &c->rq_head;
+    while (*link && *link != t)
+    {
+        link = &(*link)->rq_next;
     }
-    else
+    if (*link)
     {
-        t->user_stack = PTR_TO_U32(kmalloc(USER_STACK_SIZE));
-        if (!t->user_stack)
-        {
-            kfree(PTR_FROM_U32(t->kernel_stack));
-            kfree(t);
-            return NULL;
-        }
-        t->user_stack_top = t->user_stack + USER_STACK_SIZE;
-
-        t->context.eip = FUNC_PTR_TO_U32(entry);
-        t->context.eflags = 0x202;
-
-        kstack[-1] = FUNC_PTR_TO_U32(user_task_entry);
-        kstack[-2] = 0;
-        kstack[-3] = 0;
-        kstack[-4] = 0;
-        kstack[-5] = 0;
-
-        t->context.esp = PTR_TO_U32(&kstack[-5]);
+        *link = t->rq_next;
+        c->rq_count--;
     }
+    t->queued = false;
+    t->rq_next = NULL;
+}
 
-    t->next = task_queue;
-    task_queue = t;
+// caller holds c->rq_lock; a task woken before it blocked again leaves its queue
+static void set_current_state_locked(struct cpu* c, const uint8_t state)
+{
+    c->current->state = state;
+    rq_dequeue(c, c->current);
+}
 
-    return t;
+// interrupts are off
+static void set_current_state(const uint8_t state)
+{
+    struct cpu* c = this_cpu();
+    spin_lock(&c->rq_lock);
+    set_current_state_locked(c, state);
+    spin_unlock(&c->rq_lock);
 }
 
-struct task* task_create_user(uint32_t entry_point, const uint8_t priority)
+// interrupts are off with flags from spin_lock_irqsave; no run queue is locked
+static void schedule_irqoff(const uint32_t flags)
 {
-    struct task* t = (struct task*)kmalloc(sizeof(struct task));
-    if (!t)
+    spin_lock(&this_cpu()->rq_lock);
+    schedule_locked(flags);
+}
+
+static uint32_t lat_bucket(uint32_t cycles)
+{
+    uint32_t bucket = 0;
+    while (cycles > 1 && bucket < SCHED_LAT_BUCKETS - 1)
     {
-        return NULL;
+        cycles >>= 1;
+        bucket++;
     }
+    return bucket;
+}
 
-    memset(t, 0, sizeof(struct task));
-    t->id = next_tid++;
-    t->pid = (pid_t)t->id;
-    t->parent_pid = current_task ? current_task->pid : 0;
-    t->state = TASK_READY;
-    t->priority = priority;
-    t->time_slice = 10;
-    t->kernel_mode = false;
-    t->exit_code = 0;
-    t->waiting_for = 0;
-
-    t->kernel_stack = PTR_TO_U32(kmalloc(KERNEL_STACK_SIZE));
-    if (!t->kernel_stack)
+// caller holds the run queue lock; prev stops running at now
+static void account_switch_out(struct task* prev, const uint64_t now, const bool involuntary)
+{
+    prev->stats.run_cycles += now - prev->stats.run_stamp;
+    prev->stats.ready_stamp = now;
+    prev->stats.woken = false;
+    if (involuntary)
     {
-        kfree(t);
-        return NULL;
+        prev->stats.nr_involuntary++;
     }
-    t->kernel_stack_top = t->kernel_stack + KERNEL_STACK_SIZE;
-
-    t->user_stack = PTR_TO_U32(kmalloc(USER_STACK_SIZE));
-    if (!t->user_stack)
+    else
     {
-        kfree(PTR_FROM_U32(t->kernel_stack));
-        kfree(t);
-        return NULL;
+        prev->stats.nr_voluntary++;
     }
-    t->user_stack_top = t->user_stack + USER_STACK_SIZE;
-
-    t->context.eip = entry_point;
-    t->context.eflags = 0x202;
-
-    uint32_t* kstack = (uint32_t*)PTR_FROM_U32(t->kernel_stack_top);
-    kstack[-1] = FUNC_PTR_TO_U32(user_task_entry);
-    kstack[-2] = 0;
-    kstack[-3] = 0;
-    kstack[-4] = 0;
-    kstack[-5] = 0;
-
-    t->context.esp = PTR_TO_U32(&kstack[-5]);
-
-    t->next = task_queue;
-    task_queue = t;
-
-    return t;
 }
 
-void task_destroy(const tid_t id)
+// caller holds the run queue lock of the CPU whose stats are passed; next starts running at now
+static void account_switch_in(struct task* next, const uint64_t now, struct sched_global_stats* stats)
 {
-    struct task* prev = NULL;
-    struct task* t = task_queue;
+    const uint64_t waited = now - next->stats.ready_stamp;
+    next->stats.wait_cycles += waited;
+    next->stats.run_stamp = now;
 
-    while (t)
+    if (next->stats.woken)
     {
-        if (t->id == id)
+        const uint32_t latency = waited > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)waited;
+        const uint32_t bucket = lat_bucket(latency);
+        next->stats.woken = false;
+        next->stats.nr_wakeups++;
+        next->stats.wakeup_hist[bucket]++;
+        if (latency > next->stats.max_wakeup_latency)
         {
-            if (prev) prev->next = t->next;
-            else task_queue = t->next;
+            next->stats.max_wakeup_latency = latency;
+        }
 
-            if (t->kernel_stack) kfree(PTR_FROM_U32(t->kernel_stack));
-            if (t->user_stack) kfree(PTR_FROM_U32(t->user_stack));
-            kfree(t);
-            return;
+        stats->wakeups++;
+        stats->wakeup_cycles += latency;
+        stats->wakeup_hist[bucket]++;
+        if (latency > stats->wakeup_max_cycles)
+        {
+            stats->wakeup_max_cycles = latency;
         }
-        prev = t;
-        t = t->next;
     }
 }
 
-void task_exit(const tid_t id, const int32_t exit_code)
+/*
+ * Deadline class. Budgets are charged in nanoseconds on context switches
+ * and on every tick, so a task overruns its runtime by at most one tick
+ * before it drops back to its fixed priority.
+ */
+static uint64_t tick_ns(void)
 {
-    struct task* t = task_queue;
-    while (t)
-    {
-        if (t->id == id)
-        {
-            t->state = TASK_ZOMBIE;
-            t->exit_code = exit_code;
+    return NSEC_PER_SEC / timer_get_frequency();
+}
 
-            struct task* parent = task_find(t->parent_pid);
-            if (parent && parent->state == TASK_BLOCKED &&
-                (parent->waiting_for == t->pid || parent->waiting_for == -1))
-            {
-                parent->state = TASK_READY;
-            }
-            return;
-        }
-        t = t->next;
-    }
+static bool dl_active(const struct task* t)
+{
+    return t->dl.runtime && t->dl.remaining > 0;
 }
 
-struct task* task_find(const pid_t pid)
+// deadline tasks with budget left come first, by earliest deadline
+static bool task_before(const struct task* t, const struct task* other)
 {
-    struct task* t = task_queue;
-    while (t)
+    const bool t_dl = dl_active(t);
+    if (t_dl != dl_active(other))
     {
-        if (t->pid == pid)
-        {
-            return t;
-        }
-        t = t->next;
+        return t_dl;
     }
-    return NULL;
+    if (t_dl)
+    {
+        return t->dl.abs_deadline < other->dl.abs_deadline;
+    }
+    return t->priority > other->priority;
 }
 
-pid_t task_fork(void)
+// caller holds the run queue lock of t; t has been running since its charge stamp
+static void dl_charge(struct task* t, const uint64_t now)
 {
-    if (!current_task)
+    if (t->dl.remaining > 0)
     {
-        return -1;
+        t->dl.remaining -= (int64_t)(now - t->dl.charge_stamp);
     }
+    t->dl.charge_stamp = now;
+}
 
-    struct task* child = (struct task*)kmalloc(sizeof(struct task));
-    if (!child)
+static void dl_miss(struct task* t, const uint64_t now)
+{
+    const uint64_t late = now > t->dl.abs_deadline ? now - t->dl.abs_deadline : 0;
+    t->dl.nr_misses++;
+    if (late > t->dl.max_lateness)
     {
-        return -1;
+        t->dl.max_lateness = late;
     }
+}
 
-    memcpy(child, current_task, sizeof(struct task));
-    child->id = next_tid++;
-    child->pid = (pid_t)child->id;
-    child->parent_pid = current_task->pid;
-    child->state = TASK_READY;
-    child->time_slice = 10;
-    child->cpu_ticks = 0;
-    child->exit_code = 0;
-    child->waiting_for = 0;
-
-    child->kernel_stack = PTR_TO_U32(kmalloc(KERNEL_STACK_SIZE));
-    if (!child->kernel_stack)
+// caller holds the run queue lock of t
+static void dl_job_end(struct task* t, const uint64_t now)
+{
+    if (!t->dl.job_done && now > t->dl.abs_deadline)
     {
-        kfree(child);
-        return -1;
+        dl_miss(t, now);
     }
-    child->kernel_stack_top = child->kernel_stack + KERNEL_STACK_SIZE;
-
-    memcpy(PTR_FROM_U32(child->kernel_stack), PTR_FROM_U32(current_task->kernel_stack), KERNEL_STACK_SIZE);
+    t->dl.job_done = true;
+}
 
-    uint32_t stack_offset = current_task->context.esp - current_task->kernel_stack;
-    child->context.esp = child->kernel_stack + stack_offset;
+// caller holds the run queue lock of t
+static void dl_start_period(struct task* t, const uint64_t start, const uint64_t now)
+{
+    t->dl.abs_deadline = start + t->dl.deadline;
+    t->dl.period_end = start + t->dl.period;
+    t->dl.remaining = (int64_t)t->dl.runtime;
+    t->dl.charge_stamp = now;
+    t->dl.job_done = false;
+    t->dl.nr_jobs++;
+}
 
-    if (!current_task->kernel_mode && current_task->user_stack)
+// caller holds the run queue lock of t; periods stay on their grid unless the task
+// was idle for longer than a whole period
+static void dl_new_period(struct task* t, const uint64_t now)
+{
+    if (!t->dl.job_done)
     {
-        child->user_stack = PTR_TO_U32(kmalloc(USER_STACK_SIZE));
-        if (!child->user_stack)
-        {
-            kfree(PTR_FROM_U32(child->kernel_stack));
-            kfree(child);
-            return -1;
-        }
-        child->user_stack_top = child->user_stack + USER_STACK_SIZE;
-        memcpy(PTR_FROM_U32(child->user_stack), PTR_FROM_U32(current_task->user_stack), USER_STACK_SIZE);
+        dl_miss(t, now);
     }
+    dl_start_period(t, now < t->dl.period_end + t->dl.period ? t->dl.period_end : now, now);
+}
 
-    child->context.eax = 0;
+// caller holds the run queue lock of t
+static void dl_wakeup(struct task* t, const uint64_t now)
+{
+    // sleeps until the next period are tick based and may end a tick early
+    if (now + tick_ns() >= t->dl.period_end)
+    {
+        dl_new_period(t, now);
+        return;
+    }
 
-    child->next = task_queue;
-    task_queue = child;
+    // constant bandwidth rule: leftover budget that cannot run by the old
+    // deadline at the reserved rate gets a fresh period instead
+    const uint64_t left = t->dl.remaining > 0 ? (uint64_t)t->dl.remaining : 0;
+    if (now >= t->dl.abs_deadline || left * t->dl.period > (t->dl.abs_deadline - now) * t->dl.runtime)
+    {
+        dl_start_period(t, now, now);
+        return;
+    }
 
-    return child->pid;
+    // otherwise the new job runs on what is left of the budget
+    t->dl.job_done = false;
+    t->dl.charge_stamp = now;
 }
 
-pid_t task_wait(const pid_t pid, int32_t* status)
+// caller holds task_lock and the run queue lock of t, or t can no longer run
+static void dl_release(struct task* t)
 {
-    if (!current_task)
+    if (t->dl.runtime)
     {
-        return -1;
+        dl_bandwidth -= t->dl.bandwidth;
+        dl_count--;
     }
+    memset(&t->dl, 0, sizeof(t->dl));
+}
 
-    while (1)
+// caller holds c->rq_lock
+static void dl_tick_task(struct task* t, struct task* current, const uint64_t now)
+{
+    if (t->dl.runtime && now >= t->dl.period_end && (t->state == TASK_READY || t->state == TASK_RUNNING))
     {
-        struct task* t = task_queue;
-        while (t)
+        dl_new_period(t, now);
+        if (current && t != current && task_before(t, current))
         {
-            if (t->parent_pid == current_task->pid)
-            {
-                if ((pid == -1 || t->pid == pid) && t->state == TASK_ZOMBIE)
-                {
-                    pid_t child_pid = t->pid;
-                    if (status)
-                    {
-                        *status = t->exit_code;
-                    }
-                    task_destroy(t->id);
-                    return child_pid;
-                }
-            }
-            t = t->next;
+            current->need_resched = true;
         }
+    }
+}
 
-        bool has_children = false;
-        t = task_queue;
-        while (t)
+// caller holds c->rq_lock; opens due periods of the running task and those queued on c
+static void dl_tick(const struct cpu* c)
+{
+    const uint64_t now = ktime_get_ns();
+    struct task* current = c->current;
+    if (current && current->dl.runtime)
+    {
+        const bool was_active = dl_active(current);
+        dl_charge(current, now);
+        if (was_active && !dl_active(current))
         {
-            if (t->parent_pid == current_task->pid)
-            {
-                if (pid == -1 || t->pid == pid)
-                {
-                    has_children = true;
-                    break;
-                }
-            }
-            t = t->next;
+            current->need_resched = true;
         }
+    }
 
-        if (!has_children)
+    if (current)
+    {
+        dl_tick_task(current, current, now);
+    }
+    for (struct task* t = c->rq_head; t; t = t->rq_next)
+    {
+        if (t != current)
         {
-            return -1;
+            dl_tick_task(t, current, now);
         }
-
-        current_task->waiting_for = pid;
-        current_task->state = TASK_BLOCKED;
-        schedule();
     }
 }
 
-static struct task* pick_next_task(void)
+// caller holds the run queue lock of t; t runs and must give the CPU a chance to repick
+static void resched_task(struct task* t)
 {
-    struct task* best = NULL;
-    struct task* t = task_queue;
-
-    while (t)
+    t->need_resched = true;
+    if (t->cpu != this_cpu()->id)
     {
-        if (t->state == TASK_READY)
-        {
-            if (!best || t->priority > best->priority)
-            {
-                best = t;
-            }
-        }
-        t = t->next;
+        smp_send_resched(t->cpu);
     }
-    return best;
 }
 
-void schedule(void)
+// caller holds the run queue lock of t; t just became READY or gained priority
+static void check_preempt(struct task* t)
 {
-    if (!task_queue) return;
-
-    struct task* next = pick_next_task();
-    if (!next) return;
-
-    if (current_task && current_task->state == TASK_RUNNING)
+    struct cpu* self = this_cpu();
+    struct cpu* target = smp_get_cpu(t->cpu);
+    if (!target || !target->online)
     {
-        current_task->state = TASK_READY;
+        target = self;
     }
 
-    struct task* old = current_task;
-    current_task = next;
-    current_task->state = TASK_RUNNING;
-    current_task->time_slice = 10;
-
-    if (current_task->kernel_stack)
+    const struct task* running = target->current;
+    if (running && running != t && (running == target->idle || task_before(t, running)))
     {
-        tss_set_kernel_stack(current_task->kernel_stack + KERNEL_STACK_SIZE);
+        if (target == self)
+        {
+            self->current->need_resched = true;
+        }
+        else
+        {
+            target->current->need_resched = true;
+            smp_send_resched(target->id);
+        }
+        return;
     }
 
-    if (old && old != current_task)
+    // the home CPU is busy; kick an idle one so it steals the task
+    struct cpu* idle = find_idle_cpu();
+    if (idle && idle != self && !t->pinned)
     {
-        switch_context(&old->context, &current_task->context);
+        smp_send_resched(idle->id);
     }
-    else if (!old)
+}
+
+// interrupts are off and no run queue is locked; does nothing unless t is blocked
+static void wake_task(struct task* t)
+{
+    struct cpu* c = task_rq_lock(t);
+    if (t->state == TASK_BLOCKED)
     {
-        switch_context(NULL, &current_task->context);
+        t->state = TASK_READY;
+        t->stats.ready_stamp = rdtsc();
+        t->stats.woken = true;
+        if (t->dl.runtime)
+        {
+            dl_wakeup(t, ktime_get_ns());
+        }
+        rq_enqueue(c, t);
+        check_preempt(t);
     }
+    spin_unlock(&c->rq_lock);
 }
 
-void sched_yield(void)
+// caller holds task_lock
+static struct task* task_alloc(void)
 {
-    schedule();
+    struct task* t = task_free_list;
+    if (t)
+    {
+        task_free_list = t->next;
+    }
+    return t;
 }
 
-void sched_tick(void)
+// caller holds task_lock
+static void task_free(struct task* t)
 {
-    tick_count++;
+    t->next = task_free_list;
+    task_free_list = t;
+}
 
-    if (current_task)
+static bool task_slot_available(const bool new_process)
+{
+    if (task_count >= MAX_THREADS)
     {
-        current_task->cpu_ticks++;
+        return false;
+    }
+    return !new_process || process_count < MAX_PROCESSES;
+}
 
-        if (current_task->time_slice > 0)
+static uint32_t least_loaded_cpu(void)
+{
+    uint32_t best = this_cpu()->id;
+    uint32_t best_load = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        const struct cpu* c = smp_get_cpu(i);
+        if (!c || !c->online)
         {
-            current_task->time_slice--;
+            continue;
         }
 
-        if (current_task->time_slice == 0)
+        // a hint only, read without the queue locked
+        const uint32_t load = (cpu_is_idle(c) ? 0 : 1) + c->rq_count;
+
+        if (load < best_load)
         {
-            schedule();
+            best = i;
+            best_load = load;
         }
     }
+    return best;
 }
 
-struct task* sched_get_current(void)
+// caller holds task_lock
+static void task_link(struct task* t)
 {
-    return current_task;
+    t->cpu = least_loaded_cpu();
+    t->next = task_queue;
+    task_queue = t;
+    task_count++;
+    if (!t->is_thread)
+    {
+        process_count++;
+    }
 }
 
-void sched_block(const uint8_t reason)
+static struct task* task_reserve(const bool new_process)
 {
-    (void)reason;
-    if (current_task)
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = NULL;
+    if (task_slot_available(new_process))
     {
-        current_task->state = TASK_BLOCKED;
-        schedule();
+        t = task_alloc();
+    }
+    if (t)
+    {
+        memset(t, 0, sizeof(struct task));
+        t->id = next_tid++;
     }
+    spin_unlock_irqrestore(&task_lock, flags);
+    return t;
 }
 
-void sched_unblock(const tid_t id)
+static void task_release(struct task* t)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    task_free(t);
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+// new tasks are not kicked to idle CPUs; those pick them up on their next tick
+static void task_publish(struct task* t)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    task_link(t);
+    struct cpu* c = smp_get_cpu(t->cpu);
+    spin_lock(&c->rq_lock);
+    t->state = TASK_READY;
+    memset(&t->stats, 0, sizeof(t->stats));
+    t->stats.ready_stamp = rdtsc();
+    rq_enqueue(c, t);
+    spin_unlock(&c->rq_lock);
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+struct task* sched_get_task_list(void)
+{
+    return task_queue;
+}
+
+/*
+ * New tasks start here with interrupts off and the run queue lock still
+ * held by the CPU that switched to them.
+ */
+static void task_bootstrap(void)
+{
+    sched_finish_switch();
+    sti();
+
+    struct task* t = this_cpu()->current;
+    if (!t->kernel_mode)
+    {
+        enter_usermode(
+                t->entry,
+                t->user_stack_top,
+                USER_CS_SEL,
+                USER_DS_SEL
+        );
+    }
+    else if (t->is_thread)
+    {
+        ((void (*)(uint32_t))PTR_FROM_U32(t->entry))(t->entry_arg);
+        thread_exit(0);
+    }
+    else
+    {
+        ((void (*)(void))PTR_FROM_U32(t->entry))();
+        task_exit(t->id, 0);
+        schedule();
+    }
+
+    while (1)
+    {
+        hlt();
+    }
+}
+
+static void task_init_context(struct task* t)
+{
+    uint32_t* kstack = (uint32_t*)PTR_FROM_U32(t->kernel_stack_top);
+    kstack[-1] = 0;
+    kstack[-2] = 0;
+    kstack[-3] = 0;
+    kstack[-4] = 0;
+    kstack[-5] = 0;
+
+    t->context.esp = PTR_TO_U32(&kstack[-5]);
+    t->context.eip = FUNC_PTR_TO_U32(task_bootstrap);
+    t->context.eflags = 0x002;
+}
+
+struct task* task_create(void (*entry)(void), const uint8_t priority, const bool kernel_mode)
+{
+    struct task* current = this_cpu()->current;
+    struct task* t = task_reserve(true);
+    if (!t)
+    {
+        return NULL;
+    }
+
+    t->pid = (pid_t)t->id;
+    t->parent_pid = current ? current->pid : 0;
+    t->state = TASK_BLOCKED;
+    t->priority = priority;
+    t->base_priority = priority;
+    t->inherited_priority = 0;
+    t->time_slice = 10;
+    t->kernel_mode = kernel_mode;
+    t->exit_code = 0;
+    t->waiting_for = 0;
+    t->entry = FUNC_PTR_TO_U32(entry);
+
+    t->kernel_stack = stack_alloc(STACK_KERNEL);
+    if (!t->kernel_stack)
+    {
+        task_release(t);
+        return NULL;
+    }
+    t->kernel_stack_top = t->kernel_stack + KERNEL_STACK_SIZE;
+
+    if (!kernel_mode)
+    {
+        t->user_stack = stack_alloc(STACK_USER);
+        if (!t->user_stack)
+        {
+            stack_free(STACK_KERNEL, t->kernel_stack);
+            task_release(t);
+            return NULL;
+        }
+        t->user_stack_top = t->user_stack + USER_STACK_SIZE;
+    }
+
+    task_init_context(t);
+    task_publish(t);
+
+    return t;
+}
+
+struct task* task_create_user(const uint32_t entry_point, const uint8_t priority)
+{
+    struct task* current = this_cpu()->current;
+    struct task* t = task_reserve(true);
+    if (!t)
+    {
+        return NULL;
+    }
+
+    t->pid = (pid_t)t->id;
+    t->parent_pid = current ? current->pid : 0;
+    t->state = TASK_BLOCKED;
+    t->priority = priority;
+    t->base_priority = priority;
+    t->inherited_priority = 0;
+    t->time_slice = 10;
+    t->kernel_mode = false;
+    t->exit_code = 0;
+    t->waiting_for = 0;
+    t->entry = entry_point;
+
+    t->kernel_stack = stack_alloc(STACK_KERNEL);
+    if (!t->kernel_stack)
+    {
+        task_release(t);
+        return NULL;
+    }
+    t->kernel_stack_top = t->kernel_stack + KERNEL_STACK_SIZE;
+
+    t->user_stack = stack_alloc(STACK_USER);
+    if (!t->user_stack)
+    {
+        stack_free(STACK_KERNEL, t->kernel_stack);
+        task_release(t);
+        return NULL;
+    }
+    t->user_stack_top = t->user_stack + USER_STACK_SIZE;
+
+    task_init_context(t);
+    task_publish(t);
+
+    return t;
+}
+
+void task_destroy(const tid_t id)
+{
+    while (1)
+    {
+        const uint32_t flags = spin_lock_irqsave(&task_lock);
+
+        struct task* prev = NULL;
+        struct task* t = task_queue;
+        while (t && t->id != id)
+        {
+            prev = t;
+            t = t->next;
+        }
+
+        if (!t)
+        {
+            spin_unlock_irqrestore(&task_lock, flags);
+            return;
+        }
+
+        // a task running on another CPU is stopped before its stacks go away
+        struct cpu* c = task_rq_lock(t);
+        if (t->on_cpu && t != this_cpu()->current)
+        {
+            if (t->state != TASK_ZOMBIE)
+            {
+                rq_dequeue(c, t);
+                t->state = TASK_ZOMBIE;
+                t->need_resched = true;
+                smp_send_resched(t->cpu);
+            }
+            spin_unlock(&c->rq_lock);
+            spin_unlock_irqrestore(&task_lock, flags);
+            __asm__ volatile ("pause");
+            continue;
+        }
+        rq_dequeue(c, t);
+        spin_unlock(&c->rq_lock);
+
+        if (prev) prev->next = t->next;
+        else task_queue = t->next;
+
+        task_count--;
+        if (!t->is_thread)
+        {
+            process_count--;
+        }
+
+        del_timer(&t->sleep_timer);
+        dl_release(t);
+        const uint32_t kernel_stack = t->kernel_stack;
+        const uint32_t user_stack = t->user_stack;
+        const pid_t process = t->is_thread ? 0 : t->pid;
+        task_free(t);
+        spin_unlock_irqrestore(&task_lock, flags);
+
+        if (kernel_stack) stack_free(STACK_KERNEL, kernel_stack);
+        if (user_stack) stack_free(STACK_USER, user_stack);
+        // a killed process never went through task_exit
+        pipe_exit(process);
+        udrv_exit(process);
+        return;
+    }
+}
+
+// caller holds task_lock with interrupts off; t stops being runnable
+static void task_kill_locked(struct task* t, const int32_t exit_code)
+{
+    struct cpu* c = task_rq_lock(t);
+    rq_dequeue(c, t);
+    t->state = TASK_ZOMBIE;
+    t->exit_code = exit_code;
+    dl_release(t);
+    if (t->on_cpu && c != this_cpu())
+    {
+        t->need_resched = true;
+        smp_send_resched(c->id);
+    }
+    spin_unlock(&c->rq_lock);
+    del_timer(&t->sleep_timer);
+}
+
+// caller holds task_lock with interrupts off
+static void task_exit_locked(struct task* t, const int32_t exit_code)
+{
+    task_kill_locked(t, exit_code);
+
+    struct task* other = task_queue;
+    while (other)
+    {
+        // the main thread exiting takes the rest of the process with it
+        if (!t->is_thread && other->pid == t->pid && other->is_thread &&
+            other->state != TASK_ZOMBIE)
+        {
+            task_kill_locked(other, exit_code);
+        }
+        if (other->state == TASK_BLOCKED && other->join_waiting_for == t->id)
+        {
+            wake_task(other);
+        }
+        other = other->next;
+    }
+
+    if (t->is_thread)
+    {
+        return;
+    }
+
+    other = task_queue;
+    while (other)
+    {
+        if (other->pid == t->parent_pid && !other->is_thread)
+        {
+            if (other->state == TASK_BLOCKED &&
+                (other->waiting_for == t->pid || other->waiting_for == -1))
+            {
+                wake_task(other);
+            }
+            break;
+        }
+        other = other->next;
+    }
+}
+
+void task_exit(const tid_t id, const int32_t exit_code)
+{
+    // descriptors close first so the other ends see end of file at once
+    const struct task* exiting = thread_find(id);
+    if (exiting && !exiting->is_thread)
+    {
+        pipe_exit(exiting->pid);
+        udrv_exit(exiting->pid);
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = task_queue;
+    while (t)
+    {
+        if (t->id == id)
+        {
+            task_exit_locked(t, exit_code);
+            break;
+        }
+        t = t->next;
+    }
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+static struct task* task_find_locked(const pid_t pid)
+{
+    struct task* t = task_queue;
+    while (t)
+    {
+        if (t->pid == pid && !t->is_thread)
+        {
+            return t;
+        }
+        t = t->next;
+    }
+    return NULL;
+}
+
+static struct task* thread_find_locked(const tid_t id)
+{
+    struct task* t = task_queue;
+    while (t)
+    {
+        if (t->id == id)
+        {
+            return t;
+        }
+        t = t->next;
+    }
+    return NULL;
+}
+
+struct task* task_find(const pid_t pid)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = task_find_locked(pid);
+    spin_unlock_irqrestore(&task_lock, flags);
+    return t;
+}
+
+struct task* thread_find(const tid_t id)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = thread_find_locked(id);
+    spin_unlock_irqrestore(&task_lock, flags);
+    return t;
+}
+
+struct task* thread_create(const uint32_t entry, const uint32_t arg, const uint8_t priority)
+{
+    struct task* owner = this_cpu()->current;
+    if (!owner || !entry)
+    {
+        return NULL;
+    }
+
+    struct task* t = task_reserve(false);
+    if (!t)
+    {
+        return NULL;
+    }
+
+    t->pid = owner->pid;
+    t->parent_pid = owner->parent_pid;
+    t->state = TASK_BLOCKED;
+    t->priority = priority;
+    t->base_priority = priority;
+    t->inherited_priority = 0;
+    t->time_slice = 10;
+    t->kernel_mode = owner->kernel_mode;
+    t->is_thread = true;
+    t->entry = entry;
+    t->entry_arg = arg;
+
+    t->kernel_stack = stack_alloc(STACK_KERNEL);
+    if (!t->kernel_stack)
+    {
+        task_release(t);
+        return NULL;
+    }
+    t->kernel_stack_top = t->kernel_stack + KERNEL_STACK_SIZE;
+
+    if (!t->kernel_mode)
+    {
+        t->user_stack = stack_alloc(STACK_USER);
+        if (!t->user_stack)
+        {
+            stack_free(STACK_KERNEL, t->kernel_stack);
+            task_release(t);
+            return NULL;
+        }
+
+        // user threads see arg as their first stack argument and must leave via thread_exit
+        uint32_t* ustack = (uint32_t*)PTR_FROM_U32(t->user_stack + USER_STACK_SIZE);
+        ustack[-1] = arg;
+        ustack[-2] = 0;
+        t->user_stack_top = PTR_TO_U32(&ustack[-2]);
+    }
+
+    task_init_context(t);
+    t->context.cr3 = owner->context.cr3;
+    task_publish(t);
+
+    return t;
+}
+
+void thread_exit(const int32_t exit_code)
+{
+    struct task* current = this_cpu()->current;
+    if (!current)
+    {
+        return;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    task_exit_locked(current, exit_code);
+    spin_unlock(&task_lock);
+    schedule_irqoff(flags);
+}
+
+int thread_join(const tid_t id, int32_t* status)
+{
+    struct task* current = this_cpu()->current;
+    if (!current || id == current->id)
+    {
+        return -1;
+    }
+
+    while (1)
+    {
+        const uint32_t flags = spin_lock_irqsave(&task_lock);
+        struct task* t = thread_find_locked(id);
+        if (!t || !t->is_thread || t->pid != current->pid)
+        {
+            spin_unlock_irqrestore(&task_lock, flags);
+            return -1;
+        }
+
+        if (t->state == TASK_ZOMBIE)
+        {
+            if (status)
+            {
+                *status = t->exit_code;
+            }
+            spin_unlock_irqrestore(&task_lock, flags);
+            task_destroy(id);
+            return 0;
+        }
+
+        // checked and blocked under the lock, so the exit cannot slip in between
+        current->join_waiting_for = id;
+        set_current_state(TASK_BLOCKED);
+        spin_unlock(&task_lock);
+        schedule_irqoff(flags);
+        current->join_waiting_for = 0;
+    }
+}
+
+uint32_t sched_get_thread_count(const pid_t pid)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    uint32_t count = 0;
+    const struct task* t = task_queue;
+    while (t)
+    {
+        if (t->pid == pid)
+        {
+            count++;
+        }
+        t = t->next;
+    }
+    spin_unlock_irqrestore(&task_lock, flags);
+    return count;
+}
+
+pid_t task_fork(void)
+{
+    struct task* current = this_cpu()->current;
+    if (!current)
+    {
+        return -1;
+    }
+
+    struct task* child = task_reserve(true);
+    if (!child)
+    {
+        return -1;
+    }
+
+    const tid_t child_id = child->id;
+    memcpy(child, current, sizeof(struct task));
+    child->id = child_id;
+    child->pid = (pid_t)child->id;
+    child->parent_pid = current->pid;
+    child->state = TASK_BLOCKED;
+    child->priority = current->base_priority;
+    child->inherited_priority = 0;
+    memset(&child->dl, 0, sizeof(child->dl));
+    child->time_slice = 10;
+    child->cpu_ticks = 0;
+    child->exit_code = 0;
+    child->waiting_for = 0;
+    child->is_thread = false;
+    child->join_waiting_for = 0;
+    child->on_cpu = false;
+    child->queued = false;
+    child->rq_next = NULL;
+    child->pinned = false;
+    child->need_resched = false;
+    child->preempt_count = 0;
+    timer_setup(&child->sleep_timer, NULL, 0);
+
+    child->kernel_stack = stack_alloc(STACK_KERNEL);
+    if (!child->kernel_stack)
+    {
+        task_release(child);
+        return -1;
+    }
+    child->kernel_stack_top = child->kernel_stack + KERNEL_STACK_SIZE;
+
+    memcpy(PTR_FROM_U32(child->kernel_stack), PTR_FROM_U32(current->kernel_stack), KERNEL_STACK_SIZE);
+
+    uint32_t stack_offset = current->context.esp - current->kernel_stack;
+    child->context.esp = child->kernel_stack + stack_offset;
+
+    if (!current->kernel_mode && current->user_stack)
+    {
+        child->user_stack = stack_alloc(STACK_USER);
+        if (!child->user_stack)
+        {
+            stack_free(STACK_KERNEL, child->kernel_stack);
+            task_release(child);
+            return -1;
+        }
+        child->user_stack_top = child->user_stack + USER_STACK_SIZE;
+        memcpy(PTR_FROM_U32(child->user_stack), PTR_FROM_U32(current->user_stack), USER_STACK_SIZE);
+    }
+
+    child->context.eax = 0;
+
+    if (pipe_fork(current->pid, child->pid) != 0)
+    {
+        if (!current->kernel_mode && current->user_stack)
+        {
+            stack_free(STACK_USER, child->user_stack);
+        }
+        stack_free(STACK_KERNEL, child->kernel_stack);
+        task_release(child);
+        return -1;
+    }
+
+    task_publish(child);
+
+    return child->pid;
+}
+
+static void reap_threads(const pid_t pid)
+{
+    while (1)
+    {
+        const uint32_t flags = spin_lock_irqsave(&task_lock);
+        struct task* t = task_queue;
+        while (t && !(t->pid == pid && t->is_thread))
+        {
+            t = t->next;
+        }
+        const tid_t id = t ? t->id : 0;
+        spin_unlock_irqrestore(&task_lock, flags);
+
+        if (!id)
+        {
+            return;
+        }
+        task_destroy(id);
+    }
+}
+
+pid_t task_wait(const pid_t pid, int32_t* status)
+{
+    struct task* current = this_cpu()->current;
+    if (!current)
+    {
+        return -1;
+    }
+
+    while (1)
+    {
+        const uint32_t flags = spin_lock_irqsave(&task_lock);
+
+        bool has_children = false;
+        struct task* t = task_queue;
+        while (t)
+        {
+            if (t->parent_pid == current->pid && !t->is_thread && (pid == -1 || t->pid == pid))
+            {
+                if (t->state == TASK_ZOMBIE)
+                {
+                    const pid_t child_pid = t->pid;
+                    const tid_t child_id = t->id;
+                    if (status)
+                    {
+                        *status = t->exit_code;
+                    }
+                    spin_unlock_irqrestore(&task_lock, flags);
+                    task_destroy(child_id);
+                    reap_threads(child_pid);
+                    return child_pid;
+                }
+                has_children = true;
+            }
+            t = t->next;
+        }
+
+        if (!has_children)
+        {
+            spin_unlock_irqrestore(&task_lock, flags);
+            return -1;
+        }
+
+        current->waiting_for = pid;
+        set_current_state(TASK_BLOCKED);
+        spin_unlock(&task_lock);
+        schedule_irqoff(flags);
+    }
+}
+
+// the outgoing task is still on_cpu but may simply be picked again
+static bool task_runnable_on(const struct task* t, const struct cpu* c)
+{
+    return t->state == TASK_READY && t->cpu == c->id && (!t->on_cpu || t == c->current);
+}
+
+// a task woken before it finished blocking is queued while it still runs
+static bool task_stealable(const struct task* t, const uint32_t cpu)
+{
+    return t->state == TASK_READY && !t->on_cpu && !t->pinned && t->cpu != cpu;
+}
+
+// caller holds v->rq_lock
+static struct task* find_stealable(const struct cpu* v, const uint32_t cpu)
+{
+    struct task* best = NULL;
+    for (struct task* t = v->rq_head; t; t = t->rq_next)
+    {
+        if (task_stealable(t, cpu) && (!best || task_before(t, best)))
+        {
+            best = t;
+        }
+    }
+    return best;
+}
+
+/*
+ * Caller holds c->rq_lock. Victim queues are only tried, so two CPUs
+ * stealing from each other cannot deadlock; a busy queue is skipped
+ * until the next tick. The queue holding the best candidate so far stays
+ * locked until a better one turns up.
+ */
+static struct task* steal_task(struct cpu* c)
+{
+    struct cpu* from = NULL;
+    struct task* best = NULL;
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        struct cpu* v = smp_get_cpu(i);
+        if (!v || v == c || !v->online || !v->rq_count || !spin_trylock(&v->rq_lock))
+        {
+            continue;
+        }
+
+        struct task* t = find_stealable(v, c->id);
+        if (t && (!best || task_before(t, best)))
+        {
+            if (from)
+            {
+                spin_unlock(&from->rq_lock);
+            }
+            from = v;
+            best = t;
+        }
+        else
+        {
+            spin_unlock(&v->rq_lock);
+        }
+    }
+
+    if (!best)
+    {
+        return NULL;
+    }
+    rq_dequeue(from, best);
+    best->cpu = c->id;
+    spin_unlock(&from->rq_lock);
+    c->steals++;
+    return best;
+}
+
+// caller holds c->rq_lock; the task returned is off the queue
+static struct task* pick_next_task(struct cpu* c)
+{
+    struct task* best = NULL;
+    for (struct task* t = c->rq_head; t; t = t->rq_next)
+    {
+        if (task_runnable_on(t, c) && (!best || task_before(t, best)))
+        {
+            best = t;
+        }
+    }
+    if (best)
+    {
+        rq_dequeue(c, best);
+        return best;
+    }
+
+    // own queue is empty: steal the highest priority task queued elsewhere
+    best = steal_task(c);
+    if (best)
+    {
+        return best;
+    }
+
+    if (c->idle && task_runnable_on(c->idle, c))
+    {
+        return c->idle;
+    }
+    return NULL;
+}
+
+// caller holds c->rq_lock; a preempted or woken prev goes back on the queue
+static void put_prev_task(struct cpu* c, struct task* prev)
+{
+    if (prev->state == TASK_RUNNING)
+    {
+        prev->state = TASK_READY;
+    }
+    if (prev->state == TASK_READY)
+    {
+        rq_enqueue(c, prev);
+    }
+}
+
+void sched_finish_switch(void)
+{
+    struct cpu* c = this_cpu();
+    if (c->prev)
+    {
+        c->prev->on_cpu = false;
+        c->prev = NULL;
+    }
+    spin_unlock(&c->rq_lock);
+}
+
+// caller holds c->rq_lock; gives the CPU to next and releases the lock
+static void switch_locked(struct cpu* c, struct task* prev, struct task* next, const uint64_t now,
+                          const bool involuntary, const uint32_t flags)
+{
+    if (next != prev)
+    {
+        if (prev)
+        {
+            account_switch_out(prev, now, involuntary);
+        }
+        account_switch_in(next, now, &cpu_stats[c->id]);
+        cpu_stats[c->id].switches++;
+
+        if (dl_count)
+        {
+            const uint64_t ns = ktime_get_ns();
+            if (prev && prev->dl.runtime)
+            {
+                dl_charge(prev, ns);
+                if (prev->state == TASK_BLOCKED)
+                {
+                    dl_job_end(prev, ns);
+                }
+            }
+            next->dl.charge_stamp = ns;
+        }
+    }
+
+    next->state = TASK_RUNNING;
+    next->on_cpu = true;
+    next->cpu = c->id;
+    next->time_slice = 10;
+    c->current = next;
+    c->prev = (prev != next) ? prev : NULL;
+
+    if (next->kernel_stack)
+    {
+        tss_set_kernel_stack(next->kernel_stack + KERNEL_STACK_SIZE);
+    }
+    udrv_switch(next->pid);
+
+    if (!prev)
+    {
+        switch_context(NULL, &next->context);
+    }
+    else if (prev != next)
+    {
+        switch_context(&prev->context, &next->context);
+    }
+
+    sched_finish_switch();
+    if (flags & 0x200)
+    {
+        sti();
+    }
+}
+
+/*
+ * Called with the run queue of this CPU locked and flags from
+ * spin_lock_irqsave. Returns with the lock released and the interrupt
+ * state restored, possibly on another CPU after the task migrated.
+ */
+static void schedule_locked(const uint32_t flags)
 {
-    struct task* t = task_queue;
-    while (t)
+    const uint64_t start = rdtsc();
+    struct cpu* c = this_cpu();
+    struct task* prev = c->current;
+
+    // still runnable and asked to give up the CPU: preempted, not yielding
+    const bool involuntary = prev && prev->state == TASK_RUNNING && prev->need_resched;
+    if (prev)
     {
-        if (t->id == id)
+        prev->need_resched = false;
+        put_prev_task(c, prev);
+    }
+
+    struct task* next = pick_next_task(c);
+
+    const uint64_t now = rdtsc();
+    const uint32_t cost = (uint32_t)(now - start);
+    struct sched_global_stats* stats = &cpu_stats[c->id];
+    stats->schedule_calls++;
+    stats->schedule_cycles += cost;
+    if (cost > stats->schedule_max_cycles)
+    {
+        stats->schedule_max_cycles = cost;
+    }
+
+    if (!next)
+    {
+        if (prev && prev->state == TASK_READY)
+        {
+            rq_dequeue(c, prev);
+            prev->state = TASK_RUNNING;
+        }
+        spin_unlock_irqrestore(&c->rq_lock, flags);
+        return;
+    }
+
+    switch_locked(c, prev, next, now, involuntary, flags);
+}
+
+void schedule(void)
+{
+    uint32_t flags;
+    this_rq_lock_irqsave(&flags);
+    schedule_locked(flags);
+}
+
+void sched_yield(void)
+{
+    schedule();
+}
+
+// interrupts are off; busy queues are skipped, the next tick looks again
+static bool steal_candidate_exists(const uint32_t cpu)
+{
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        struct cpu* v = smp_get_cpu(i);
+        if (!v || v->id == cpu || !v->online || !v->rq_count || !spin_trylock(&v->rq_lock))
+        {
+            continue;
+        }
+        const bool found = find_stealable(v, cpu) != NULL;
+        spin_unlock(&v->rq_lock);
+        if (found)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void sched_tick(void)
+{
+    struct cpu* c = this_cpu();
+    struct task* current = c->current;
+
+    c->ticks++;
+    if (c->id == 0)
+    {
+        tick_count++;
+    }
+
+    if (current)
+    {
+        current->cpu_ticks++;
+
+        if (current->time_slice > 0)
+        {
+            current->time_slice--;
+        }
+
+        if (current->time_slice == 0)
+        {
+            current->need_resched = true;
+        }
+
+        // idle-time work stealing
+        if (current == c->idle && !current->need_resched && steal_candidate_exists(c->id))
+        {
+            current->need_resched = true;
+        }
+    }
+
+    if (dl_count)
+    {
+        spin_lock(&c->rq_lock);
+        dl_tick(c);
+        spin_unlock(&c->rq_lock);
+    }
+}
+
+void sched_set_need_resched(void)
+{
+    struct task* current = this_cpu()->current;
+    if (current)
+    {
+        current->need_resched = true;
+    }
+}
+
+bool sched_need_resched(void)
+{
+    const struct task* current = this_cpu()->current;
+    return current && current->need_resched;
+}
+
+void preempt_disable(void)
+{
+    struct task* current = this_cpu()->current;
+    if (current)
+    {
+        current->preempt_count++;
+    }
+}
+
+void preempt_enable(void)
+{
+    struct task* current = this_cpu()->current;
+    if (!current || current->preempt_count == 0)
+    {
+        return;
+    }
+
+    current->preempt_count--;
+    if (current->preempt_count == 0 && current->need_resched && (read_eflags() & 0x200))
+    {
+        schedule();
+    }
+}
+
+void sched_preempt_irq(void)
+{
+    const struct task* current = this_cpu()->current;
+    if (current && current->need_resched && current->preempt_count == 0)
+    {
+        schedule();
+    }
+}
+
+struct task* sched_get_current(void)
+{
+    return this_cpu()->current;
+}
+
+void sched_prepare_block(void)
+{
+    uint32_t flags;
+    struct cpu* c = this_rq_lock_irqsave(&flags);
+    if (c->current)
+    {
+        set_current_state_locked(c, TASK_BLOCKED);
+    }
+    spin_unlock_irqrestore(&c->rq_lock, flags);
+}
+
+void sched_cancel_block(void)
+{
+    uint32_t flags;
+    struct cpu* c = this_rq_lock_irqsave(&flags);
+    if (c->current)
+    {
+        set_current_state_locked(c, TASK_RUNNING);
+    }
+    spin_unlock_irqrestore(&c->rq_lock, flags);
+}
+
+void sched_block(const uint8_t reason)
+{
+    (void)reason;
+    uint32_t flags;
+    struct cpu* c = this_rq_lock_irqsave(&flags);
+    if (!c->current)
+    {
+        spin_unlock_irqrestore(&c->rq_lock, flags);
+        return;
+    }
+    set_current_state_locked(c, TASK_BLOCKED);
+    schedule_locked(flags);
+}
+
+/*
+ * Direct handoff for synchronous IPC. The partner is woken and switched to
+ * on this CPU without a run queue scan; it already runs at the priority
+ * the IPC layer lent it. A partner that cannot run here (still switching
+ * out elsewhere, pinned to another CPU, or on a run queue that is busy)
+ * is woken the normal way.
+ */
+void sched_handoff(const tid_t id)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct cpu* c = this_cpu();
+    struct task* prev = c->current;
+    struct task* next = thread_find_locked(id);
+
+    // the partner's queue is only tried while this CPU's is held
+    spin_lock(&c->rq_lock);
+    struct cpu* from = NULL;
+    bool direct = next && next != prev && !(next->pinned && next->cpu != c->id);
+    if (direct && next->cpu != c->id)
+    {
+        from = smp_get_cpu(next->cpu);
+        if (!spin_trylock(&from->rq_lock))
+        {
+            from = NULL;
+        }
+        // it may have been stolen before its queue was locked
+        direct = from && next->cpu == from->id;
+    }
+
+    // a caller that stays runnable only yields when it may be preempted
+    const bool may_switch = prev && (prev->state == TASK_BLOCKED || !prev->preempt_count);
+    if (!may_switch || !direct || next->state != TASK_BLOCKED || next->on_cpu)
+    {
+        if (from)
+        {
+            spin_unlock(&from->rq_lock);
+        }
+        spin_unlock(&c->rq_lock);
+        if (next)
         {
-            t->state = TASK_READY;
+            wake_task(next);
+        }
+        spin_unlock(&task_lock);
+        if (prev && prev->state == TASK_BLOCKED)
+        {
+            schedule_irqoff(flags);
             return;
         }
-        t = t->next;
+        if (flags & 0x200)
+        {
+            sti();
+        }
+        return;
+    }
+
+    // next moves to this CPU; nothing can find it until switch_locked runs it
+    next->cpu = c->id;
+    if (from)
+    {
+        spin_unlock(&from->rq_lock);
+    }
+    spin_unlock(&task_lock);
+
+    const uint64_t now = rdtsc();
+    next->stats.ready_stamp = now;
+    next->stats.woken = true;
+    if (next->dl.runtime)
+    {
+        dl_wakeup(next, ktime_get_ns());
+    }
+
+    // a caller that keeps running was not preempted, it lent its slice
+    prev->need_resched = false;
+    put_prev_task(c, prev);
+    cpu_stats[c->id].handoffs++;
+    switch_locked(c, prev, next, now, false, flags);
+}
+
+void sched_unblock(const tid_t id)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = thread_find_locked(id);
+    if (t)
+    {
+        wake_task(t);
+    }
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+void sched_set_inherited_priority(const tid_t id, const uint8_t prio)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = thread_find_locked(id);
+    if (!t)
+    {
+        spin_unlock_irqrestore(&task_lock, flags);
+        return;
+    }
+
+    struct cpu* c = task_rq_lock(t);
+    if (t->state == TASK_ZOMBIE)
+    {
+        spin_unlock(&c->rq_lock);
+        spin_unlock_irqrestore(&task_lock, flags);
+        return;
+    }
+
+    t->inherited_priority = prio;
+    const uint8_t effective = prio > t->base_priority ? prio : t->base_priority;
+    const uint8_t old = t->priority;
+    t->priority = effective;
+
+    if (effective > old && t->state == TASK_READY)
+    {
+        check_preempt(t);
+    }
+    else if (effective < old && t->state == TASK_RUNNING)
+    {
+        // a task it was shielded from may be waiting: let the CPU repick
+        resched_task(t);
+    }
+    spin_unlock(&c->rq_lock);
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+int sched_set_deadline(const tid_t id, const uint32_t runtime_us, const uint32_t deadline_us,
+                       const uint32_t period_us)
+{
+    if (runtime_us && (runtime_us > deadline_us || deadline_us > period_us))
+    {
+        return -1;
+    }
+
+    const uint32_t bandwidth = runtime_us ? (uint32_t)((uint64_t)runtime_us * DL_BANDWIDTH_UNIT / period_us) : 0;
+    const uint64_t now = ktime_get_ns();
+
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct task* t = thread_find_locked(id);
+    if (!t)
+    {
+        spin_unlock_irqrestore(&task_lock, flags);
+        return -1;
+    }
+
+    struct cpu* c = task_rq_lock(t);
+    const uint32_t others = dl_bandwidth - (t->dl.runtime ? t->dl.bandwidth : 0);
+    if (t->state == TASK_ZOMBIE || task_is_idle(t) || others + bandwidth > SCHED_DL_MAX_BANDWIDTH)
+    {
+        spin_unlock(&c->rq_lock);
+        spin_unlock_irqrestore(&task_lock, flags);
+        return -1;
+    }
+
+    dl_release(t);
+    if (runtime_us)
+    {
+        t->dl.runtime = (uint64_t)runtime_us * NSEC_PER_USEC;
+        t->dl.deadline = (uint64_t)deadline_us * NSEC_PER_USEC;
+        t->dl.period = (uint64_t)period_us * NSEC_PER_USEC;
+        t->dl.bandwidth = bandwidth;
+        dl_start_period(t, now, now);
+        dl_bandwidth += bandwidth;
+        dl_count++;
+    }
+
+    if (t->state == TASK_READY)
+    {
+        check_preempt(t);
+    }
+    else if (t->state == TASK_RUNNING)
+    {
+        resched_task(t);
+    }
+    spin_unlock(&c->rq_lock);
+    spin_unlock_irqrestore(&task_lock, flags);
+    return 0;
+}
+
+void sched_dl_yield(void)
+{
+    struct task* current = this_cpu()->current;
+    if (!current || !current->dl.runtime)
+    {
+        sched_yield();
+        return;
+    }
+
+    uint32_t flags;
+    struct cpu* c = this_rq_lock_irqsave(&flags);
+    const uint64_t now = ktime_get_ns();
+    dl_charge(current, now);
+    dl_job_end(current, now);
+    const uint64_t wait = current->dl.period_end > now ? current->dl.period_end - now : 0;
+    spin_unlock_irqrestore(&c->rq_lock, flags);
+
+    // the wakeup opens the next period, see dl_wakeup()
+    const uint64_t tick = tick_ns();
+    timer_sleep((uint32_t)((wait + tick - 1) / tick));
+}
+
+uint32_t sched_get_dl_bandwidth(void)
+{
+    return dl_bandwidth;
+}
+
+void sched_set_idle_task(const uint32_t cpu, struct task* t)
+{
+    struct cpu* c = smp_get_cpu(cpu);
+    if (!c || !t)
+    {
+        return;
+    }
+
+    // the idle task leaves the queue it was published on and is never queued again
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    struct cpu* from = task_rq_lock(t);
+    rq_dequeue(from, t);
+    c->idle = t;
+    t->cpu = cpu;
+    t->pinned = true;
+    spin_unlock(&from->rq_lock);
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+void sched_start_cpu(void)
+{
+    schedule();
+
+    // nothing to run: the CPU has no idle task yet
+    while (1)
+    {
+        hlt();
     }
 }
 
@@ -444,8 +1809,81 @@ uint32_t sched_get_total_ticks(void)
     return tick_count;
 }
 
+void sched_get_global_stats(struct sched_global_stats* out)
+{
+    if (!out)
+    {
+        return;
+    }
+
+    memset(out, 0, sizeof(*out));
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        struct cpu* c = smp_get_cpu(i);
+        if (!c)
+        {
+            continue;
+        }
+
+        const uint32_t flags = spin_lock_irqsave(&c->rq_lock);
+        const struct sched_global_stats* s = &cpu_stats[i];
+        out->switches += s->switches;
+        out->schedule_calls += s->schedule_calls;
+        out->schedule_cycles += s->schedule_cycles;
+        if (s->schedule_max_cycles > out->schedule_max_cycles)
+        {
+            out->schedule_max_cycles = s->schedule_max_cycles;
+        }
+        out->wakeups += s->wakeups;
+        out->wakeup_cycles += s->wakeup_cycles;
+        if (s->wakeup_max_cycles > out->wakeup_max_cycles)
+        {
+            out->wakeup_max_cycles = s->wakeup_max_cycles;
+        }
+        for (uint32_t b = 0; b < SCHED_LAT_BUCKETS; b++)
+        {
+            out->wakeup_hist[b] += s->wakeup_hist[b];
+        }
+        out->handoffs += s->handoffs;
+        spin_unlock_irqrestore(&c->rq_lock, flags);
+    }
+}
+
+uint32_t sched_get_switch_count(void)
+{
+    uint32_t switches = 0;
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        switches += cpu_stats[i].switches;
+    }
+    return switches;
+}
+
+uint32_t sched_get_runnable_count(void)
+{
+    const uint32_t flags = spin_lock_irqsave(&task_lock);
+    uint32_t count = 0;
+    const struct task* t = task_queue;
+    while (t)
+    {
+        if ((t->state == TASK_READY || t->state == TASK_RUNNING) && !task_is_idle(t))
+        {
+            count++;
+        }
+        t = t->next;
+    }
+    spin_unlock_irqrestore(&task_lock, flags);
+    return count;
+}
+
 struct task* sched_get_idle_task(void)
 {
+    const struct cpu* boot = smp_get_cpu(0);
+    if (boot && boot->idle)
+    {
+        return boot->idle;
+    }
+
     struct task* t = task_queue;
     while (t)
     {
@@ -3,6 +3,7 @@
 
 #include "../include/types.h"
 #include "../include/config.h"
+#include "../sys/ktimer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,8 +57,87 @@ struct iret_frame
     uint32_t ss;
 };
 
+/**
+ * @brief Number of log2 buckets in the wakeup latency histograms
+ * @details Bucket n counts latencies of 2^n to 2^(n+1)-1 TSC cycles.
+ */
+#define SCHED_LAT_BUCKETS 32
+
+/**
+ * @brief Per-task scheduling accounting in TSC cycles \struct sched_stats
+ * @details A wakeup is a BLOCKED task made READY; its latency runs until
+ *          the task is switched in. Preempted tasks only add wait time.
+ */
+struct sched_stats
+{
+    uint64_t run_cycles;
+    uint64_t wait_cycles;
+    uint64_t ready_stamp;
+    uint64_t run_stamp;
+    uint32_t nr_voluntary;
+    uint32_t nr_involuntary;
+    uint32_t nr_wakeups;
+    uint32_t max_wakeup_latency;
+    bool woken;
+    uint32_t wakeup_hist[SCHED_LAT_BUCKETS];
+};
+
+/**
+ * @brief System-wide scheduler statistics \struct sched_global_stats
+ * @details schedule cycles cover the pick of the next task, not the
+ *          context switch itself.
+ */
+struct sched_global_stats
+{
+    uint32_t switches;
+    uint32_t schedule_calls;
+    uint64_t schedule_cycles;
+    uint32_t schedule_max_cycles;
+    uint32_t wakeups;
+    uint64_t wakeup_cycles;
+    uint32_t wakeup_max_cycles;
+    uint32_t wakeup_hist[SCHED_LAT_BUCKETS];
+    uint32_t handoffs;
+};
+
+/**
+ * @brief Share of one CPU the deadline class may reserve, in parts per million
+ * @details Deadline tasks may run on any CPU, so admission is bounded by a
+ *          single CPU to keep global EDF within its guarantees.
+ */
+#define SCHED_DL_MAX_BANDWIDTH 900000
+
+/**
+ * @brief Deadline class parameters and state in nanoseconds \struct sched_dl
+ * @details A task with a runtime gets up to runtime of CPU time in every
+ *          period, ahead of all fixed-priority tasks and ordered by earliest
+ *          absolute deadline. Once the budget is spent it runs at its fixed
+ *          priority until the next period replenishes it. A job ends when
+ *          the task blocks or calls sched_dl_yield(); it misses when it ends
+ *          after its deadline or is still running when its period is over.
+ */
+struct sched_dl
+{
+    uint64_t runtime;
+    uint64_t deadline;
+    uint64_t period;
+    uint64_t abs_deadline;
+    uint64_t period_end;
+    uint64_t charge_stamp;
+    int64_t remaining;
+    uint32_t bandwidth;
+    bool job_done;
+    uint32_t nr_jobs;
+    uint32_t nr_misses;
+    uint64_t max_lateness;
+};
+
 /**
  * @brief Task structure
+ * @details priority is the effective priority the scheduler picks by: the
+ *          higher of base_priority and inherited_priority. next links all
+ *          tasks; rq_next links a READY task on the run queue of its cpu
+ *          while queued is set.
  */
 struct task
 {
@@ -66,17 +146,33 @@ struct task
     pid_t parent_pid;
     uint8_t state;
     uint8_t priority;
+    uint8_t base_priority;
+    uint8_t inherited_priority;
     uint32_t time_slice;
     bool kernel_mode;
     uint32_t kernel_stack;
     uint32_t kernel_stack_top;
     uint32_t user_stack;
     uint32_t user_stack_top;
+    uint32_t entry;
+    uint32_t entry_arg;
     uint32_t cpu_ticks;
     int32_t exit_code;
     pid_t waiting_for;
+    bool is_thread;
+    tid_t join_waiting_for;
+    volatile bool need_resched;
+    volatile uint32_t preempt_count;
+    uint32_t cpu;
+    bool pinned;
+    volatile bool on_cpu;
+    struct ktimer sleep_timer;
+    struct sched_stats stats;
+    struct sched_dl dl;
     struct task_context context;
     struct task* next;
+    struct task* rq_next;
+    bool queued;
 };
 
 /**
@@ -135,6 +231,49 @@ pid_t task_wait(pid_t pid, int32_t* status);
  */
 struct task* task_find(pid_t pid);
 
+/**
+ * @brief Find a task by thread ID
+ * @param id The thread ID to search for
+ * @return Pointer to the task, or NULL if not found
+ */
+struct task* thread_find(tid_t id);
+
+/**
+ * @brief Create a new thread in the current process
+ * @details The thread shares the PID, address space and ports of the caller
+ *          but gets its own TID and kernel/user stacks. Kernel-mode callers
+ *          get a kernel thread that is entered as entry(arg); user-mode callers
+ *          get a user thread entered at the user address entry with arg as its
+ *          first stack argument.
+ * @param entry Thread entry point address
+ * @param arg Argument passed to the entry point
+ * @param priority Thread priority
+ * @return Pointer to the created thread, or NULL on failure
+ */
+struct task* thread_create(uint32_t entry, uint32_t arg, uint8_t priority);
+
+/**
+ * @brief Exit the current thread
+ * @details Wakes up a thread blocked in thread_join on the caller
+ * @param exit_code The exit code reported to the joiner
+ */
+void thread_exit(int32_t exit_code);
+
+/**
+ * @brief Wait for a thread of the current process to exit and reap it
+ * @param id The thread ID to join
+ * @param status Pointer to store the thread exit code, may be NULL
+ * @return 0 on success, -1 on error
+ */
+int thread_join(tid_t id, int32_t* status);
+
+/**
+ * @brief Count the threads belonging to a process
+ * @param pid The process ID
+ * @return Number of tasks sharing the PID, including the main thread
+ */
+uint32_t sched_get_thread_count(pid_t pid);
+
 /**
  * @brief Schedule the next task to run
  */
@@ -150,6 +289,40 @@ void sched_yield(void);
  */
 void sched_tick(void);
 
+/**
+ * @brief Request a reschedule at the next safe point
+ * @details Sets need_resched on the current task; the switch happens on
+ *          interrupt/syscall return or when preemption is re-enabled.
+ */
+void sched_set_need_resched(void);
+
+/**
+ * @brief Check whether a reschedule is pending for the current task
+ * @return true if need_resched is set
+ */
+bool sched_need_resched(void);
+
+/**
+ * @brief Disable preemption of the current task
+ * @details Calls nest; the task is not switched out by interrupts until the
+ *          matching preempt_enable.
+ */
+void preempt_disable(void);
+
+/**
+ * @brief Re-enable preemption of the current task
+ * @details Runs a pending reschedule once the nesting count drops to zero and
+ *          interrupts are enabled.
+ */
+void preempt_enable(void);
+
+/**
+ * @brief Reschedule point on interrupt and syscall return
+ * @details Called from the common interrupt stubs after the C handler. Acts on
+ *          need_resched unless preemption is disabled.
+ */
+void sched_preempt_irq(void);
+
 /**
  * @brief Get the currently running task
  * @return Pointer to the current task
@@ -162,12 +335,70 @@ struct task* sched_get_current(void);
  */
 void sched_block(uint8_t reason);
 
+/**
+ * @brief Mark the current task blocked without switching away
+ * @details For sleepers that publish themselves on a wait queue under their
+ *          own lock: call this before dropping that lock, then schedule().
+ *          A wakeup in between turns the task back to READY and the
+ *          schedule() call simply picks it again.
+ */
+void sched_prepare_block(void);
+
+/**
+ * @brief Undo sched_prepare_block when the wait condition is already met
+ */
+void sched_cancel_block(void);
+
 /**
  * @brief Unblock a task by its ID
  * @param id The task ID to unblock
  */
 void sched_unblock(tid_t id);
 
+/**
+ * @brief Wake a blocked task and switch to it on this CPU at once
+ * @details The caller either blocked with sched_prepare_block or stays
+ *          READY and runs again when picked. Falls back to a normal wakeup
+ *          when the task cannot run on this CPU right now.
+ * @param id The blocked task to run
+ */
+void sched_handoff(tid_t id);
+
+/**
+ * @brief Lend a priority to a task
+ * @details The task runs at the higher of its base priority and prio until
+ *          the loan is changed again; 0 drops the loan. Used by IPC so a
+ *          server runs at the priority of the clients waiting on it.
+ * @param id The task ID to boost
+ * @param prio The inherited priority
+ */
+void sched_set_inherited_priority(tid_t id, uint8_t prio);
+
+/**
+ * @brief Move a task into or out of the deadline class
+ * @details Admission fails when the reserved bandwidth of all deadline
+ *          tasks would exceed SCHED_DL_MAX_BANDWIDTH. A runtime of 0 returns
+ *          the task to its fixed priority.
+ * @param id The task ID
+ * @param runtime_us CPU time per period in microseconds
+ * @param deadline_us Deadline relative to the period start, at least runtime
+ * @param period_us Period in microseconds, at least the deadline
+ * @return 0 on success, -1 on invalid parameters or admission failure
+ */
+int sched_set_deadline(tid_t id, uint32_t runtime_us, uint32_t deadline_us, uint32_t period_us);
+
+/**
+ * @brief End the current job of a deadline task and wait for the next period
+ * @details Behaves like sched_yield() for tasks outside the deadline class.
+ */
+void sched_dl_yield(void);
+
+/**
+ * @brief Get the bandwidth reserved by the deadline class
+ * @return Reserved share of one CPU in parts per million
+ */
+uint32_t sched_get_dl_bandwidth(void);
+
 /**
  * @brief Switch context between two tasks
  * @param old Pointer to the old task context
@@ -184,6 +415,27 @@ extern void switch_context(struct task_context* old, struct task_context* new_ct
  */
 extern void enter_usermode(uint32_t entry, uint32_t user_stack, uint32_t cs, uint32_t ds);
 
+/**
+ * @brief Complete a context switch on the incoming side
+ * @details Releases the scheduler lock taken by the CPU that switched to the
+ *          current task and marks the previous task as off the CPU.
+ */
+void sched_finish_switch(void);
+
+/**
+ * @brief Register the idle task of a CPU
+ * @param cpu CPU index
+ * @param t Idle task, pinned to the CPU and only run when nothing else is
+ */
+void sched_set_idle_task(uint32_t cpu, struct task* t);
+
+/**
+ * @brief Enter the scheduler on the calling CPU
+ * @details Used by application processors once they are online; does not
+ *          return.
+ */
+void sched_start_cpu(void);
+
 /**
  * @brief Get the list of all tasks
  * @return Pointer to the head of the task list
@@ -191,7 +443,7 @@ extern void enter_usermode(uint32_t entry, uint32_t user_stack, uint32_t cs, uin
 struct task* sched_get_task_list(void);
 
 /**
- * @brief Get the idle task
+ * @brief Get the idle task of the boot CPU
  * @return Pointer to the idle task
  */
 struct task* sched_get_idle_task(void);
@@ -202,6 +454,24 @@ struct task* sched_get_idle_task(void);
  */
 uint32_t sched_get_total_ticks(void);
 
+/**
+ * @brief Get the system-wide scheduler statistics
+ * @param out Pointer to store a snapshot
+ */
+void sched_get_global_stats(struct sched_global_stats* out);
+
+/**
+ * @brief Get the number of context switches since boot
+ * @return Switches between two different tasks on any CPU
+ */
+uint32_t sched_get_switch_count(void);
+
+/**
+ * @brief Get the number of runnable tasks, including the running ones
+ * @return Number of non-idle tasks in the READY or RUNNING state
+ */
+uint32_t sched_get_runnable_count(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,11 @@ switch_context:
     popl 36(%eax)
 
 .load_new:
+    # the task may resume on another CPU; point GS at this CPU's data
+    str %cx
+    addw $8, %cx
+    movw %cx, %gs
+
     movl 12(%ebp), %eax
     testl %eax, %eax
     jz .switch_done
@@ -0,0 +1,238 @@
+#include "clock.h"
+#include "timer.h"
+#include "../arch/i686/arch.h"
+#include "../drivers/bus/acpi.h"
+#include "../drivers/char/rtc.h"
+#include "../mm/vmm.h"
+#include "udrv.h"
+#include "../lib/log.h"
+#include "../include/cast.h"
+
+#define NSEC_PER_SEC 1000000000u
+#define FSEC_PER_NSEC 1000000u
+
+#define CPUID_FEAT_EDX_TSC      (1u << 4)
+#define CPUID_EXT_INVARIANT_TSC (1u << 8)
+
+#define HPET_REG_CAPS    0x000
+#define HPET_REG_CONFIG  0x010
+#define HPET_REG_COUNTER 0x0F0
+#define HPET_CONFIG_ENABLE 0x1
+
+struct clocksource
+{
+    const char* name;
+    uint32_t id;
+    uint64_t (*read)(void);
+    uint32_t freq_hz;
+    uint32_t mult;
+    uint32_t shift;
+};
+
+static struct clocksource source;
+static uint64_t base_cycles = 0;
+static uint32_t realtime_sec = 0;
+static uint64_t realtime_ns = 0;
+static volatile uint32_t* hpet_regs = NULL;
+
+static uint64_t read_tsc(void)
+{
+    return rdtsc();
+}
+
+static uint64_t read_hpet(void)
+{
+    uint32_t hi;
+    uint32_t lo;
+    do
+    {
+        hi = hpet_regs[(HPET_REG_COUNTER + 4) / 4];
+        lo = hpet_regs[HPET_REG_COUNTER / 4];
+    } while (hi != hpet_regs[(HPET_REG_COUNTER + 4) / 4]);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static uint64_t read_pit(void)
+{
+    return timer_get_ticks();
+}
+
+/*
+ * Pick the largest shift that keeps mult in 32 bits so cycles are
+ * converted with a multiply and shift instead of a 64-bit divide.
+ */
+static void clocksource_set_freq(const uint32_t freq_hz)
+{
+    source.freq_hz = freq_hz;
+    source.shift = 24;
+    while (source.shift > 0 &&
+           (((uint64_t)NSEC_PER_SEC << source.shift) / freq_hz) > 0xFFFFFFFFu)
+    {
+        source.shift--;
+    }
+    source.mult = (uint32_t)(((uint64_t)NSEC_PER_SEC << source.shift) / freq_hz);
+}
+
+static uint64_t cycles_to_ns(const uint64_t cycles)
+{
+    const uint64_t hi = (cycles >> 32) * source.mult;
+    const uint64_t lo = (cycles & 0xFFFFFFFFu) * source.mult;
+    return (hi << (32 - source.shift)) + (lo >> source.shift);
+}
+
+static bool tsc_available(void)
+{
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_FEAT_EDX_TSC))
+    {
+        return false;
+    }
+
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000007)
+    {
+        cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        if (!(edx & CPUID_EXT_INVARIANT_TSC))
+        {
+            log_warn("Clock: TSC is not invariant, frequency scaling may skew time");
+        }
+    }
+    return true;
+}
+
+static uint32_t tsc_calibrate(void)
+{
+    const uint32_t flags = read_eflags();
+    cli();
+    const uint64_t start = rdtsc();
+    timer_delay(CLOCK_CALIBRATE_TICKS);
+    const uint64_t end = rdtsc();
+    if (flags & 0x200)
+    {
+        sti();
+    }
+
+    const uint64_t hz = (end - start) * timer_get_frequency() / CLOCK_CALIBRATE_TICKS;
+    return hz > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)hz;
+}
+
+static bool hpet_setup(void)
+{
+    const struct acpi_hpet* table = (const struct acpi_hpet*)acpi_find_table(ACPI_SIG_HPET);
+    if (!table || table->address_space_id != 0 || (table->address >> 32) != 0)
+    {
+        return false;
+    }
+
+    const uint32_t phys = (uint32_t)table->address;
+    vmm_map_page(vmm_get_kernel_directory(), phys, phys, PAGE_PRESENT | PAGE_WRITE | PAGE_CACHE_DISABLE);
+    udrv_reserve_mmio(phys & ~0xFFF, PAGE_SIZE);
+    hpet_regs = PTR_FROM_U32_TYPED(volatile uint32_t, phys);
+
+    const uint32_t period_fs = hpet_regs[(HPET_REG_CAPS + 4) / 4];
+    if (period_fs == 0 || period_fs > 100000000u)
+    {
+        hpet_regs = NULL;
+        return false;
+    }
+
+    hpet_regs[HPET_REG_CONFIG / 4] |= HPET_CONFIG_ENABLE;
+    clocksource_set_freq((uint32_t)(((uint64_t)NSEC_PER_SEC * FSEC_PER_NSEC) / period_fs));
+    return true;
+}
+
+void clock_init(void)
+{
+    if (tsc_available())
+    {
+        source.name = "tsc";
+        source.id = CLOCKSOURCE_TSC;
+        source.read = read_tsc;
+        clocksource_set_freq(tsc_calibrate());
+    }
+    else if (hpet_setup())
+    {
+        source.name = "hpet";
+        source.id = CLOCKSOURCE_HPET;
+        source.read = read_hpet;
+    }
+    else
+    {
+        source.name = "pit";
+        source.id = CLOCKSOURCE_PIT;
+        source.read = read_pit;
+        clocksource_set_freq(timer_get_frequency());
+    }
+
+    base_cycles = source.read();
+    clock_set_realtime(rtc_get_timestamp());
+
+    log_info_fmt("Clock: Using %s clocksource at %u Hz", source.name, source.freq_hz);
+}
+
+uint64_t ktime_get_ns(void)
+{
+    if (!source.read)
+    {
+        return 0;
+    }
+    return cycles_to_ns(source.read() - base_cycles);
+}
+
+static void ns_to_timespec(const uint64_t ns, struct timespec* ts)
+{
+    const uint64_t sec = ns / NSEC_PER_SEC;
+    ts->tv_sec = (int32_t)sec;
+    ts->tv_nsec = (int32_t)(ns - sec * NSEC_PER_SEC);
+}
+
+void clock_get_realtime(struct timespec* ts)
+{
+    if (!ts) return;
+
+    const uint64_t elapsed = ktime_get_ns() - realtime_ns;
+    ns_to_timespec(elapsed, ts);
+    ts->tv_sec += (int32_t)realtime_sec;
+}
+
+void clock_set_realtime(const uint32_t seconds)
+{
+    realtime_ns = ktime_get_ns();
+    realtime_sec = seconds;
+}
+
+int clock_gettime(const uint32_t clock_id, struct timespec* ts)
+{
+    if (!ts) return -1;
+
+    switch (clock_id)
+    {
+        case CLOCK_REALTIME:
+            clock_get_realtime(ts);
+            return 0;
+        case CLOCK_MONOTONIC:
+            ns_to_timespec(ktime_get_ns(), ts);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+uint32_t clock_get_source(void)
+{
+    return source.id;
+}
+
+const char* clock_get_source_name(void)
+{
+    return source.name ? source.name : "none";
+}
+
+uint32_t clock_get_frequency(void)
+{
+    return source.freq_hz;
+}
@@ -0,0 +1,87 @@
+#ifndef KERNEL_CLOCK_H
+#define KERNEL_CLOCK_H
+
+#include "../include/types.h"
+#include "timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Clock IDs for SYS_CLOCK_GETTIME
+ */
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+/**
+ * @brief Hardware counters the clocksource can run on
+ */
+#define CLOCKSOURCE_PIT  0
+#define CLOCKSOURCE_TSC  1
+#define CLOCKSOURCE_HPET 2
+
+/**
+ * @brief Number of PIT ticks the TSC is calibrated against
+ */
+#define CLOCK_CALIBRATE_TICKS 5
+
+/**
+ * @brief Select and calibrate the clocksource and latch the wall clock
+ *
+ * Uses the TSC calibrated against the PIT when available, otherwise the
+ * HPET described by ACPI, otherwise the PIT tick count. The RTC is read
+ * once here; the wall clock afterwards is derived from the clocksource.
+ * Must run after timer_init, acpi_init and rtc_init.
+ */
+void clock_init(void);
+
+/**
+ * @brief Get monotonic time since clock_init
+ * @return Nanoseconds since the clocksource was started
+ */
+uint64_t ktime_get_ns(void);
+
+/**
+ * @brief Get the wall clock time
+ * @param ts Receives seconds and nanoseconds since the Unix epoch
+ */
+void clock_get_realtime(struct timespec* ts);
+
+/**
+ * @brief Set the wall clock time
+ * @param seconds Seconds since the Unix epoch
+ */
+void clock_set_realtime(uint32_t seconds);
+
+/**
+ * @brief Read a clock
+ * @param clock_id CLOCK_REALTIME or CLOCK_MONOTONIC
+ * @param ts Receives the time
+ * @return 0 on success, -1 on invalid clock
+ */
+int clock_gettime(uint32_t clock_id, struct timespec* ts);
+
+/**
+ * @brief Get the active clocksource
+ * @return One of the CLOCKSOURCE_* values
+ */
+uint32_t clock_get_source(void);
+
+/**
+ * @brief Get the name of the active clocksource
+ * @return "tsc", "hpet" or "pit"
+ */
+const char* clock_get_source_name(void);
+
+/**
+ * @brief Get the frequency of the active clocksource
+ * @return Counter frequency in Hz
+ */
+uint32_t clock_get_frequency(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,245 @@
+#include "ktimer.h"
+#include "../arch/i686/arch.h"
+#include "../include/spinlock.h"
+
+/*
+ * Hierarchical timing wheel: one 256-slot root level and four 64-slot
+ * levels covering the full 32-bit tick range. Timers are hashed into a
+ * slot by expiry (O(1) add/del) and cascade down one level each time
+ * the level below wraps.
+ */
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
+
+static struct ktimer* tv1[TVR_SIZE];
+static struct ktimer* tvn[TVN_LEVELS][TVN_SIZE];
+static uint32_t wheel_base = 0;
+static uint32_t pending_count = 0;
+static spinlock_t wheel_lock = SPINLOCK_INIT;
+
+static void slot_insert(struct ktimer** slot, struct ktimer* timer)
+{
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot)
+    {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+}
+
+static void slot_remove(struct ktimer* timer)
+{
+    if (timer->prev)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        *timer->slot = timer->next;
+    }
+    if (timer->next)
+    {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->slot = NULL;
+}
+
+static void internal_add_timer(struct ktimer* timer)
+{
+    const uint32_t expires = timer->expires;
+    const uint32_t delta = expires - wheel_base;
+    struct ktimer** slot;
+
+    if ((int32_t)delta < 0)
+    {
+        // already due: run on the next processed tick
+        slot = &tv1[wheel_base & TVR_MASK];
+    }
+    else if (delta < TVR_SIZE)
+    {
+        slot = &tv1[expires & TVR_MASK];
+    }
+    else
+    {
+        int level = 0;
+        while (level < TVN_LEVELS - 1 &&
+               delta >= (1U << (TVR_BITS + (level + 1) * TVN_BITS)))
+        {
+            level++;
+        }
+        const uint32_t index = (expires >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+        slot = &tvn[level][index];
+    }
+
+    slot_insert(slot, timer);
+}
+
+static uint32_t cascade(const int level)
+{
+    const uint32_t index = (wheel_base >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+    struct ktimer* timer = tvn[level][index];
+    tvn[level][index] = NULL;
+
+    while (timer)
+    {
+        struct ktimer* next = timer->next;
+        internal_add_timer(timer);
+        timer = next;
+    }
+    return index;
+}
+
+void ktimer_init(const uint32_t now)
+{
+    for (int i = 0; i < TVR_SIZE; i++)
+    {
+        tv1[i] = NULL;
+    }
+    for (int level = 0; level < TVN_LEVELS; level++)
+    {
+        for (int i = 0; i < TVN_SIZE; i++)
+        {
+            tvn[level][i] = NULL;
+        }
+    }
+    wheel_base = now + 1;
+    pending_count = 0;
+}
+
+void timer_setup(struct ktimer* timer, const ktimer_func_t callback, const uint32_t data)
+{
+    if (!timer) return;
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->slot = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->data = data;
+}
+
+void add_timer(struct ktimer* timer)
+{
+    if (!timer || timer->slot) return;
+
+    const uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    internal_add_timer(timer);
+    pending_count++;
+    spin_unlock_irqrestore(&wheel_lock, flags);
+}
+
+int del_timer(struct ktimer* timer)
+{
+    if (!timer) return 0;
+
+    const uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    int was_pending = 0;
+    if (timer->slot)
+    {
+        slot_remove(timer);
+        pending_count--;
+        was_pending = 1;
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+    return was_pending;
+}
+
+int mod_timer(struct ktimer* timer, const uint32_t expires)
+{
+    if (!timer) return 0;
+
+    const uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    int was_pending = 0;
+    if (timer->slot)
+    {
+        slot_remove(timer);
+        was_pending = 1;
+    }
+    else
+    {
+        pending_count++;
+    }
+    timer->expires = expires;
+    internal_add_timer(timer);
+    spin_unlock_irqrestore(&wheel_lock, flags);
+    return was_pending;
+}
+
+bool timer_pending(const struct ktimer* timer)
+{
+    return timer && timer->slot != NULL;
+}
+
+void ktimer_run(const uint32_t now)
+{
+    const uint32_t flags = spin_lock_irqsave(&wheel_lock);
+    while ((int32_t)(now - wheel_base) >= 0)
+    {
+        const uint32_t index = wheel_base & TVR_MASK;
+        if (index == 0)
+        {
+            for (int level = 0; level < TVN_LEVELS; level++)
+            {
+                if (cascade(level) != 0)
+                {
+                    break;
+                }
+            }
+        }
+        wheel_base++;
+
+        // re-added timers land in a later slot, so this terminates
+        while (tv1[index])
+        {
+            struct ktimer* timer = tv1[index];
+            slot_remove(timer);
+            pending_count--;
+            if (timer->callback)
+            {
+                // callbacks may wake tasks or re-arm timers
+                spin_unlock(&wheel_lock);
+                timer->callback(timer->data);
+                spin_lock(&wheel_lock);
+            }
+        }
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+}
+
+uint32_t ktimer_next_expiry(const uint32_t now, const uint32_t limit)
+{
+    if (pending_count == 0)
+    {
+        return limit;
+    }
+
+    // wheel_base is the next tick to process, i.e. now + 1 when caught up
+    const uint32_t first = wheel_base - now;
+    for (uint32_t i = 0; first + i <= limit; i++)
+    {
+        const uint32_t tick = wheel_base + i;
+        if (tv1[tick & TVR_MASK])
+        {
+            return first + i;
+        }
+        if (i > 0 && (tick & TVR_MASK) == 0)
+        {
+            // a cascade may bring timers down at this tick
+            return first + i;
+        }
+    }
+    return limit;
+}
+
+uint32_t ktimer_get_pending_count(void)
+{
+    return pending_count;
+}
@@ -0,0 +1,95 @@
+#ifndef KERNEL_KTIMER_H
+#define KERNEL_KTIMER_H
+
+#include "../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Kernel timer callback, run from the timer softirq
+ * @param data The value given to timer_setup
+ */
+typedef void (*ktimer_func_t)(uint32_t data);
+
+/**
+ * @brief Kernel timer queued on the timing wheel
+ */
+struct ktimer
+{
+    struct ktimer* next;
+    struct ktimer* prev;
+    struct ktimer** slot;
+    uint32_t expires;
+    ktimer_func_t callback;
+    uint32_t data;
+};
+
+/**
+ * @brief Initialize the timing wheel
+ * @param now The current tick count
+ */
+void ktimer_init(uint32_t now);
+
+/**
+ * @brief Prepare a timer before its first use
+ * @param timer The timer to initialize
+ * @param callback Function to run on expiry
+ * @param data Argument passed to the callback
+ */
+void timer_setup(struct ktimer* timer, ktimer_func_t callback, uint32_t data);
+
+/**
+ * @brief Queue a timer to fire at timer->expires
+ * @param timer The timer to add, must not be pending
+ */
+void add_timer(struct ktimer* timer);
+
+/**
+ * @brief Remove a timer from the wheel
+ * @param timer The timer to remove
+ * @return 1 if the timer was pending, 0 otherwise
+ */
+int del_timer(struct ktimer* timer);
+
+/**
+ * @brief Change the expiry of a timer, queueing it if needed
+ * @param timer The timer to modify
+ * @param expires The new absolute expiry tick
+ * @return 1 if the timer was pending, 0 otherwise
+ */
+int mod_timer(struct ktimer* timer, uint32_t expires);
+
+/**
+ * @brief Check whether a timer is queued
+ * @param timer The timer to check
+ * @return True if the timer is pending
+ */
+bool timer_pending(const struct ktimer* timer);
+
+/**
+ * @brief Run all timers that expired up to the given tick
+ * @param now The current tick count
+ */
+void ktimer_run(uint32_t now);
+
+/**
+ * @brief Get the number of ticks until the next timer may expire
+ * @param now The current tick count
+ * @param limit The maximum value to return
+ * @return Ticks until the next expiry, or limit if none is nearer
+ */
+uint32_t ktimer_next_expiry(uint32_t now, uint32_t limit);
+
+/**
+ * @brief Get the number of pending timers
+ * @return Number of timers on the wheel
+ */
+uint32_t ktimer_get_pending_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,184 @@
+#include "softirq.h"
+#include "../arch/i686/arch.h"
+#include "../arch/i686/smp.h"
+#include "../sched/sched.h"
+
+/*
+ * Bottom halves. Top halves ack their device and raise a softirq; the
+ * pending softirqs of a CPU run when its outermost interrupt handler
+ * returns, with interrupts enabled so further IRQs are not held off.
+ * Preemption stays disabled while they run, which keeps them on this
+ * CPU and off the task they interrupted.
+ */
+#define SOFTIRQ_MAX_RESTART 10
+
+static softirq_handler_t softirq_handlers[NR_SOFTIRQS];
+static volatile uint32_t softirq_counts[NR_SOFTIRQS];
+static bool softirq_ready = false;
+
+// caller has interrupts disabled
+static void tasklet_enqueue(struct cpu* c, struct tasklet* t)
+{
+    t->next = NULL;
+    if (c->tasklet_tail)
+    {
+        c->tasklet_tail->next = t;
+    }
+    else
+    {
+        c->tasklet_head = t;
+    }
+    c->tasklet_tail = t;
+}
+
+static void tasklet_action(void)
+{
+    struct cpu* c = this_cpu();
+
+    cli();
+    struct tasklet* list = c->tasklet_head;
+    c->tasklet_head = NULL;
+    c->tasklet_tail = NULL;
+    sti();
+
+    while (list)
+    {
+        struct tasklet* t = list;
+        list = t->next;
+
+        // still running on another CPU: retry on the next pass
+        if (__sync_fetch_and_or(&t->state, TASKLET_STATE_RUN) & TASKLET_STATE_RUN)
+        {
+            cli();
+            tasklet_enqueue(c, t);
+            sti();
+            raise_softirq(SOFTIRQ_TASKLET);
+            continue;
+        }
+
+        __sync_fetch_and_and(&t->state, ~TASKLET_STATE_SCHED);
+        t->func(t->data);
+        __sync_fetch_and_and(&t->state, ~TASKLET_STATE_RUN);
+    }
+}
+
+void softirq_init(void)
+{
+    for (uint32_t i = 0; i < NR_SOFTIRQS; i++)
+    {
+        softirq_handlers[i] = NULL;
+        softirq_counts[i] = 0;
+    }
+    open_softirq(SOFTIRQ_TASKLET, tasklet_action);
+    softirq_ready = true;
+}
+
+void open_softirq(const uint32_t nr, const softirq_handler_t handler)
+{
+    if (nr < NR_SOFTIRQS)
+    {
+        softirq_handlers[nr] = handler;
+    }
+}
+
+void raise_softirq(const uint32_t nr)
+{
+    if (nr < NR_SOFTIRQS)
+    {
+        __sync_fetch_and_or(&this_cpu()->softirq_pending, 1u << nr);
+    }
+}
+
+void do_softirq(void)
+{
+    if (!softirq_ready)
+    {
+        return;
+    }
+
+    struct cpu* c = this_cpu();
+    if (c->in_softirq || c->irq_depth > 0 || !c->softirq_pending)
+    {
+        return;
+    }
+
+    c->in_softirq = true;
+    preempt_disable();
+
+    // handlers may raise more work; bound the loop so a busy source cannot
+    // starve the interrupted task, leftovers run on the next IRQ exit
+    for (uint32_t restart = 0; restart < SOFTIRQ_MAX_RESTART && c->softirq_pending; restart++)
+    {
+        const uint32_t pending = __sync_lock_test_and_set(&c->softirq_pending, 0);
+        sti();
+        for (uint32_t nr = 0; nr < NR_SOFTIRQS; nr++)
+        {
+            if ((pending & (1u << nr)) && softirq_handlers[nr])
+            {
+                softirq_handlers[nr]();
+                __sync_fetch_and_add(&softirq_counts[nr], 1);
+            }
+        }
+        cli();
+    }
+
+    c->in_softirq = false;
+    // interrupts are off, so this never switches; the IRQ return path does
+    preempt_enable();
+}
+
+void irq_enter(void)
+{
+    this_cpu()->irq_depth++;
+}
+
+void irq_exit(void)
+{
+    struct cpu* c = this_cpu();
+    c->irq_depth--;
+    if (c->irq_depth == 0)
+    {
+        do_softirq();
+    }
+}
+
+bool in_irq(void)
+{
+    return softirq_ready && this_cpu()->irq_depth > 0;
+}
+
+bool in_softirq(void)
+{
+    return softirq_ready && this_cpu()->in_softirq;
+}
+
+uint32_t softirq_get_count(const uint32_t nr)
+{
+    return nr < NR_SOFTIRQS ? softirq_counts[nr] : 0;
+}
+
+void tasklet_init(struct tasklet* t, void (*func)(uint32_t data), const uint32_t data)
+{
+    t->next = NULL;
+    t->state = 0;
+    t->func = func;
+    t->data = data;
+}
+
+bool tasklet_schedule(struct tasklet* t)
+{
+    if (__sync_fetch_and_or(&t->state, TASKLET_STATE_SCHED) & TASKLET_STATE_SCHED)
+    {
+        return false;
+    }
+
+    const uint32_t flags = read_eflags();
+    cli();
+    tasklet_enqueue(this_cpu(), t);
+    raise_softirq(SOFTIRQ_TASKLET);
+    if (flags & 0x200)
+    {
+        sti();
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef KERNEL_SOFTIRQ_H
+#define KERNEL_SOFTIRQ_H
+
+#include "../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Softirq numbers, run in ascending order
+ */
+#define SOFTIRQ_TIMER   0
+#define SOFTIRQ_TASKLET 1
+#define NR_SOFTIRQS     2
+
+/**
+ * @brief Softirq handler, run with interrupts enabled on IRQ exit
+ */
+typedef void (*softirq_handler_t)(void);
+
+/**
+ * @brief Deferred function queued from interrupt context \struct tasklet
+ *
+ * A tasklet is queued on the CPU that schedules it and never runs on two
+ * CPUs at the same time. Scheduling it again before it runs is a no-op.
+ */
+struct tasklet
+{
+    struct tasklet* next;
+    volatile uint32_t state;
+    void (*func)(uint32_t data);
+    uint32_t data;
+};
+
+#define TASKLET_STATE_SCHED 0x1
+#define TASKLET_STATE_RUN   0x2
+
+/**
+ * @brief Initialize the softirq layer and the tasklet softirq
+ * @details Must run after smp_early_init; before that in_irq() is always false.
+ */
+void softirq_init(void);
+
+/**
+ * @brief Install the handler of a softirq
+ * @param nr Softirq number
+ * @param handler Function run when the softirq is pending
+ */
+void open_softirq(uint32_t nr, softirq_handler_t handler);
+
+/**
+ * @brief Mark a softirq pending on the calling CPU
+ * @param nr Softirq number
+ */
+void raise_softirq(uint32_t nr);
+
+/**
+ * @brief Run the pending softirqs of the calling CPU
+ * @details Called with interrupts disabled on IRQ exit. Handlers run with
+ *          interrupts enabled and preemption disabled; interrupts are
+ *          disabled again on return. Does nothing when nested inside
+ *          another softirq run.
+ */
+void do_softirq(void);
+
+/**
+ * @brief Enter hard interrupt context on the calling CPU
+ */
+void irq_enter(void);
+
+/**
+ * @brief Leave hard interrupt context on the calling CPU
+ * @details Runs the pending softirqs once the outermost handler is done.
+ */
+void irq_exit(void);
+
+/**
+ * @brief Check whether the caller runs in a hard interrupt handler
+ * @return true inside a top half
+ */
+bool in_irq(void);
+
+/**
+ * @brief Check whether the caller runs in a softirq or tasklet
+ * @return true inside a bottom half
+ */
+bool in_softirq(void);
+
+/**
+ * @brief Get how often a softirq has run
+ * @param nr Softirq number
+ * @return Number of runs on all CPUs, or 0 for an invalid number
+ */
+uint32_t softirq_get_count(uint32_t nr);
+
+/**
+ * @brief Prepare a tasklet before its first use
+ * @param t The tasklet to initialize
+ * @param func Function to run
+ * @param data Argument passed to func
+ */
+void tasklet_init(struct tasklet* t, void (*func)(uint32_t data), uint32_t data);
+
+/**
+ * @brief Queue a tasklet on the calling CPU
+ * @param t The tasklet to run
+ * @return true if it was queued, false if it was already pending
+ */
+bool tasklet_schedule(struct tasklet* t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
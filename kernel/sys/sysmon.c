@@ -7,6 +7,9 @@
 
 static cpu_stats_t cpu_stats;
 static uint32_t last_update_tick = 0;
+static uint32_t switch_sample_tick = 0;
+static uint32_t switch_sample_count = 0;
+static uint32_t switch_rate = 0;
 
 void sysmon_init(void)
 {
@@ -15,6 +18,9 @@ void sysmon_init(void)
     cpu_stats.kernel_ticks = 0;
     cpu_stats.usage_percent = 0;
     last_update_tick = 0;
+    switch_sample_tick = 0;
+    switch_sample_count = 0;
+    switch_rate = 0;
 }
 
 void sysmon_get_memory_stats(memory_stats_t* stats)
@@ -100,6 +106,47 @@ void sysmon_get_process_stats(process_stats_t* stats)
     }
 }
 
+void sysmon_get_sched_stats(sched_summary_t* stats)
+{
+    if (!stats)
+    {
+        return;
+    }
+
+    struct sched_global_stats g;
+    sched_get_global_stats(&g);
+
+    const uint32_t now = timer_get_ticks();
+    const uint32_t elapsed = now - switch_sample_tick;
+    if (elapsed >= timer_get_frequency() || switch_sample_tick == 0)
+    {
+        if (elapsed > 0)
+        {
+            switch_rate = (uint32_t)(((uint64_t)(g.switches - switch_sample_count) * timer_get_frequency()) / elapsed);
+        }
+        switch_sample_tick = now;
+        switch_sample_count = g.switches;
+    }
+
+    stats->switches = g.switches;
+    stats->switch_rate = switch_rate;
+    stats->avg_schedule_cycles = g.schedule_calls ? (uint32_t)(g.schedule_cycles / g.schedule_calls) : 0;
+    stats->max_schedule_cycles = g.schedule_max_cycles;
+    stats->wakeups = g.wakeups;
+    stats->avg_wakeup_cycles = g.wakeups ? (uint32_t)(g.wakeup_cycles / g.wakeups) : 0;
+    stats->max_wakeup_cycles = g.wakeup_max_cycles;
+
+    stats->voluntary = 0;
+    stats->involuntary = 0;
+    const struct task* t = sched_get_task_list();
+    while (t)
+    {
+        stats->voluntary += t->stats.nr_voluntary;
+        stats->involuntary += t->stats.nr_involuntary;
+        t = t->next;
+    }
+}
+
 static void print_memory_size(uint32_t bytes)
 {
     if (bytes >= 1024 * 1024)
@@ -168,7 +215,33 @@ void sysmon_print_summary(void)
     console_write_dec(proc.blocked_processes);
     console_write("\n  Zombie:  ");
     console_write_dec(proc.zombie_processes);
-    console_write("\n");
+    console_write("\n\n");
+
+    sched_summary_t sched;
+    sysmon_get_sched_stats(&sched);
+
+    console_write("Scheduler:\n");
+    console_write("  Switches: ");
+    console_write_dec(sched.switches);
+    console_write(" (");
+    console_write_dec(sched.switch_rate);
+    console_write("/s, ");
+    console_write_dec(sched.voluntary);
+    console_write(" voluntary, ");
+    console_write_dec(sched.involuntary);
+    console_write(" involuntary)\n");
+    console_write("  schedule(): avg ");
+    console_write_dec(sched.avg_schedule_cycles);
+    console_write(" max ");
+    console_write_dec(sched.max_schedule_cycles);
+    console_write(" cycles\n");
+    console_write("  Wakeup latency: avg ");
+    console_write_dec(sched.avg_wakeup_cycles);
+    console_write(" max ");
+    console_write_dec(sched.max_wakeup_cycles);
+    console_write(" cycles over ");
+    console_write_dec(sched.wakeups);
+    console_write(" wakeups\n");
 }
 
 void sysmon_update(void)
@@ -36,6 +36,24 @@ typedef struct process_stats
     uint32_t zombie_processes;
 } process_stats_t;
 
+/**
+ * @brief Scheduler statistics structure
+ * @details Cycle figures are TSC cycles. switch_rate is measured over the
+ *          window since the previous sample, or since boot on the first.
+ */
+typedef struct sched_summary
+{
+    uint32_t switches;
+    uint32_t switch_rate;
+    uint32_t voluntary;
+    uint32_t involuntary;
+    uint32_t avg_schedule_cycles;
+    uint32_t max_schedule_cycles;
+    uint32_t wakeups;
+    uint32_t avg_wakeup_cycles;
+    uint32_t max_wakeup_cycles;
+} sched_summary_t;
+
 /**
  * @brief Initialize system monitoring subsystem
  */
@@ -59,6 +77,14 @@ void sysmon_get_cpu_stats(cpu_stats_t* stats);
  */
 void sysmon_get_process_stats(process_stats_t* stats);
 
+/**
+ * @brief Get current scheduler statistics
+ * @details Samples the context switch counter; calls closer than a second
+ *          apart reuse the previous rate.
+ * @param stats Pointer to sched_summary_t structure to fill
+ */
+void sysmon_get_sched_stats(sched_summary_t* stats);
+
 /**
  * @brief Print system summary to console
  */
@@ -1,27 +1,192 @@
 #include "timer.h"
+#include "ktimer.h"
+#include "softirq.h"
 #include "../arch/i686/arch.h"
 #include "../arch/i686/idt.h"
+#include "../arch/i686/smp.h"
+#include "../arch/i686/lapic.h"
+#include "../arch/i686/ioapic.h"
 #include "../sched/sched.h"
+#include "../include/config.h"
 
 #define PIT_FREQ 1193180
 
+#define PIT_CHANNEL0    0x40
+#define PIT_COMMAND     0x43
+#define PIT_LATCH_CH0   0x00
+#define PIT_ONESHOT_CH0 0x30
+#define PIT_PERIODIC_CH0 0x34
+#define PIT_MAX_COUNT   0xFFFF
+
 static uint32_t tick_count = 0;
+static uint32_t pit_divisor = 0;
+static uint32_t tick_hz = 0;
+static bool tickless_enabled = true;
+static volatile bool oneshot_armed = false;
+static uint32_t oneshot_ticks = 0;
+static uint32_t oneshot_count = 0;
+static uint32_t idle_entries = 0;
+static uint32_t ticks_skipped = 0;
+static uint8_t tick_source = TICK_SOURCE_PIT;
 
-static void timer_callback(struct registers* regs)
+static void pit_program(const uint8_t mode, const uint32_t count)
 {
-    (void)regs;
+    outb(PIT_COMMAND, mode);
+    outb(PIT_CHANNEL0, (uint8_t)(count & 0xFF));
+    outb(PIT_CHANNEL0, (uint8_t)((count >> 8) & 0xFF));
+}
+
+static uint32_t pit_read_count(void)
+{
+    outb(PIT_COMMAND, PIT_LATCH_CH0);
+    const uint8_t lo = inb(PIT_CHANNEL0);
+    const uint8_t hi = inb(PIT_CHANNEL0);
+    return (uint32_t)lo | ((uint32_t)hi << 8);
+}
+
+// expired kernel timers run as a softirq, off the tick's hard IRQ path
+static void timer_softirq(void)
+{
+    ktimer_run(tick_count);
+}
+
+static void timer_catch_up(const uint32_t ticks)
+{
+    tick_count += ticks;
+    raise_softirq(SOFTIRQ_TIMER);
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+        sched_tick();
+    }
+    if (ticks > 1)
+    {
+        ticks_skipped += ticks - 1;
+    }
+}
+
+static void tick_set_periodic(void)
+{
+    if (tick_source == TICK_SOURCE_LAPIC)
+    {
+        lapic_timer_periodic();
+    }
+    else
+    {
+        pit_program(PIT_PERIODIC_CH0, pit_divisor);
+    }
+}
+
+static void tick_set_oneshot(const uint32_t ticks)
+{
+    if (tick_source == TICK_SOURCE_LAPIC)
+    {
+        lapic_timer_oneshot(ticks);
+    }
+    else
+    {
+        oneshot_count = ticks * pit_divisor;
+        pit_program(PIT_ONESHOT_CH0, oneshot_count);
+    }
+}
+
+// whole ticks since the one-shot was armed; rest is what is left of the next
+static uint32_t tick_oneshot_elapsed(uint32_t* rest)
+{
+    if (tick_source == TICK_SOURCE_LAPIC)
+    {
+        return lapic_timer_elapsed(rest);
+    }
+
+    const uint32_t remaining = pit_read_count();
+    const uint32_t elapsed = (remaining < oneshot_count) ? oneshot_count - remaining : 0;
+    const uint32_t part = elapsed % pit_divisor;
+    *rest = part ? pit_divisor - part : 0;
+    return elapsed / pit_divisor;
+}
+
+// one-shot over the rest of an interrupted tick; the tick that ends it
+// goes through timer_tick like any expired one-shot
+static void tick_set_rest(const uint32_t rest)
+{
+    oneshot_ticks = 1;
+    if (tick_source == TICK_SOURCE_LAPIC)
+    {
+        lapic_timer_oneshot_rest(rest);
+    }
+    else
+    {
+        oneshot_count = rest;
+        pit_program(PIT_ONESHOT_CH0, rest);
+    }
+}
+
+static uint32_t tick_max_oneshot(void)
+{
+    if (tick_source == TICK_SOURCE_LAPIC)
+    {
+        return lapic_timer_max_ticks();
+    }
+    return pit_divisor ? PIT_MAX_COUNT / pit_divisor : 1;
+}
+
+// boot CPU tick work, shared by the PIT and local APIC timer interrupts
+static void timer_tick(void)
+{
+    if (oneshot_armed)
+    {
+        oneshot_armed = false;
+        tick_set_periodic();
+        timer_catch_up(oneshot_ticks);
+        return;
+    }
+
     tick_count++;
+    raise_softirq(SOFTIRQ_TIMER);
     sched_tick();
 }
 
+static int timer_callback(struct registers* regs, void* dev_id)
+{
+    (void)regs;
+    (void)dev_id;
+    timer_tick();
+
+    // the PIT only interrupts the boot CPU; forward the tick to the others
+    smp_broadcast_tick();
+    return IRQ_HANDLED;
+}
+
+static int lapic_timer_callback(struct registers* regs, void* dev_id)
+{
+    (void)regs;
+    (void)dev_id;
+
+    // every CPU has its own local APIC timer, so no tick forwarding
+    if (this_cpu()->id != 0)
+    {
+        lapic_timer_rearm();
+        sched_tick();
+        return IRQ_HANDLED;
+    }
+
+    if (!oneshot_armed)
+    {
+        lapic_timer_rearm();
+    }
+    timer_tick();
+    return IRQ_HANDLED;
+}
+
 void timer_init(const uint32_t frequency)
 {
-    register_interrupt_handler(32, timer_callback);
+    request_irq(32, timer_callback, NULL, "timer");
+    open_softirq(SOFTIRQ_TIMER, timer_softirq);
 
-    const uint32_t divisor = PIT_FREQ / frequency;
-    outb(0x43, 0x36);
-    outb(0x40, (uint8_t)(divisor & 0xFF));
-    outb(0x40, (uint8_t)((divisor >> 8) & 0xFF));
+    pit_divisor = PIT_FREQ / frequency;
+    tick_hz = frequency;
+    oneshot_armed = false;
+    ktimer_init(tick_count);
+    pit_program(PIT_PERIODIC_CH0, pit_divisor);
 }
 
 uint32_t timer_get_ticks(void)
@@ -31,9 +196,213 @@ uint32_t timer_get_ticks(void)
 
 void timer_wait(const uint32_t ticks)
 {
-    const uint32_t end = tick_count + ticks;
-    while (tick_count < end)
+    timer_sleep(ticks);
+}
+
+static void sleep_timeout(const uint32_t data)
+{
+    sched_unblock((tid_t)data);
+}
+
+void timer_sleep(const uint32_t ticks)
+{
+    struct task* current = sched_get_current();
+    if (!current)
+    {
+        timer_delay(ticks);
+        return;
+    }
+
+    if (ticks == 0)
     {
+        sched_yield();
+        return;
+    }
+
+    // mark ourselves blocked before the timer can fire (possibly on another
+    // CPU), so its wakeup is never lost
+    timer_setup(&current->sleep_timer, sleep_timeout, current->id);
+    sched_prepare_block();
+    mod_timer(&current->sleep_timer, tick_count + ticks);
+    schedule();
+
+    while (timer_pending(&current->sleep_timer))
+    {
+        sched_prepare_block();
+        if (!timer_pending(&current->sleep_timer))
+        {
+            sched_cancel_block();
+            break;
+        }
+        schedule();
+    }
+}
+
+void timer_sleep_ms(const uint32_t ms)
+{
+    timer_sleep(timer_ms_to_ticks(ms));
+}
+
+uint32_t timer_ms_to_ticks(const uint32_t ms)
+{
+    const uint32_t hz = tick_hz ? tick_hz : TICK_FREQUENCY_HZ;
+    return (uint32_t)(((uint64_t)ms * hz + 999) / 1000);
+}
+
+uint32_t timer_get_frequency(void)
+{
+    return tick_hz ? tick_hz : TICK_FREQUENCY_HZ;
+}
+
+void timer_delay(const uint32_t ticks)
+{
+    if (pit_divisor == 0)
+    {
+        return;
+    }
+
+    // poll the PIT counter; works before the scheduler runs and with
+    // interrupts disabled
+    uint64_t remaining = (uint64_t)ticks * pit_divisor;
+    uint32_t prev = pit_read_count();
+    while (remaining > 0)
+    {
+        const uint32_t cur = pit_read_count();
+        const uint32_t elapsed = (cur <= prev) ? prev - cur : prev + (pit_divisor - cur);
+        remaining = (elapsed >= remaining) ? 0 : remaining - elapsed;
+        prev = cur;
+    }
+}
+
+uint32_t timer_next_event(void)
+{
+    return ktimer_next_expiry(tick_count, tick_max_oneshot());
+}
+
+bool timer_use_lapic(void)
+{
+    if (!lapic_is_enabled() || !lapic_timer_calibrate(timer_get_frequency()))
+    {
+        return false;
+    }
+
+    request_irq(LAPIC_VECTOR_TIMER, lapic_timer_callback, NULL, "lapic-timer");
+
+    const uint32_t flags = read_eflags();
+    cli();
+    // the PIT keeps counting for timer_delay, but no longer interrupts
+    if (ioapic_is_enabled())
+    {
+        ioapic_mask_irq(0);
+    }
+    else
+    {
+        outb(0x21, inb(0x21) | 0x01);
+    }
+    tick_source = TICK_SOURCE_LAPIC;
+    lapic_timer_periodic();
+    if (flags & 0x200)
+    {
+        sti();
+    }
+    return true;
+}
+
+void timer_init_ap(void)
+{
+    if (tick_source == TICK_SOURCE_LAPIC)
+    {
+        lapic_timer_periodic();
+    }
+}
+
+uint8_t timer_get_tick_source(void)
+{
+    return tick_source;
+}
+
+void timer_idle(void)
+{
+    cli();
+
+    // only the boot CPU owns the PIT; the others just wait for an interrupt,
+    // as does the boot CPU while the rest of a cut short tick runs out
+    if (!tickless_enabled || pit_divisor == 0 || this_cpu()->id != 0 ||
+        oneshot_armed || sched_get_runnable_count() > 0)
+    {
+        sti();
+        hlt();
+        return;
+    }
+
+    uint32_t ticks = timer_next_event();
+    const uint32_t max_ticks = tick_max_oneshot();
+    if (ticks > max_ticks)
+    {
+        ticks = max_ticks;
+    }
+    if (ticks <= 1)
+    {
+        sti();
         hlt();
+        return;
+    }
+
+    oneshot_ticks = ticks;
+    oneshot_armed = true;
+    idle_entries++;
+    tick_set_oneshot(ticks);
+
+    // hold off the switch until the tick is restored and caught up;
+    // sti takes effect after hlt, so no wakeup is lost in between
+    preempt_disable();
+    sti();
+    hlt();
+    cli();
+
+    if (oneshot_armed)
+    {
+        // woken early by another interrupt: account for the whole ticks
+        // elapsed and let the partial one run out before the periodic tick
+        // restarts, so it stays in phase and no time is lost
+        uint32_t rest;
+        const uint32_t elapsed = tick_oneshot_elapsed(&rest);
+        if (rest)
+        {
+            tick_set_rest(rest);
+        }
+        else
+        {
+            oneshot_armed = false;
+            tick_set_periodic();
+        }
+        timer_catch_up(elapsed);
+    }
+
+    // not inside an IRQ here, so run the timers caught up above right away
+    do_softirq();
+    sti();
+    preempt_enable();
+}
+
+void timer_set_tickless(const bool enabled)
+{
+    tickless_enabled = enabled;
+}
+
+bool timer_is_tickless(void)
+{
+    return tickless_enabled;
+}
+
+void timer_get_idle_stats(uint32_t* entries, uint32_t* skipped)
+{
+    if (entries)
+    {
+        *entries = idle_entries;
+    }
+    if (skipped)
+    {
+        *skipped = ticks_skipped;
     }
 }
@@ -7,6 +7,21 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Time interval used by SYS_NANOSLEEP
+ */
+struct timespec
+{
+    int32_t tv_sec;
+    int32_t tv_nsec;
+};
+
+/**
+ * @brief Scheduler tick sources
+ */
+#define TICK_SOURCE_PIT   0
+#define TICK_SOURCE_LAPIC 1
+
 /**
  * @brief Initialize the system timer
  * @param frequency The frequency in Hz
@@ -25,6 +40,98 @@ uint32_t timer_get_ticks(void);
  */
 void timer_wait(uint32_t ticks);
 
+/**
+ * @brief Block the current task for a number of ticks
+ *
+ * Queues the task's sleep timer on the timing wheel and blocks until it
+ * fires. Before the scheduler runs this falls back to timer_delay().
+ * @param ticks The number of ticks to sleep
+ */
+void timer_sleep(uint32_t ticks);
+
+/**
+ * @brief Block the current task for at least the given time
+ * @param ms Milliseconds to sleep, rounded up to whole ticks
+ */
+void timer_sleep_ms(uint32_t ms);
+
+/**
+ * @brief Busy-wait by polling the PIT counter
+ *
+ * Does not need interrupts, for use during early boot.
+ * @param ticks The number of ticks to wait
+ */
+void timer_delay(uint32_t ticks);
+
+/**
+ * @brief Convert milliseconds to timer ticks, rounding up
+ * @param ms Milliseconds
+ * @return Number of ticks
+ */
+uint32_t timer_ms_to_ticks(uint32_t ms);
+
+/**
+ * @brief Get the timer tick frequency
+ * @return Ticks per second
+ */
+uint32_t timer_get_frequency(void);
+
+/**
+ * @brief Get the number of ticks until the next pending timer event
+ * @return Ticks until the next event, capped to the one-shot range
+ */
+uint32_t timer_next_event(void);
+
+/**
+ * @brief Move the scheduler tick from the PIT to the local APIC timers
+ * @details Calibrates the local APIC timer, masks the PIT interrupt and
+ *          starts periodic ticks on the boot CPU. Call after clock_init so
+ *          TSC-deadline mode can use the calibrated TSC.
+ * @return true if the local APIC timer now drives the tick
+ */
+bool timer_use_lapic(void);
+
+/**
+ * @brief Start the tick on an application processor
+ * @details Arms the local APIC timer of the caller when it is the tick
+ *          source; with the PIT the tick arrives by IPI instead.
+ */
+void timer_init_ap(void);
+
+/**
+ * @brief Get the current scheduler tick source
+ * @return TICK_SOURCE_PIT or TICK_SOURCE_LAPIC
+ */
+uint8_t timer_get_tick_source(void);
+
+/**
+ * @brief Idle the CPU until the next interrupt
+ *
+ * When the calling task is the only runnable one, the PIT is switched
+ * to one-shot mode for the next timer event and the skipped ticks are
+ * accounted on wakeup. Otherwise the periodic tick is kept.
+ */
+void timer_idle(void);
+
+/**
+ * @brief Enable or disable dynamic ticks in the idle loop
+ * @param enabled True to allow one-shot programming when idle
+ */
+void timer_set_tickless(bool enabled);
+
+/**
+ * @brief Check whether dynamic ticks are enabled
+ * @return True if the idle loop may stop the periodic tick
+ */
+bool timer_is_tickless(void);
+
+/**
+ * @brief Get tickless idle statistics
+ * @param entries Receives the number of one-shot idle periods (may be NULL)
+ * @param skipped Receives the number of timer interrupts avoided (may be NULL)
+ */
+void timer_get_idle_stats(uint32_t* entries, uint32_t* skipped);
+
 #ifdef __cplusplus
 }
 #endif
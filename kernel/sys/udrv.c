@@ -0,0 +1,651 @@
+#include "udrv.h"
+#include "../arch/i686/idt.h"
+#include "../arch/i686/gdt.h"
+#include "../arch/i686/smp.h"
+#include "../ipc/ipc.h"
+#include "../mm/vmm.h"
+#include "../mm/pmm.h"
+#include "../include/spinlock.h"
+#include "../include/string.h"
+
+/*
+ * User-space drivers. A driver process gets three things from the kernel:
+ * interrupts, forwarded to one of its ports as notification badges; I/O
+ * ports, opened in the TSS I/O bitmap while it runs; and device memory,
+ * mapped uncached into its address space.
+ *
+ * A forwarded line is masked by the top half and stays masked until the
+ * driver acks it, so the device is serviced at task level without the
+ * line firing again in between. The I/O bitmap is per CPU: each CPU
+ * remembers which grants it has opened and swaps them on a switch to
+ * another process, so switches among processes without grants cost one
+ * comparison.
+ *
+ * All of this is privileged. One process, the authority (the user init),
+ * decides which processes are drivers and which ports they get; drivers
+ * then bind lines and map device memory themselves. Ranges kernel drivers
+ * use are reserved and never handed out.
+ */
+#define IRQ_BASE_VECTOR 32
+
+// first address above the local APIC and I/O APIC windows the kernel maps
+#define MMIO_KERNEL_BASE 0xFEC00000
+
+struct irq_binding
+{
+    pid_t owner;
+    int port;
+    uint32_t badge;
+    volatile bool masked;
+    volatile uint32_t raised;
+    volatile uint32_t acks;
+};
+
+struct io_grant
+{
+    pid_t owner;
+    uint16_t base;
+    uint16_t count;
+};
+
+// what this CPU's bitmap currently opens
+struct io_applied
+{
+    pid_t owner;
+    uint32_t gen;
+    uint32_t count;
+    struct io_grant ranges[UDRV_MAX_IO_GRANTS];
+};
+
+struct mmio_range
+{
+    uint32_t base;
+    uint32_t size;
+};
+
+struct mmio_grant
+{
+    pid_t owner;
+    page_directory_t* dir;
+    uint32_t phys;
+    uint32_t virt;
+    uint32_t pages;
+};
+
+// port ranges kernel drivers own; a grant may not overlap any of them
+static const struct io_grant reserved_ports[] = {
+        { 0, 0x000, 0x100 },    // PIC, PIT, keyboard, CMOS, DMA
+        { 0, 0x170, 8 },        // ATA secondary
+        { 0, 0x1F0, 8 },        // ATA primary
+        { 0, 0x376, 1 },
+        { 0, 0x3C0, 0x20 },     // VGA and the text console
+        { 0, 0x3F6, 1 },
+        { 0, 0x3F8, 8 },        // COM1, the kernel log
+        { 0, 0xCF8, 8 },        // PCI configuration
+};
+
+static volatile pid_t authority = 0;
+static pid_t drivers[UDRV_MAX_DRIVERS];
+static struct io_grant reserved_io[UDRV_MAX_RESERVED];
+static struct mmio_range reserved_mmio[UDRV_MAX_RESERVED];
+static spinlock_t rights_lock = SPINLOCK_INIT;
+
+static struct irq_binding bindings[UDRV_IRQ_LINES];
+static spinlock_t bind_lock = SPINLOCK_INIT;
+
+static struct io_grant io_grants[UDRV_MAX_IO_GRANTS];
+static struct io_applied io_applied[MAX_CPUS];
+static volatile uint32_t io_gen = 0;
+static volatile uint32_t io_grant_count = 0;
+static spinlock_t io_lock = SPINLOCK_INIT;
+
+static struct mmio_grant mmio_grants[UDRV_MAX_MMIO_GRANTS];
+static spinlock_t mmio_lock = SPINLOCK_INIT;
+
+static bool ranges_overlap(const uint32_t a, const uint32_t a_len, const uint32_t b, const uint32_t b_len)
+{
+    return a < b + b_len && b < a + a_len;
+}
+
+static bool is_driver(const pid_t pid)
+{
+    if (pid == 0)
+    {
+        return false;
+    }
+    if (pid == authority)
+    {
+        return true;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&rights_lock);
+    bool found = false;
+    for (uint32_t i = 0; i < UDRV_MAX_DRIVERS && !found; i++)
+    {
+        found = drivers[i] == pid;
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+    return found;
+}
+
+static bool io_reserved(const uint32_t base, const uint32_t count)
+{
+    for (uint32_t i = 0; i < sizeof(reserved_ports) / sizeof(reserved_ports[0]); i++)
+    {
+        if (ranges_overlap(base, count, reserved_ports[i].base, reserved_ports[i].count))
+        {
+            return true;
+        }
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&rights_lock);
+    bool hit = false;
+    for (uint32_t i = 0; i < UDRV_MAX_RESERVED && !hit; i++)
+    {
+        hit = reserved_io[i].count && ranges_overlap(base, count, reserved_io[i].base, reserved_io[i].count);
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+    return hit;
+}
+
+static bool mmio_reserved(const uint32_t phys, const uint32_t len)
+{
+    const uint32_t flags = spin_lock_irqsave(&rights_lock);
+    bool hit = false;
+    for (uint32_t i = 0; i < UDRV_MAX_RESERVED && !hit; i++)
+    {
+        hit = reserved_mmio[i].size && ranges_overlap(phys, len, reserved_mmio[i].base, reserved_mmio[i].size);
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+    return hit;
+}
+
+static int udrv_irq_handler(struct registers* regs, void* dev_id)
+{
+    (void)regs;
+    struct irq_binding* b = dev_id;
+    const uint8_t irq = (uint8_t)(b - bindings);
+
+    irq_mask_line(irq);
+    b->masked = true;
+    b->raised++;
+    port_notify(b->port, b->badge);
+    return IRQ_HANDLED;
+}
+
+void udrv_init(void)
+{
+    // runs before the kernel drivers that fill the reservation tables
+    spin_init(&rights_lock);
+    spin_init(&bind_lock);
+    spin_init(&io_lock);
+    spin_init(&mmio_lock);
+    memset(bindings, 0, sizeof(bindings));
+    memset(io_grants, 0, sizeof(io_grants));
+    memset(io_applied, 0, sizeof(io_applied));
+    memset(mmio_grants, 0, sizeof(mmio_grants));
+    memset(drivers, 0, sizeof(drivers));
+    memset(reserved_io, 0, sizeof(reserved_io));
+    memset(reserved_mmio, 0, sizeof(reserved_mmio));
+    authority = 0;
+    io_gen = 0;
+    io_grant_count = 0;
+}
+
+void udrv_set_authority(const pid_t pid)
+{
+    authority = pid;
+}
+
+pid_t udrv_get_authority(void)
+{
+    return authority;
+}
+
+int udrv_authorize(const pid_t granter, const pid_t target)
+{
+    if (granter == 0 || granter != authority || target == 0)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&rights_lock);
+    pid_t* slot = NULL;
+    for (uint32_t i = 0; i < UDRV_MAX_DRIVERS; i++)
+    {
+        if (drivers[i] == target)
+        {
+            spin_unlock_irqrestore(&rights_lock, flags);
+            return 0;
+        }
+        if (drivers[i] == 0 && !slot)
+        {
+            slot = &drivers[i];
+        }
+    }
+    if (slot)
+    {
+        *slot = target;
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+    return slot ? 0 : -1;
+}
+
+int udrv_reserve_io(const uint16_t base, const uint32_t count)
+{
+    if (count == 0 || base + count > IO_PORT_COUNT)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&rights_lock);
+    int ret = -1;
+    for (uint32_t i = 0; i < UDRV_MAX_RESERVED; i++)
+    {
+        struct io_grant* r = &reserved_io[i];
+        if (r->count == 0 || (r->base == base && r->count == count))
+        {
+            r->base = base;
+            r->count = (uint16_t)count;
+            ret = 0;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+    return ret;
+}
+
+int udrv_reserve_mmio(const uint32_t phys, const uint32_t size)
+{
+    if (size == 0)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&rights_lock);
+    int ret = -1;
+    for (uint32_t i = 0; i < UDRV_MAX_RESERVED; i++)
+    {
+        struct mmio_range* r = &reserved_mmio[i];
+        if (r->size == 0 || (r->base == phys && r->size == size))
+        {
+            r->base = phys;
+            r->size = size;
+            ret = 0;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+    return ret;
+}
+
+int udrv_irq_bind(const uint8_t irq, const int port, const uint32_t badge, const pid_t caller)
+{
+    // the timer drives the scheduler and IRQ 2 is the PIC cascade
+    if (irq == 0 || irq == 2 || irq >= UDRV_IRQ_LINES || badge == 0 || !is_driver(caller))
+    {
+        return -1;
+    }
+    if (port_get_owner(port) != caller)
+    {
+        return -1;
+    }
+
+    const uint8_t vector = (uint8_t)(IRQ_BASE_VECTOR + irq);
+    const uint32_t flags = spin_lock_irqsave(&bind_lock);
+    struct irq_binding* b = &bindings[irq];
+    if (b->owner != 0 || irq_get_action_count(vector) != 0)
+    {
+        spin_unlock_irqrestore(&bind_lock, flags);
+        return -1;
+    }
+    b->owner = caller;
+    b->port = port;
+    b->badge = badge;
+    b->masked = false;
+    b->raised = 0;
+    b->acks = 0;
+    spin_unlock_irqrestore(&bind_lock, flags);
+
+    if (request_irq(vector, udrv_irq_handler, b, "udrv") != 0)
+    {
+        b->owner = 0;
+        return -1;
+    }
+    irq_unmask_line(irq);
+    return 0;
+}
+
+int udrv_irq_ack(const uint8_t irq, const pid_t caller)
+{
+    if (irq >= UDRV_IRQ_LINES || caller == 0)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&bind_lock);
+    struct irq_binding* b = &bindings[irq];
+    if (b->owner != caller)
+    {
+        spin_unlock_irqrestore(&bind_lock, flags);
+        return -1;
+    }
+    b->acks++;
+    if (b->masked)
+    {
+        b->masked = false;
+        irq_unmask_line(irq);
+    }
+    spin_unlock_irqrestore(&bind_lock, flags);
+    return 0;
+}
+
+int udrv_irq_unbind(const uint8_t irq, const pid_t caller)
+{
+    if (irq >= UDRV_IRQ_LINES || caller == 0)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&bind_lock);
+    struct irq_binding* b = &bindings[irq];
+    if (b->owner != caller)
+    {
+        spin_unlock_irqrestore(&bind_lock, flags);
+        return -1;
+    }
+    irq_mask_line(irq);
+    b->masked = true;
+    spin_unlock_irqrestore(&bind_lock, flags);
+
+    // free_irq waits out a handler still running on another CPU
+    free_irq((uint8_t)(IRQ_BASE_VECTOR + irq), b);
+    b->owner = 0;
+    return 0;
+}
+
+void udrv_irq_get_stats(const uint8_t irq, struct udrv_irq_stats* out)
+{
+    if (!out)
+    {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (irq >= UDRV_IRQ_LINES)
+    {
+        return;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&bind_lock);
+    const struct irq_binding* b = &bindings[irq];
+    out->owner = b->owner;
+    out->port = b->owner ? b->port : -1;
+    out->raised = b->raised;
+    out->acks = b->acks;
+    out->masked = b->masked;
+    spin_unlock_irqrestore(&bind_lock, flags);
+}
+
+// caller holds io_lock with interrupts off; reloads this CPU's bitmap for pid
+static void io_apply(const pid_t pid)
+{
+    struct io_applied* a = &io_applied[this_cpu()->id];
+    for (uint32_t i = 0; i < a->count; i++)
+    {
+        tss_set_io_range(a->ranges[i].base, a->ranges[i].count, false);
+    }
+
+    a->count = 0;
+    for (uint32_t i = 0; i < UDRV_MAX_IO_GRANTS; i++)
+    {
+        if (io_grants[i].owner == pid && pid != 0)
+        {
+            a->ranges[a->count++] = io_grants[i];
+            tss_set_io_range(io_grants[i].base, io_grants[i].count, true);
+        }
+    }
+    a->owner = pid;
+    a->gen = io_gen;
+}
+
+int udrv_io_grant(const pid_t granter, const pid_t target, const uint16_t base, const uint32_t count)
+{
+    if (granter == 0 || granter != authority || !is_driver(target))
+    {
+        return -1;
+    }
+    if (count == 0 || base + count > IO_PORT_COUNT || io_reserved(base, count))
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&io_lock);
+    struct io_grant* slot = NULL;
+    for (uint32_t i = 0; i < UDRV_MAX_IO_GRANTS; i++)
+    {
+        const struct io_grant* g = &io_grants[i];
+        if (g->owner == 0)
+        {
+            if (!slot) slot = &io_grants[i];
+        }
+        else if (ranges_overlap(base, count, g->base, g->count))
+        {
+            spin_unlock_irqrestore(&io_lock, flags);
+            return -1;
+        }
+    }
+    if (!slot)
+    {
+        spin_unlock_irqrestore(&io_lock, flags);
+        return -1;
+    }
+
+    slot->owner = target;
+    slot->base = base;
+    slot->count = (uint16_t)count;
+    io_grant_count++;
+    io_gen++;
+
+    // other CPUs pick the grant up on their next switch
+    if (io_applied[this_cpu()->id].owner == target)
+    {
+        io_apply(target);
+    }
+    spin_unlock_irqrestore(&io_lock, flags);
+    return 0;
+}
+
+void udrv_switch(const pid_t pid)
+{
+    const struct io_applied* a = &io_applied[this_cpu()->id];
+    if (a->count == 0 && io_grant_count == 0)
+    {
+        return;
+    }
+    if (a->owner == pid && a->gen == io_gen)
+    {
+        return;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&io_lock);
+    io_apply(pid);
+    spin_unlock_irqrestore(&io_lock, flags);
+}
+
+int udrv_mmio_map(const pid_t caller, const uint32_t phys, const uint32_t pages, const uint32_t virt)
+{
+    if (!is_driver(caller) || pages == 0 || pages > UDRV_MMIO_MAX_PAGES)
+    {
+        return -1;
+    }
+    if ((phys & 0xFFF) || (virt & 0xFFF) || virt == 0)
+    {
+        return -1;
+    }
+
+    // device memory only: nothing the frame allocator hands out, nothing the
+    // kernel maps for the interrupt controllers or its own drivers
+    const uint32_t len = pages * PAGE_SIZE;
+    if (phys < pmm_get_memory_size() || phys > MMIO_KERNEL_BASE - len || mmio_reserved(phys, len))
+    {
+        return -1;
+    }
+    if (virt > USER_SPACE_END + 1 - len)
+    {
+        return -1;
+    }
+
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        if (vmm_get_physical_address(dir, virt + i * PAGE_SIZE))
+        {
+            return -1;
+        }
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&mmio_lock);
+    struct mmio_grant* slot = NULL;
+    for (uint32_t i = 0; i < UDRV_MAX_MMIO_GRANTS; i++)
+    {
+        const struct mmio_grant* g = &mmio_grants[i];
+        if (g->owner == 0)
+        {
+            if (!slot) slot = &mmio_grants[i];
+        }
+        else if (ranges_overlap(phys, len, g->phys, g->pages * PAGE_SIZE))
+        {
+            spin_unlock_irqrestore(&mmio_lock, flags);
+            return -1;
+        }
+    }
+    if (!slot)
+    {
+        spin_unlock_irqrestore(&mmio_lock, flags);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        if (vmm_map_page(dir, virt + i * PAGE_SIZE, phys + i * PAGE_SIZE,
+                         PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PAGE_CACHE_DISABLE) != 0)
+        {
+            // vmm_unmap_page leaves the frame alone, which is what device memory needs
+            for (uint32_t j = 0; j < i; j++)
+            {
+                vmm_unmap_page(dir, virt + j * PAGE_SIZE);
+            }
+            spin_unlock_irqrestore(&mmio_lock, flags);
+            return -1;
+        }
+    }
+
+    slot->owner = caller;
+    slot->dir = dir;
+    slot->phys = phys;
+    slot->virt = virt;
+    slot->pages = pages;
+    spin_unlock_irqrestore(&mmio_lock, flags);
+    return 0;
+}
+
+// caller holds mmio_lock
+static void mmio_release(struct mmio_grant* g)
+{
+    for (uint32_t i = 0; i < g->pages; i++)
+    {
+        vmm_unmap_page(g->dir, g->virt + i * PAGE_SIZE);
+    }
+    memset(g, 0, sizeof(*g));
+}
+
+int udrv_mmio_unmap(const pid_t caller, const uint32_t virt)
+{
+    if (caller == 0)
+    {
+        return -1;
+    }
+
+    const uint32_t flags = spin_lock_irqsave(&mmio_lock);
+    for (uint32_t i = 0; i < UDRV_MAX_MMIO_GRANTS; i++)
+    {
+        struct mmio_grant* g = &mmio_grants[i];
+        if (g->owner == caller && g->virt == virt)
+        {
+            mmio_release(g);
+            spin_unlock_irqrestore(&mmio_lock, flags);
+            smp_flush_tlb();
+            return 0;
+        }
+    }
+    spin_unlock_irqrestore(&mmio_lock, flags);
+    return -1;
+}
+
+void udrv_exit(const pid_t pid)
+{
+    if (pid == 0)
+    {
+        return;
+    }
+
+    if (authority == pid)
+    {
+        authority = 0;
+    }
+    uint32_t flags = spin_lock_irqsave(&rights_lock);
+    for (uint32_t i = 0; i < UDRV_MAX_DRIVERS; i++)
+    {
+        if (drivers[i] == pid)
+        {
+            drivers[i] = 0;
+        }
+    }
+    spin_unlock_irqrestore(&rights_lock, flags);
+
+    for (uint8_t irq = 0; irq < UDRV_IRQ_LINES; irq++)
+    {
+        if (bindings[irq].owner == pid)
+        {
+            udrv_irq_unbind(irq, pid);
+        }
+    }
+
+    flags = spin_lock_irqsave(&io_lock);
+    bool dropped = false;
+    for (uint32_t i = 0; i < UDRV_MAX_IO_GRANTS; i++)
+    {
+        if (io_grants[i].owner == pid)
+        {
+            memset(&io_grants[i], 0, sizeof(io_grants[i]));
+            io_grant_count--;
+            dropped = true;
+        }
+    }
+    if (dropped)
+    {
+        // CPUs still holding the ranges open close them on their next switch
+        io_gen++;
+        if (io_applied[this_cpu()->id].owner == pid)
+        {
+            io_apply(pid);
+        }
+    }
+    spin_unlock_irqrestore(&io_lock, flags);
+
+    flags = spin_lock_irqsave(&mmio_lock);
+    bool unmapped = false;
+    for (uint32_t i = 0; i < UDRV_MAX_MMIO_GRANTS; i++)
+    {
+        if (mmio_grants[i].owner == pid)
+        {
+            mmio_release(&mmio_grants[i]);
+            unmapped = true;
+        }
+    }
+    spin_unlock_irqrestore(&mmio_lock, flags);
+    if (unmapped)
+    {
+        smp_flush_tlb();
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef KERNEL_UDRV_H
+#define KERNEL_UDRV_H
+
+#include "../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief ISA IRQ lines a user driver may bind
+ */
+#define UDRV_IRQ_LINES 16
+
+/**
+ * @brief Most I/O port ranges granted at once, over all processes
+ */
+#define UDRV_MAX_IO_GRANTS 32
+
+/**
+ * @brief Most device memory windows mapped at once, over all processes
+ */
+#define UDRV_MAX_MMIO_GRANTS 16
+
+/**
+ * @brief Largest device memory window (1 MB)
+ */
+#define UDRV_MMIO_MAX_PAGES 256
+
+/**
+ * @brief Most processes the driver authority can authorize at once
+ */
+#define UDRV_MAX_DRIVERS 16
+
+/**
+ * @brief Most I/O port and device memory ranges kernel drivers can reserve
+ */
+#define UDRV_MAX_RESERVED 16
+
+/**
+ * @brief Per-line counters of a bound IRQ \struct udrv_irq_stats
+ * @details raised counts interrupts forwarded to the port, acks counts
+ *          unmasks by the driver.
+ */
+struct udrv_irq_stats
+{
+    pid_t owner;
+    int port;
+    uint32_t raised;
+    uint32_t acks;
+    bool masked;
+};
+
+/**
+ * @brief Initialize the user driver tables
+ */
+void udrv_init(void);
+
+/**
+ * @brief Name the process that hands out driver rights
+ * @details The shell names the user init it spawns. The authority may use
+ *          every driver call itself and is the only process that may
+ *          authorize others or grant I/O ports. It loses the role when it
+ *          exits.
+ * @param pid The authority, or 0 for none
+ */
+void udrv_set_authority(pid_t pid);
+
+/**
+ * @brief Get the driver authority
+ * @return Its PID, or 0 if there is none
+ */
+pid_t udrv_get_authority(void);
+
+/**
+ * @brief Let a process bind IRQ lines, hold I/O grants and map device memory
+ * @param granter The calling process, which must be the authority
+ * @param target The process to authorize
+ * @return 0 on success, -1 if the granter is not the authority or the
+ *         driver table is full
+ */
+int udrv_authorize(pid_t granter, pid_t target);
+
+/**
+ * @brief Keep I/O ports a kernel driver uses out of user grants
+ * @param base First port
+ * @param count Number of ports
+ * @return 0 on success, -1 if the reservation table is full
+ */
+int udrv_reserve_io(uint16_t base, uint32_t count);
+
+/**
+ * @brief Keep device memory a kernel driver uses out of user mappings
+ * @param phys First physical address
+ * @param size Size in bytes
+ * @return 0 on success, -1 if the reservation table is full
+ */
+int udrv_reserve_mmio(uint32_t phys, uint32_t size);
+
+/**
+ * @brief Forward an IRQ line to a port as notification badges
+ * @details Each interrupt masks the line and posts badge to the port; the
+ *          line stays masked until the driver calls udrv_irq_ack after
+ *          servicing the device, so a level-triggered device cannot storm
+ *          the CPU while its driver is not running. Lines a kernel driver
+ *          handles, the timer and the cascade cannot be bound.
+ * @param irq ISA IRQ number
+ * @param port A port the caller owns
+ * @param badge Badge bits posted per interrupt, not 0
+ * @param caller The binding process, an authorized driver
+ * @return 0 on success, -1 on failure
+ */
+int udrv_irq_bind(uint8_t irq, int port, uint32_t badge, pid_t caller);
+
+/**
+ * @brief Unmask a bound IRQ line after servicing the device
+ * @param irq ISA IRQ number
+ * @param caller The process that bound the line
+ * @return 0 on success, -1 if the caller does not own the line
+ */
+int udrv_irq_ack(uint8_t irq, pid_t caller);
+
+/**
+ * @brief Stop forwarding an IRQ line and leave it masked
+ * @param irq ISA IRQ number
+ * @param caller The process that bound the line
+ * @return 0 on success, -1 if the caller does not own the line
+ */
+int udrv_irq_unbind(uint8_t irq, pid_t caller);
+
+/**
+ * @brief Get the counters of an IRQ line
+ * @param irq ISA IRQ number
+ * @param out Filled with the counters; owner is 0 if the line is unbound
+ */
+void udrv_irq_get_stats(uint8_t irq, struct udrv_irq_stats* out);
+
+/**
+ * @brief Let a process use a range of I/O ports from ring 3
+ * @details Grants are exclusive: a port granted to one process or driven
+ *          by the kernel cannot be granted again. The range opens in the
+ *          TSS I/O bitmap whenever a thread of the process runs.
+ * @param granter The calling process, which must be the authority
+ * @param target The process receiving the grant, an authorized driver
+ * @param base First port
+ * @param count Number of ports
+ * @return 0 on success, -1 on failure
+ */
+int udrv_io_grant(pid_t granter, pid_t target, uint16_t base, uint32_t count);
+
+/**
+ * @brief Map device memory into the calling address space
+ * @details The window is mapped uncached and writable at virt. Only
+ *          physical memory above the RAM the kernel manages and outside
+ *          every range a kernel driver reserved qualifies, so a driver
+ *          reaches its own device's BARs but never another process's frames
+ *          or a device the kernel drives.
+ * @param caller The mapping process, an authorized driver
+ * @param phys Page aligned physical address of the device memory
+ * @param pages Number of pages, up to UDRV_MMIO_MAX_PAGES
+ * @param virt Page aligned user address of a free window
+ * @return 0 on success, -1 on failure
+ */
+int udrv_mmio_map(pid_t caller, uint32_t phys, uint32_t pages, uint32_t virt);
+
+/**
+ * @brief Unmap device memory mapped with udrv_mmio_map
+ * @param caller The mapping process
+ * @param virt Address the window was mapped at
+ * @return 0 on success, -1 if no window of the caller starts there
+ */
+int udrv_mmio_unmap(pid_t caller, uint32_t virt);
+
+/**
+ * @brief Load the I/O grants of the next task into this CPU's TSS
+ * @details Called by the scheduler on every switch; a switch between
+ *          threads of one process, or between processes with no grants,
+ *          leaves the bitmap alone.
+ * @param pid The process about to run
+ */
+void udrv_switch(pid_t pid);
+
+/**
+ * @brief Drop every right, IRQ binding, I/O grant and device mapping of a process
+ * @param pid The exiting process
+ */
+void udrv_exit(pid_t pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+#include "workqueue.h"
+#include "../sched/sched.h"
+#include "../include/spinlock.h"
+
+/*
+ * One kernel worker thread drains a FIFO of work items. Producers only
+ * touch the queue under work_lock, so interrupt handlers and softirqs can
+ * hand over jobs that are too long to run with the CPU borrowed from the
+ * interrupted task.
+ */
+static struct work* work_head = NULL;
+static struct work* work_tail = NULL;
+static tid_t worker_tid = 0;
+static volatile uint32_t work_completed = 0;
+static spinlock_t work_lock = SPINLOCK_INIT;
+
+static void worker_thread(void)
+{
+    while (1)
+    {
+        const uint32_t flags = spin_lock_irqsave(&work_lock);
+        struct work* w = work_head;
+        if (!w)
+        {
+            // blocked before the lock drops, so a concurrent schedule_work
+            // always finds us in a state it can wake
+            sched_prepare_block();
+            spin_unlock_irqrestore(&work_lock, flags);
+            schedule();
+            continue;
+        }
+
+        work_head = w->next;
+        if (!work_head)
+        {
+            work_tail = NULL;
+        }
+        w->next = NULL;
+        w->pending = false;
+        spin_unlock_irqrestore(&work_lock, flags);
+
+        w->func(w);
+        __sync_fetch_and_add(&work_completed, 1);
+    }
+}
+
+void work_init(struct work* work, const work_func_t func, const uint32_t data)
+{
+    work->next = NULL;
+    work->func = func;
+    work->data = data;
+    work->pending = false;
+}
+
+int workqueue_init(void)
+{
+    const struct task* t = task_create(worker_thread, WORKQUEUE_PRIORITY, true);
+    if (!t)
+    {
+        return -1;
+    }
+    worker_tid = t->id;
+    return 0;
+}
+
+bool schedule_work(struct work* work)
+{
+    const uint32_t flags = spin_lock_irqsave(&work_lock);
+    if (work->pending)
+    {
+        spin_unlock_irqrestore(&work_lock, flags);
+        return false;
+    }
+
+    work->pending = true;
+    work->next = NULL;
+    if (work_tail)
+    {
+        work_tail->next = work;
+    }
+    else
+    {
+        work_head = work;
+    }
+    work_tail = work;
+    const tid_t worker = worker_tid;
+    spin_unlock_irqrestore(&work_lock, flags);
+
+    if (worker)
+    {
+        sched_unblock(worker);
+    }
+    return true;
+}
+
+bool work_pending(const struct work* work)
+{
+    return work->pending;
+}
+
+tid_t workqueue_get_worker(void)
+{
+    return worker_tid;
+}
+
+uint32_t workqueue_get_completed(void)
+{
+    return work_completed;
+}
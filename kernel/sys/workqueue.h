@@ -0,0 +1,85 @@
+#ifndef KERNEL_WORKQUEUE_H
+#define KERNEL_WORKQUEUE_H
+
+#include "../include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Priority of the kernel worker thread
+ * @details Above the init and self-test tasks so deferred driver work
+ *          runs as soon as it is queued.
+ */
+#define WORKQUEUE_PRIORITY 3
+
+struct work;
+
+/**
+ * @brief Work function, run in the kernel worker thread
+ * @param work The work item that was queued
+ */
+typedef void (*work_func_t)(struct work* work);
+
+/**
+ * @brief Deferred job run in process context \struct work
+ *
+ * Work items may sleep and take as long as they need. Queueing an item
+ * that is already pending is a no-op.
+ */
+struct work
+{
+    struct work* next;
+    work_func_t func;
+    uint32_t data;
+    volatile bool pending;
+};
+
+/**
+ * @brief Prepare a work item before its first use
+ * @param work The work item to initialize
+ * @param func Function to run
+ * @param data Value for the function to read from work->data
+ */
+void work_init(struct work* work, work_func_t func, uint32_t data);
+
+/**
+ * @brief Create the kernel worker thread
+ * @details Work queued earlier runs as soon as the thread is scheduled.
+ * @return 0 on success, -1 if the thread could not be created
+ */
+int workqueue_init(void);
+
+/**
+ * @brief Queue a work item for the kernel worker thread
+ * @details Safe to call from interrupt and softirq context.
+ * @param work The work item to run
+ * @return true if it was queued, false if it was already pending
+ */
+bool schedule_work(struct work* work);
+
+/**
+ * @brief Check whether a work item is queued and has not started yet
+ * @param work The work item
+ * @return true while pending
+ */
+bool work_pending(const struct work* work);
+
+/**
+ * @brief Get the task ID of the kernel worker thread
+ * @return The worker's task ID, or 0 before workqueue_init
+ */
+tid_t workqueue_get_worker(void);
+
+/**
+ * @brief Get how many work items the worker thread has run
+ * @return Completed work item count
+ */
+uint32_t workqueue_get_completed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 #include "../drivers/storage/ata.h"
 #include "../drivers/storage/ahci.h"
 #include "../fs/diskfs.h"
+#include "../sys/timer.h"
 #include "../include/string.h"
 
 int disk_installer_dialog(void)
@@ -71,7 +72,7 @@ int disk_installer_dialog(void)
         console_write("No ATA drives detected!\n");
         console_set_color(0x07, 0x00);
         console_write("Continue in RAM-only mode...\n");
-        for (volatile int i = 0; i < 50000000; i++);
+        timer_sleep_ms(2000);
         return -1;
     }
 
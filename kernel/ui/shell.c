@@ -12,15 +12,26 @@
 #include "../sched/sched.h"
 #include "../mm/pmm.h"
 #include "../mm/heap.h"
+#include "../mm/stack.h"
 #include "../mm/vmm.h"
+#include "../ipc/ipc.h"
 #include "../arch/i686/arch.h"
+#include "../arch/i686/smp.h"
+#include "../arch/i686/idt.h"
+#include "../arch/i686/lapic.h"
 #include "../sys/timer.h"
+#include "../sys/clock.h"
 #include "../sys/sysmon.h"
+#include "../sys/udrv.h"
 #include "../lib/debug_utils.h"
 #include "basic.h"
 #include "tui.h"
 #include "editor.h"
 #include "../../tests/test_runner.h"
+#include "../../tests/ipc/bench_ipc.h"
+#include "../../tests/sched/bench_futex.h"
+#include "../../tests/sys/bench_udrv.h"
+#include "../../tests/ipc/bench_suite.h"
 #include "../include/cast.h"
 
 #define CMD_BUFFER_SIZE 256
@@ -139,6 +150,14 @@ static void cmd_help(void)
     console_write("  shutdown- Shutdown the system\n");
     console_write("  reboot  - Reboot the system\n");
     console_write("  cpu     - Show CPU Task usage\n");
+    console_write("  cpus    - Show online processors\n");
+    console_write("  apic    - Show interrupt controller and IRQ latency\n");
+    console_write("  irqstat - Show per-vector interrupt counts and rates\n");
+    console_write("  schedstat [tid] - Show scheduling latency and switch counts\n");
+    console_write("  ipcbench- Measure IPC and pipe throughput and round trip latency\n");
+    console_write("  ipcsuite- Run the IPC latency suite, results also on serial\n");
+    console_write("  lockbench- Measure futex mutex contention and wake latency\n");
+    console_write("  irqbench- Measure IRQ delivery latency to a user driver port\n");
     console_write("  sysmon  - Show system statistics\n");
     console_write("  trace   - Show function trace\n");
     console_write("  clrtrace- Clear trace buffer\n");
@@ -162,46 +181,81 @@ static void cmd_clear(void)
     console_clear();
 }
 
+static void ps_write_state(const uint8_t state)
+{
+    switch (state)
+    {
+        case TASK_RUNNING: console_write("RUNNING  "); break;
+        case TASK_READY:   console_write("READY    "); break;
+        case TASK_BLOCKED: console_write("BLOCKED  "); break;
+        case TASK_ZOMBIE:  console_write("ZOMBIE   "); break;
+        default:           console_write("UNKNOWN  "); break;
+    }
+}
+
 static void cmd_ps(void)
 {
-    console_write("PID  STATE    PRIORITY\n");
-    console_write("----------------------\n");
+    console_write("PID  TID  STATE    PRIORITY\n");
+    console_write("---------------------------\n");
 
     const struct task* t = sched_get_task_list();
     while (t)
     {
+        if (t->is_thread)
+        {
+            t = t->next;
+            continue;
+        }
+
         console_write("  ");
         console_write_dec(t->pid);
         console_write("  ");
-        switch (t->state)
-        {
-            case TASK_RUNNING: console_write("RUNNING  "); break;
-            case TASK_READY:   console_write("READY    "); break;
-            case TASK_BLOCKED: console_write("BLOCKED  "); break;
-            case TASK_ZOMBIE:  console_write("ZOMBIE   "); break;
-            default:           console_write("UNKNOWN  "); break;
-        }
+        console_write_dec(t->id);
+        console_write("  ");
+        ps_write_state(t->state);
         console_write_dec(t->priority);
         console_write("\n");
 
+        const struct task* thread = sched_get_task_list();
+        while (thread)
+        {
+            if (thread->is_thread && thread->pid == t->pid)
+            {
+                console_write("   \\_ ");
+                console_write_dec(thread->id);
+                console_write("  ");
+                ps_write_state(thread->state);
+                console_write_dec(thread->priority);
+                console_write("\n");
+            }
+            thread = thread->next;
+        }
+
         t = t->next;
     }
 }
 
 static void cmd_kill(uint8_t pid)
 {
+    bool found = false;
     struct task* t = sched_get_task_list();
     while (t)
     {
+        struct task* next = t->next;
         if (t->pid == pid)
         {
             task_destroy(t->id);
-            console_write("Task ");
-            console_write_dec(pid);
-            console_write(" terminated.\n");
-            return;
+            found = true;
         }
-        t = t->next;
+        t = next;
+    }
+
+    if (found)
+    {
+        console_write("Task ");
+        console_write_dec(pid);
+        console_write(" terminated.\n");
+        return;
     }
     console_write("No such task with PID ");
     console_write_dec(pid);
@@ -236,7 +290,26 @@ static void cmd_mem(void)
     console_write_dec(free_blocks);
     console_write("\n  Largest free block: ");
     console_write_dec(largest_free);
+    console_write(" bytes\n  IPC queues: ");
+    console_write_dec(ipc_get_queue_memory());
     console_write(" bytes\n");
+
+    struct stack_stats kstats, ustats;
+    stack_get_stats(STACK_KERNEL, &kstats);
+    stack_get_stats(STACK_USER, &ustats);
+
+    console_write("Stack Cache (kernel/user):\n");
+    console_write("  In use: ");
+    console_write_dec(kstats.in_use);
+    console_write("/");
+    console_write_dec(ustats.in_use);
+    console_write("\n  Cached: ");
+    console_write_dec(kstats.cached);
+    console_write("/");
+    console_write_dec(ustats.cached);
+    console_write("\n  Mapped pages: ");
+    console_write_dec(kstats.mapped_pages + ustats.mapped_pages);
+    console_write("\n");
 }
 
 static void cmd_defrag(void)
@@ -288,6 +361,451 @@ static void cmd_uptime(void)
     console_write("m ");
     console_write_dec(seconds % 60);
     console_write("s\n");
+
+    uint32_t idle_entries = 0;
+    uint32_t ticks_skipped = 0;
+    timer_get_idle_stats(&idle_entries, &ticks_skipped);
+    console_write("Tickless idle: ");
+    console_write(timer_is_tickless() ? "on" : "off");
+    console_write(", ");
+    console_write_dec(idle_entries);
+    console_write(" idle periods, ");
+    console_write_dec(ticks_skipped);
+    console_write(" ticks skipped\n");
+
+    console_write("Clocksource: ");
+    console_write(clock_get_source_name());
+    console_write(" (");
+    console_write_dec(clock_get_frequency() / 1000);
+    console_write(" kHz)\n");
+}
+
+static void cmd_cpus(void)
+{
+    console_write("CPUs online: ");
+    console_write_dec(smp_get_online_count());
+    console_write("\n");
+    console_write("CPU  APIC  TICKS      IPIS     STEALS  CURRENT\n");
+
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        const struct cpu* c = smp_get_cpu(i);
+        if (!c || !c->online)
+        {
+            continue;
+        }
+
+        console_write_dec(c->id);
+        console_write("    ");
+        console_write_dec(c->apic_id);
+        console_write("     ");
+        console_write_dec(c->ticks);
+        console_write("  ");
+        console_write_dec(c->ipis);
+        console_write("  ");
+        console_write_dec(c->steals);
+        console_write("  ");
+        if (c->current && c->current == c->idle)
+        {
+            console_write("idle");
+        }
+        else if (c->current)
+        {
+            console_write("pid ");
+            console_write_dec(c->current->pid);
+        }
+        else
+        {
+            console_write("-");
+        }
+        console_write("\n");
+    }
+}
+
+static void print_irq_latency(const char* label, const uint8_t mode)
+{
+    struct irq_latency lat;
+    irq_get_latency(mode, &lat);
+
+    console_write(label);
+    if (lat.count == 0)
+    {
+        console_write("no samples\n");
+        return;
+    }
+    console_write_dec(lat.count);
+    console_write(" irqs, min ");
+    console_write_dec(lat.min_cycles);
+    console_write(" avg ");
+    console_write_dec((uint32_t)(lat.total_cycles / lat.count));
+    console_write(" max ");
+    console_write_dec(lat.max_cycles);
+    console_write(" cycles\n");
+}
+
+static void cmd_apic(void)
+{
+    console_write("Interrupt controller: ");
+    console_write(irq_get_mode() == IRQ_MODE_APIC ? "I/O APIC + local APIC\n" : "8259 PIC\n");
+    console_write("Tick source: ");
+    if (timer_get_tick_source() == TICK_SOURCE_LAPIC)
+    {
+        console_write(lapic_timer_is_deadline() ? "local APIC timer (TSC-deadline)\n" : "local APIC timer\n");
+    }
+    else
+    {
+        console_write("PIT\n");
+    }
+
+    console_write("Entry-to-handler latency:\n");
+    print_irq_latency("  PIC:  ", IRQ_MODE_PIC);
+    print_irq_latency("  APIC: ", IRQ_MODE_APIC);
+
+    console_write("EOI cost: PIC ");
+    console_write_dec(irq_measure_eoi(IRQ_MODE_PIC));
+    console_write(" cycles, APIC ");
+    const uint32_t apic_eoi = irq_measure_eoi(IRQ_MODE_APIC);
+    if (apic_eoi)
+    {
+        console_write_dec(apic_eoi);
+        console_write(" cycles\n");
+    }
+    else
+    {
+        console_write("n/a\n");
+    }
+}
+
+static void write_column(const uint32_t value, const uint32_t width)
+{
+    char buf[16];
+    int_to_str_pad((int)value, buf, 1);
+    for (uint32_t len = strlen(buf); len < width; len++)
+    {
+        console_write(" ");
+    }
+    console_write(buf);
+}
+
+static void cmd_irqstat(void)
+{
+    // sample the counters over one second for the rate column
+    static uint32_t before[256];
+    for (uint32_t v = 32; v < 256; v++)
+    {
+        struct irq_vector_stats st;
+        irq_get_vector_stats((uint8_t)v, &st);
+        before[v] = st.count;
+    }
+    timer_sleep_ms(1000);
+
+    console_write("VEC  NAME            COUNT    RATE/s  UNHANDLED  AVG-CYC  MAX-CYC  MAX-LAT\n");
+    for (uint32_t v = 32; v < 256; v++)
+    {
+        struct irq_vector_stats st;
+        irq_get_vector_stats((uint8_t)v, &st);
+        const uint32_t actions = irq_get_action_count((uint8_t)v);
+        if (st.count == 0 && actions == 0)
+        {
+            continue;
+        }
+
+        write_column(v, 3);
+        console_write("  ");
+        const char* name = irq_get_name((uint8_t)v);
+        name = name ? name : "-";
+        console_write(name);
+        uint32_t len = strlen(name);
+        if (actions > 1)
+        {
+            console_write("+");
+            console_write_dec(actions - 1);
+            len += 2;
+        }
+        for (; len < 12; len++)
+        {
+            console_write(" ");
+        }
+        write_column(st.count, 9);
+        write_column(st.count - before[v], 10);
+        write_column(st.unhandled, 11);
+        write_column(st.count ? (uint32_t)(st.handler_cycles / st.count) : 0, 9);
+        write_column(st.max_handler_cycles, 9);
+        write_column(st.max_latency, 9);
+        console_write("\n");
+    }
+}
+
+static void print_latency_hist(const uint32_t* hist)
+{
+    uint32_t peak = 0;
+    for (uint32_t i = 0; i < SCHED_LAT_BUCKETS; i++)
+    {
+        peak = hist[i] > peak ? hist[i] : peak;
+    }
+    if (peak == 0)
+    {
+        console_write("  (no wakeups)\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < SCHED_LAT_BUCKETS; i++)
+    {
+        if (hist[i] == 0)
+        {
+            continue;
+        }
+        console_write("  2^");
+        write_column(i, 2);
+        console_write(" cyc ");
+        write_column(hist[i], 8);
+        console_write(" ");
+        const uint32_t bar = (uint32_t)(((uint64_t)hist[i] * 40 + peak - 1) / peak);
+        for (uint32_t j = 0; j < bar; j++)
+        {
+            console_write("#");
+        }
+        console_write("\n");
+    }
+}
+
+static void cmd_schedstat(const int argc, char* argv[])
+{
+    // report microseconds once the TSC is calibrated, kilocycles otherwise
+    const bool tsc_time = clock_get_source() == CLOCKSOURCE_TSC && clock_get_frequency() >= 1000000;
+    const uint32_t unit = tsc_time ? clock_get_frequency() / 1000000 : 1000;
+    const char* unit_name = tsc_time ? "us" : "kcyc";
+
+    if (argc > 1)
+    {
+        tid_t tid = 0;
+        for (size_t i = 0; i < strlen(argv[1]); i++)
+        {
+            if (argv[1][i] < '0' || argv[1][i] > '9')
+            {
+                console_write("schedstat: invalid TID\n");
+                return;
+            }
+            tid = tid * 10 + (tid_t)(argv[1][i] - '0');
+        }
+
+        const struct task* t = thread_find(tid);
+        if (!t)
+        {
+            console_write("schedstat: no such task\n");
+            return;
+        }
+        if (t->dl.runtime)
+        {
+            console_write("Deadline class: ");
+            console_write_dec((uint32_t)(t->dl.runtime / 1000));
+            console_write(" us every ");
+            console_write_dec((uint32_t)(t->dl.period / 1000));
+            console_write(" us, ");
+            console_write_dec(t->dl.nr_jobs);
+            console_write(" jobs, ");
+            console_write_dec(t->dl.nr_misses);
+            console_write(" missed (max ");
+            console_write_dec((uint32_t)(t->dl.max_lateness / 1000));
+            console_write(" us late)\n");
+        }
+        console_write("Wakeup latency of TID ");
+        console_write_dec(t->id);
+        console_write(" (max ");
+        console_write_dec(t->stats.max_wakeup_latency / unit);
+        console_write(" ");
+        console_write(unit_name);
+        console_write("):\n");
+        print_latency_hist(t->stats.wakeup_hist);
+        return;
+    }
+
+    sched_summary_t sum;
+    sysmon_get_sched_stats(&sum);
+    console_write("Context switches: ");
+    console_write_dec(sum.switches);
+    console_write(" (");
+    console_write_dec(sum.switch_rate);
+    console_write("/s)  schedule(): avg ");
+    console_write_dec(sum.avg_schedule_cycles);
+    console_write(" max ");
+    console_write_dec(sum.max_schedule_cycles);
+    console_write(" cycles\n");
+
+    if (!tsc_time)
+    {
+        console_write("TSC is not the clocksource: RUN/WAIT in Mcycles\n");
+    }
+    console_write("TID  PID  STATE    RUN-ms  WAIT-ms     VOL   INVOL  WAKEUPS  MAXLAT-");
+    console_write(unit_name);
+    console_write("\n");
+
+    const uint64_t now = rdtsc();
+    const struct task* t = sched_get_task_list();
+    while (t)
+    {
+        uint64_t run = t->stats.run_cycles;
+        if (t->state == TASK_RUNNING)
+        {
+            run += now - t->stats.run_stamp;
+        }
+
+        write_column(t->id, 3);
+        write_column((uint32_t)t->pid, 5);
+        console_write("  ");
+        ps_write_state(t->state);
+        write_column((uint32_t)(run / unit / 1000), 6);
+        write_column((uint32_t)(t->stats.wait_cycles / unit / 1000), 9);
+        write_column(t->stats.nr_voluntary, 8);
+        write_column(t->stats.nr_involuntary, 8);
+        write_column(t->stats.nr_wakeups, 9);
+        write_column(t->stats.max_wakeup_latency / unit, 11);
+        console_write("\n");
+        t = t->next;
+    }
+
+    struct sched_global_stats g;
+    sched_get_global_stats(&g);
+    console_write("Direct IPC handoffs: ");
+    console_write_dec(g.handoffs);
+    console_write("\nWakeup latency, all tasks:\n");
+    print_latency_hist(g.wakeup_hist);
+}
+
+static void print_ipc_bench(const char* label, const uint32_t pages, const uint32_t messages)
+{
+    struct ipc_bench_result r;
+    console_write(label);
+    if (ipc_bench_throughput(pages, messages, &r) != 0)
+    {
+        console_write("failed\n");
+        return;
+    }
+    write_column(r.mb_per_s, 7);
+    console_write(" MB/s  ");
+    write_column((uint32_t)(r.ns / r.messages), 7);
+    console_write(" ns/msg\n");
+}
+
+static void print_ipc_pingpong(const char* label, const bool direct, const uint32_t rounds)
+{
+    struct ipc_pingpong_result r;
+    console_write(label);
+    if (ipc_bench_pingpong(direct, rounds, &r) != 0)
+    {
+        console_write("failed\n");
+        return;
+    }
+    write_column(r.ns_per_round, 7);
+    console_write(" ns/round trip  ");
+    console_write_dec(r.handoffs);
+    console_write(" direct switches\n");
+}
+
+static void print_ipc_batch(const char* label, const uint32_t batch, const uint32_t messages)
+{
+    struct ipc_bench_result r;
+    console_write(label);
+    if (ipc_bench_batch(batch, messages, &r) != 0)
+    {
+        console_write("failed\n");
+        return;
+    }
+    write_column(r.mb_per_s, 7);
+    console_write(" MB/s  ");
+    write_column((uint32_t)(r.ns / r.messages), 7);
+    console_write(" ns/msg\n");
+}
+
+static void print_ipc_pipe(const char* label, const uint32_t chunk)
+{
+    struct ipc_bench_result r;
+    console_write(label);
+    if (ipc_bench_pipe(chunk, 1024 * 1024, &r) != 0)
+    {
+        console_write("failed\n");
+        return;
+    }
+    write_column(r.mb_per_s, 7);
+    console_write(" MB/s  ");
+    write_column((uint32_t)(r.ns / r.messages), 7);
+    console_write(" ns/write\n");
+}
+
+static void cmd_ipcbench(void)
+{
+    console_write("IPC throughput, one port, send + receive per message\n");
+    print_ipc_bench("  256 B inline: ", 0, 4096);
+    print_ipc_bench("  64 KB pages:  ", IPC_MAX_PAGES, 1024);
+    console_write("IPC throughput, 32 B messages, batched\n");
+    print_ipc_batch("  batch of 1:   ", 1, 8192);
+    print_ipc_batch("  batch of 4:   ", 4, 8192);
+    print_ipc_batch("  batch of 16:  ", MSG_QUEUE_SIZE, 8192);
+    console_write("Pipe throughput, 1 MB between two threads\n");
+    print_ipc_pipe("  256 B writes: ", 256);
+    print_ipc_pipe("  4 KB writes:  ", 4096);
+    print_ipc_pipe("  16 KB writes: ", IPC_BENCH_PIPE_CHUNK_MAX);
+    console_write("IPC latency, client and server thread\n");
+    print_ipc_pingpong("  call/reply:   ", true, 2000);
+    print_ipc_pingpong("  send/receive: ", false, 2000);
+}
+
+static void print_lock_bench(const char* label, const uint32_t lock, const uint32_t threads)
+{
+    struct futex_bench_result r;
+    console_write(label);
+    if (futex_bench_lock(lock, threads, 2000, &r) != 0)
+    {
+        console_write("failed\n");
+        return;
+    }
+    write_column(r.ns_per_op, 7);
+    console_write(" ns/lock  ");
+    write_column(r.sleeps, 6);
+    console_write(" sleeps");
+    console_write(r.consistent ? "\n" : "  counter lost updates\n");
+}
+
+static void cmd_lockbench(void)
+{
+    console_write("Lock contention, 2000 acquisitions per thread\n");
+    print_lock_bench("  mutex, 1 thread:  ", FUTEX_BENCH_MUTEX, 1);
+    print_lock_bench("  mutex, 4 threads: ", FUTEX_BENCH_MUTEX, 4);
+    print_lock_bench("  mutex, 8 threads: ", FUTEX_BENCH_MUTEX, FUTEX_BENCH_MAX_THREADS);
+    print_lock_bench("  yield, 4 threads: ", FUTEX_BENCH_SPIN, 4);
+    print_lock_bench("  yield, 8 threads: ", FUTEX_BENCH_SPIN, FUTEX_BENCH_MAX_THREADS);
+
+    struct futex_bench_result r;
+    console_write("Futex wake latency, semaphore ping-pong\n  round trip:       ");
+    if (futex_bench_handoff(2000, &r) != 0)
+    {
+        console_write("failed\n");
+        return;
+    }
+    write_column(r.ns_per_op, 7);
+    console_write(" ns  ");
+    write_column(r.wakes, 6);
+    console_write(" wakes\n");
+}
+
+static void cmd_irqbench(void)
+{
+    struct udrv_bench_result r;
+    console_write("IRQ forwarding to a driver port, 1000 interrupts on IRQ ");
+    console_write_dec(UDRV_BENCH_IRQ);
+    console_write("\n");
+    if (udrv_bench_latency(1000, &r) != 0)
+    {
+        console_write("  failed (line busy or interrupt lost)\n");
+        return;
+    }
+    console_write("  min:     ");
+    write_column((uint32_t)r.min_ns, 7);
+    console_write(" ns\n  average: ");
+    write_column((uint32_t)r.avg_ns, 7);
+    console_write(" ns\n  max:     ");
+    write_column((uint32_t)r.max_ns, 7);
+    console_write(" ns\n");
 }
 
 static void cmd_version(void)
@@ -834,6 +1352,7 @@ static void cmd_spawn(void)
     if (t)
     {
         vterm_set_owner(VTERM_INIT, t->pid);
+        udrv_set_authority(t->pid);
         log_info("User init spawned on terminal 1 (Alt+F2)");
         console_write("Created user task with PID ");
         console_write_dec(t->pid);
@@ -939,7 +1458,7 @@ static void cmd_test(int argc, char* argv[])
         console_write("  list          - List available suites\n");
         console_write("  <suite>       - Run a specific suite\n");
         console_write("  <suite> <test>- Run a specific test\n");
-        console_write("\nSuites: pmm, heap, string, fs, ipc, sched\n");
+        console_write("\nSuites: pmm, heap, stack, string, fs, ipc, sched, dl, timer, clock, softirq, irq, udrv\n");
         return;
     }
 
@@ -959,6 +1478,10 @@ static void cmd_test(int argc, char* argv[])
         console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
         console_write("- Kernel Heap (12 tests)\n");
         console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  stack  ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Stack Cache (6 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
         console_write("  string ");
         console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
         console_write("- String Functions (22 tests)\n");
@@ -969,18 +1492,54 @@ static void cmd_test(int argc, char* argv[])
         console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
         console_write("  ipc    ");
         console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
-        console_write("- Inter-Process Communication (11 tests)\n");
+        console_write("- Inter-Process Communication (33 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  chan   ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Shared-Memory Channels (4 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  pipe   ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Pipes (4 tests)\n");
         console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
         console_write("  sched  ");
         console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
-        console_write("- Scheduler (11 tests)\n");
+        console_write("- Scheduler (18 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  dl     ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Deadline Scheduling (3 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  futex  ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Futexes and Sync Library (4 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  timer  ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Timer Wheel (7 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  clock  ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Clocksource (4 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  softirq");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Bottom Halves (4 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  irq    ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- Shared IRQs (3 tests)\n");
+        console_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        console_write("  udrv   ");
+        console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        console_write("- User-Space Drivers (6 tests)\n");
         console_write("  types  ");
         console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
         console_write("- Types (4 tests)\n");
         console_write("  String  ");
         console_set_color(VGA_LIGHT_GREY, VGA_BLACK);
         console_write("- String (13 tests)\n");
-        console_write("\nTotal: 93 unit tests\n");
+        console_write("\nTotal: 168 unit tests\n");
     }
     else if (argc == 2)
     {
@@ -1076,6 +1635,41 @@ void execute_command(char* cmd)
     {
         cmd_uptime();
     }
+    else if (strcmp(argv[0], "cpus") == 0)
+    {
+        cmd_cpus();
+    }
+    else if (strcmp(argv[0], "apic") == 0)
+    {
+        cmd_apic();
+    }
+    else if (strcmp(argv[0], "irqstat") == 0)
+    {
+        cmd_irqstat();
+    }
+    else if (strcmp(argv[0], "schedstat") == 0)
+    {
+        cmd_schedstat(argc, argv);
+    }
+    else if (strcmp(argv[0], "ipcbench") == 0)
+    {
+        cmd_ipcbench();
+    }
+    else if (strcmp(argv[0], "ipcsuite") == 0)
+    {
+        if (ipc_suite_run() != 0)
+        {
+            console_write("ipcsuite: some benchmarks failed\n");
+        }
+    }
+    else if (strcmp(argv[0], "lockbench") == 0)
+    {
+        cmd_lockbench();
+    }
+    else if (strcmp(argv[0], "irqbench") == 0)
+    {
+        cmd_irqbench();
+    }
     else if (strcmp(argv[0], "ver") == 0 || strcmp(argv[0], "version") == 0)
     {
         cmd_version();
@@ -11,6 +11,7 @@
 #include "../mm/pmm.h"
 #include "../sys/timer.h"
 #include "../sys/sysmon.h"
+#include "../arch/i686/idt.h"
 
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 25
@@ -37,9 +38,15 @@
 #define CHAR_BLOCK_FULL  '#'
 #define CHAR_BLOCK_EMPTY ' '
 
+#define IRQ_DASH_ROWS  7
+#define IRQ_STORM_RATE 10000
+
 static struct tui_panel panels[TUI_MAX_PANELS];
 static uint8_t panel_count = 0;
 
+static uint32_t irq_last_count[256];
+static uint32_t irq_last_tick = 0;
+
 void tui_init(void)
 {
     memset(panels, 0, sizeof(panels));
@@ -278,6 +285,7 @@ void tui_draw_dashboard(void)
     tui_panel_write(main_panel, 40, 2, "PMM Free:");
 
     tui_panel_write(main_panel, 1, 4, "PID  Name       State     CPU%  Stack");
+    tui_panel_write(main_panel, 53, 4, "IRQ  Name        Rate/s");
 
     tui_panel_write(main_panel, 1, 14, "Memory Details:");
 
@@ -288,6 +296,70 @@ void tui_draw_dashboard(void)
     tui_update_dashboard();
 }
 
+// busiest interrupt vectors since the previous refresh; storms in red
+static void tui_update_irq_rates(const int panel_id)
+{
+    const uint32_t now = timer_get_ticks();
+    const uint32_t elapsed = now - irq_last_tick;
+    irq_last_tick = now;
+
+    uint8_t top_vec[IRQ_DASH_ROWS];
+    uint32_t top_rate[IRQ_DASH_ROWS];
+    uint32_t shown = 0;
+
+    for (uint32_t v = 32; v < 256; v++)
+    {
+        struct irq_vector_stats st;
+        irq_get_vector_stats((uint8_t)v, &st);
+        const uint32_t delta = st.count - irq_last_count[v];
+        irq_last_count[v] = st.count;
+        if (st.count == 0 || elapsed == 0)
+        {
+            continue;
+        }
+
+        const uint32_t rate = (uint32_t)(((uint64_t)delta * timer_get_frequency()) / elapsed);
+        uint32_t pos = shown < IRQ_DASH_ROWS ? shown++ : IRQ_DASH_ROWS;
+        while (pos > 0 && top_rate[pos - 1] < rate)
+        {
+            if (pos < IRQ_DASH_ROWS)
+            {
+                top_vec[pos] = top_vec[pos - 1];
+                top_rate[pos] = top_rate[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < IRQ_DASH_ROWS)
+        {
+            top_vec[pos] = (uint8_t)v;
+            top_rate[pos] = rate;
+        }
+    }
+
+    const struct tui_panel* p = &panels[panel_id];
+    for (uint32_t row = 0; row < IRQ_DASH_ROWS; row++)
+    {
+        char line[32];
+        char num_str[16];
+        strcpy(line, "                        ");
+        if (row < shown)
+        {
+            int_to_str_pad(top_vec[row], num_str, 1);
+            memcpy(line + 3 - strlen(num_str), num_str, strlen(num_str));
+            const char* name = irq_get_name(top_vec[row]);
+            name = name ? name : "-";
+            const uint32_t name_len = strlen(name) < 10 ? strlen(name) : 10;
+            memcpy(line + 5, name, name_len);
+            int_to_str_pad((int)top_rate[row], num_str, 1);
+            const uint32_t rate_len = strlen(num_str);
+            memcpy(line + 23 - rate_len, num_str, rate_len);
+        }
+
+        const uint8_t fg = (row < shown && top_rate[row] >= IRQ_STORM_RATE) ? VGA_LIGHT_RED : p->fg_color;
+        tui_write_string_at(p->x + 54, (uint8_t)(p->y + 6 + row), line, fg, p->bg_color);
+    }
+}
+
 void tui_update_dashboard(void)
 {
     if (panel_count == 0)
@@ -452,6 +524,8 @@ void tui_update_dashboard(void)
         row++;
     }
 
+    tui_update_irq_rates(main_panel);
+
     uint32_t free_blocks = 0;
     uint32_t largest_free = 0;
     heap_get_fragmentation(&free_blocks, &largest_free);
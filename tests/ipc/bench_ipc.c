@@ -0,0 +1,369 @@
+#include "bench_ipc.h"
+#include "../../kernel/ipc/ipc.h"
+#include "../../kernel/ipc/pipe.h"
+#include "../../kernel/mm/vmm.h"
+#include "../../kernel/mm/pmm.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/include/string.h"
+#include "../../kernel/include/cast.h"
+
+// two 64 KB windows the payload pages bounce between
+#define BENCH_PAGE_A 0x40400000
+#define BENCH_PAGE_B 0x40440000
+
+static volatile int pingpong_port = -1;
+static volatile int pingpong_reply_port = -1;
+static volatile uint32_t pingpong_rounds = 0;
+
+static void pingpong_server(const uint32_t direct)
+{
+    struct message msg;
+    for (uint32_t i = 0; i < pingpong_rounds; i++)
+    {
+        msg.page_count = 0;
+        if (msg_receive(pingpong_port, &msg, IPC_BLOCK) != 0)
+        {
+            break;
+        }
+        const int ret = direct ? ipc_reply(pingpong_port, &msg)
+                               : msg_send(pingpong_reply_port, &msg, IPC_BLOCK);
+        if (ret != 0)
+        {
+            break;
+        }
+    }
+    thread_exit(0);
+}
+
+static int pipe_fds[2] = { -1, -1 };
+static volatile uint32_t pipe_total = 0;
+static uint8_t pipe_wbuf[IPC_BENCH_PIPE_CHUNK_MAX];
+static uint8_t pipe_rbuf[IPC_BENCH_PIPE_CHUNK_MAX];
+
+static uint8_t pipe_pattern(const uint32_t at)
+{
+    return (uint8_t)(at ^ (at >> 8));
+}
+
+static void pipe_writer(const uint32_t chunk)
+{
+    const pid_t pid = sched_get_current()->pid;
+    uint32_t sent = 0;
+    while (sent < pipe_total)
+    {
+        const uint32_t n = pipe_total - sent < chunk ? pipe_total - sent : chunk;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            pipe_wbuf[i] = pipe_pattern(sent + i);
+        }
+        if (pipe_write(pid, pipe_fds[1], pipe_wbuf, n) != (int)n)
+        {
+            break;
+        }
+        sent += n;
+    }
+    pipe_close(pid, pipe_fds[1]);
+    thread_exit(0);
+}
+
+static bool bench_map(const uint32_t pages)
+{
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        if (vmm_get_physical_address(dir, BENCH_PAGE_A + i * PAGE_SIZE) ||
+            vmm_get_physical_address(dir, BENCH_PAGE_B + i * PAGE_SIZE))
+        {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        void* frame = pmm_alloc_block();
+        if (!frame || vmm_map_page(dir, BENCH_PAGE_A + i * PAGE_SIZE, PTR_TO_U32(frame),
+                                   PAGE_PRESENT | PAGE_WRITE | PAGE_USER) != 0)
+        {
+            for (uint32_t j = 0; j < i; j++)
+            {
+                vmm_free_page(dir, BENCH_PAGE_A + j * PAGE_SIZE);
+            }
+            if (frame)
+            {
+                pmm_free_block(frame);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+static void bench_unmap(const uint32_t base, const uint32_t pages)
+{
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        vmm_free_page(vmm_get_current_directory(), base + i * PAGE_SIZE);
+    }
+}
+
+int ipc_bench_throughput(const uint32_t pages, const uint32_t messages, struct ipc_bench_result* out)
+{
+    if (!out || pages > IPC_MAX_PAGES || messages == 0)
+    {
+        return -1;
+    }
+
+    const int port = port_create(1);
+    if (port < 0)
+    {
+        return -1;
+    }
+    if (pages && !bench_map(pages))
+    {
+        port_destroy(port);
+        return -1;
+    }
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    uint32_t at = BENCH_PAGE_A;
+    uint32_t spare = BENCH_PAGE_B;
+    int ret = 0;
+
+    const uint64_t start = ktime_get_ns();
+    for (uint32_t i = 0; i < messages && ret == 0; i++)
+    {
+        // the pages land in the other window and go back on the next round
+        msg.len = pages ? 0 : MAX_MSG_SIZE;
+        msg.page_addr = at;
+        msg.page_count = pages;
+        ret = msg_send(port, &msg, IPC_NONBLOCK | (pages ? IPC_MOVE : 0));
+        if (ret != 0)
+        {
+            break;
+        }
+
+        msg.page_addr = spare;
+        msg.page_count = pages;
+        ret = msg_receive(port, &msg, IPC_NONBLOCK);
+        if (pages)
+        {
+            spare = at;
+            at = msg.page_addr;
+        }
+    }
+    const uint64_t ns = ktime_get_ns() - start;
+
+    if (pages)
+    {
+        bench_unmap(at, pages);
+    }
+    port_destroy(port);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    out->bytes = pages ? pages * PAGE_SIZE : MAX_MSG_SIZE;
+    out->messages = messages;
+    out->ns = ns ? ns : 1;
+    // bytes per microsecond is MB/s
+    out->mb_per_s = (uint32_t)((uint64_t)out->bytes * messages * 1000 / out->ns);
+    return 0;
+}
+
+int ipc_bench_pingpong(const bool direct, const uint32_t rounds, struct ipc_pingpong_result* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || rounds == 0)
+    {
+        return -1;
+    }
+
+    pingpong_rounds = rounds;
+    pingpong_port = port_create(current->pid);
+    pingpong_reply_port = direct ? -1 : port_create(current->pid);
+    if (pingpong_port < 0 || (!direct && pingpong_reply_port < 0))
+    {
+        if (pingpong_port >= 0)
+        {
+            port_destroy(pingpong_port);
+        }
+        return -1;
+    }
+
+    const struct task* server = thread_create(FUNC_PTR_TO_U32(pingpong_server), direct, current->priority);
+    if (!server)
+    {
+        port_destroy(pingpong_port);
+        if (!direct)
+        {
+            port_destroy(pingpong_reply_port);
+        }
+        return -1;
+    }
+    const tid_t server_id = server->id;
+
+    struct sched_global_stats before;
+    struct sched_global_stats after;
+    struct message msg;
+    struct message reply;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = sizeof(uint32_t);
+    int ret = 0;
+
+    sched_get_global_stats(&before);
+    const uint64_t start = ktime_get_ns();
+    for (uint32_t i = 0; i < rounds && ret == 0; i++)
+    {
+        if (direct)
+        {
+            ret = ipc_call(pingpong_port, &msg, &reply);
+        }
+        else
+        {
+            ret = msg_send(pingpong_port, &msg, IPC_BLOCK);
+            reply.page_count = 0;
+            if (ret == 0)
+            {
+                ret = msg_receive(pingpong_reply_port, &reply, IPC_BLOCK);
+            }
+        }
+    }
+    const uint64_t ns = ktime_get_ns() - start;
+    sched_get_global_stats(&after);
+
+    // a failed round leaves the server waiting; the destroy releases it
+    port_destroy(pingpong_port);
+    if (!direct)
+    {
+        port_destroy(pingpong_reply_port);
+    }
+    thread_join(server_id, NULL);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    out->rounds = rounds;
+    out->ns = ns;
+    out->ns_per_round = (uint32_t)(ns / rounds);
+    out->handoffs = after.handoffs - before.handoffs;
+    return 0;
+}
+
+int ipc_bench_batch(const uint32_t batch, const uint32_t messages, struct ipc_bench_result* out)
+{
+    if (!out || batch == 0 || batch > MSG_QUEUE_SIZE || messages < batch)
+    {
+        return -1;
+    }
+
+    const int port = port_create(1);
+    if (port < 0)
+    {
+        return -1;
+    }
+
+    struct message msgs[MSG_QUEUE_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        msgs[i].len = IPC_BENCH_BATCH_LEN;
+    }
+    const uint32_t rounds = messages / batch;
+    int ret = 0;
+
+    const uint64_t start = ktime_get_ns();
+    for (uint32_t i = 0; i < rounds && ret == 0; i++)
+    {
+        if (batch == 1)
+        {
+            ret = msg_send(port, &msgs[0], IPC_NONBLOCK);
+            msgs[0].page_count = 0;
+            if (ret == 0)
+            {
+                ret = msg_receive(port, &msgs[0], IPC_NONBLOCK);
+            }
+            continue;
+        }
+
+        if (msg_send_batch(port, msgs, batch, IPC_NONBLOCK) != (int)batch ||
+            msg_receive_batch(port, msgs, batch, IPC_NONBLOCK) != (int)batch)
+        {
+            ret = -1;
+        }
+    }
+    const uint64_t ns = ktime_get_ns() - start;
+
+    port_destroy(port);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    out->bytes = IPC_BENCH_BATCH_LEN;
+    out->messages = rounds * batch;
+    out->ns = ns ? ns : 1;
+    out->mb_per_s = (uint32_t)((uint64_t)out->bytes * out->messages * 1000 / out->ns);
+    return 0;
+}
+
+int ipc_bench_pipe(const uint32_t chunk, const uint32_t bytes, struct ipc_bench_result* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || chunk == 0 || chunk > IPC_BENCH_PIPE_CHUNK_MAX || bytes == 0)
+    {
+        return -1;
+    }
+
+    int fds[2];
+    if (pipe_create(current->pid, fds, 0) != 0)
+    {
+        return -1;
+    }
+    pipe_fds[0] = fds[0];
+    pipe_fds[1] = fds[1];
+    pipe_total = bytes;
+
+    const uint64_t start = ktime_get_ns();
+    const struct task* writer = thread_create(FUNC_PTR_TO_U32(pipe_writer), chunk, current->priority);
+    if (!writer)
+    {
+        pipe_close(current->pid, fds[0]);
+        pipe_close(current->pid, fds[1]);
+        return -1;
+    }
+    const tid_t writer_id = writer->id;
+
+    uint32_t received = 0;
+    bool intact = true;
+    while (1)
+    {
+        const int n = pipe_read(current->pid, fds[0], pipe_rbuf, chunk);
+        if (n <= 0)
+        {
+            break;
+        }
+        for (int i = 0; i < n && intact; i++)
+        {
+            intact = pipe_rbuf[i] == pipe_pattern(received + (uint32_t)i);
+        }
+        received += (uint32_t)n;
+    }
+    const uint64_t ns = ktime_get_ns() - start;
+
+    // a failed read leaves the writer blocked; losing its reader releases it
+    pipe_close(current->pid, fds[0]);
+    thread_join(writer_id, NULL);
+    if (!intact || received != bytes)
+    {
+        return -1;
+    }
+
+    out->bytes = chunk;
+    out->messages = (bytes + chunk - 1) / chunk;
+    out->ns = ns ? ns : 1;
+    out->mb_per_s = (uint32_t)((uint64_t)bytes * 1000 / out->ns);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef BENCH_IPC_H
+#define BENCH_IPC_H
+
+#include "../../kernel/include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Outcome of one IPC throughput run \struct ipc_bench_result
+ */
+struct ipc_bench_result
+{
+    uint32_t bytes;
+    uint32_t messages;
+    uint64_t ns;
+    uint32_t mb_per_s;
+};
+
+/**
+ * @brief Outcome of one request/reply latency run \struct ipc_pingpong_result
+ */
+struct ipc_pingpong_result
+{
+    uint32_t rounds;
+    uint64_t ns;
+    uint32_t ns_per_round;
+    uint32_t handoffs;
+};
+
+/**
+ * @brief Measure message throughput through one port
+ * @details Sends and receives messages back to back on the calling task.
+ *          With pages set to 0 every message carries MAX_MSG_SIZE bytes
+ *          inline; otherwise it carries that many pages moved with IPC_MOVE.
+ * @param pages Pages per message, 0 for the inline path
+ * @param messages Number of messages to pass
+ * @param out Filled with the payload size, time taken and throughput
+ * @return 0 on success, -1 if the port or the buffer pages are unavailable
+ */
+int ipc_bench_throughput(uint32_t pages, uint32_t messages, struct ipc_bench_result* out);
+
+/**
+ * @brief Measure request/reply round trips against a server thread
+ * @details With direct set the client uses ipc_call and the server
+ *          ipc_reply; otherwise each side sends on the other's port, which
+ *          costs a queue copy, a wakeup and a schedule() per direction.
+ * @param direct Use the call/reply path with direct handoff
+ * @param rounds Number of round trips
+ * @param out Filled with the time taken and the handoffs seen
+ * @return 0 on success, -1 if a port or the server thread is unavailable
+ */
+int ipc_bench_pingpong(bool direct, uint32_t rounds, struct ipc_pingpong_result* out);
+
+/**
+ * @brief Measure small message throughput with batched send and receive
+ * @details Passes IPC_BENCH_BATCH_LEN byte messages through one port,
+ *          batch at a time with msg_send_batch and msg_receive_batch. A
+ *          batch of 1 uses msg_send and msg_receive as the baseline.
+ * @param batch Messages per batch, 1 to MSG_QUEUE_SIZE
+ * @param messages Number of messages to pass, rounded down to whole batches
+ * @param out Filled with the payload size, time taken and throughput
+ * @return 0 on success, -1 if the port is unavailable or a batch failed
+ */
+int ipc_bench_batch(uint32_t batch, uint32_t messages, struct ipc_bench_result* out);
+
+/**
+ * @brief Payload of the messages ipc_bench_batch passes
+ */
+#define IPC_BENCH_BATCH_LEN 32
+
+/**
+ * @brief Largest chunk ipc_bench_pipe writes per call
+ */
+#define IPC_BENCH_PIPE_CHUNK_MAX 16384
+
+/**
+ * @brief Measure streaming throughput through a pipe
+ * @details A writer thread pushes bytes total bytes in chunk sized writes
+ *          and closes its end; the caller reads until end of file and
+ *          checks every byte against the pattern written.
+ * @param chunk Bytes per write and per read, 1 to IPC_BENCH_PIPE_CHUNK_MAX
+ * @param bytes Total bytes to stream
+ * @param out Filled with the chunk size, writes, time taken and throughput
+ * @return 0 on success, -1 if the pipe or thread is unavailable or a byte
+ *         arrived wrong
+ */
+int ipc_bench_pipe(uint32_t chunk, uint32_t bytes, struct ipc_bench_result* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
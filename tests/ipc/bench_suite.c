@@ -0,0 +1,714 @@
+#include "bench_suite.h"
+#include "../../kernel/ipc/ipc.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/arch/i686/arch.h"
+#include "../../kernel/drivers/char/serial.h"
+#include "../../kernel/ui/console.h"
+#include "../../kernel/include/string.h"
+#include "../../kernel/include/cast.h"
+
+/*
+ * IPC microbenchmarks. Everything is timed with the TSC on the thread that
+ * owns the sample, and every benchmark runs untimed warmup rounds first so
+ * the port, the ring and the server threads are hot. Results are kept as
+ * raw cycle counts and reduced to min/median/p99/max; converting to time
+ * is left to the reader, who gets the TSC frequency in the header line.
+ */
+static uint32_t suite_samples[IPC_SUITE_MAX_SAMPLES];
+
+static uint32_t cycles_since(const uint64_t start)
+{
+    const uint64_t d = rdtsc() - start;
+    return d > 0xFFFFFFFFULL ? 0xFFFFFFFF : (uint32_t)d;
+}
+
+static void put_seq(struct message* msg, const uint32_t stream, const uint32_t seq)
+{
+    memcpy(msg->data, &stream, sizeof(stream));
+    memcpy(msg->data + sizeof(stream), &seq, sizeof(seq));
+}
+
+static void get_seq(const struct message* msg, uint32_t* stream, uint32_t* seq)
+{
+    memcpy(stream, msg->data, sizeof(*stream));
+    memcpy(seq, msg->data + sizeof(*stream), sizeof(*seq));
+}
+
+void ipc_suite_summarize(uint32_t* samples, const uint32_t count, struct ipc_suite_stats* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!samples || count == 0)
+    {
+        return;
+    }
+
+    // shell sort with Ciura's gaps: no allocation, fast enough for 4096
+    static const uint32_t gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+    for (uint32_t g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++)
+    {
+        const uint32_t gap = gaps[g];
+        for (uint32_t i = gap; i < count; i++)
+        {
+            const uint32_t v = samples[i];
+            uint32_t j = i;
+            while (j >= gap && samples[j - gap] > v)
+            {
+                samples[j] = samples[j - gap];
+                j -= gap;
+            }
+            samples[j] = v;
+        }
+    }
+
+    // nearest rank: the smallest sample with at least p% at or below it
+    out->samples = count;
+    out->min = samples[0];
+    out->median = samples[(count * 50 + 99) / 100 - 1];
+    out->p99 = samples[(count * 99 + 99) / 100 - 1];
+    out->max = samples[count - 1];
+}
+
+static volatile int pp_port = -1;
+static volatile int pp_reply_port = -1;
+
+static void pingpong_server(const uint32_t direct)
+{
+    // runs until the client destroys the port
+    struct message msg;
+    while (1)
+    {
+        msg.page_count = 0;
+        if (msg_receive(pp_port, &msg, IPC_BLOCK) != 0)
+        {
+            break;
+        }
+        const int ret = direct ? ipc_reply(pp_port, &msg) : msg_send(pp_reply_port, &msg, IPC_BLOCK);
+        if (ret != 0)
+        {
+            break;
+        }
+    }
+    thread_exit(0);
+}
+
+int ipc_suite_pingpong(const bool direct, const uint32_t warmup, const uint32_t rounds, struct ipc_suite_stats* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || rounds == 0 || rounds > IPC_SUITE_MAX_SAMPLES)
+    {
+        return -1;
+    }
+
+    pp_port = port_create(current->pid);
+    pp_reply_port = direct ? -1 : port_create(current->pid);
+    if (pp_port < 0 || (!direct && pp_reply_port < 0))
+    {
+        if (pp_port >= 0)
+        {
+            port_destroy(pp_port);
+        }
+        return -1;
+    }
+
+    const struct task* server = thread_create(FUNC_PTR_TO_U32(pingpong_server), direct, current->priority);
+    if (!server)
+    {
+        port_destroy(pp_port);
+        if (!direct)
+        {
+            port_destroy(pp_reply_port);
+        }
+        return -1;
+    }
+    const tid_t server_id = server->id;
+
+    struct message msg;
+    struct message reply;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = sizeof(uint32_t);
+    int ret = 0;
+
+    for (uint32_t i = 0; i < warmup + rounds && ret == 0; i++)
+    {
+        const uint64_t start = rdtsc();
+        if (direct)
+        {
+            ret = ipc_call(pp_port, &msg, &reply);
+        }
+        else
+        {
+            ret = msg_send(pp_port, &msg, IPC_BLOCK);
+            reply.page_count = 0;
+            if (ret == 0)
+            {
+                ret = msg_receive(pp_reply_port, &reply, IPC_BLOCK);
+            }
+        }
+        if (i >= warmup)
+        {
+            suite_samples[i - warmup] = cycles_since(start);
+        }
+    }
+
+    port_destroy(pp_port);
+    if (!direct)
+    {
+        port_destroy(pp_reply_port);
+    }
+    thread_join(server_id, NULL);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    ipc_suite_summarize(suite_samples, rounds, out);
+    return 0;
+}
+
+int ipc_suite_size(const uint32_t len, const uint32_t warmup, const uint32_t rounds, struct ipc_suite_stats* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || len == 0 || len > MAX_MSG_SIZE || rounds == 0 || rounds > IPC_SUITE_MAX_SAMPLES)
+    {
+        return -1;
+    }
+
+    const int port = port_create(current->pid);
+    if (port < 0)
+    {
+        return -1;
+    }
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    int ret = 0;
+    for (uint32_t i = 0; i < warmup + rounds && ret == 0; i++)
+    {
+        msg.len = len;
+        msg.page_count = 0;
+        const uint64_t start = rdtsc();
+        ret = msg_send(port, &msg, IPC_NONBLOCK);
+        if (ret == 0)
+        {
+            ret = msg_receive(port, &msg, IPC_NONBLOCK);
+        }
+        if (i >= warmup)
+        {
+            suite_samples[i - warmup] = cycles_since(start);
+        }
+    }
+
+    port_destroy(port);
+    if (ret != 0 || msg.len != len)
+    {
+        return -1;
+    }
+
+    ipc_suite_summarize(suite_samples, rounds, out);
+    return 0;
+}
+
+static volatile int fan_ports[IPC_SUITE_MAX_THREADS];
+static volatile uint32_t fan_per_thread = 0;
+static volatile uint32_t fan_ready = 0;
+static volatile uint32_t fan_done = 0;
+static volatile bool fan_go = false;
+static volatile bool fan_error = false;
+
+static void fan_wait_go(void)
+{
+    __sync_fetch_and_add(&fan_ready, 1);
+    while (!fan_go)
+    {
+        sched_yield();
+    }
+}
+
+static void fan_sender(const uint32_t index)
+{
+    fan_wait_go();
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    for (uint32_t seq = 0; seq < fan_per_thread; seq++)
+    {
+        msg.len = IPC_SUITE_MSG_LEN;
+        put_seq(&msg, index, seq);
+        if (msg_send(fan_ports[0], &msg, IPC_BLOCK) != 0)
+        {
+            fan_error = true;
+            break;
+        }
+    }
+    thread_exit(0);
+}
+
+static void fan_receiver(const uint32_t index)
+{
+    fan_wait_go();
+
+    struct message msg;
+    for (uint32_t seq = 0; seq < fan_per_thread; seq++)
+    {
+        msg.page_count = 0;
+        uint32_t stream = 0;
+        uint32_t got = 0;
+        if (msg_receive(fan_ports[index], &msg, IPC_BLOCK) != 0)
+        {
+            fan_error = true;
+            break;
+        }
+        get_seq(&msg, &stream, &got);
+        if (stream != index || got != seq)
+        {
+            fan_error = true;
+        }
+    }
+    __sync_fetch_and_add(&fan_done, 1);
+    thread_exit(0);
+}
+
+// starts threads workers running entry and waits until all of them are parked
+static bool fan_start(const uint32_t entry, const uint32_t threads, tid_t* ids)
+{
+    const struct task* current = sched_get_current();
+    fan_ready = 0;
+    fan_done = 0;
+    fan_go = false;
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        const struct task* t = thread_create(entry, i, current->priority);
+        if (!t)
+        {
+            // let the ones already started run into an error and exit
+            fan_error = true;
+            fan_per_thread = 0;
+            fan_go = true;
+            for (uint32_t j = 0; j < i; j++)
+            {
+                thread_join(ids[j], NULL);
+            }
+            return false;
+        }
+        ids[i] = t->id;
+    }
+    while (fan_ready < threads)
+    {
+        sched_yield();
+    }
+    return true;
+}
+
+static int fan_in_run(const uint32_t senders, uint32_t* cycles)
+{
+    tid_t ids[IPC_SUITE_MAX_THREADS];
+    if (!fan_start(FUNC_PTR_TO_U32(fan_sender), senders, ids))
+    {
+        return -1;
+    }
+
+    uint32_t next[IPC_SUITE_MAX_THREADS];
+    memset(next, 0, sizeof(next));
+    const uint32_t total = fan_per_thread * senders;
+    struct message msg;
+
+    const uint64_t start = rdtsc();
+    fan_go = true;
+    for (uint32_t i = 0; i < total && !fan_error; i++)
+    {
+        msg.page_count = 0;
+        uint32_t stream = 0;
+        uint32_t seq = 0;
+        if (msg_receive(fan_ports[0], &msg, IPC_BLOCK) != 0)
+        {
+            fan_error = true;
+            break;
+        }
+        // senders interleave, but each one's messages stay in order
+        get_seq(&msg, &stream, &seq);
+        if (stream >= senders || seq != next[stream]++)
+        {
+            fan_error = true;
+        }
+    }
+    const uint64_t elapsed = rdtsc() - start;
+
+    if (fan_error)
+    {
+        // senders may be blocked on the full queue; the destroy releases them
+        port_destroy(fan_ports[0]);
+        fan_ports[0] = -1;
+    }
+    for (uint32_t i = 0; i < senders; i++)
+    {
+        thread_join(ids[i], NULL);
+    }
+    *cycles = (uint32_t)(elapsed / total);
+    return fan_error ? -1 : 0;
+}
+
+int ipc_suite_fan_in(const uint32_t senders, const uint32_t messages, const uint32_t runs, struct ipc_suite_stats* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || senders == 0 || senders > IPC_SUITE_MAX_THREADS ||
+        messages < senders || runs == 0 || runs > IPC_SUITE_MAX_SAMPLES)
+    {
+        return -1;
+    }
+
+    fan_ports[0] = port_create(current->pid);
+    if (fan_ports[0] < 0)
+    {
+        return -1;
+    }
+
+    fan_error = false;
+    int ret = 0;
+    for (uint32_t r = 0; r <= runs && ret == 0; r++)
+    {
+        uint32_t cycles = 0;
+        fan_per_thread = messages / senders;
+        ret = fan_in_run(senders, &cycles);
+        if (r > 0)
+        {
+            suite_samples[r - 1] = cycles;
+        }
+    }
+
+    if (fan_ports[0] >= 0)
+    {
+        port_destroy(fan_ports[0]);
+    }
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    ipc_suite_summarize(suite_samples, runs, out);
+    return 0;
+}
+
+static int fan_out_run(const uint32_t receivers, uint32_t* cycles)
+{
+    tid_t ids[IPC_SUITE_MAX_THREADS];
+    if (!fan_start(FUNC_PTR_TO_U32(fan_receiver), receivers, ids))
+    {
+        return -1;
+    }
+
+    const uint32_t total = fan_per_thread * receivers;
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+
+    const uint64_t start = rdtsc();
+    fan_go = true;
+    for (uint32_t i = 0; i < total && !fan_error; i++)
+    {
+        const uint32_t to = i % receivers;
+        msg.len = IPC_SUITE_MSG_LEN;
+        put_seq(&msg, to, i / receivers);
+        if (msg_send(fan_ports[to], &msg, IPC_BLOCK) != 0)
+        {
+            fan_error = true;
+        }
+    }
+    while (fan_done < receivers && !fan_error)
+    {
+        sched_yield();
+    }
+    const uint64_t elapsed = rdtsc() - start;
+
+    if (fan_error)
+    {
+        // receivers may still wait for messages that never came
+        for (uint32_t i = 0; i < receivers; i++)
+        {
+            port_destroy(fan_ports[i]);
+            fan_ports[i] = -1;
+        }
+    }
+    for (uint32_t i = 0; i < receivers; i++)
+    {
+        thread_join(ids[i], NULL);
+    }
+    *cycles = (uint32_t)(elapsed / total);
+    return fan_error ? -1 : 0;
+}
+
+int ipc_suite_fan_out(const uint32_t receivers, const uint32_t messages, const uint32_t runs, struct ipc_suite_stats* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || receivers == 0 || receivers > IPC_SUITE_MAX_THREADS ||
+        messages < receivers || runs == 0 || runs > IPC_SUITE_MAX_SAMPLES)
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < receivers; i++)
+    {
+        fan_ports[i] = port_create(current->pid);
+        if (fan_ports[i] < 0)
+        {
+            for (uint32_t j = 0; j < i; j++)
+            {
+                port_destroy(fan_ports[j]);
+            }
+            return -1;
+        }
+    }
+
+    fan_error = false;
+    int ret = 0;
+    for (uint32_t r = 0; r <= runs && ret == 0; r++)
+    {
+        uint32_t cycles = 0;
+        fan_per_thread = messages / receivers;
+        ret = fan_out_run(receivers, &cycles);
+        if (r > 0)
+        {
+            suite_samples[r - 1] = cycles;
+        }
+    }
+
+    for (uint32_t i = 0; i < receivers; i++)
+    {
+        if (fan_ports[i] >= 0)
+        {
+            port_destroy(fan_ports[i]);
+        }
+    }
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    ipc_suite_summarize(suite_samples, runs, out);
+    return 0;
+}
+
+static volatile int fq_port = -1;
+static volatile uint32_t fq_messages = 0;
+static volatile bool fq_error = false;
+
+static void full_queue_receiver(const uint32_t unused)
+{
+    (void)unused;
+    struct message msg;
+    for (uint32_t seq = 0; seq < fq_messages; seq++)
+    {
+        msg.page_count = 0;
+        uint32_t stream = 0;
+        uint32_t got = 0;
+        if (msg_receive(fq_port, &msg, IPC_BLOCK) != 0)
+        {
+            fq_error = true;
+            break;
+        }
+        get_seq(&msg, &stream, &got);
+        if (got != seq)
+        {
+            fq_error = true;
+        }
+    }
+    thread_exit(0);
+}
+
+int ipc_suite_full_queue(const uint32_t depth, const uint32_t messages, struct ipc_suite_stats* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || depth == 0 || depth > MSG_QUEUE_SIZE || messages == 0)
+    {
+        return -1;
+    }
+
+    fq_port = port_create(current->pid);
+    if (fq_port < 0)
+    {
+        return -1;
+    }
+    if (port_set_limits(fq_port, PORT_RING_DEFAULT, depth, current->pid) != 0)
+    {
+        port_destroy(fq_port);
+        return -1;
+    }
+
+    fq_messages = messages;
+    fq_error = false;
+    const struct task* receiver = thread_create(FUNC_PTR_TO_U32(full_queue_receiver), 0, current->priority);
+    if (!receiver)
+    {
+        port_destroy(fq_port);
+        return -1;
+    }
+    const tid_t receiver_id = receiver->id;
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    uint32_t stalls = 0;
+    int ret = 0;
+    for (uint32_t seq = 0; seq < messages && ret == 0; seq++)
+    {
+        msg.len = IPC_SUITE_MSG_LEN;
+        put_seq(&msg, 0, seq);
+        ret = msg_send(fq_port, &msg, IPC_NONBLOCK);
+        if (ret != -2)
+        {
+            continue;
+        }
+
+        const uint64_t start = rdtsc();
+        ret = msg_send(fq_port, &msg, IPC_BLOCK);
+        const uint32_t cycles = cycles_since(start);
+        if (stalls < IPC_SUITE_MAX_SAMPLES)
+        {
+            suite_samples[stalls] = cycles;
+        }
+        stalls++;
+    }
+
+    // a failed send leaves the receiver waiting; the destroy releases it
+    if (ret != 0)
+    {
+        port_destroy(fq_port);
+        thread_join(receiver_id, NULL);
+        return -1;
+    }
+    thread_join(receiver_id, NULL);
+    port_destroy(fq_port);
+    if (fq_error)
+    {
+        return -1;
+    }
+
+    ipc_suite_summarize(suite_samples, stalls < IPC_SUITE_MAX_SAMPLES ? stalls : IPC_SUITE_MAX_SAMPLES, out);
+    return 0;
+}
+
+static void serial_put_dec(uint32_t value)
+{
+    char buf[11];
+    int i = 10;
+    buf[i] = '\0';
+    do
+    {
+        buf[--i] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    serial_write_str(&buf[i]);
+}
+
+static uint32_t tsc_hz(void)
+{
+    return clock_get_source() == CLOCKSOURCE_TSC ? clock_get_frequency() : 0;
+}
+
+static uint32_t cycles_to_ns(const uint32_t cycles, const uint32_t hz)
+{
+    return hz ? (uint32_t)((uint64_t)cycles * 1000000000ULL / hz) : cycles;
+}
+
+static void report(const char* name, const char* key, const uint32_t value,
+                   const int ret, const struct ipc_suite_stats* s)
+{
+    serial_write_str("IPCBENCH ");
+    serial_write_str(name);
+    if (key)
+    {
+        serial_write(' ');
+        serial_write_str(key);
+        serial_write('=');
+        serial_put_dec(value);
+    }
+    if (ret != 0)
+    {
+        serial_write_str(" failed\n");
+    }
+    else
+    {
+        serial_write_str(" n=");
+        serial_put_dec(s->samples);
+        serial_write_str(" min=");
+        serial_put_dec(s->min);
+        serial_write_str(" median=");
+        serial_put_dec(s->median);
+        serial_write_str(" p99=");
+        serial_put_dec(s->p99);
+        serial_write_str(" max=");
+        serial_put_dec(s->max);
+        serial_write('\n');
+    }
+
+    const uint32_t hz = tsc_hz();
+    console_write("  ");
+    console_write(name);
+    if (key)
+    {
+        console_write(" ");
+        console_write(key);
+        console_write("=");
+        console_write_dec(value);
+    }
+    if (ret != 0)
+    {
+        console_write(": failed\n");
+        return;
+    }
+    console_write(": median ");
+    console_write_dec(cycles_to_ns(s->median, hz));
+    console_write(", p99 ");
+    console_write_dec(cycles_to_ns(s->p99, hz));
+    console_write(hz ? " ns\n" : " cycles\n");
+}
+
+int ipc_suite_run(void)
+{
+    static const uint32_t sizes[] = { 4, 16, 64, 128, MAX_MSG_SIZE };
+    struct ipc_suite_stats s;
+    int failed = 0;
+    int ret;
+
+    serial_write_str("IPCBENCH begin tsc_hz=");
+    serial_put_dec(tsc_hz());
+    serial_write_str(" clocksource=");
+    serial_write_str(clock_get_source_name());
+    serial_write('\n');
+    console_write("IPC benchmark suite, TSC timed after warmup\n");
+
+    ret = ipc_suite_pingpong(true, 200, 2000, &s);
+    report("pingpong_call", NULL, 0, ret, &s);
+    failed |= ret;
+    ret = ipc_suite_pingpong(false, 200, 2000, &s);
+    report("pingpong_queued", NULL, 0, ret, &s);
+    failed |= ret;
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        ret = ipc_suite_size(sizes[i], 200, 2000, &s);
+        report("send_receive", "bytes", sizes[i], ret, &s);
+        failed |= ret;
+    }
+
+    for (uint32_t n = 1; n <= IPC_SUITE_MAX_THREADS; n *= 2)
+    {
+        ret = ipc_suite_fan_in(n, 2048, 20, &s);
+        report("fan_in", "senders", n, ret, &s);
+        failed |= ret;
+    }
+    for (uint32_t n = 1; n <= IPC_SUITE_MAX_THREADS; n *= 2)
+    {
+        ret = ipc_suite_fan_out(n, 2048, 20, &s);
+        report("fan_out", "receivers", n, ret, &s);
+        failed |= ret;
+    }
+
+    for (uint32_t depth = 1; depth <= MSG_QUEUE_SIZE; depth *= 4)
+    {
+        ret = ipc_suite_full_queue(depth, 2000, &s);
+        report("full_queue", "depth", depth, ret, &s);
+        failed |= ret;
+    }
+
+    serial_write_str(failed ? "IPCBENCH end failed\n" : "IPCBENCH end ok\n");
+    return failed ? -1 : 0;
+}
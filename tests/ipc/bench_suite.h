@@ -0,0 +1,127 @@
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include "../../kernel/include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Most timed samples one benchmark keeps
+ */
+#define IPC_SUITE_MAX_SAMPLES 4096
+
+/**
+ * @brief Most sender or receiver threads in the fan-in and fan-out runs
+ */
+#define IPC_SUITE_MAX_THREADS 4
+
+/**
+ * @brief Payload of the messages the throughput runs pass
+ */
+#define IPC_SUITE_MSG_LEN 32
+
+/**
+ * @brief Distribution of one benchmark, in TSC cycles \struct ipc_suite_stats
+ * @details Percentiles use the nearest-rank method over the samples kept
+ *          after warmup.
+ */
+struct ipc_suite_stats
+{
+    uint32_t samples;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+};
+
+/**
+ * @brief Sort samples in place and summarize them
+ * @param samples Cycle counts, reordered by the call
+ * @param count Number of samples
+ * @param out Filled with the distribution; all zero if count is 0
+ */
+void ipc_suite_summarize(uint32_t* samples, uint32_t count, struct ipc_suite_stats* out);
+
+/**
+ * @brief Time request/reply round trips against a server thread
+ * @details Each round is one sample. With direct set the client uses
+ *          ipc_call and the server ipc_reply; otherwise each side sends on
+ *          the other's port.
+ * @param direct Use the call/reply path
+ * @param warmup Untimed rounds run first
+ * @param rounds Timed rounds, up to IPC_SUITE_MAX_SAMPLES
+ * @param out Filled with the round trip distribution
+ * @return 0 on success, -1 if a port or the server thread is unavailable
+ */
+int ipc_suite_pingpong(bool direct, uint32_t warmup, uint32_t rounds, struct ipc_suite_stats* out);
+
+/**
+ * @brief Time one send plus receive of an inline message of a given size
+ * @param len Payload bytes, 1 to MAX_MSG_SIZE
+ * @param warmup Untimed messages passed first
+ * @param rounds Timed messages, up to IPC_SUITE_MAX_SAMPLES
+ * @param out Filled with the per-message distribution
+ * @return 0 on success, -1 if the port is unavailable or a message failed
+ */
+int ipc_suite_size(uint32_t len, uint32_t warmup, uint32_t rounds, struct ipc_suite_stats* out);
+
+/**
+ * @brief Measure many-to-one throughput
+ * @details senders threads stream messages into one port the caller
+ *          drains. Every run is one sample, the cycles per message over the
+ *          whole run; the first run is warmup. The receiver checks every
+ *          sender's messages arrive in order.
+ * @param senders Sender threads, 1 to IPC_SUITE_MAX_THREADS
+ * @param messages Messages per run, split evenly between the senders
+ * @param runs Timed runs, up to IPC_SUITE_MAX_SAMPLES
+ * @param out Filled with the cycles-per-message distribution
+ * @return 0 on success, -1 if a thread is unavailable or messages were
+ *         lost or reordered
+ */
+int ipc_suite_fan_in(uint32_t senders, uint32_t messages, uint32_t runs, struct ipc_suite_stats* out);
+
+/**
+ * @brief Measure one-to-many throughput
+ * @details The caller deals messages round robin to the ports of
+ *          receivers threads. Sampling as in ipc_suite_fan_in.
+ * @param receivers Receiver threads, 1 to IPC_SUITE_MAX_THREADS
+ * @param messages Messages per run, split evenly between the receivers
+ * @param runs Timed runs, up to IPC_SUITE_MAX_SAMPLES
+ * @param out Filled with the cycles-per-message distribution
+ * @return 0 on success, -1 if a port or thread is unavailable or messages
+ *         were lost or reordered
+ */
+int ipc_suite_fan_out(uint32_t receivers, uint32_t messages, uint32_t runs, struct ipc_suite_stats* out);
+
+/**
+ * @brief Time senders blocking on a full queue
+ * @details The caller sends messages into a port limited to depth queued
+ *          messages while a receiver thread drains it. Every send that
+ *          finds the queue full is retried with IPC_BLOCK and timed until
+ *          it returns, so the samples are the cost of blocking and being
+ *          woken, and their count is the number of stalls.
+ * @param depth Queue limit, 1 to MSG_QUEUE_SIZE
+ * @param messages Messages to pass
+ * @param out Filled with the blocked-send distribution
+ * @return 0 on success, -1 if the port or thread is unavailable or
+ *         messages were lost or reordered
+ */
+int ipc_suite_full_queue(uint32_t depth, uint32_t messages, struct ipc_suite_stats* out);
+
+/**
+ * @brief Run the whole suite
+ * @details Prints a table on the console and one line per result on the
+ *          serial port, framed by begin and end lines:
+ *          "IPCBENCH <name> n=<samples> min=<c> median=<c> p99=<c> max=<c>"
+ *          with cycle counts, so runs of different builds can be diffed.
+ * @return 0 if every benchmark ran, -1 otherwise
+ */
+int ipc_suite_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
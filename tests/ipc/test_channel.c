@@ -0,0 +1,211 @@
+#include "test_channel.h"
+#include "../../kernel/ipc/channel.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/mm/vmm.h"
+#include "../../kernel/mm/pmm.h"
+#include "../../kernel/include/string.h"
+#include "../../kernel/include/cast.h"
+
+// user range no test process maps, clear of the IPC test windows
+#define CHAN_TEST_A 0x40800000
+#define CHAN_TEST_B 0x40840000
+
+static volatile int producer_chan = -1;
+
+static bool window_free(const uint32_t virt, const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (vmm_get_physical_address(vmm_get_current_directory(), virt + i * PAGE_SIZE))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// writes through its own view of the shared address space, then wakes
+static void ring_producer(const uint32_t len)
+{
+    struct channel_header* h = PTR_FROM_U32_TYPED(struct channel_header, CHAN_TEST_A);
+    uint8_t* data = PTR_FROM_U32_TYPED(uint8_t, CHAN_TEST_A + PAGE_SIZE);
+    sched_yield();
+    for (uint32_t i = 0; i < len; i++)
+    {
+        data[i] = (uint8_t)(i + 1);
+    }
+    h->head = len;
+    __sync_synchronize();
+    if (h->consumer_waiting)
+    {
+        channel_wake(producer_chan, CHAN_CONSUMER, sched_get_current()->pid);
+    }
+    thread_exit(0);
+}
+
+TEST_CASE(chan_create_maps_shared_ring)
+{
+    if (!window_free(CHAN_TEST_A, 3) || !window_free(CHAN_TEST_B, 3))
+    {
+        return TEST_SKIP;
+    }
+    const int id = channel_create(1, 2, CHAN_TEST_A);
+    TEST_ASSERT_GE(id, 0);
+    TEST_ASSERT_EQ(channel_map(id, CHAN_TEST_B, 1), 0);
+
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const uint32_t a = vmm_get_physical_address(dir, CHAN_TEST_A + i * PAGE_SIZE);
+        TEST_ASSERT_NEQ(a, 0);
+        TEST_ASSERT_EQ(vmm_get_physical_address(dir, CHAN_TEST_B + i * PAGE_SIZE), a);
+    }
+
+    const struct channel_header* a = PTR_FROM_U32_TYPED(const struct channel_header, CHAN_TEST_A);
+    struct channel_header* b = PTR_FROM_U32_TYPED(struct channel_header, CHAN_TEST_B);
+    TEST_ASSERT_EQ(a->size, 2 * PAGE_SIZE);
+    TEST_ASSERT_EQ(a->head, 0);
+    TEST_ASSERT_EQ(__builtin_offsetof(struct channel_header, tail) % 64, 0);
+
+    // writes through one end are seen through the other, no copy-on-write
+    b->head = 7;
+    *PTR_FROM_U32_TYPED(uint8_t, CHAN_TEST_B + 2 * PAGE_SIZE) = 0xA5;
+    TEST_ASSERT_EQ(a->head, 7);
+    TEST_ASSERT_EQ(*PTR_FROM_U32_TYPED(const uint8_t, CHAN_TEST_A + 2 * PAGE_SIZE), 0xA5);
+
+    // the frames go back once the channel and both mappings are gone
+    const uint32_t free_before = pmm_get_free_block_count();
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_B, 1), 0);
+    TEST_ASSERT_EQ(channel_destroy(id, 1), 0);
+    TEST_ASSERT_EQ(pmm_get_free_block_count(), free_before);
+    TEST_ASSERT_EQ(a->head, 7);
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_A, 1), -1);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        vmm_free_page(dir, CHAN_TEST_A + i * PAGE_SIZE);
+    }
+    TEST_ASSERT_EQ(pmm_get_free_block_count(), free_before + 3);
+    return TEST_PASS;
+}
+
+TEST_CASE(chan_rejects_bad_windows)
+{
+    if (!window_free(CHAN_TEST_A, 2) || !window_free(CHAN_TEST_B, 2))
+    {
+        return TEST_SKIP;
+    }
+    TEST_ASSERT_EQ(channel_create(1, 3, CHAN_TEST_A), -1);
+    TEST_ASSERT_EQ(channel_create(1, CHANNEL_MAX_PAGES * 2, CHAN_TEST_A), -1);
+    TEST_ASSERT_EQ(channel_create(1, 1, CHAN_TEST_A + 4), -1);
+    TEST_ASSERT_EQ(channel_create(1, 1, KERNEL_VIRTUAL_BASE), -1);
+
+    const int id = channel_create(1, 1, CHAN_TEST_A);
+    TEST_ASSERT_GE(id, 0);
+    TEST_ASSERT_EQ(channel_map(id, CHAN_TEST_A + PAGE_SIZE, 1), -1);
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_B, 1), -1);
+    TEST_ASSERT_EQ(channel_wait(id, CHAN_TEST_B, CHAN_CONSUMER, 0, 1), -1);
+    TEST_ASSERT_EQ(channel_wait(id, CHAN_TEST_A, 2, 0, 1), -1);
+    TEST_ASSERT_EQ(channel_wake(id, CHAN_CONSUMER, 1), 0);
+
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_A, 1), 0);
+    TEST_ASSERT(window_free(CHAN_TEST_A, 2));
+    TEST_ASSERT_EQ(channel_destroy(id, 1), 0);
+    TEST_ASSERT_EQ(channel_destroy(id, 1), -1);
+    return TEST_PASS;
+}
+
+TEST_CASE(chan_only_owner_and_peer)
+{
+    if (!window_free(CHAN_TEST_A, 2) || !window_free(CHAN_TEST_B, 2))
+    {
+        return TEST_SKIP;
+    }
+
+    // a granted peer is the only other process let in
+    int id = channel_create(1, 1, CHAN_TEST_A);
+    TEST_ASSERT_GE(id, 0);
+    TEST_ASSERT_EQ(channel_grant(id, 2, 2), -1);
+    TEST_ASSERT_EQ(channel_grant(id, 1, 2), 0);
+    TEST_ASSERT_EQ(channel_grant(id, 1, 3), -1);
+    TEST_ASSERT_EQ(channel_map(id, CHAN_TEST_B, 3), -1);
+    TEST_ASSERT_EQ(channel_wake(id, CHAN_CONSUMER, 3), -1);
+    TEST_ASSERT_EQ(channel_wait(id, CHAN_TEST_A, CHAN_CONSUMER, 1, 3), -1);
+    TEST_ASSERT_EQ(channel_map(id, CHAN_TEST_B, 2), 0);
+    TEST_ASSERT_EQ(channel_wake(id, CHAN_CONSUMER, 2), 0);
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_B, 2), 0);
+
+    // only the owner tears it down
+    TEST_ASSERT_EQ(channel_destroy(id, 2), -1);
+    TEST_ASSERT_EQ(channel_destroy(id, 3), -1);
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_A, 1), 0);
+    TEST_ASSERT_EQ(channel_destroy(id, 1), 0);
+
+    // without a grant the first process to map becomes the peer
+    id = channel_create(1, 1, CHAN_TEST_A);
+    TEST_ASSERT_GE(id, 0);
+    TEST_ASSERT_EQ(channel_map(id, CHAN_TEST_B, 2), 0);
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_B, 2), 0);
+    TEST_ASSERT_EQ(channel_map(id, CHAN_TEST_B, 3), -1);
+    TEST_ASSERT_EQ(channel_grant(id, 1, 3), -1);
+    TEST_ASSERT(window_free(CHAN_TEST_B, 2));
+
+    TEST_ASSERT_EQ(channel_unmap(id, CHAN_TEST_A, 1), 0);
+    TEST_ASSERT_EQ(channel_destroy(id, 1), 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(chan_wait_sleeps_until_producer_wakes)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    if (!window_free(CHAN_TEST_A, 2))
+    {
+        return TEST_SKIP;
+    }
+    producer_chan = channel_create(current->pid, 1, CHAN_TEST_A);
+    TEST_ASSERT_GE(producer_chan, 0);
+    struct channel_header* h = PTR_FROM_U32_TYPED(struct channel_header, CHAN_TEST_A);
+
+    // an index that already moved returns at once
+    TEST_ASSERT_EQ(channel_wait(producer_chan, CHAN_TEST_A, CHAN_CONSUMER, 1, current->pid), 0);
+
+    const struct task* producer = thread_create(FUNC_PTR_TO_U32(ring_producer), 16, current->priority);
+    TEST_ASSERT_NOT_NULL(producer);
+    const tid_t producer_id = producer->id;
+
+    h->consumer_waiting = 1;
+    __sync_synchronize();
+    while (h->head == 0)
+    {
+        TEST_ASSERT_EQ(channel_wait(producer_chan, CHAN_TEST_A, CHAN_CONSUMER, 0, current->pid), 0);
+    }
+    h->consumer_waiting = 0;
+    TEST_ASSERT_EQ(h->head, 16);
+    const uint8_t* data = PTR_FROM_U32_TYPED(const uint8_t, CHAN_TEST_A + PAGE_SIZE);
+    TEST_ASSERT_EQ(data[0], 1);
+    TEST_ASSERT_EQ(data[15], 16);
+    TEST_ASSERT_EQ(thread_join(producer_id, NULL), 0);
+
+    TEST_ASSERT_EQ(channel_unmap(producer_chan, CHAN_TEST_A, current->pid), 0);
+    TEST_ASSERT_EQ(channel_destroy(producer_chan, current->pid), 0);
+    return TEST_PASS;
+}
+
+static struct test_case channel_cases[] = {
+        TEST_ENTRY(chan_create_maps_shared_ring),
+        TEST_ENTRY(chan_rejects_bad_windows),
+        TEST_ENTRY(chan_only_owner_and_peer),
+        TEST_ENTRY(chan_wait_sleeps_until_producer_wakes),
+        TEST_SUITE_END
+};
+
+static struct test_suite channel_suite = {
+        .name = "Channel Tests",
+        .cases = channel_cases,
+        .count = 4
+};
+
+struct test_suite* test_channel_get_suite(void)
+{
+    return &channel_suite;
+}
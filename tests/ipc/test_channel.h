@@ -0,0 +1,20 @@
+#ifndef TEST_CHANNEL_H
+#define TEST_CHANNEL_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the channel test suite
+ * @return Pointer to the channel test suite
+ */
+struct test_suite* test_channel_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,6 +1,144 @@
 #include "test_ipc.h"
+#include "bench_suite.h"
 #include "../../kernel/ipc/ipc.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/mm/vmm.h"
+#include "../../kernel/mm/pmm.h"
+#include "../../kernel/sys/clock.h"
 #include "../../kernel/include/string.h"
+#include "../../kernel/include/cast.h"
+#include "../../kernel/core/syscall.h"
+#include "../../kernel/arch/i686/idt.h"
+
+// user range no test process maps; both windows fit in one page table
+#define PAGE_TEST_SRC 0x40000000
+#define PAGE_TEST_DST 0x40100000
+static volatile uint32_t served_prio = 0;
+static volatile uint32_t replied_prio = 0;
+static volatile int call_port = -1;
+static volatile int forged_reply = 0;
+static volatile int reply_port_id = -1;
+static volatile uint32_t answered_prio = 0;
+
+static void low_prio_entry(void)
+{
+    while (1)
+    {
+        sched_yield();
+    }
+}
+
+static void low_prio_server(const uint32_t port)
+{
+    struct message msg;
+    if (msg_receive((int)port, &msg, IPC_BLOCK) == 0)
+    {
+        served_prio = sched_get_current()->priority;
+        msg_reply(msg.sender, &msg);
+        replied_prio = sched_get_current()->priority;
+    }
+    thread_exit(0);
+}
+
+// sends one request and records its priority once the answer is in
+static void low_prio_client(const uint32_t port)
+{
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.sender = sched_get_current()->pid;
+    if (msg_send((int)port, &msg, IPC_NONBLOCK) == 0 && msg_receive(reply_port_id, &msg, IPC_BLOCK) == 0)
+    {
+        answered_prio = sched_get_current()->priority;
+    }
+    thread_exit(0);
+}
+
+// tries to answer a call some other thread is serving
+static void forge_reply(const uint32_t unused)
+{
+    (void)unused;
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = 1;
+    msg.data[0] = 0xEE;
+    forged_reply = ipc_reply(call_port, &msg);
+    thread_exit(0);
+}
+
+// answers each call with the payload incremented, then drops the port
+static void call_server(const uint32_t rounds)
+{
+    struct message msg;
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        msg.page_count = 0;
+        if (msg_receive(call_port, &msg, IPC_BLOCK) != 0)
+        {
+            break;
+        }
+        if (i == 0)
+        {
+            const struct task* forger = thread_create(FUNC_PTR_TO_U32(forge_reply), 0,
+                                                      sched_get_current()->priority);
+            if (forger)
+            {
+                thread_join(forger->id, NULL);
+            }
+        }
+        msg.data[0]++;
+        ipc_reply(call_port, &msg);
+    }
+    if (msg_receive(call_port, &msg, IPC_BLOCK) == 0)
+    {
+        port_destroy(call_port);
+    }
+    thread_exit(0);
+}
+
+static void set_member_sender(const uint32_t port)
+{
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = 1;
+    sched_yield();
+    msg_send((int)port, &msg, IPC_BLOCK);
+    thread_exit(0);
+}
+
+static bool map_test_pages(const uint32_t virt, const uint32_t count)
+{
+    page_directory_t* dir = vmm_get_current_directory();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        void* frame = pmm_alloc_block();
+        if (!frame || vmm_map_page(dir, virt + i * PAGE_SIZE, PTR_TO_U32(frame),
+                                   PAGE_PRESENT | PAGE_WRITE | PAGE_USER) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_range_free(const uint32_t virt, const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (vmm_get_physical_address(vmm_get_current_directory(), virt + i * PAGE_SIZE))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void unmap_test_pages(const uint32_t virt, const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        vmm_free_page(vmm_get_current_directory(), virt + i * PAGE_SIZE);
+    }
+}
 
 TEST_CASE(ipc_port_create_success)
 {
@@ -140,6 +278,717 @@ TEST_CASE(ipc_port_reuse_after_destroy)
     return TEST_PASS;
 }
 
+TEST_CASE(ipc_priority_inherit_on_send)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_GT(current->priority, 1);
+
+    const uint8_t low = (uint8_t)(current->priority - 1);
+    const struct task* owner = task_create(low_prio_entry, low, true);
+    TEST_ASSERT_NOT_NULL(owner);
+    const int port = port_create(owner->pid);
+    TEST_ASSERT_GE(port, 0);
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.sender = current->pid;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), 0);
+
+    // the queued message lends the sender's priority to the owner
+    TEST_ASSERT_EQ(owner->priority, current->priority);
+    TEST_ASSERT_EQ(owner->base_priority, low);
+
+    port_destroy(port);
+    TEST_ASSERT_EQ(owner->priority, low);
+    task_exit(owner->id, 0);
+    task_destroy(owner->id);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_priority_inherit_until_reply)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_GT(current->priority, 1);
+
+    // msg_reply answers on the first port of the destination, so the reply
+    // port has to come first
+    const int reply_port = port_create(current->pid);
+    const int server_port = port_create(current->pid);
+    TEST_ASSERT_GE(reply_port, 0);
+    TEST_ASSERT_GT(server_port, reply_port);
+
+    served_prio = 0;
+    replied_prio = 0;
+    const uint8_t low = (uint8_t)(current->priority - 1);
+    const struct task* server = thread_create(FUNC_PTR_TO_U32(low_prio_server), (uint32_t)server_port, low);
+    TEST_ASSERT_NOT_NULL(server);
+    const tid_t server_id = server->id;
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.sender = current->pid;
+    TEST_ASSERT_EQ(msg_send(server_port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg_receive(reply_port, &msg, IPC_BLOCK), 0);
+    TEST_ASSERT_EQ(thread_join(server_id, NULL), 0);
+
+    // boosted while serving the request, back to its own level after replying
+    TEST_ASSERT_EQ(served_prio, current->priority);
+    TEST_ASSERT_EQ(replied_prio, low);
+
+    port_destroy(server_port);
+    port_destroy(reply_port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_priority_reply_lends_nothing)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_GT(current->priority, 1);
+
+    // msg_reply answers on the first port of the destination
+    const int reply_port = port_create(current->pid);
+    const int server_port = port_create(current->pid);
+    TEST_ASSERT_GE(reply_port, 0);
+    TEST_ASSERT_GT(server_port, reply_port);
+    reply_port_id = reply_port;
+
+    answered_prio = 0;
+    const uint8_t low = (uint8_t)(current->priority - 1);
+    const struct task* client = thread_create(FUNC_PTR_TO_U32(low_prio_client), (uint32_t)server_port, low);
+    TEST_ASSERT_NOT_NULL(client);
+    const tid_t client_id = client->id;
+
+    // this thread serves at a higher priority than the client's
+    struct message msg;
+    msg.page_count = 0;
+    TEST_ASSERT_EQ(msg_receive(server_port, &msg, IPC_BLOCK), 0);
+    TEST_ASSERT_EQ(msg_reply(msg.sender, &msg), 0);
+    TEST_ASSERT_EQ(thread_join(client_id, NULL), 0);
+
+    // the client got its answer without taking the server's priority along
+    TEST_ASSERT_EQ(answered_prio, low);
+
+    port_destroy(server_port);
+    port_destroy(reply_port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_queue_allocated_on_first_send)
+{
+    const uint32_t before = ipc_get_queue_memory();
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(ipc_get_queue_memory(), before);
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = 4;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(ipc_get_queue_memory(), before + PORT_RING_DEFAULT);
+
+    port_destroy(port);
+    TEST_ASSERT_EQ(ipc_get_queue_memory(), before);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_queue_limits_bytes_and_messages)
+{
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(port_set_limits(port, PORT_RING_MIN - 1, 4, 1), -1);
+    TEST_ASSERT_EQ(port_set_limits(port, 512, 0, 1), -1);
+    TEST_ASSERT_EQ(port_set_limits(port, 512, MSG_QUEUE_SIZE, 2), -1);
+    TEST_ASSERT_EQ(port_set_limits(port, 512, MSG_QUEUE_SIZE, 1), 0);
+
+    // small messages take a 28 byte record: the message limit hits first
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = 4;
+    uint32_t queued = 0;
+    while (msg_send(port, &msg, IPC_NONBLOCK) == 0)
+    {
+        queued++;
+    }
+    TEST_ASSERT_EQ(queued, MSG_QUEUE_SIZE);
+    TEST_ASSERT_EQ(port_set_limits(port, 1024, MSG_QUEUE_SIZE, 1), -1);
+    for (uint32_t i = 0; i < queued; i++)
+    {
+        TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), 0);
+    }
+
+    // full messages take 280 bytes: the byte limit hits first
+    msg.len = MAX_MSG_SIZE;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), -2);
+
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_queue_records_wrap)
+{
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(port_set_limits(port, PORT_RING_MIN, 4, 1), 0);
+
+    // lengths that do not divide the ring move records across its end
+    struct message msg;
+    struct message out;
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.type = i;
+        msg.len = (i * 37) % 120 + 1;
+        memset(msg.data, (int)i, msg.len);
+        TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), 0);
+
+        memset(&out, 0xFF, sizeof(out));
+        out.page_count = 0;
+        TEST_ASSERT_EQ(msg_receive(port, &out, IPC_NONBLOCK), 0);
+        TEST_ASSERT_EQ(out.type, i);
+        TEST_ASSERT_EQ(out.len, msg.len);
+        TEST_ASSERT_EQ(out.data[0], (uint8_t)i);
+        TEST_ASSERT_EQ(out.data[out.len - 1], (uint8_t)i);
+        TEST_ASSERT_EQ(out.page_count, 0);
+    }
+
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_batch_send_receive_drains_queue)
+{
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+
+    struct message msgs[8];
+    memset(msgs, 0, sizeof(msgs));
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        msgs[i].type = i;
+        msgs[i].len = i + 1;
+        msgs[i].data[i] = (uint8_t)i;
+    }
+    TEST_ASSERT_EQ(msg_send_batch(port, msgs, 8, IPC_NONBLOCK), 8);
+
+    struct message out[IPC_BATCH_MAX];
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQ(msg_receive_batch(port, out, 5, IPC_NONBLOCK), 5);
+    TEST_ASSERT_EQ(msg_receive_batch(port, &out[5], IPC_BATCH_MAX - 5, IPC_NONBLOCK), 3);
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_EQ(out[i].type, i);
+        TEST_ASSERT_EQ(out[i].len, i + 1);
+        TEST_ASSERT_EQ(out[i].data[i], (uint8_t)i);
+    }
+    TEST_ASSERT_EQ(msg_receive_batch(port, out, IPC_BATCH_MAX, IPC_NONBLOCK), -2);
+
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_batch_send_stops_when_full)
+{
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(port_set_limits(port, PORT_RING_MIN, 3, 1), 0);
+
+    struct message msgs[5];
+    memset(msgs, 0, sizeof(msgs));
+    TEST_ASSERT_EQ(msg_send_batch(port, msgs, 5, IPC_MOVE), -1);
+    msgs[4].len = MAX_MSG_SIZE + 1;
+    TEST_ASSERT_EQ(msg_send_batch(port, msgs, 5, IPC_NONBLOCK), -1);
+    msgs[4].len = 0;
+
+    // a batch that does not fit queues its head and reports how much
+    TEST_ASSERT_EQ(msg_send_batch(port, msgs, 5, IPC_NONBLOCK), 3);
+    TEST_ASSERT_EQ(msg_send_batch(port, msgs, 5, IPC_NONBLOCK), -2);
+
+    struct message out[5];
+    TEST_ASSERT_EQ(msg_receive_batch(port, out, 5, IPC_NONBLOCK), 3);
+    TEST_ASSERT_EQ(msg_send_batch(port, &msgs[3], 2, IPC_NONBLOCK), 2);
+
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_port_set_reports_ready_ports)
+{
+    const int set = portset_create(1);
+    TEST_ASSERT_GE(set, 0);
+    int port[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        port[i] = port_create(1);
+        TEST_ASSERT_GE(port[i], 0);
+        TEST_ASSERT_EQ(portset_add(set, port[i], 1), 0);
+    }
+    TEST_ASSERT_EQ(portset_add(set, port[0], 1), -1);
+
+    // only the owner of both the set and the port may change membership
+    const int foreign = port_create(2);
+    TEST_ASSERT_GE(foreign, 0);
+    TEST_ASSERT_EQ(portset_add(set, foreign, 1), -1);
+    TEST_ASSERT_EQ(portset_add(set, foreign, 2), -1);
+    TEST_ASSERT_EQ(portset_remove(set, port[0], 2), -1);
+    TEST_ASSERT_EQ(portset_destroy(set, 2), -1);
+    port_destroy(foreign);
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = 1;
+    TEST_ASSERT_EQ(msg_send(port[2], &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg_send(port[0], &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg_send(port[2], &msg, IPC_NONBLOCK), 0);
+
+    // another process cannot take the owner's ready ports
+    int ready[4];
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 2), -1);
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 1), 2);
+    TEST_ASSERT_EQ(ready[0], port[2]);
+    TEST_ASSERT_EQ(ready[1], port[0]);
+
+    // edge triggered: queued messages alone do not report a port again
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 1), 0);
+    TEST_ASSERT_EQ(msg_send(port[0], &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 1), 1);
+    TEST_ASSERT_EQ(ready[0], port[0]);
+
+    // a port joining with messages queued is ready at once
+    TEST_ASSERT_EQ(portset_remove(set, port[2], 1), 0);
+    TEST_ASSERT_EQ(portset_remove(set, port[2], 1), -1);
+    TEST_ASSERT_EQ(portset_add(set, port[2], 1), 0);
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 1), 1);
+    TEST_ASSERT_EQ(ready[0], port[2]);
+
+    // a destroyed member leaves the ready list
+    TEST_ASSERT_EQ(msg_send(port[1], &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(port_destroy(port[1]), 0);
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 1), 0);
+
+    TEST_ASSERT_EQ(portset_destroy(set, 1), 0);
+    TEST_ASSERT_EQ(portset_wait(set, ready, 4, 0, 1), -1);
+    port_destroy(port[0]);
+    port_destroy(port[2]);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_port_set_wait_times_out)
+{
+    if (!sched_get_current())
+    {
+        return TEST_SKIP;
+    }
+    const int set = portset_create(1);
+    TEST_ASSERT_GE(set, 0);
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(portset_add(set, port, 1), 0);
+
+    int ready[1];
+    const uint64_t start = ktime_get_ns();
+    TEST_ASSERT_EQ(portset_wait(set, ready, 1, 30, 1), 0);
+    TEST_ASSERT_GE(ktime_get_ns() - start, 20000000ULL);
+
+    portset_destroy(set, 1);
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_port_set_wakes_on_send)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    const int set = portset_create(current->pid);
+    TEST_ASSERT_GE(set, 0);
+    const int port = port_create(current->pid);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(portset_add(set, port, current->pid), 0);
+
+    const struct task* sender = thread_create(FUNC_PTR_TO_U32(set_member_sender), (uint32_t)port, current->priority);
+    TEST_ASSERT_NOT_NULL(sender);
+    const tid_t sender_id = sender->id;
+
+    int ready[2];
+    TEST_ASSERT_EQ(portset_wait(set, ready, 2, PORT_WAIT_FOREVER, current->pid), 1);
+    TEST_ASSERT_EQ(ready[0], port);
+    TEST_ASSERT_EQ(thread_join(sender_id, NULL), 0);
+
+    struct message msg;
+    msg.page_count = 0;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), 0);
+    portset_destroy(set, current->pid);
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_notify_coalesces_badges)
+{
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(port_notify(port, 0), -1);
+    TEST_ASSERT_EQ(port_notify(MAX_PORTS, 1), -1);
+
+    const uint32_t before = ipc_get_queue_memory();
+    TEST_ASSERT_EQ(port_notify(port, 0x1), 0);
+    TEST_ASSERT_EQ(port_notify(port, 0x4), 0);
+    TEST_ASSERT_EQ(port_notify(port, 0x1), 0);
+    TEST_ASSERT_EQ(ipc_get_queue_memory(), before);
+
+    struct message msg;
+    memset(&msg, 0xFF, sizeof(msg));
+    msg.page_count = 0;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg.type, MSG_NOTIFY);
+    TEST_ASSERT_EQ(msg.sender, 0);
+    TEST_ASSERT_EQ(msg.len, sizeof(uint32_t));
+    uint32_t badges;
+    memcpy(&badges, msg.data, sizeof(badges));
+    TEST_ASSERT_EQ(badges, 0x5);
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), -2);
+
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_notify_bypasses_full_queue)
+{
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(port_set_limits(port, PORT_RING_MIN, 1, 1), 0);
+    const int set = portset_create(1);
+    TEST_ASSERT_GE(set, 0);
+    TEST_ASSERT_EQ(portset_add(set, port, 1), 0);
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = MSG_SEND;
+    msg.len = 1;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK), -2);
+    int ready[1];
+    TEST_ASSERT_EQ(portset_wait(set, ready, 1, 0, 1), 1);
+
+    // the badge gets through the full queue, wakes the set and goes first
+    TEST_ASSERT_EQ(port_notify(port, 0x80000000), 0);
+    TEST_ASSERT_EQ(portset_wait(set, ready, 1, 0, 1), 1);
+    struct message out[4];
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQ(msg_receive_batch(port, out, 4, IPC_NONBLOCK), 2);
+    TEST_ASSERT_EQ(out[0].type, MSG_NOTIFY);
+    TEST_ASSERT_EQ(out[0].data[3], 0x80);
+    TEST_ASSERT_EQ(out[1].type, MSG_SEND);
+
+    portset_destroy(set, 1);
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+static void test_port_name(char* name, const uint32_t i)
+{
+    memcpy(name, "test.svc", 8);
+    name[8] = (char)('a' + i / 26);
+    name[9] = (char)('a' + i % 26);
+    name[10] = '\0';
+}
+
+TEST_CASE(ipc_registry_register_lookup)
+{
+    const int port = port_create(1);
+    const int other = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_GE(other, 0);
+
+    TEST_ASSERT_EQ(port_lookup("test.echo"), -1);
+    TEST_ASSERT_EQ(port_register("", port, 1), -1);
+    TEST_ASSERT_EQ(port_register("test.echo", port, 2), -1);
+    TEST_ASSERT_EQ(port_register("test.echo", port, 1), 0);
+    TEST_ASSERT_EQ(port_lookup("test.echo"), port);
+    TEST_ASSERT_EQ(port_register("test.echo", other, 1), -1);
+    TEST_ASSERT_EQ(port_register("test.echo2", port, 1), -1);
+
+    char long_name[PORT_NAME_MAX + 1];
+    memset(long_name, 'x', PORT_NAME_MAX);
+    long_name[PORT_NAME_MAX] = '\0';
+    TEST_ASSERT_EQ(port_register(long_name, other, 1), -1);
+
+    TEST_ASSERT_EQ(port_unregister("test.echo", 2), -1);
+    TEST_ASSERT_EQ(port_unregister("test.echo", 1), 0);
+    TEST_ASSERT_EQ(port_lookup("test.echo"), -1);
+    TEST_ASSERT_EQ(port_unregister("test.echo", 1), -1);
+
+    // the name goes away with its port
+    TEST_ASSERT_EQ(port_register("test.echo", other, 1), 0);
+    port_destroy(other);
+    TEST_ASSERT_EQ(port_lookup("test.echo"), -1);
+
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_registry_foreign_destroy)
+{
+    const pid_t self = sched_get_current()->pid;
+    const pid_t other = self == 0x7FFFFFF0 ? 0x7FFFFFF1 : 0x7FFFFFF0;
+    const int port = port_create(other);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(port_register("test.owned", port, other), 0);
+
+    // a task that does not own the port cannot free its name
+    struct registers regs;
+    memset(&regs, 0, sizeof(regs));
+    regs.eax = SYS_PORT_DESTROY;
+    regs.ebx = (uint32_t)port;
+    TEST_ASSERT_EQ(syscall_handler(&regs), -1);
+    TEST_ASSERT_EQ(port_lookup("test.owned"), port);
+    TEST_ASSERT_EQ(port_get_owner(port), other);
+
+    port_destroy(port);
+
+    const int mine = port_create(self);
+    TEST_ASSERT_GE(mine, 0);
+    regs.ebx = (uint32_t)mine;
+    TEST_ASSERT_EQ(syscall_handler(&regs), 0);
+    TEST_ASSERT_EQ(port_get_owner(mine), 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_registry_survives_removals)
+{
+    int ports_made[64];
+    char name[PORT_NAME_MAX];
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        ports_made[i] = port_create(1);
+        TEST_ASSERT_GE(ports_made[i], 0);
+        test_port_name(name, i);
+        TEST_ASSERT_EQ(port_register(name, ports_made[i], 1), 0);
+    }
+
+    // removals move colliding names; the rest must stay reachable
+    for (uint32_t i = 0; i < 64; i += 2)
+    {
+        test_port_name(name, i);
+        TEST_ASSERT_EQ(port_unregister(name, 1), 0);
+    }
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        test_port_name(name, i);
+        TEST_ASSERT_EQ(port_lookup(name), (i & 1) ? ports_made[i] : -1);
+    }
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        port_destroy(ports_made[i]);
+    }
+    test_port_name(name, 1);
+    TEST_ASSERT_EQ(port_lookup(name), -1);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_port_create_until_full)
+{
+    static int made[MAX_PORTS];
+    uint32_t count = 0;
+    while (count < MAX_PORTS)
+    {
+        const int port = port_create(1);
+        if (port < 0)
+        {
+            break;
+        }
+        made[count++] = port;
+    }
+    TEST_ASSERT_GT(count, 1);
+    TEST_ASSERT_EQ(port_create(1), -1);
+
+    // the only free ID is the one just destroyed
+    const int freed = made[count / 2];
+    TEST_ASSERT_EQ(port_destroy(freed), 0);
+    TEST_ASSERT_EQ(port_create(1), freed);
+    TEST_ASSERT_EQ(port_create(1), -1);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        port_destroy(made[i]);
+    }
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_page_move_remaps_frames)
+{
+    if (!test_range_free(PAGE_TEST_SRC, 2) || !test_range_free(PAGE_TEST_DST, 2))
+    {
+        return TEST_SKIP;
+    }
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT(map_test_pages(PAGE_TEST_SRC, 2));
+
+    page_directory_t* dir = vmm_get_current_directory();
+    const uint32_t frame = vmm_get_physical_address(dir, PAGE_TEST_SRC + PAGE_SIZE);
+    uint8_t* src = (uint8_t*)PTR_FROM_U32(PAGE_TEST_SRC);
+    memset(src, 0x5A, 2 * PAGE_SIZE);
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+
+    // kernel pages never move: above user space or mapped without PAGE_USER
+    msg.page_addr = KERNEL_VIRTUAL_BASE;
+    msg.page_count = 1;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK | IPC_MOVE), -1);
+    const uint32_t first = vmm_get_physical_address(dir, PAGE_TEST_SRC);
+    TEST_ASSERT_EQ(vmm_map_page(dir, PAGE_TEST_SRC, first, PAGE_PRESENT | PAGE_WRITE), 0);
+    msg.page_addr = PAGE_TEST_SRC;
+    msg.page_count = 2;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK | IPC_MOVE), -1);
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, PAGE_TEST_SRC + PAGE_SIZE), frame);
+    TEST_ASSERT_EQ(vmm_map_page(dir, PAGE_TEST_SRC, first, PAGE_PRESENT | PAGE_WRITE | PAGE_USER), 0);
+
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK | IPC_MOVE), 0);
+    TEST_ASSERT(test_range_free(PAGE_TEST_SRC, 2));
+
+    // a window that is too small leaves the message queued
+    memset(&msg, 0, sizeof(msg));
+    msg.page_addr = PAGE_TEST_DST;
+    msg.page_count = 1;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), -3);
+
+    msg.page_count = 2;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg.page_addr, PAGE_TEST_DST);
+    TEST_ASSERT_EQ(msg.page_count, 2);
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, PAGE_TEST_DST + PAGE_SIZE), frame);
+
+    const uint8_t* dst = (const uint8_t*)PTR_FROM_U32(PAGE_TEST_DST);
+    TEST_ASSERT_EQ(dst[0], 0x5A);
+    TEST_ASSERT_EQ(dst[2 * PAGE_SIZE - 1], 0x5A);
+
+    unmap_test_pages(PAGE_TEST_DST, 2);
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_page_share_copy_on_write)
+{
+    if (!test_range_free(PAGE_TEST_SRC, 1) || !test_range_free(PAGE_TEST_DST, 1))
+    {
+        return TEST_SKIP;
+    }
+    const int port = port_create(1);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT(map_test_pages(PAGE_TEST_SRC, 1));
+
+    page_directory_t* dir = vmm_get_current_directory();
+    const uint32_t frame = vmm_get_physical_address(dir, PAGE_TEST_SRC);
+    uint8_t* src = (uint8_t*)PTR_FROM_U32(PAGE_TEST_SRC);
+    src[0] = 'A';
+
+    struct message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.page_addr = PAGE_TEST_SRC;
+    msg.page_count = 1;
+    TEST_ASSERT_EQ(msg_send(port, &msg, IPC_NONBLOCK | IPC_SHARE), 0);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.page_addr = PAGE_TEST_DST;
+    msg.page_count = 1;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, PAGE_TEST_DST), frame);
+
+    // both sides read the same frame, the first writer gets a copy
+    TEST_ASSERT(vmm_check_user_ptr(src, 1, true));
+    TEST_ASSERT_NEQ(vmm_get_physical_address(dir, PAGE_TEST_SRC), frame);
+    src[0] = 'B';
+
+    const uint8_t* dst = (const uint8_t*)PTR_FROM_U32(PAGE_TEST_DST);
+    TEST_ASSERT_EQ(dst[0], 'A');
+
+    // the last holder writes in place
+    TEST_ASSERT(vmm_check_user_ptr(dst, 1, true));
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, PAGE_TEST_DST), frame);
+
+    unmap_test_pages(PAGE_TEST_SRC, 1);
+    unmap_test_pages(PAGE_TEST_DST, 1);
+    port_destroy(port);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_call_returns_reply)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    call_port = port_create(current->pid);
+    TEST_ASSERT_GE(call_port, 0);
+    forged_reply = 0;
+
+    const struct task* server = thread_create(FUNC_PTR_TO_U32(call_server), 3, current->priority);
+    TEST_ASSERT_NOT_NULL(server);
+    const tid_t server_id = server->id;
+
+    struct message msg;
+    struct message reply;
+    memset(&msg, 0, sizeof(msg));
+    msg.len = 1;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        msg.data[0] = (uint8_t)(i * 10);
+        memset(&reply, 0, sizeof(reply));
+        TEST_ASSERT_EQ(ipc_call(call_port, &msg, &reply), 0);
+        TEST_ASSERT_EQ(reply.len, 1);
+        TEST_ASSERT_EQ(reply.data[0], i * 10 + 1);
+        TEST_ASSERT_EQ(reply.sender, current->pid);
+    }
+
+    // a thread not serving the call could not answer in the server's place
+    TEST_ASSERT_EQ(forged_reply, -1);
+
+    // the server drops the next request by destroying the port
+    TEST_ASSERT_EQ(ipc_call(call_port, &msg, &reply), -1);
+    TEST_ASSERT_EQ(thread_join(server_id, NULL), 0);
+    TEST_ASSERT_EQ(ipc_reply(call_port, &msg), -1);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_suite_percentiles_nearest_rank)
+{
+    static uint32_t samples[100];
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        samples[i] = (i * 37) % 100 + 1;
+    }
+    struct ipc_suite_stats s;
+    ipc_suite_summarize(samples, 100, &s);
+    TEST_ASSERT_EQ(s.samples, 100);
+    TEST_ASSERT_EQ(s.min, 1);
+    TEST_ASSERT_EQ(s.median, 50);
+    TEST_ASSERT_EQ(s.p99, 99);
+    TEST_ASSERT_EQ(s.max, 100);
+
+    ipc_suite_summarize(samples, 1, &s);
+    TEST_ASSERT_EQ(s.median, samples[0]);
+    TEST_ASSERT_EQ(s.p99, samples[0]);
+    ipc_suite_summarize(samples, 0, &s);
+    TEST_ASSERT_EQ(s.samples, 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(ipc_suite_fan_runs_keep_order)
+{
+    struct ipc_suite_stats s;
+    TEST_ASSERT_EQ(ipc_suite_fan_in(IPC_SUITE_MAX_THREADS, 256, 2, &s), 0);
+    TEST_ASSERT_EQ(s.samples, 2);
+    TEST_ASSERT_EQ(ipc_suite_fan_out(IPC_SUITE_MAX_THREADS, 256, 2, &s), 0);
+    TEST_ASSERT_EQ(s.samples, 2);
+    TEST_ASSERT_EQ(ipc_suite_full_queue(1, 200, &s), 0);
+    TEST_ASSERT_EQ(ipc_suite_size(MAX_MSG_SIZE, 10, 100, &s), 0);
+    TEST_ASSERT(s.min <= s.median && s.median <= s.p99 && s.p99 <= s.max);
+    return TEST_PASS;
+}
+
 static struct test_case ipc_cases[] = {
         TEST_ENTRY(ipc_port_create_success),
         TEST_ENTRY(ipc_port_create_multiple),
@@ -152,13 +1001,35 @@ static struct test_case ipc_cases[] = {
         TEST_ENTRY(ipc_msg_send_invalid_port),
         TEST_ENTRY(ipc_msg_receive_invalid_port),
         TEST_ENTRY(ipc_port_reuse_after_destroy),
+        TEST_ENTRY(ipc_priority_inherit_on_send),
+        TEST_ENTRY(ipc_priority_inherit_until_reply),
+        TEST_ENTRY(ipc_priority_reply_lends_nothing),
+        TEST_ENTRY(ipc_queue_allocated_on_first_send),
+        TEST_ENTRY(ipc_queue_limits_bytes_and_messages),
+        TEST_ENTRY(ipc_queue_records_wrap),
+        TEST_ENTRY(ipc_batch_send_receive_drains_queue),
+        TEST_ENTRY(ipc_batch_send_stops_when_full),
+        TEST_ENTRY(ipc_port_set_reports_ready_ports),
+        TEST_ENTRY(ipc_port_set_wait_times_out),
+        TEST_ENTRY(ipc_port_set_wakes_on_send),
+        TEST_ENTRY(ipc_notify_coalesces_badges),
+        TEST_ENTRY(ipc_notify_bypasses_full_queue),
+        TEST_ENTRY(ipc_registry_register_lookup),
+        TEST_ENTRY(ipc_registry_foreign_destroy),
+        TEST_ENTRY(ipc_registry_survives_removals),
+        TEST_ENTRY(ipc_port_create_until_full),
+        TEST_ENTRY(ipc_page_move_remaps_frames),
+        TEST_ENTRY(ipc_page_share_copy_on_write),
+        TEST_ENTRY(ipc_call_returns_reply),
+        TEST_ENTRY(ipc_suite_percentiles_nearest_rank),
+        TEST_ENTRY(ipc_suite_fan_runs_keep_order),
         TEST_SUITE_END
 };
 
 static struct test_suite ipc_suite = {
         .name = "IPC Tests",
         .cases = ipc_cases,
-        .count = 11
+        .count = 33
 };
 
 struct test_suite* test_ipc_get_suite(void)
@@ -0,0 +1,114 @@
+#include "test_pipe.h"
+#include "bench_ipc.h"
+#include "../../kernel/ipc/pipe.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/include/string.h"
+
+// stands in for a forked child; no task ever gets this PID
+#define PIPE_TEST_CHILD ((pid_t)0x7FFFFFF0)
+
+static uint8_t pipe_buf[PIPE_SIZE + 256];
+
+TEST_CASE(pipe_write_then_read_to_eof)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    const pid_t pid = current->pid;
+    int fds[2];
+    TEST_ASSERT_EQ(pipe_create(pid, fds, 0), 0);
+    TEST_ASSERT_NEQ(fds[0], fds[1]);
+
+    const char* text = "streamed through the ring";
+    const uint32_t len = strlen(text);
+    TEST_ASSERT_EQ(pipe_write(pid, fds[1], text, len), (int)len);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, 8), 8);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf + 8, sizeof(pipe_buf) - 8), (int)len - 8);
+    TEST_ASSERT_MEM_EQ(pipe_buf, text, len);
+
+    // ends only work in their own direction
+    TEST_ASSERT_EQ(pipe_write(pid, fds[0], text, 1), -1);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[1], pipe_buf, 1), -1);
+
+    TEST_ASSERT_EQ(pipe_close(pid, fds[1]), 0);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, 1), 0);
+    TEST_ASSERT_EQ(pipe_close(pid, fds[0]), 0);
+    TEST_ASSERT_EQ(pipe_close(pid, fds[0]), -1);
+    return TEST_PASS;
+}
+
+TEST_CASE(pipe_nonblocking_writes_partially)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    const pid_t pid = current->pid;
+    int fds[2];
+    TEST_ASSERT_EQ(pipe_create(pid, fds, PIPE_NONBLOCK), 0);
+
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, 1), -3);
+    memset(pipe_buf, 0x5A, sizeof(pipe_buf));
+    TEST_ASSERT_EQ(pipe_write(pid, fds[1], pipe_buf, sizeof(pipe_buf)), PIPE_SIZE);
+    TEST_ASSERT_EQ(pipe_write(pid, fds[1], pipe_buf, 1), -3);
+
+    // the ring wraps: free a little at the front and fill it again
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, 100), 100);
+    TEST_ASSERT_EQ(pipe_write(pid, fds[1], pipe_buf, 200), 100);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, sizeof(pipe_buf)), PIPE_SIZE);
+    TEST_ASSERT_EQ(pipe_buf[PIPE_SIZE - 1], 0x5A);
+
+    TEST_ASSERT_EQ(pipe_close(pid, fds[0]), 0);
+    TEST_ASSERT_EQ(pipe_write(pid, fds[1], pipe_buf, 1), -2);
+    TEST_ASSERT_EQ(pipe_close(pid, fds[1]), 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(pipe_fork_shares_ends)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    const pid_t pid = current->pid;
+    int fds[2];
+    TEST_ASSERT_EQ(pipe_create(pid, fds, PIPE_NONBLOCK), 0);
+    TEST_ASSERT_EQ(pipe_fork(pid, PIPE_TEST_CHILD), 0);
+
+    // the child writes through its copy of the descriptor
+    TEST_ASSERT_EQ(pipe_write(PIPE_TEST_CHILD, fds[1], "hi", 2), 2);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, sizeof(pipe_buf)), 2);
+
+    // the child still holds a write end, so no end of file yet
+    TEST_ASSERT_EQ(pipe_close(pid, fds[1]), 0);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, 1), -3);
+    pipe_exit(PIPE_TEST_CHILD);
+    TEST_ASSERT_EQ(pipe_read(pid, fds[0], pipe_buf, 1), 0);
+    TEST_ASSERT_EQ(pipe_write(PIPE_TEST_CHILD, fds[1], "x", 1), -1);
+
+    TEST_ASSERT_EQ(pipe_close(pid, fds[0]), 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(pipe_streams_between_threads)
+{
+    struct ipc_bench_result r;
+    TEST_ASSERT_EQ(ipc_bench_pipe(1000, 200000, &r), 0);
+    TEST_ASSERT_EQ(r.messages, 200);
+    TEST_ASSERT_EQ(ipc_bench_pipe(IPC_BENCH_PIPE_CHUNK_MAX, 4 * PIPE_SIZE + 17, &r), 0);
+    return TEST_PASS;
+}
+
+static struct test_case pipe_cases[] = {
+        TEST_ENTRY(pipe_write_then_read_to_eof),
+        TEST_ENTRY(pipe_nonblocking_writes_partially),
+        TEST_ENTRY(pipe_fork_shares_ends),
+        TEST_ENTRY(pipe_streams_between_threads),
+        TEST_SUITE_END
+};
+
+static struct test_suite pipe_suite = {
+        .name = "Pipe Tests",
+        .cases = pipe_cases,
+        .count = 4
+};
+
+struct test_suite* test_pipe_get_suite(void)
+{
+    return &pipe_suite;
+}
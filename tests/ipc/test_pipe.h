@@ -0,0 +1,20 @@
+#ifndef TEST_PIPE_H
+#define TEST_PIPE_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the pipe test suite
+ * @return Pointer to the pipe test suite
+ */
+struct test_suite* test_pipe_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#include "test_stack.h"
+#include "../../kernel/mm/stack.h"
+#include "../../kernel/mm/vmm.h"
+#include "../../kernel/mm/heap.h"
+#include "../../kernel/sched/sched.h"
+
+TEST_CASE(stack_alloc_kernel)
+{
+    const uint32_t base = stack_alloc(STACK_KERNEL);
+    TEST_ASSERT_NEQ(base, 0);
+    TEST_ASSERT_EQ(base & (PAGE_SIZE - 1), 0);
+    TEST_ASSERT_TRUE(vmm_is_mapped(vmm_get_kernel_directory(), base));
+    TEST_ASSERT_TRUE(vmm_is_mapped(vmm_get_kernel_directory(), base + KERNEL_STACK_SIZE - 1));
+    stack_free(STACK_KERNEL, base);
+    return TEST_PASS;
+}
+
+TEST_CASE(stack_guard_page_unmapped)
+{
+    const uint32_t base = stack_alloc(STACK_KERNEL);
+    TEST_ASSERT_NEQ(base, 0);
+    TEST_ASSERT_FALSE(vmm_is_mapped(vmm_get_kernel_directory(), base - STACK_GUARD_SIZE));
+    stack_free(STACK_KERNEL, base);
+    return TEST_PASS;
+}
+
+TEST_CASE(stack_user_pool_is_user_accessible)
+{
+    const uint32_t base = stack_alloc(STACK_USER);
+    TEST_ASSERT_NEQ(base, 0);
+    TEST_ASSERT_LT(base, KERNEL_VIRTUAL_BASE);
+    TEST_ASSERT_FALSE(vmm_is_mapped(vmm_get_kernel_directory(), base - STACK_GUARD_SIZE));
+    stack_free(STACK_USER, base);
+    return TEST_PASS;
+}
+
+TEST_CASE(stack_free_is_cached)
+{
+    const uint32_t base = stack_alloc(STACK_KERNEL);
+    TEST_ASSERT_NEQ(base, 0);
+    stack_free(STACK_KERNEL, base);
+
+    struct stack_stats before;
+    stack_get_stats(STACK_KERNEL, &before);
+    const uint32_t again = stack_alloc(STACK_KERNEL);
+    struct stack_stats after;
+    stack_get_stats(STACK_KERNEL, &after);
+
+    TEST_ASSERT_EQ(again, base);
+    TEST_ASSERT_EQ(after.cache_hits, before.cache_hits + 1);
+    TEST_ASSERT_EQ(after.mapped_pages, before.mapped_pages);
+    stack_free(STACK_KERNEL, again);
+    return TEST_PASS;
+}
+
+TEST_CASE(stack_distinct_slots)
+{
+    const uint32_t a = stack_alloc(STACK_KERNEL);
+    const uint32_t b = stack_alloc(STACK_KERNEL);
+    TEST_ASSERT_NEQ(a, 0);
+    TEST_ASSERT_NEQ(b, 0);
+    TEST_ASSERT_NEQ(a, b);
+    TEST_ASSERT_GE(b > a ? b - a : a - b, KERNEL_STACK_SIZE + STACK_GUARD_SIZE);
+    stack_free(STACK_KERNEL, a);
+    stack_free(STACK_KERNEL, b);
+    return TEST_PASS;
+}
+
+static void stack_test_entry(void)
+{
+    while (1)
+    {
+        sched_yield();
+    }
+}
+
+TEST_CASE(stack_task_churn_skips_heap)
+{
+    const struct task* warm = task_create(stack_test_entry, 0, true);
+    TEST_ASSERT_NOT_NULL(warm);
+    task_destroy(warm->id);
+
+    const size_t used_before = heap_get_used();
+    for (int i = 0; i < 8; i++)
+    {
+        const struct task* t = task_create(stack_test_entry, 0, true);
+        TEST_ASSERT_NOT_NULL(t);
+        task_destroy(t->id);
+    }
+    TEST_ASSERT_EQ(heap_get_used(), used_before);
+    return TEST_PASS;
+}
+
+static struct test_case stack_cases[] = {
+        TEST_ENTRY(stack_alloc_kernel),
+        TEST_ENTRY(stack_guard_page_unmapped),
+        TEST_ENTRY(stack_user_pool_is_user_accessible),
+        TEST_ENTRY(stack_free_is_cached),
+        TEST_ENTRY(stack_distinct_slots),
+        TEST_ENTRY(stack_task_churn_skips_heap),
+        TEST_SUITE_END
+};
+
+static struct test_suite stack_suite = {
+        .name = "Stack Cache Tests",
+        .cases = stack_cases,
+        .count = 6
+};
+
+struct test_suite* test_stack_get_suite(void)
+{
+    return &stack_suite;
+}
@@ -0,0 +1,20 @@
+#ifndef TEST_STACK_H
+#define TEST_STACK_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the stack cache test suite
+ * @return Pointer to the stack cache test suite
+ */
+struct test_suite* test_stack_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+#include "bench_futex.h"
+#include "../../kernel/sched/futex.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/include/cast.h"
+
+// the library runs in kernel threads here, on the kernel side of the calls
+#define SYNC_FUTEX_WAIT(addr, expected, ms) futex_wait(PTR_TO_U32(addr), (expected), (ms))
+#define SYNC_FUTEX_WAKE(addr, count) futex_wake(PTR_TO_U32(addr), (uint32_t)(count))
+#include "../../user/lib/sync.h"
+
+// work done while holding the lock, long enough to be preempted in
+#define BENCH_CRITICAL_SPINS 64
+
+static struct mutex bench_mutex = MUTEX_INIT;
+static volatile uint32_t bench_spin = 0;
+static volatile uint32_t bench_counter = 0;
+static volatile uint32_t bench_rounds = 0;
+static volatile bool bench_go = false;
+static volatile bool bench_abort = false;
+
+static struct semaphore ping = SEMAPHORE_INIT(0);
+static struct semaphore pong = SEMAPHORE_INIT(0);
+
+static void bench_critical(void)
+{
+    const uint32_t v = bench_counter;
+    for (volatile uint32_t i = 0; i < BENCH_CRITICAL_SPINS; i++)
+    {
+    }
+    bench_counter = v + 1;
+}
+
+static void lock_worker(const uint32_t lock)
+{
+    while (!bench_go && !bench_abort)
+    {
+        sched_yield();
+    }
+    for (uint32_t i = 0; i < bench_rounds && !bench_abort; i++)
+    {
+        if (lock == FUTEX_BENCH_MUTEX)
+        {
+            mutex_lock(&bench_mutex);
+            bench_critical();
+            mutex_unlock(&bench_mutex);
+        }
+        else
+        {
+            while (__sync_lock_test_and_set(&bench_spin, 1))
+            {
+                sched_yield();
+            }
+            bench_critical();
+            __sync_lock_release(&bench_spin);
+        }
+    }
+    thread_exit(0);
+}
+
+static void handoff_partner(const uint32_t rounds)
+{
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        sem_wait(&ping);
+        sem_post(&pong);
+    }
+    thread_exit(0);
+}
+
+static void fill_traffic(struct futex_bench_result* out, const struct futex_stats* before)
+{
+    struct futex_stats after;
+    futex_get_stats(&after);
+    out->sleeps = after.waits - before->waits;
+    out->wakes = after.wakes - before->wakes;
+}
+
+int futex_bench_lock(const uint32_t lock, const uint32_t threads, const uint32_t rounds,
+                     struct futex_bench_result* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || lock > FUTEX_BENCH_SPIN || rounds == 0 ||
+        threads == 0 || threads > FUTEX_BENCH_MAX_THREADS)
+    {
+        return -1;
+    }
+
+    mutex_init(&bench_mutex);
+    bench_spin = 0;
+    bench_counter = 0;
+    bench_rounds = rounds;
+    bench_go = false;
+    bench_abort = false;
+
+    tid_t workers[FUTEX_BENCH_MAX_THREADS];
+    uint32_t created = 0;
+    for (; created < threads; created++)
+    {
+        const struct task* t = thread_create(FUNC_PTR_TO_U32(lock_worker), lock, current->priority);
+        if (!t)
+        {
+            break;
+        }
+        workers[created] = t->id;
+    }
+    if (created < threads)
+    {
+        bench_abort = true;
+        for (uint32_t i = 0; i < created; i++)
+        {
+            thread_join(workers[i], NULL);
+        }
+        return -1;
+    }
+
+    struct futex_stats before;
+    futex_get_stats(&before);
+    const uint64_t start = ktime_get_ns();
+    bench_go = true;
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        thread_join(workers[i], NULL);
+    }
+    const uint64_t ns = ktime_get_ns() - start;
+
+    out->threads = threads;
+    out->ops = threads * rounds;
+    out->ns = ns;
+    out->ns_per_op = (uint32_t)(ns / out->ops);
+    out->consistent = bench_counter == out->ops;
+    fill_traffic(out, &before);
+    return 0;
+}
+
+int futex_bench_handoff(const uint32_t rounds, struct futex_bench_result* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || !current || rounds == 0)
+    {
+        return -1;
+    }
+
+    sem_init(&ping, 0);
+    sem_init(&pong, 0);
+    const struct task* partner = thread_create(FUNC_PTR_TO_U32(handoff_partner), rounds, current->priority);
+    if (!partner)
+    {
+        return -1;
+    }
+    const tid_t partner_id = partner->id;
+
+    struct futex_stats before;
+    futex_get_stats(&before);
+    const uint64_t start = ktime_get_ns();
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        sem_post(&ping);
+        sem_wait(&pong);
+    }
+    const uint64_t ns = ktime_get_ns() - start;
+    thread_join(partner_id, NULL);
+
+    out->threads = 2;
+    out->ops = rounds;
+    out->ns = ns;
+    out->ns_per_op = (uint32_t)(ns / rounds);
+    out->consistent = ping.count == 0 && pong.count == 0;
+    fill_traffic(out, &before);
+    return 0;
+}
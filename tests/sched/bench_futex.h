@@ -0,0 +1,67 @@
+#ifndef BENCH_FUTEX_H
+#define BENCH_FUTEX_H
+
+#include "../../kernel/include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Most worker threads futex_bench_lock runs
+ */
+#define FUTEX_BENCH_MAX_THREADS 8
+
+/**
+ * @brief Lock futex_bench_lock measures
+ */
+#define FUTEX_BENCH_MUTEX 0
+#define FUTEX_BENCH_SPIN  1
+
+/**
+ * @brief Outcome of one futex benchmark run \struct futex_bench_result
+ * @details sleeps and wakes are the futex waits and woken tasks during the
+ *          run; consistent is false if the lock let two holders in.
+ */
+struct futex_bench_result
+{
+    uint32_t threads;
+    uint32_t ops;
+    uint64_t ns;
+    uint32_t ns_per_op;
+    uint32_t sleeps;
+    uint32_t wakes;
+    bool consistent;
+};
+
+/**
+ * @brief Measure a lock under contention
+ * @details Every thread takes the lock rounds times around a short critical
+ *          section that bumps a shared counter. FUTEX_BENCH_MUTEX uses the
+ *          mutex of user/lib/sync.h on the kernel futex calls;
+ *          FUTEX_BENCH_SPIN is the baseline, a test-and-set lock that calls
+ *          sched_yield() while the lock is taken.
+ * @param lock FUTEX_BENCH_MUTEX or FUTEX_BENCH_SPIN
+ * @param threads Worker threads, 1 to FUTEX_BENCH_MAX_THREADS
+ * @param rounds Lock acquisitions per thread
+ * @param out Filled with the time per acquisition and the futex traffic
+ * @return 0 on success, -1 if a worker thread could not be created
+ */
+int futex_bench_lock(uint32_t lock, uint32_t threads, uint32_t rounds, struct futex_bench_result* out);
+
+/**
+ * @brief Measure sleep/wake round trips between two threads
+ * @details The caller and a partner thread bounce a token through two
+ *          semaphores of user/lib/sync.h, so every round costs two futex
+ *          wakes and two sleeps.
+ * @param rounds Number of round trips
+ * @param out Filled with the time per round trip and the futex traffic
+ * @return 0 on success, -1 if the partner thread could not be created
+ */
+int futex_bench_handoff(uint32_t rounds, struct futex_bench_result* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,185 @@
+#include "test_deadline.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/arch/i686/smp.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/sys/timer.h"
+#include "../../kernel/include/cast.h"
+
+#define DL_RUNTIME_US       4000
+#define DL_PERIOD_US        20000
+#define DL_JOBS             20
+#define DL_WORK_ITERATIONS  20000
+#define DL_LOAD_PRIORITY    100
+#define DL_LOAD_LIMIT_NS    2000000000ull
+#define DL_MAX_LOAD         MAX_CPUS
+
+static volatile bool load_stop = false;
+static volatile uint32_t jobs_done = 0;
+static volatile uint32_t jobs_missed = 0;
+static volatile uint32_t work_sink = 0;
+
+static void spin_entry(void)
+{
+    while (1)
+    {
+        sched_yield();
+    }
+}
+
+static void busy_work(const uint32_t iterations)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        acc = (acc << 1) ^ (acc >> 3) ^ i;
+    }
+    work_sink += acc & 1;
+}
+
+// CPU-bound load above every fixed priority; bounded so a broken deadline
+// class cannot hang the system
+static void load_thread(const uint32_t arg)
+{
+    (void)arg;
+    // let the test finish spawning before the CPUs are taken
+    timer_sleep(2);
+
+    const uint64_t until = ktime_get_ns() + DL_LOAD_LIMIT_NS;
+    while (!load_stop && ktime_get_ns() < until)
+    {
+        busy_work(1000);
+    }
+    thread_exit(0);
+}
+
+static void periodic_thread(const uint32_t jobs)
+{
+    const struct task* self = sched_get_current();
+    if (sched_set_deadline(self->id, DL_RUNTIME_US, DL_PERIOD_US, DL_PERIOD_US) == 0)
+    {
+        for (uint32_t i = 0; i < jobs; i++)
+        {
+            busy_work(DL_WORK_ITERATIONS);
+            jobs_done++;
+            sched_dl_yield();
+        }
+        jobs_missed = self->dl.nr_misses;
+    }
+    load_stop = true;
+    thread_exit(0);
+}
+
+TEST_CASE(dl_admission_control)
+{
+    const uint32_t base = sched_get_dl_bandwidth();
+    const struct task* t = task_create(spin_entry, 1, true);
+    TEST_ASSERT_NOT_NULL(t);
+
+    // runtime <= deadline <= period
+    TEST_ASSERT_EQ(sched_set_deadline(t->id, 3000, 2000, 10000), -1);
+    TEST_ASSERT_EQ(sched_set_deadline(t->id, 1000, 20000, 10000), -1);
+    TEST_ASSERT_EQ(sched_set_deadline(99999, 1000, 10000, 10000), -1);
+
+    // a full CPU is more than the class may reserve
+    TEST_ASSERT_EQ(sched_set_deadline(t->id, 10000, 10000, 10000), -1);
+    TEST_ASSERT_EQ(sched_get_dl_bandwidth(), base);
+
+    TEST_ASSERT_EQ(sched_set_deadline(t->id, 1000, 10000, 10000), 0);
+    TEST_ASSERT_EQ(sched_get_dl_bandwidth(), base + 100000);
+    TEST_ASSERT_EQ(t->dl.runtime, 1000000);
+
+    TEST_ASSERT_EQ(sched_set_deadline(t->id, 0, 0, 0), 0);
+    TEST_ASSERT_EQ(sched_get_dl_bandwidth(), base);
+
+    // exiting hands the reservation back
+    TEST_ASSERT_EQ(sched_set_deadline(t->id, 2000, 10000, 10000), 0);
+    TEST_ASSERT_EQ(sched_get_dl_bandwidth(), base + 200000);
+    task_exit(t->id, 0);
+    TEST_ASSERT_EQ(sched_get_dl_bandwidth(), base);
+    task_destroy(t->id);
+    return TEST_PASS;
+}
+
+TEST_CASE(dl_overrun_counts_miss)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_EQ(sched_set_deadline(current->id, 1000, 1000, 100000), 0);
+
+    // run well past the 1 ms deadline before ending the job
+    const uint64_t until = ktime_get_ns() + 30000000ull;
+    while (ktime_get_ns() < until)
+    {
+        busy_work(1000);
+    }
+    sched_dl_yield();
+
+    const uint32_t misses = current->dl.nr_misses;
+    const uint64_t lateness = current->dl.max_lateness;
+    TEST_ASSERT_EQ(sched_set_deadline(current->id, 0, 0, 0), 0);
+    TEST_ASSERT_GE(misses, 1);
+    TEST_ASSERT_GT(lateness, 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(dl_meets_deadlines_under_load)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+
+    load_stop = false;
+    jobs_done = 0;
+    jobs_missed = 0;
+
+    // the periodic task sits below the load by fixed priority and only gets
+    // the CPU through its reservation
+    const struct task* periodic = thread_create(FUNC_PTR_TO_U32(periodic_thread), DL_JOBS, current->priority);
+    TEST_ASSERT_NOT_NULL(periodic);
+    const tid_t periodic_id = periodic->id;
+
+    const uint32_t online = smp_get_online_count();
+    const uint32_t loads = online < DL_MAX_LOAD ? online : DL_MAX_LOAD;
+    tid_t load_ids[DL_MAX_LOAD];
+    uint32_t started = 0;
+    const uint64_t start = ktime_get_ns();
+    for (uint32_t i = 0; i < loads; i++)
+    {
+        const struct task* t = thread_create(FUNC_PTR_TO_U32(load_thread), 0, DL_LOAD_PRIORITY);
+        if (t)
+        {
+            load_ids[started++] = t->id;
+        }
+    }
+
+    TEST_ASSERT_EQ(thread_join(periodic_id, NULL), 0);
+    const uint64_t elapsed = ktime_get_ns() - start;
+    for (uint32_t i = 0; i < started; i++)
+    {
+        thread_join(load_ids[i], NULL);
+    }
+
+    TEST_ASSERT_EQ(started, loads);
+    TEST_ASSERT_EQ(jobs_done, DL_JOBS);
+    TEST_ASSERT_EQ(jobs_missed, 0);
+    // finished on its reservation, not once the load gave up
+    TEST_ASSERT_LT(elapsed, DL_LOAD_LIMIT_NS);
+    return TEST_PASS;
+}
+
+static struct test_case deadline_cases[] = {
+        TEST_ENTRY(dl_admission_control),
+        TEST_ENTRY(dl_overrun_counts_miss),
+        TEST_ENTRY(dl_meets_deadlines_under_load),
+        TEST_SUITE_END
+};
+
+static struct test_suite deadline_suite = {
+        .name = "Deadline Scheduling Tests",
+        .cases = deadline_cases,
+        .count = 3
+};
+
+struct test_suite* test_deadline_get_suite(void)
+{
+    return &deadline_suite;
+}
@@ -0,0 +1,20 @@
+#ifndef TEST_DEADLINE_H
+#define TEST_DEADLINE_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the deadline scheduling test suite
+ * @return Pointer to the deadline scheduling test suite
+ */
+struct test_suite* test_deadline_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
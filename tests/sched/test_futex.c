@@ -0,0 +1,103 @@
+#include "test_futex.h"
+#include "bench_futex.h"
+#include "../../kernel/sched/futex.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/include/cast.h"
+
+static volatile uint32_t futex_word = 0;
+static volatile int waiter_ret = 1;
+
+static void futex_waiter(const uint32_t expected)
+{
+    waiter_ret = futex_wait(PTR_TO_U32(&futex_word), expected, FUTEX_WAIT_FOREVER);
+    thread_exit(0);
+}
+
+TEST_CASE(futex_wait_checks_word)
+{
+    futex_word = 5;
+    TEST_ASSERT_EQ(futex_wait(PTR_TO_U32(&futex_word), 4, FUTEX_WAIT_FOREVER), -2);
+    TEST_ASSERT_EQ(futex_wait(PTR_TO_U32(&futex_word) + 1, 5, FUTEX_WAIT_FOREVER), -1);
+    TEST_ASSERT_EQ(futex_wake(PTR_TO_U32(&futex_word), FUTEX_WAKE_ALL), 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(futex_wait_times_out)
+{
+    struct futex_stats before;
+    struct futex_stats after;
+    futex_get_stats(&before);
+    futex_word = 0;
+
+    const uint64_t start = ktime_get_ns();
+    TEST_ASSERT_EQ(futex_wait(PTR_TO_U32(&futex_word), 0, 20), -3);
+    TEST_ASSERT_GE(ktime_get_ns() - start, 10000000ULL);
+
+    futex_get_stats(&after);
+    TEST_ASSERT_EQ(after.timeouts - before.timeouts, 1);
+    TEST_ASSERT_EQ(after.sleeping, before.sleeping);
+    return TEST_PASS;
+}
+
+TEST_CASE(futex_wake_releases_sleeper)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    struct futex_stats before;
+    struct futex_stats s;
+    futex_get_stats(&before);
+    futex_word = 0;
+    waiter_ret = 1;
+
+    const struct task* waiter = thread_create(FUNC_PTR_TO_U32(futex_waiter), 0, current->priority);
+    TEST_ASSERT_NOT_NULL(waiter);
+    const tid_t waiter_id = waiter->id;
+    do
+    {
+        sched_yield();
+        futex_get_stats(&s);
+    } while (s.sleeping == before.sleeping);
+
+    // a wake on another word leaves the sleeper queued
+    static volatile uint32_t other_word = 0;
+    TEST_ASSERT_EQ(futex_wake(PTR_TO_U32(&other_word), 1), 0);
+    futex_word = 1;
+    TEST_ASSERT_EQ(futex_wake(PTR_TO_U32(&futex_word), FUTEX_WAKE_ALL), 1);
+    TEST_ASSERT_EQ(thread_join(waiter_id, NULL), 0);
+    TEST_ASSERT_EQ(waiter_ret, 0);
+
+    futex_get_stats(&s);
+    TEST_ASSERT_EQ(s.sleeping, before.sleeping);
+    return TEST_PASS;
+}
+
+TEST_CASE(futex_sync_library_excludes)
+{
+    struct futex_bench_result r;
+    TEST_ASSERT_EQ(futex_bench_lock(FUTEX_BENCH_MUTEX, 4, 500, &r), 0);
+    TEST_ASSERT(r.consistent);
+    TEST_ASSERT_EQ(r.ops, 2000);
+    TEST_ASSERT_EQ(futex_bench_handoff(100, &r), 0);
+    TEST_ASSERT(r.consistent);
+    return TEST_PASS;
+}
+
+static struct test_case futex_cases[] = {
+        TEST_ENTRY(futex_wait_checks_word),
+        TEST_ENTRY(futex_wait_times_out),
+        TEST_ENTRY(futex_wake_releases_sleeper),
+        TEST_ENTRY(futex_sync_library_excludes),
+        TEST_SUITE_END
+};
+
+static struct test_suite futex_suite = {
+        .name = "Futex Tests",
+        .cases = futex_cases,
+        .count = 4
+};
+
+struct test_suite* test_futex_get_suite(void)
+{
+    return &futex_suite;
+}
@@ -0,0 +1,20 @@
+#ifndef TEST_FUTEX_H
+#define TEST_FUTEX_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the futex test suite
+ * @return Pointer to the futex test suite
+ */
+struct test_suite* test_futex_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
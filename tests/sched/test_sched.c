@@ -1,5 +1,12 @@
 #include "test_sched.h"
 #include "../../kernel/sched/sched.h"
+#include "../../kernel/arch/i686/smp.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/sys/timer.h"
+#include "../../kernel/include/cast.h"
+
+#define PARALLEL_MAX_WORKERS 4
+#define PARALLEL_ITERATIONS  20000000
 
 static volatile int test_task_ran = 0;
 
@@ -12,6 +19,26 @@ static void dummy_task_entry(void)
     }
 }
 
+static volatile uint32_t thread_arg_seen = 0;
+
+static void thread_entry(void* arg)
+{
+    thread_arg_seen = PTR_TO_U32(arg);
+    thread_exit(7);
+}
+
+static volatile uint32_t parallel_sink = 0;
+
+static void parallel_worker(const uint32_t iterations)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        acc = (acc << 1) ^ (acc >> 3) ^ i;
+    }
+    __sync_fetch_and_add(&parallel_sink, acc & 1);
+}
+
 TEST_CASE(sched_get_current_not_null)
 {
     const struct task* current = sched_get_current();
@@ -105,6 +132,187 @@ TEST_CASE(sched_task_count)
     return TEST_PASS;
 }
 
+TEST_CASE(sched_thread_shares_pid)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    const uint32_t before = sched_get_thread_count(current->pid);
+    const struct task* t = thread_create(FUNC_PTR_TO_U32(thread_entry), 0, 0);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_EQ(t->pid, current->pid);
+    TEST_ASSERT_NEQ(t->id, current->id);
+    TEST_ASSERT_TRUE(t->is_thread);
+    TEST_ASSERT_NEQ(t->kernel_stack, current->kernel_stack);
+    TEST_ASSERT_EQ(sched_get_thread_count(current->pid), before + 1);
+    TEST_ASSERT_EQ(task_find(current->pid), current);
+    task_destroy(t->id);
+    TEST_ASSERT_EQ(sched_get_thread_count(current->pid), before);
+    return TEST_PASS;
+}
+
+TEST_CASE(sched_thread_join_exit_code)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    thread_arg_seen = 0;
+    const struct task* t = thread_create(FUNC_PTR_TO_U32(thread_entry), 0x1234, current->priority);
+    TEST_ASSERT_NOT_NULL(t);
+    const tid_t tid = t->id;
+    int32_t status = 0;
+    TEST_ASSERT_EQ(thread_join(tid, &status), 0);
+    TEST_ASSERT_EQ(status, 7);
+    TEST_ASSERT_EQ(thread_arg_seen, 0x1234);
+    TEST_ASSERT_NULL(thread_find(tid));
+    return TEST_PASS;
+}
+
+TEST_CASE(sched_thread_join_invalid)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_EQ(thread_join(current->id, NULL), -1);
+    TEST_ASSERT_EQ(thread_join(99999, NULL), -1);
+    return TEST_PASS;
+}
+
+TEST_CASE(sched_runnable_count)
+{
+    const uint32_t before = sched_get_runnable_count();
+    TEST_ASSERT_GE(before, 1);
+    const struct task* t = task_create(dummy_task_entry, 5, true);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_EQ(sched_get_runnable_count(), before + 1);
+    task_exit(t->id, 0);
+    TEST_ASSERT_EQ(sched_get_runnable_count(), before);
+    task_destroy(t->id);
+    return TEST_PASS;
+}
+
+static bool rq_contains(struct cpu* c, const struct task* t)
+{
+    bool found = false;
+    const uint32_t flags = spin_lock_irqsave(&c->rq_lock);
+    for (const struct task* q = c->rq_head; q; q = q->rq_next)
+    {
+        if (q == t)
+        {
+            found = true;
+        }
+    }
+    spin_unlock_irqrestore(&c->rq_lock, flags);
+    return found;
+}
+
+TEST_CASE(sched_run_queue_membership)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+    TEST_ASSERT_FALSE(current->queued);
+
+    const struct task* t = task_create(dummy_task_entry, 5, true);
+    TEST_ASSERT_NOT_NULL(t);
+    const struct cpu* home = smp_get_cpu(t->cpu);
+    TEST_ASSERT_NOT_NULL(home);
+    TEST_ASSERT_TRUE(home->online);
+
+    // a dead task is on no run queue, and idle tasks never are
+    task_exit(t->id, 0);
+    TEST_ASSERT_FALSE(t->queued);
+    for (uint32_t i = 0; i < MAX_CPUS; i++)
+    {
+        struct cpu* c = smp_get_cpu(i);
+        if (c && c->online)
+        {
+            TEST_ASSERT_FALSE(rq_contains(c, t));
+            TEST_ASSERT_FALSE(c->idle && rq_contains(c, c->idle));
+        }
+    }
+    task_destroy(t->id);
+    return TEST_PASS;
+}
+
+TEST_CASE(sched_smp_parallel_speedup)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+
+    const uint32_t online = smp_get_online_count();
+    const uint32_t workers = online < PARALLEL_MAX_WORKERS ? online : PARALLEL_MAX_WORKERS;
+    TEST_ASSERT_GE(workers, 1);
+
+    const uint64_t serial_start = ktime_get_ns();
+    for (uint32_t i = 0; i < workers; i++)
+    {
+        parallel_worker(PARALLEL_ITERATIONS);
+    }
+    const uint64_t serial_ns = ktime_get_ns() - serial_start;
+
+    tid_t tids[PARALLEL_MAX_WORKERS];
+    const uint64_t parallel_start = ktime_get_ns();
+    for (uint32_t i = 0; i < workers; i++)
+    {
+        const struct task* t = thread_create(FUNC_PTR_TO_U32(parallel_worker), PARALLEL_ITERATIONS,
+                                             current->priority);
+        TEST_ASSERT_NOT_NULL(t);
+        tids[i] = t->id;
+    }
+    for (uint32_t i = 0; i < workers; i++)
+    {
+        int32_t status = -1;
+        TEST_ASSERT_EQ(thread_join(tids[i], &status), 0);
+        TEST_ASSERT_EQ(status, 0);
+    }
+    const uint64_t parallel_ns = ktime_get_ns() - parallel_start;
+
+    // the same work split across CPUs must finish sooner than in series
+    if (online > 1)
+    {
+        TEST_ASSERT_TRUE(parallel_ns < serial_ns);
+    }
+    return TEST_PASS;
+}
+
+TEST_CASE(sched_stats_count_switches)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+
+    const uint32_t voluntary = current->stats.nr_voluntary;
+    const uint32_t switches = sched_get_switch_count();
+    timer_sleep(2);
+
+    // blocking in timer_sleep is a voluntary switch away and back
+    TEST_ASSERT_GT(current->stats.nr_voluntary, voluntary);
+    TEST_ASSERT_GE(sched_get_switch_count(), switches + 2);
+    TEST_ASSERT_GT(current->stats.run_cycles, 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(sched_stats_wakeup_histogram)
+{
+    const struct task* current = sched_get_current();
+    TEST_ASSERT_NOT_NULL(current);
+
+    const uint32_t wakeups = current->stats.nr_wakeups;
+    timer_sleep(2);
+    TEST_ASSERT_GT(current->stats.nr_wakeups, wakeups);
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < SCHED_LAT_BUCKETS; i++)
+    {
+        total += current->stats.wakeup_hist[i];
+    }
+    TEST_ASSERT_EQ(total, current->stats.nr_wakeups);
+    TEST_ASSERT_GT(current->stats.max_wakeup_latency, 0);
+
+    struct sched_global_stats g;
+    sched_get_global_stats(&g);
+    TEST_ASSERT_GE(g.wakeups, current->stats.nr_wakeups);
+    TEST_ASSERT_GE(g.wakeup_max_cycles, current->stats.max_wakeup_latency);
+    TEST_ASSERT_GT(g.schedule_calls, 0);
+    return TEST_PASS;
+}
+
 static struct test_case sched_cases[] = {
         TEST_ENTRY(sched_get_current_not_null),
         TEST_ENTRY(sched_current_is_running),
@@ -116,13 +324,21 @@ static struct test_case sched_cases[] = {
         TEST_ENTRY(sched_task_find_invalid),
         TEST_ENTRY(sched_task_exit_zombie),
         TEST_ENTRY(sched_task_count),
+        TEST_ENTRY(sched_thread_shares_pid),
+        TEST_ENTRY(sched_thread_join_exit_code),
+        TEST_ENTRY(sched_thread_join_invalid),
+        TEST_ENTRY(sched_runnable_count),
+        TEST_ENTRY(sched_run_queue_membership),
+        TEST_ENTRY(sched_smp_parallel_speedup),
+        TEST_ENTRY(sched_stats_count_switches),
+        TEST_ENTRY(sched_stats_wakeup_histogram),
         TEST_SUITE_END
 };
 
 static struct test_suite sched_suite = {
         .name = "Scheduler Tests",
         .cases = sched_cases,
-        .count = 11
+        .count = 18
 };
 
 struct test_suite* test_sched_get_suite(void)
@@ -0,0 +1,132 @@
+#include "bench_udrv.h"
+#include "../../kernel/sys/udrv.h"
+#include "../../kernel/ipc/ipc.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/include/string.h"
+#include "../../kernel/include/cast.h"
+
+// a round that takes longer than this counts as a lost interrupt
+#define BENCH_ROUND_TIMEOUT_NS 1000000000ULL
+
+static volatile int driver_port = -1;
+static volatile uint32_t driver_rounds = 0;
+static volatile uint32_t driver_done = 0;
+static volatile uint64_t raised_ns = 0;
+static volatile uint64_t lat_min = 0;
+static volatile uint64_t lat_max = 0;
+static volatile uint64_t lat_sum = 0;
+
+static void raise_bench_irq(void)
+{
+    __asm__ volatile ("int %0" : : "i"(32 + UDRV_BENCH_IRQ));
+}
+
+static void bench_driver(const uint32_t pid)
+{
+    struct message msg;
+    while (driver_done < driver_rounds)
+    {
+        msg.page_count = 0;
+        if (msg_receive(driver_port, &msg, IPC_BLOCK) != 0)
+        {
+            break;
+        }
+        const uint64_t lat = ktime_get_ns() - raised_ns;
+        if (msg.type != MSG_NOTIFY)
+        {
+            continue;
+        }
+        if (lat < lat_min) lat_min = lat;
+        if (lat > lat_max) lat_max = lat;
+        lat_sum += lat;
+        udrv_irq_ack(UDRV_BENCH_IRQ, (pid_t)pid);
+        driver_done++;
+    }
+    thread_exit(0);
+}
+
+int udrv_bench_latency(const uint32_t rounds, struct udrv_bench_result* out)
+{
+    const struct task* current = sched_get_current();
+    if (!out || rounds == 0 || !current || current->pid == 0)
+    {
+        return -1;
+    }
+    const pid_t pid = current->pid;
+
+    const int port = port_create(pid);
+    if (port < 0)
+    {
+        return -1;
+    }
+
+    // the benchmark stands in as the authority only long enough to bind
+    const pid_t authority = udrv_get_authority();
+    udrv_set_authority(pid);
+    const int bound = udrv_irq_bind(UDRV_BENCH_IRQ, port, 0x1, pid);
+    udrv_set_authority(authority);
+    if (bound != 0)
+    {
+        port_destroy(port);
+        return -1;
+    }
+
+    driver_port = port;
+    driver_rounds = rounds;
+    driver_done = 0;
+    lat_min = ~0ULL;
+    lat_max = 0;
+    lat_sum = 0;
+
+    const struct task* driver = thread_create(FUNC_PTR_TO_U32(bench_driver), (uint32_t)pid, current->priority);
+    if (!driver)
+    {
+        udrv_irq_unbind(UDRV_BENCH_IRQ, pid);
+        port_destroy(port);
+        return -1;
+    }
+    const tid_t driver_id = driver->id;
+
+    int ret = 0;
+    for (uint32_t i = 0; i < rounds && ret == 0; i++)
+    {
+        raised_ns = ktime_get_ns();
+        raise_bench_irq();
+
+        // the driver acks before the next round, so the line is open again
+        while (driver_done == i)
+        {
+            if (ktime_get_ns() - raised_ns > BENCH_ROUND_TIMEOUT_NS)
+            {
+                ret = -1;
+                break;
+            }
+            sched_yield();
+        }
+    }
+
+    struct udrv_irq_stats s;
+    udrv_irq_get_stats(UDRV_BENCH_IRQ, &s);
+    if (ret != 0)
+    {
+        // release the driver from its receive
+        driver_rounds = 0;
+        port_notify(port, 0x1);
+    }
+    thread_join(driver_id, NULL);
+    udrv_irq_unbind(UDRV_BENCH_IRQ, pid);
+    port_destroy(port);
+
+    memset(out, 0, sizeof(*out));
+    out->rounds = driver_done;
+    out->raised = s.raised;
+    out->acks = s.acks;
+    if (driver_done)
+    {
+        out->min_ns = lat_min;
+        out->max_ns = lat_max;
+        out->avg_ns = lat_sum / driver_done;
+    }
+    return ret;
+}
@@ -0,0 +1,48 @@
+#ifndef BENCH_UDRV_H
+#define BENCH_UDRV_H
+
+#include "../../kernel/include/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief IRQ line the benchmark binds; nothing is wired to it under QEMU
+ */
+#define UDRV_BENCH_IRQ 5
+
+/**
+ * @brief Outcome of one IRQ forwarding latency run \struct udrv_bench_result
+ * @details Latencies run from just before the interrupt is raised to the
+ *          driver thread returning from its receive.
+ */
+struct udrv_bench_result
+{
+    uint32_t rounds;
+    uint64_t min_ns;
+    uint64_t avg_ns;
+    uint64_t max_ns;
+    uint32_t raised;
+    uint32_t acks;
+};
+
+/**
+ * @brief Measure interrupt-to-driver latency through a forwarded IRQ
+ * @details Binds UDRV_BENCH_IRQ to a port a driver thread sleeps on, then
+ *          raises the vector with a software interrupt rounds times. Each
+ *          round goes through the same path a device interrupt takes: the
+ *          top half masks the line and posts the badge, the driver wakes,
+ *          stamps the time and acks the line before the next round.
+ * @param rounds Number of interrupts
+ * @param out Filled with the minimum, average and maximum latency
+ * @return 0 on success, -1 if the line, the port or the thread is
+ *         unavailable or an interrupt was not delivered
+ */
+int udrv_bench_latency(uint32_t rounds, struct udrv_bench_result* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
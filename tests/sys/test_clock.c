@@ -0,0 +1,71 @@
+#include "test_clock.h"
+#include "../../kernel/sys/clock.h"
+#include "../../kernel/sys/timer.h"
+#include "../../kernel/drivers/char/rtc.h"
+
+TEST_CASE(clock_monotonic_advances)
+{
+    const uint64_t t1 = ktime_get_ns();
+    const uint64_t t2 = ktime_get_ns();
+    TEST_ASSERT_TRUE(t2 >= t1);
+    return TEST_PASS;
+}
+
+TEST_CASE(clock_tracks_sleep)
+{
+    const uint64_t start = ktime_get_ns();
+    timer_sleep_ms(20);
+    const uint64_t elapsed = ktime_get_ns() - start;
+    TEST_ASSERT_TRUE(elapsed >= 10000000ull);
+    return TEST_PASS;
+}
+
+TEST_CASE(clock_gettime_ids)
+{
+    struct timespec ts;
+    TEST_ASSERT_EQ(clock_gettime(CLOCK_MONOTONIC, &ts), 0);
+    TEST_ASSERT_GE(ts.tv_nsec, 0);
+    TEST_ASSERT_LT(ts.tv_nsec, 1000000000);
+    TEST_ASSERT_EQ(clock_gettime(CLOCK_REALTIME, &ts), 0);
+    TEST_ASSERT_GT(ts.tv_sec, 0);
+    TEST_ASSERT_EQ(clock_gettime(99, &ts), -1);
+    TEST_ASSERT_EQ(clock_gettime(CLOCK_MONOTONIC, NULL), -1);
+    return TEST_PASS;
+}
+
+TEST_CASE(clock_timestamp_roundtrip)
+{
+    struct rtc_time t;
+    rtc_timestamp_to_time(951782400u, &t);
+    TEST_ASSERT_EQ(t.year, 2000);
+    TEST_ASSERT_EQ(t.month, 2);
+    TEST_ASSERT_EQ(t.day, 29);
+    TEST_ASSERT_EQ(t.hour, 0);
+    TEST_ASSERT_EQ(rtc_time_to_timestamp(&t), 951782400u);
+
+    rtc_timestamp_to_time(0, &t);
+    TEST_ASSERT_EQ(t.year, 1970);
+    TEST_ASSERT_EQ(t.month, 1);
+    TEST_ASSERT_EQ(t.day, 1);
+    TEST_ASSERT_EQ(t.weekday, 5);
+    return TEST_PASS;
+}
+
+static struct test_case clock_cases[] = {
+        TEST_ENTRY(clock_monotonic_advances),
+        TEST_ENTRY(clock_tracks_sleep),
+        TEST_ENTRY(clock_gettime_ids),
+        TEST_ENTRY(clock_timestamp_roundtrip),
+        TEST_SUITE_END
+};
+
+static struct test_suite clock_suite = {
+        .name = "Clock Tests",
+        .cases = clock_cases,
+        .count = 4
+};
+
+struct test_suite* test_clock_get_suite(void)
+{
+    return &clock_suite;
+}
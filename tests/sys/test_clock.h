@@ -0,0 +1,20 @@
+#ifndef TEST_CLOCK_H
+#define TEST_CLOCK_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the clock test suite
+ * @return Pointer to the clock test suite
+ */
+struct test_suite* test_clock_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+#include "test_irq.h"
+#include "../../kernel/arch/i686/idt.h"
+#include "../../kernel/include/string.h"
+
+// IRQ 15 (secondary ATA) is unused while the disk drivers poll
+#define TEST_IRQ_VECTOR 47
+
+static volatile uint32_t hits[2];
+static int cookie_a;
+static int cookie_b;
+
+static int shared_handler(struct registers* regs, void* dev_id)
+{
+    (void)regs;
+    if (dev_id == &cookie_a)
+    {
+        hits[0]++;
+        return IRQ_HANDLED;
+    }
+    hits[1]++;
+    return IRQ_NONE;
+}
+
+static void raise_test_irq(void)
+{
+    __asm__ volatile ("int $47");
+}
+
+TEST_CASE(irq_shared_chain_runs_all)
+{
+    hits[0] = 0;
+    hits[1] = 0;
+    TEST_ASSERT_EQ(request_irq(TEST_IRQ_VECTOR, shared_handler, &cookie_a, "test-a"), 0);
+    TEST_ASSERT_EQ(request_irq(TEST_IRQ_VECTOR, shared_handler, &cookie_b, "test-b"), 0);
+    TEST_ASSERT_EQ(irq_get_action_count(TEST_IRQ_VECTOR), 2);
+    TEST_ASSERT_STR_EQ(irq_get_name(TEST_IRQ_VECTOR), "test-a");
+
+    raise_test_irq();
+    TEST_ASSERT_EQ(hits[0], 1);
+    TEST_ASSERT_EQ(hits[1], 1);
+
+    TEST_ASSERT_EQ(free_irq(TEST_IRQ_VECTOR, &cookie_a), 0);
+    TEST_ASSERT_EQ(free_irq(TEST_IRQ_VECTOR, &cookie_b), 0);
+    TEST_ASSERT_EQ(irq_get_action_count(TEST_IRQ_VECTOR), 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(irq_request_free_by_cookie)
+{
+    TEST_ASSERT_EQ(request_irq(TEST_IRQ_VECTOR, shared_handler, &cookie_a, "test-a"), 0);
+    TEST_ASSERT_EQ(request_irq(TEST_IRQ_VECTOR, shared_handler, &cookie_a, "test-a"), -1);
+    TEST_ASSERT_EQ(request_irq(3, shared_handler, &cookie_b, "test-b"), -1);
+    TEST_ASSERT_EQ(free_irq(TEST_IRQ_VECTOR, &cookie_b), -1);
+
+    hits[0] = 0;
+    TEST_ASSERT_EQ(free_irq(TEST_IRQ_VECTOR, &cookie_a), 0);
+    TEST_ASSERT_EQ(free_irq(TEST_IRQ_VECTOR, &cookie_a), -1);
+    raise_test_irq();
+    TEST_ASSERT_EQ(hits[0], 0);
+    return TEST_PASS;
+}
+
+TEST_CASE(irq_vector_stats_counted)
+{
+    struct irq_vector_stats before;
+    struct irq_vector_stats after;
+
+    TEST_ASSERT_EQ(request_irq(TEST_IRQ_VECTOR, shared_handler, &cookie_b, "test-b"), 0);
+    irq_get_vector_stats(TEST_IRQ_VECTOR, &before);
+    raise_test_irq();
+    raise_test_irq();
+    irq_get_vector_stats(TEST_IRQ_VECTOR, &after);
+    free_irq(TEST_IRQ_VECTOR, &cookie_b);
+
+    TEST_ASSERT_EQ(after.count, before.count + 2);
+    // the only handler declined both interrupts
+    TEST_ASSERT_EQ(after.unhandled, before.unhandled + 2);
+    TEST_ASSERT_GT(after.handler_cycles, before.handler_cycles);
+    TEST_ASSERT_GE(after.max_latency, before.max_latency);
+    TEST_ASSERT_GT(after.max_handler_cycles, 0);
+    return TEST_PASS;
+}
+
+static struct test_case irq_cases[] = {
+        TEST_ENTRY(irq_shared_chain_runs_all),
+        TEST_ENTRY(irq_request_free_by_cookie),
+        TEST_ENTRY(irq_vector_stats_counted),
+        TEST_SUITE_END
+};
+
+static struct test_suite irq_suite = {
+        .name = "IRQ Tests",
+        .cases = irq_cases,
+        .count = 3
+};
+
+struct test_suite* test_irq_get_suite(void)
+{
+    return &irq_suite;
+}
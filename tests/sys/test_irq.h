@@ -0,0 +1,20 @@
+#ifndef TEST_IRQ_H
+#define TEST_IRQ_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the IRQ test suite
+ * @return Pointer to the IRQ test suite
+ */
+struct test_suite* test_irq_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TEST_SOFTIRQ_H
+#define TEST_SOFTIRQ_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the softirq test suite
+ * @return Pointer to the softirq test suite
+ */
+struct test_suite* test_softirq_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+#include "test_timer.h"
+#include "../../kernel/sys/timer.h"
+#include "../../kernel/sys/ktimer.h"
+#include "../../kernel/arch/i686/idt.h"
+
+static volatile uint32_t fired_count = 0;
+static volatile uint32_t fired_tick = 0;
+
+static void count_callback(const uint32_t data)
+{
+    (void)data;
+    fired_count++;
+    fired_tick = timer_get_ticks();
+}
+
+TEST_CASE(timer_add_del)
+{
+    struct ktimer t;
+    timer_setup(&t, count_callback, 0);
+    TEST_ASSERT_FALSE(timer_pending(&t));
+
+    const uint32_t before = ktimer_get_pending_count();
+    t.expires = timer_get_ticks() + 1000;
+    add_timer(&t);
+    TEST_ASSERT_TRUE(timer_pending(&t));
+    TEST_ASSERT_EQ(ktimer_get_pending_count(), before + 1);
+
+    TEST_ASSERT_EQ(del_timer(&t), 1);
+    TEST_ASSERT_FALSE(timer_pending(&t));
+    TEST_ASSERT_EQ(del_timer(&t), 0);
+    TEST_ASSERT_EQ(ktimer_get_pending_count(), before);
+    return TEST_PASS;
+}
+
+TEST_CASE(timer_mod_requeues)
+{
+    struct ktimer t;
+    timer_setup(&t, count_callback, 0);
+    TEST_ASSERT_EQ(mod_timer(&t, timer_get_ticks() + 500), 0);
+    TEST_ASSERT_TRUE(timer_pending(&t));
+    TEST_ASSERT_EQ(mod_timer(&t, timer_get_ticks() + 600), 1);
+    TEST_ASSERT_EQ(t.expires, timer_get_ticks() + 600);
+    del_timer(&t);
+    return TEST_PASS;
+}
+
+TEST_CASE(timer_far_expiry_cascades)
+{
+    struct ktimer t;
+    timer_setup(&t, count_callback, 0);
+    mod_timer(&t, timer_get_ticks() + 5000000);
+    TEST_ASSERT_TRUE(timer_pending(&t));
+    TEST_ASSERT_EQ(del_timer(&t), 1);
+    return TEST_PASS;
+}
+
+TEST_CASE(timer_callback_fires)
+{
+    struct ktimer t;
+    timer_setup(&t, count_callback, 0);
+    fired_count = 0;
+    const uint32_t expires = timer_get_ticks() + 2;
+    mod_timer(&t, expires);
+    timer_sleep(5);
+    TEST_ASSERT_EQ(fired_count, 1);
+    TEST_ASSERT_GE(fired_tick, expires);
+    TEST_ASSERT_FALSE(timer_pending(&t));
+    return TEST_PASS;
+}
+
+TEST_CASE(timer_sleep_blocks)
+{
+    const uint32_t start = timer_get_ticks();
+    timer_sleep_ms(30);
+    TEST_ASSERT_GE(timer_get_ticks() - start, timer_ms_to_ticks(30));
+    return TEST_PASS;
+}
+
+TEST_CASE(timer_ms_rounds_up)
+{
+    TEST_ASSERT_EQ(timer_ms_to_ticks(0), 0);
+    TEST_ASSERT_EQ(timer_ms_to_ticks(1), 1);
+    TEST_ASSERT_EQ(timer_ms_to_ticks(1000), timer_get_frequency());
+    return TEST_PASS;
+}
+
+TEST_CASE(timer_irq_latency_recorded)
+{
+    const uint8_t mode = irq_get_mode();
+    if (mode == IRQ_MODE_PIC)
+    {
+        TEST_ASSERT_EQ(timer_get_tick_source(), TICK_SOURCE_PIT);
+    }
+
+    struct irq_latency before;
+    irq_get_latency(mode, &before);
+    timer_sleep(2);
+
+    // every tick passes through irq_handler in either controller mode
+    struct irq_latency after;
+    irq_get_latency(mode, &after);
+    TEST_ASSERT_GE(after.count, before.count + 1);
+    TEST_ASSERT_GE(after.max_cycles, after.min_cycles);
+    TEST_ASSERT_NEQ(irq_measure_eoi(IRQ_MODE_PIC), 0);
+    return TEST_PASS;
+}
+
+static struct test_case timer_cases[] = {
+        TEST_ENTRY(timer_add_del),
+        TEST_ENTRY(timer_mod_requeues),
+        TEST_ENTRY(timer_far_expiry_cascades),
+        TEST_ENTRY(timer_callback_fires),
+        TEST_ENTRY(timer_sleep_blocks),
+        TEST_ENTRY(timer_ms_rounds_up),
+        TEST_ENTRY(timer_irq_latency_recorded),
+        TEST_SUITE_END
+};
+
+static struct test_suite timer_suite = {
+        .name = "Timer Tests",
+        .cases = timer_cases,
+        .count = 7
+};
+
+struct test_suite* test_timer_get_suite(void)
+{
+    return &timer_suite;
+}
@@ -0,0 +1,20 @@
+#ifndef TEST_TIMER_H
+#define TEST_TIMER_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the timer test suite
+ * @return Pointer to the timer test suite
+ */
+struct test_suite* test_timer_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
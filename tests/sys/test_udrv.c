@@ -0,0 +1,232 @@
+#include "test_udrv.h"
+#include "bench_udrv.h"
+#include "../../kernel/sys/udrv.h"
+#include "../../kernel/ipc/ipc.h"
+#include "../../kernel/mm/vmm.h"
+#include "../../kernel/mm/pmm.h"
+#include "../../kernel/sched/sched.h"
+#include "../../kernel/include/string.h"
+
+// stand in for driver processes; no task ever gets these PIDs
+#define UDRV_TEST_PID_A ((pid_t)0x7FFFFFF1)
+#define UDRV_TEST_PID_B ((pid_t)0x7FFFFFF2)
+#define UDRV_TEST_PID_C ((pid_t)0x7FFFFFF3)
+#define UDRV_TEST_AUTHORITY ((pid_t)0x7FFFFFF0)
+
+// device window; nothing else maps here
+#define UDRV_TEST_WINDOW 0x40C00000
+#define UDRV_TEST_DEVICE 0xF0000000
+
+static pid_t saved_authority;
+
+static void raise_bench_irq(void)
+{
+    __asm__ volatile ("int %0" : : "i"(32 + UDRV_BENCH_IRQ));
+}
+
+// the test authority authorizes drivers A and B; C stays unprivileged
+static void rights_begin(void)
+{
+    saved_authority = udrv_get_authority();
+    udrv_set_authority(UDRV_TEST_AUTHORITY);
+    udrv_authorize(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A);
+    udrv_authorize(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_B);
+}
+
+static void rights_end(void)
+{
+    udrv_exit(UDRV_TEST_PID_A);
+    udrv_exit(UDRV_TEST_PID_B);
+    udrv_exit(UDRV_TEST_PID_C);
+    udrv_set_authority(saved_authority);
+}
+
+TEST_CASE(udrv_irq_bind_checks_line_and_port)
+{
+    rights_begin();
+    const int port = port_create(UDRV_TEST_PID_A);
+    TEST_ASSERT_GE(port, 0);
+
+    // timer, cascade, keyboard and out of range lines are refused
+    TEST_ASSERT_EQ(udrv_irq_bind(0, port, 1, UDRV_TEST_PID_A), -1);
+    TEST_ASSERT_EQ(udrv_irq_bind(2, port, 1, UDRV_TEST_PID_A), -1);
+    TEST_ASSERT_EQ(udrv_irq_bind(1, port, 1, UDRV_TEST_PID_A), -1);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_IRQ_LINES, port, 1, UDRV_TEST_PID_A), -1);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 0, UDRV_TEST_PID_A), -1);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 1, UDRV_TEST_PID_B), -1);
+
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 1, UDRV_TEST_PID_A), 0);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 1, UDRV_TEST_PID_A), -1);
+    TEST_ASSERT_EQ(udrv_irq_unbind(UDRV_BENCH_IRQ, UDRV_TEST_PID_B), -1);
+    TEST_ASSERT_EQ(udrv_irq_unbind(UDRV_BENCH_IRQ, UDRV_TEST_PID_A), 0);
+    TEST_ASSERT_EQ(udrv_irq_unbind(UDRV_BENCH_IRQ, UDRV_TEST_PID_A), -1);
+
+    port_destroy(port);
+    rights_end();
+    return TEST_PASS;
+}
+
+TEST_CASE(udrv_irq_masked_until_ack)
+{
+    rights_begin();
+    const int port = port_create(UDRV_TEST_PID_A);
+    TEST_ASSERT_GE(port, 0);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 0x10, UDRV_TEST_PID_A), 0);
+
+    raise_bench_irq();
+    struct udrv_irq_stats s;
+    udrv_irq_get_stats(UDRV_BENCH_IRQ, &s);
+    TEST_ASSERT_EQ(s.owner, UDRV_TEST_PID_A);
+    TEST_ASSERT_EQ(s.raised, 1);
+    TEST_ASSERT(s.masked);
+
+    struct message msg;
+    msg.page_count = 0;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), 0);
+    TEST_ASSERT_EQ(msg.type, MSG_NOTIFY);
+    uint32_t badges;
+    memcpy(&badges, msg.data, sizeof(badges));
+    TEST_ASSERT_EQ(badges, 0x10);
+
+    // only the driver that bound the line may reopen it
+    TEST_ASSERT_EQ(udrv_irq_ack(UDRV_BENCH_IRQ, UDRV_TEST_PID_B), -1);
+    TEST_ASSERT_EQ(udrv_irq_ack(UDRV_BENCH_IRQ, UDRV_TEST_PID_A), 0);
+    udrv_irq_get_stats(UDRV_BENCH_IRQ, &s);
+    TEST_ASSERT(!s.masked);
+    TEST_ASSERT_EQ(s.acks, 1);
+
+    // an exiting driver loses its lines and nothing is forwarded any more
+    udrv_exit(UDRV_TEST_PID_A);
+    udrv_irq_get_stats(UDRV_BENCH_IRQ, &s);
+    TEST_ASSERT_EQ(s.owner, 0);
+    raise_bench_irq();
+    msg.page_count = 0;
+    TEST_ASSERT_EQ(msg_receive(port, &msg, IPC_NONBLOCK), -2);
+
+    port_destroy(port);
+    rights_end();
+    return TEST_PASS;
+}
+
+TEST_CASE(udrv_io_grants_are_exclusive)
+{
+    rights_begin();
+
+    // ports kernel drivers use are never handed out
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x60, 1), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x1F0, 8), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x3B8, 16), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x3F8, 1), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0xCFC, 4), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0xFFF8, 16), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x280, 0), -1);
+
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x280, 8), 0);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_B, 0x284, 8), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_A, 0x287, 1), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_B, 0x288, 8), 0);
+
+    udrv_exit(UDRV_TEST_PID_A);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_B, 0x280, 8), 0);
+    udrv_exit(UDRV_TEST_PID_B);
+    rights_end();
+    return TEST_PASS;
+}
+
+TEST_CASE(udrv_mmio_maps_device_memory_only)
+{
+    rights_begin();
+    page_directory_t* dir = vmm_get_current_directory();
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, UDRV_TEST_WINDOW), 0);
+
+    // RAM, the APIC windows, unaligned and oversized requests are refused
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, 0x100000, 1, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, pmm_get_memory_size() - PAGE_SIZE, 2, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, 0xFEE00000, 1, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, UDRV_TEST_DEVICE + 4, 1, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, UDRV_TEST_DEVICE, UDRV_MMIO_MAX_PAGES + 1, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, UDRV_TEST_DEVICE, 1, 0xC0000000), -1);
+
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_A, UDRV_TEST_DEVICE, 2, UDRV_TEST_WINDOW), 0);
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, UDRV_TEST_WINDOW + PAGE_SIZE), UDRV_TEST_DEVICE + PAGE_SIZE);
+
+    // the device belongs to one driver, and the window is taken
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_B, UDRV_TEST_DEVICE + PAGE_SIZE, 1, UDRV_TEST_WINDOW + 4 * PAGE_SIZE), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_B, UDRV_TEST_DEVICE + 4 * PAGE_SIZE, 1, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_unmap(UDRV_TEST_PID_B, UDRV_TEST_WINDOW), -1);
+
+    TEST_ASSERT_EQ(udrv_mmio_unmap(UDRV_TEST_PID_A, UDRV_TEST_WINDOW), 0);
+    TEST_ASSERT_EQ(vmm_get_physical_address(dir, UDRV_TEST_WINDOW), 0);
+    TEST_ASSERT_EQ(udrv_mmio_unmap(UDRV_TEST_PID_A, UDRV_TEST_WINDOW), -1);
+    rights_end();
+    return TEST_PASS;
+}
+
+TEST_CASE(udrv_rights_need_authority)
+{
+    rights_begin();
+    const int port = port_create(UDRV_TEST_PID_C);
+    TEST_ASSERT_GE(port, 0);
+
+    // an unauthorized process gets no lines, ports or device memory
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 1, UDRV_TEST_PID_C), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_C, 0x280, 8), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_C, UDRV_TEST_DEVICE, 1, UDRV_TEST_WINDOW), -1);
+
+    // and cannot grant itself anything, nor can an authorized driver
+    TEST_ASSERT_EQ(udrv_authorize(UDRV_TEST_PID_C, UDRV_TEST_PID_C), -1);
+    TEST_ASSERT_EQ(udrv_authorize(UDRV_TEST_PID_A, UDRV_TEST_PID_C), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_PID_C, UDRV_TEST_PID_C, 0x280, 8), -1);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_PID_A, UDRV_TEST_PID_A, 0x280, 8), -1);
+
+    TEST_ASSERT_EQ(udrv_authorize(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_C), 0);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 1, UDRV_TEST_PID_C), 0);
+    TEST_ASSERT_EQ(udrv_irq_unbind(UDRV_BENCH_IRQ, UDRV_TEST_PID_C), 0);
+
+    // ranges kernel drivers reserved stay theirs, even for a driver
+    TEST_ASSERT_EQ(udrv_reserve_io(0x2A0, 8), 0);
+    TEST_ASSERT_EQ(udrv_io_grant(UDRV_TEST_AUTHORITY, UDRV_TEST_PID_C, 0x2A4, 1), -1);
+    TEST_ASSERT_EQ(udrv_reserve_mmio(UDRV_TEST_DEVICE + 16 * PAGE_SIZE, PAGE_SIZE), 0);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_C, UDRV_TEST_DEVICE + 15 * PAGE_SIZE, 2, UDRV_TEST_WINDOW), -1);
+    TEST_ASSERT_EQ(udrv_mmio_map(UDRV_TEST_PID_C, UDRV_TEST_DEVICE + 16 * PAGE_SIZE, 1, UDRV_TEST_WINDOW), -1);
+
+    // exiting drops the authorization
+    udrv_exit(UDRV_TEST_PID_C);
+    TEST_ASSERT_EQ(udrv_irq_bind(UDRV_BENCH_IRQ, port, 1, UDRV_TEST_PID_C), -1);
+
+    port_destroy(port);
+    rights_end();
+    return TEST_PASS;
+}
+
+TEST_CASE(udrv_irq_reaches_driver_thread)
+{
+    struct udrv_bench_result r;
+    TEST_ASSERT_EQ(udrv_bench_latency(50, &r), 0);
+    TEST_ASSERT_EQ(r.rounds, 50);
+    TEST_ASSERT_EQ(r.raised, 50);
+    TEST_ASSERT_EQ(r.acks, 50);
+    TEST_ASSERT(r.min_ns <= r.avg_ns && r.avg_ns <= r.max_ns);
+    return TEST_PASS;
+}
+
+static struct test_case udrv_cases[] = {
+        TEST_ENTRY(udrv_irq_bind_checks_line_and_port),
+        TEST_ENTRY(udrv_irq_masked_until_ack),
+        TEST_ENTRY(udrv_io_grants_are_exclusive),
+        TEST_ENTRY(udrv_mmio_maps_device_memory_only),
+        TEST_ENTRY(udrv_rights_need_authority),
+        TEST_ENTRY(udrv_irq_reaches_driver_thread),
+        TEST_SUITE_END
+};
+
+static struct test_suite udrv_suite = {
+        .name = "User Driver Tests",
+        .cases = udrv_cases,
+        .count = 6
+};
+
+struct test_suite* test_udrv_get_suite(void)
+{
+    return &udrv_suite;
+}
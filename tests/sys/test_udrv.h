@@ -0,0 +1,20 @@
+#ifndef TEST_UDRV_H
+#define TEST_UDRV_H
+
+#include "../test_framework.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Get the user driver test suite
+ * @return Pointer to the user driver test suite
+ */
+struct test_suite* test_udrv_get_suite(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
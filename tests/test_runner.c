@@ -2,10 +2,20 @@
 #include "test_framework.h"
 #include "mm/test_pmm.h"
 #include "mm/test_heap.h"
+#include "mm/test_stack.h"
 #include "core/test_string.h"
 #include "core/test_fs.h"
 #include "ipc/test_ipc.h"
+#include "ipc/test_channel.h"
+#include "ipc/test_pipe.h"
 #include "sched/test_sched.h"
+#include "sched/test_deadline.h"
+#include "sched/test_futex.h"
+#include "sys/test_timer.h"
+#include "sys/test_clock.h"
+#include "sys/test_softirq.h"
+#include "sys/test_irq.h"
+#include "sys/test_udrv.h"
 #include "types/test_types.h"
 #include "../kernel/include/string.h"
 
@@ -19,6 +29,10 @@ struct test_suite* test_get_suite_by_name(const char* name)
     {
         return test_heap_get_suite();
     }
+    if (strcmp(name, "stack") == 0)
+    {
+        return test_stack_get_suite();
+    }
     if (strcmp(name, "string") == 0)
     {
         return test_string_get_suite();
@@ -31,10 +45,46 @@ struct test_suite* test_get_suite_by_name(const char* name)
     {
         return test_ipc_get_suite();
     }
+    if (strcmp(name, "chan") == 0)
+    {
+        return test_channel_get_suite();
+    }
+    if (strcmp(name, "pipe") == 0)
+    {
+        return test_pipe_get_suite();
+    }
     if (strcmp(name, "sched") == 0)
     {
         return test_sched_get_suite();
     }
+    if (strcmp(name, "dl") == 0)
+    {
+        return test_deadline_get_suite();
+    }
+    if (strcmp(name, "futex") == 0)
+    {
+        return test_futex_get_suite();
+    }
+    if (strcmp(name, "timer") == 0)
+    {
+        return test_timer_get_suite();
+    }
+    if (strcmp(name, "clock") == 0)
+    {
+        return test_clock_get_suite();
+    }
+    if (strcmp(name, "softirq") == 0)
+    {
+        return test_softirq_get_suite();
+    }
+    if (strcmp(name, "irq") == 0)
+    {
+        return test_irq_get_suite();
+    }
+    if (strcmp(name, "udrv") == 0)
+    {
+        return test_udrv_get_suite();
+    }
     if (strcmp(name, "types") == 0)
     {
         return test_types_get_suite();
@@ -67,9 +117,19 @@ void run_all_tests(void)
     test_run_suite(test_string_get_suite());
     test_run_suite(test_pmm_get_suite());
     test_run_suite(test_heap_get_suite());
+    test_run_suite(test_stack_get_suite());
     test_run_suite(test_fs_get_suite());
     test_run_suite(test_ipc_get_suite());
+    test_run_suite(test_channel_get_suite());
+    test_run_suite(test_pipe_get_suite());
     test_run_suite(test_sched_get_suite());
+    test_run_suite(test_deadline_get_suite());
+    test_run_suite(test_futex_get_suite());
+    test_run_suite(test_timer_get_suite());
+    test_run_suite(test_clock_get_suite());
+    test_run_suite(test_softirq_get_suite());
+    test_run_suite(test_irq_get_suite());
+    test_run_suite(test_udrv_get_suite());
     test_run_suite(test_types_get_suite());
 
     test_summary();
@@ -82,9 +142,19 @@ void run_all_tests_console(void)
     test_run_suite(test_string_get_suite());
     test_run_suite(test_pmm_get_suite());
     test_run_suite(test_heap_get_suite());
+    test_run_suite(test_stack_get_suite());
     test_run_suite(test_fs_get_suite());
     test_run_suite(test_ipc_get_suite());
+    test_run_suite(test_channel_get_suite());
+    test_run_suite(test_pipe_get_suite());
     test_run_suite(test_sched_get_suite());
+    test_run_suite(test_deadline_get_suite());
+    test_run_suite(test_futex_get_suite());
+    test_run_suite(test_timer_get_suite());
+    test_run_suite(test_clock_get_suite());
+    test_run_suite(test_softirq_get_suite());
+    test_run_suite(test_irq_get_suite());
+    test_run_suite(test_udrv_get_suite());
     test_run_suite(test_types_get_suite());
 
     test_summary();
@@ -19,7 +19,7 @@ void run_all_tests_console(void);
 
 /**
  * @brief Run a specific test suite (output to console)
- * @param name The name of the suite (pmm, heap, string, fs, ipc, sched)
+ * @param name The name of the suite (pmm, heap, stack, string, fs, ipc, sched, dl, timer, clock, softirq, irq, chan, futex, pipe, udrv)
  */
 void run_suite_console(const char* name);
 
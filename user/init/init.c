@@ -1,5 +1,6 @@
 #include "../lib/syscall.h"
 #include "init.h"
+#include "serial_drv.h"
 
 static void print(const char* str)
 {
@@ -96,6 +97,30 @@ int main(void)
         print("[init] Fork failed!\n");
     }
 
+    // the driver outlives init's own work; it only returns if COM2 is absent
+    int ready[2];
+    const int driver = pipe(ready, 0) == 0 ? fork() : -1;
+    if (driver == 0)
+    {
+        close(ready[1]);
+        const int ret = serial_drv_main(ready[0]);
+        print("[serial] COM2 driver unavailable\n");
+        return ret;
+    }
+    else if (driver > 0)
+    {
+        // only init holds driver rights, so it grants them to the child
+        if (serial_drv_grant(driver) == 0)
+        {
+            fd_write(ready[1], "g", 1);
+            print("[init] Started COM2 driver, PID: ");
+            print_dec(driver);
+            print("\n");
+        }
+        close(ready[0]);
+        close(ready[1]);
+    }
+
     print("[init] Init complete\n");
     return 0;
 }
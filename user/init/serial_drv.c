@@ -0,0 +1,105 @@
+#include "../lib/syscall.h"
+#include "../lib/io.h"
+#include "serial_drv.h"
+
+/*
+ * A 16550 driver running entirely in ring 3. The kernel forwards IRQ 3 to
+ * our port as a notification and keeps the line masked until we ack, so
+ * the loop is: sleep on the port, drain the receive FIFO, ack.
+ */
+#define UART_DATA (SERIAL_DRV_BASE + 0)
+#define UART_IER  (SERIAL_DRV_BASE + 1)
+#define UART_FCR  (SERIAL_DRV_BASE + 2)
+#define UART_LCR  (SERIAL_DRV_BASE + 3)
+#define UART_MCR  (SERIAL_DRV_BASE + 4)
+#define UART_LSR  (SERIAL_DRV_BASE + 5)
+#define UART_PORTS 8
+
+#define LSR_DATA_READY 0x01
+#define LSR_TX_EMPTY   0x20
+
+#define SERIAL_DRV_BADGE 0x1
+
+static void uart_put(const uint8_t c)
+{
+    while (!(inb(UART_LSR) & LSR_TX_EMPTY))
+    {
+    }
+    outb(UART_DATA, c);
+}
+
+static void uart_puts(const char* s)
+{
+    while (*s)
+    {
+        uart_put((uint8_t)*s++);
+    }
+}
+
+int serial_drv_grant(const int pid)
+{
+    if (drv_authorize(pid) != 0)
+    {
+        return -1;
+    }
+    return io_grant(pid, SERIAL_DRV_BASE, UART_PORTS);
+}
+
+int serial_drv_main(const int ready_fd)
+{
+    // end of file instead of the go byte: init could not grant the rights
+    char go;
+    if (fd_read(ready_fd, &go, 1) != 1)
+    {
+        return -1;
+    }
+    // a floating bus reads all ones: no UART here
+    if (inb(UART_LSR) == 0xFF)
+    {
+        return -1;
+    }
+
+    outb(UART_IER, 0x00);
+    outb(UART_LCR, 0x80);   // divisor latch
+    outb(UART_DATA, 0x03);  // 38400 baud
+    outb(UART_IER, 0x00);
+    outb(UART_LCR, 0x03);   // 8N1
+    outb(UART_FCR, 0xC7);   // FIFOs on, cleared, 14 byte trigger
+    outb(UART_MCR, 0x0B);   // DTR, RTS, OUT2 gates the IRQ
+
+    const int port = port_create();
+    if (port < 0 || irq_bind(SERIAL_DRV_IRQ, port, SERIAL_DRV_BADGE) != 0)
+    {
+        return -1;
+    }
+    outb(UART_IER, 0x01);   // interrupt on received data
+    uart_puts("mexOS user-space serial driver\r\n");
+
+    struct message msg;
+    while (1)
+    {
+        msg.page_count = 0;
+        if (recv(port, &msg, IPC_BLOCK) != 0)
+        {
+            break;
+        }
+        if (msg.type != MSG_NOTIFY)
+        {
+            continue;
+        }
+        while (inb(UART_LSR) & LSR_DATA_READY)
+        {
+            const uint8_t c = inb(UART_DATA);
+            uart_put(c);
+            if (c == '\r')
+            {
+                uart_put('\n');
+            }
+        }
+        irq_ack(SERIAL_DRV_IRQ);
+    }
+
+    outb(UART_IER, 0x00);
+    irq_unbind(SERIAL_DRV_IRQ);
+    return -1;
+}
@@ -0,0 +1,36 @@
+#ifndef USER_SERIAL_DRV_H
+#define USER_SERIAL_DRV_H
+
+/**
+ * @brief I/O base of the UART the driver runs (COM2)
+ */
+#define SERIAL_DRV_BASE 0x2F8
+
+/**
+ * @brief ISA IRQ line of SERIAL_DRV_BASE
+ */
+#define SERIAL_DRV_IRQ 3
+
+/**
+ * @brief Give a driver process the rights the COM2 driver needs
+ * @details Must run in the driver authority (init): authorizes pid as a
+ *          driver and grants it the UART's ports.
+ * @param pid The process that runs serial_drv_main
+ * @return 0 on success, -1 if the caller is not the authority or the
+ *         ports are taken
+ */
+int serial_drv_grant(int pid);
+
+/**
+ * @brief Run the user-space COM2 driver
+ * @details Waits for a byte on ready_fd, written once init has called
+ *          serial_drv_grant for this process, then binds the UART's IRQ to a
+ *          fresh port and echoes every byte received back to the line. Only
+ *          returns when the rights were refused, the UART is missing or a
+ *          resource is taken.
+ * @param ready_fd Read end of a pipe init signals on
+ * @return -1 if the driver could not start
+ */
+int serial_drv_main(int ready_fd);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef USER_IO_H
+#define USER_IO_H
+
+#include "syscall.h"
+
+/*
+ * Port I/O for user-space drivers. The instructions fault with a general
+ * protection exception unless the ports were opened with io_grant first.
+ */
+
+/**
+ * @brief Read a byte from an I/O port
+ * @param port The port
+ * @return The byte read
+ */
+static inline uint8_t inb(uint16_t port)
+{
+    uint8_t value;
+    __asm__ volatile ("inb %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+/**
+ * @brief Write a byte to an I/O port
+ * @param port The port
+ * @param value The byte to write
+ */
+static inline void outb(uint16_t port, uint8_t value)
+{
+    __asm__ volatile ("outb %0, %1" : : "a"(value), "Nd"(port));
+}
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef USER_RING_H
+#define USER_RING_H
+
+#include "syscall.h"
+
+/*
+ * Single-producer, single-consumer byte ring on top of a shared-memory
+ * channel. head and tail count bytes ever written and read, so the ring
+ * holds head - tail bytes and both wrap freely. Each end only stores its
+ * own index; the kernel is entered only to sleep on an empty or full ring
+ * and to wake an end that announced it is sleeping.
+ *
+ * Sleeping follows the futex pattern: raise the waiting flag, fence,
+ * recheck the ring and only then wait for the index seen before. The other
+ * end stores its index, fences and wakes if it sees the flag, so one of
+ * the two always notices the other.
+ */
+
+/**
+ * @brief One end of a ring channel \struct ring
+ */
+struct ring
+{
+    int id;
+    struct channel_header* hdr;
+    uint8_t* data;
+    uint32_t mask;
+};
+
+#define RING_BARRIER() __asm__ volatile ("" ::: "memory")
+
+static inline void ring_setup(struct ring* r, int id, void* addr)
+{
+    r->id = id;
+    r->hdr = (struct channel_header*)addr;
+    r->data = (uint8_t*)addr + 4096;
+    r->mask = r->hdr->size - 1;
+}
+
+/**
+ * @brief Create a channel and open its ring
+ * @param r The ring to fill
+ * @param pages Data pages, a power of two up to CHANNEL_MAX_PAGES
+ * @param addr Page aligned free window of pages + 1 pages
+ * @return The channel ID to pass to the other end, or -1
+ */
+static inline int ring_create(struct ring* r, int pages, void* addr)
+{
+    const int id = chan_create(pages, addr);
+    if (id < 0)
+    {
+        return -1;
+    }
+    ring_setup(r, id, addr);
+    return id;
+}
+
+/**
+ * @brief Open the ring of a channel created by another process
+ * @param r The ring to fill
+ * @param id The channel ID
+ * @param addr Page aligned free window
+ * @return 0 on success, or -1
+ */
+static inline int ring_attach(struct ring* r, int id, void* addr)
+{
+    if (chan_map(id, addr) != 0)
+    {
+        return -1;
+    }
+    ring_setup(r, id, addr);
+    return 0;
+}
+
+/**
+ * @brief Close this end of a ring
+ * @param r The ring
+ * @return 0 on success, or -1
+ */
+static inline int ring_detach(struct ring* r)
+{
+    return chan_unmap(r->id, r->hdr);
+}
+
+/**
+ * @brief Get the number of bytes waiting in a ring
+ * @param r The ring
+ * @return Bytes written but not yet read
+ */
+static inline uint32_t ring_used(const struct ring* r)
+{
+    return r->hdr->head - r->hdr->tail;
+}
+
+/**
+ * @brief Copy as many bytes into the ring as fit, without blocking
+ * @param r The producer end
+ * @param buf Bytes to write
+ * @param len Number of bytes
+ * @return Number of bytes written
+ */
+static inline uint32_t ring_write(struct ring* r, const void* buf, uint32_t len)
+{
+    struct channel_header* h = r->hdr;
+    const uint32_t head = h->head;
+    const uint32_t space = h->size - (head - h->tail);
+    const uint32_t n = len < space ? len : space;
+    const uint8_t* src = (const uint8_t*)buf;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        r->data[(head + i) & r->mask] = src[i];
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    // the bytes are visible before the index that publishes them
+    RING_BARRIER();
+    h->head = head + n;
+    __sync_synchronize();
+    if (h->consumer_waiting)
+    {
+        chan_wake(r->id, CHAN_CONSUMER);
+    }
+    return n;
+}
+
+/**
+ * @brief Copy up to len bytes out of the ring, without blocking
+ * @param r The consumer end
+ * @param buf Buffer to fill
+ * @param len Size of buf
+ * @return Number of bytes read
+ */
+static inline uint32_t ring_read(struct ring* r, void* buf, uint32_t len)
+{
+    struct channel_header* h = r->hdr;
+    const uint32_t tail = h->tail;
+    const uint32_t used = h->head - tail;
+    const uint32_t n = len < used ? len : used;
+    RING_BARRIER();
+    uint8_t* dst = (uint8_t*)buf;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        dst[i] = r->data[(tail + i) & r->mask];
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    RING_BARRIER();
+    h->tail = tail + n;
+    __sync_synchronize();
+    if (h->producer_waiting)
+    {
+        chan_wake(r->id, CHAN_PRODUCER);
+    }
+    return n;
+}
+
+/**
+ * @brief Write all bytes, sleeping while the ring is full
+ * @param r The producer end
+ * @param buf Bytes to write
+ * @param len Number of bytes
+ * @return 0 on success, -1 if the channel went away
+ */
+static inline int ring_send(struct ring* r, const void* buf, uint32_t len)
+{
+    const uint8_t* src = (const uint8_t*)buf;
+    while (len)
+    {
+        const uint32_t n = ring_write(r, src, len);
+        src += n;
+        len -= n;
+        if (n)
+        {
+            continue;
+        }
+
+        struct channel_header* h = r->hdr;
+        const uint32_t tail = h->tail;
+        h->producer_waiting = 1;
+        __sync_synchronize();
+        int ret = 0;
+        if (h->head - h->tail == h->size)
+        {
+            ret = chan_wait(r->id, h, CHAN_PRODUCER, tail);
+        }
+        h->producer_waiting = 0;
+        if (ret != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Read at least one byte, sleeping while the ring is empty
+ * @param r The consumer end
+ * @param buf Buffer to fill
+ * @param len Size of buf, at least 1
+ * @return Number of bytes read, or -1 if the channel went away
+ */
+static inline int ring_recv(struct ring* r, void* buf, uint32_t len)
+{
+    while (1)
+    {
+        const uint32_t n = ring_read(r, buf, len);
+        if (n)
+        {
+            return (int)n;
+        }
+
+        struct channel_header* h = r->hdr;
+        const uint32_t head = h->head;
+        h->consumer_waiting = 1;
+        __sync_synchronize();
+        int ret = 0;
+        if (h->head == h->tail)
+        {
+            ret = chan_wait(r->id, h, CHAN_CONSUMER, head);
+        }
+        h->consumer_waiting = 0;
+        if (ret != 0)
+        {
+            return -1;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef USER_SYNC_H
+#define USER_SYNC_H
+
+/*
+ * Mutex, condition variable and semaphore on top of futexes. Every
+ * primitive is a word in memory the threads or processes share; the fast
+ * paths are a single atomic instruction and the kernel is only entered to
+ * sleep on contention or to wake a sleeper that announced itself.
+ *
+ * SYNC_FUTEX_WAIT and SYNC_FUTEX_WAKE default to the futex syscalls; a
+ * kernel-mode user of this header defines them before including it.
+ */
+#ifndef SYNC_FUTEX_WAIT
+#include "syscall.h"
+#define SYNC_FUTEX_WAIT(addr, expected, ms) futex_wait((addr), (expected), (ms))
+#define SYNC_FUTEX_WAKE(addr, count) futex_wake((addr), (count))
+#endif
+
+/**
+ * @brief Sleeping lock \struct mutex
+ * @details state is 0 when free, 1 when held and 2 when held with sleepers,
+ *          so an unlock without sleepers never enters the kernel.
+ */
+struct mutex
+{
+    volatile unsigned int state;
+};
+
+/**
+ * @brief Condition variable \struct condvar
+ * @details seq moves on every signal; a waiter sleeps on the value it saw
+ *          before dropping the mutex, so a signal in between is not lost.
+ */
+struct condvar
+{
+    volatile unsigned int seq;
+};
+
+/**
+ * @brief Counting semaphore \struct semaphore
+ */
+struct semaphore
+{
+    volatile unsigned int count;
+    volatile unsigned int waiters;
+};
+
+#define MUTEX_INIT { 0 }
+#define CONDVAR_INIT { 0 }
+#define SEMAPHORE_INIT(n) { (n), 0 }
+
+static inline void mutex_init(struct mutex* m)
+{
+    m->state = 0;
+}
+
+/**
+ * @brief Take a mutex if it is free
+ * @param m The mutex
+ * @return 1 if taken, 0 if held by someone else
+ */
+static inline int mutex_trylock(struct mutex* m)
+{
+    return __sync_bool_compare_and_swap(&m->state, 0, 1);
+}
+
+/**
+ * @brief Take a mutex, sleeping while it is held
+ * @param m The mutex
+ */
+static inline void mutex_lock(struct mutex* m)
+{
+    unsigned int c = __sync_val_compare_and_swap(&m->state, 0, 1);
+    if (c == 0)
+    {
+        return;
+    }
+
+    // from here on the lock is marked contended, even if we take it
+    if (c != 2)
+    {
+        c = __sync_lock_test_and_set(&m->state, 2);
+    }
+    while (c != 0)
+    {
+        SYNC_FUTEX_WAIT(&m->state, 2, FUTEX_WAIT_FOREVER);
+        c = __sync_lock_test_and_set(&m->state, 2);
+    }
+}
+
+/**
+ * @brief Release a mutex, waking one sleeper if any
+ * @param m The mutex
+ */
+static inline void mutex_unlock(struct mutex* m)
+{
+    if (__sync_fetch_and_sub(&m->state, 1) != 1)
+    {
+        m->state = 0;
+        SYNC_FUTEX_WAKE(&m->state, 1);
+    }
+}
+
+static inline void cond_init(struct condvar* c)
+{
+    c->seq = 0;
+}
+
+/**
+ * @brief Release a mutex and sleep until signalled or the timeout passes
+ * @details The mutex is held again on return. Wakeups may be spurious, so
+ *          callers wait in a loop around their predicate.
+ * @param c The condition variable
+ * @param m The mutex the caller holds
+ * @param timeout_ms Most milliseconds to sleep, or FUTEX_WAIT_FOREVER
+ * @return 0 when signalled or spuriously woken, -3 on timeout
+ */
+static inline int cond_timedwait(struct condvar* c, struct mutex* m, unsigned int timeout_ms)
+{
+    const unsigned int seq = c->seq;
+    mutex_unlock(m);
+    const int ret = SYNC_FUTEX_WAIT(&c->seq, seq, timeout_ms);
+
+    // others may sleep on the mutex behind us, so take it as contended
+    while (__sync_lock_test_and_set(&m->state, 2) != 0)
+    {
+        SYNC_FUTEX_WAIT(&m->state, 2, FUTEX_WAIT_FOREVER);
+    }
+    return ret == -3 ? -3 : 0;
+}
+
+/**
+ * @brief Release a mutex and sleep until signalled
+ * @param c The condition variable
+ * @param m The mutex the caller holds
+ */
+static inline void cond_wait(struct condvar* c, struct mutex* m)
+{
+    cond_timedwait(c, m, FUTEX_WAIT_FOREVER);
+}
+
+/**
+ * @brief Wake one waiter of a condition variable
+ * @param c The condition variable
+ */
+static inline void cond_signal(struct condvar* c)
+{
+    __sync_fetch_and_add(&c->seq, 1);
+    SYNC_FUTEX_WAKE(&c->seq, 1);
+}
+
+/**
+ * @brief Wake every waiter of a condition variable
+ * @param c The condition variable
+ */
+static inline void cond_broadcast(struct condvar* c)
+{
+    __sync_fetch_and_add(&c->seq, 1);
+    SYNC_FUTEX_WAKE(&c->seq, FUTEX_WAKE_ALL);
+}
+
+static inline void sem_init(struct semaphore* s, unsigned int count)
+{
+    s->count = count;
+    s->waiters = 0;
+}
+
+/**
+ * @brief Take a unit of a semaphore if one is free
+ * @param s The semaphore
+ * @return 1 if taken, 0 if the count was zero
+ */
+static inline int sem_trywait(struct semaphore* s)
+{
+    unsigned int v = s->count;
+    while (v > 0)
+    {
+        const unsigned int seen = __sync_val_compare_and_swap(&s->count, v, v - 1);
+        if (seen == v)
+        {
+            return 1;
+        }
+        v = seen;
+    }
+    return 0;
+}
+
+/**
+ * @brief Take a unit of a semaphore, sleeping while the count is zero
+ * @param s The semaphore
+ */
+static inline void sem_wait(struct semaphore* s)
+{
+    while (!sem_trywait(s))
+    {
+        // a post between the check and the sleep changes count from 0
+        __sync_fetch_and_add(&s->waiters, 1);
+        SYNC_FUTEX_WAIT(&s->count, 0, FUTEX_WAIT_FOREVER);
+        __sync_fetch_and_sub(&s->waiters, 1);
+    }
+}
+
+/**
+ * @brief Return a unit to a semaphore, waking one sleeper if any
+ * @param s The semaphore
+ */
+static inline void sem_post(struct semaphore* s)
+{
+    __sync_fetch_and_add(&s->count, 1);
+    if (s->waiters)
+    {
+        SYNC_FUTEX_WAKE(&s->count, 1);
+    }
+}
+
+#endif
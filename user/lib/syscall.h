@@ -13,9 +13,40 @@
  */
 #define IPC_BLOCK    0x01
 #define IPC_NONBLOCK 0x02
+#define IPC_MOVE     0x04
+#define IPC_SHARE    0x08
+
+/**
+ * @brief Type of the message recv returns for pending notification badges
+ */
+#define MSG_NOTIFY 3
+
+/**
+ * @brief Most pages one message can carry
+ */
+#define IPC_MAX_PAGES 16
+
+/**
+ * @brief Most messages one send_batch or recv_batch call moves
+ */
+#define IPC_BATCH_MAX 64
+
+/**
+ * @brief Longest port name, including the terminating NUL
+ */
+#define PORT_NAME_MAX 32
+
+/**
+ * @brief Timeout of port_wait that never expires
+ */
+#define PORT_WAIT_FOREVER 0xFFFFFFFF
 
 /**
  * @brief IPC message structure for user-space
+ * @details Payloads above MAX_MSG_SIZE go as whole pages: send with
+ *          IPC_MOVE or IPC_SHARE and page_addr/page_count naming them.
+ *          Before receiving, page_addr/page_count name an unmapped window
+ *          for incoming pages.
  */
 struct message
 {
@@ -23,9 +54,26 @@ struct message
     pid_t    receiver;
     uint32_t type;
     uint32_t len;
+    uint32_t page_addr;
+    uint32_t page_count;
     uint8_t  data[MAX_MSG_SIZE];
 };
 
+/**
+ * @brief Time interval for nanosleep
+ */
+struct timespec
+{
+    int32_t tv_sec;
+    int32_t tv_nsec;
+};
+
+/**
+ * @brief Clock IDs for clock_gettime
+ */
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
 /**
  * @brief System call numbers
  */
@@ -37,6 +85,7 @@ struct message
 #define SYS_FORK 5
 #define SYS_WAIT 6
 #define SYS_EXEC 7
+#define SYS_CLOSE 9
 #define SYS_SEND 10
 #define SYS_RECV 11
 #define SYS_PORT_CREATE 12
@@ -45,6 +94,89 @@ struct message
 #define SYS_MMAP 15
 #define SYS_GETTIME 16
 #define SYS_SETTIME 17
+#define SYS_THREAD_CREATE 18
+#define SYS_THREAD_EXIT 19
+#define SYS_THREAD_JOIN 20
+#define SYS_GETTID 21
+#define SYS_SLEEP 22
+#define SYS_NANOSLEEP 23
+#define SYS_CLOCK_GETTIME 24
+#define SYS_SCHED_DEADLINE 25
+#define SYS_CALL 26
+#define SYS_REPLY 27
+#define SYS_PORT_LIMITS 28
+#define SYS_SEND_BATCH 29
+#define SYS_RECV_BATCH 30
+#define SYS_PORTSET_CREATE 31
+#define SYS_PORTSET_DESTROY 32
+#define SYS_PORTSET_ADD 33
+#define SYS_PORTSET_REMOVE 34
+#define SYS_PORT_WAIT 35
+#define SYS_NOTIFY 36
+#define SYS_CHAN_CREATE 37
+#define SYS_CHAN_MAP 38
+#define SYS_CHAN_UNMAP 39
+#define SYS_CHAN_DESTROY 40
+#define SYS_CHAN_WAIT 41
+#define SYS_CHAN_WAKE 42
+#define SYS_PORT_REGISTER 43
+#define SYS_PORT_LOOKUP 44
+#define SYS_PORT_UNREGISTER 45
+#define SYS_FUTEX_WAIT 46
+#define SYS_FUTEX_WAKE 47
+#define SYS_PIPE 48
+#define SYS_FD_READ 49
+#define SYS_FD_WRITE 50
+#define SYS_IRQ_BIND 51
+#define SYS_IRQ_ACK 52
+#define SYS_IRQ_UNBIND 53
+#define SYS_IO_GRANT 54
+#define SYS_MMIO_MAP 55
+#define SYS_MMIO_UNMAP 56
+#define SYS_DRV_AUTHORIZE 57
+#define SYS_CHAN_GRANT 58
+
+/**
+ * @brief Flag for pipe() making both ends non-blocking
+ */
+#define PIPE_NONBLOCK 0x01
+
+/**
+ * @brief Futex timeout meaning wait until woken
+ */
+#define FUTEX_WAIT_FOREVER 0xFFFFFFFF
+
+/**
+ * @brief Futex wake count meaning every waiter
+ */
+#define FUTEX_WAKE_ALL 0x7FFFFFFF
+
+/**
+ * @brief Most data pages of a channel
+ */
+#define CHANNEL_MAX_PAGES 16
+
+/**
+ * @brief Sides of a channel, named by who sleeps on them
+ */
+#define CHAN_PRODUCER 0
+#define CHAN_CONSUMER 1
+
+/**
+ * @brief First page of a mapped channel \struct channel_header
+ * @details Must match the kernel's layout. The data pages follow it; see
+ *          ring.h for the ring protocol on top.
+ */
+struct channel_header
+{
+    volatile uint32_t head;
+    volatile uint32_t producer_waiting;
+    uint8_t pad0[56];
+    volatile uint32_t tail;
+    volatile uint32_t consumer_waiting;
+    uint8_t pad1[56];
+    uint32_t size;
+};
 
 /**
  * @brief Perform a system call with 0 arguments
@@ -100,6 +232,22 @@ static inline int syscall3(int num, int arg1, int arg2, int arg3)
     return ret;
 }
 
+/**
+ * @brief Perform a system call with 4 arguments
+ * @param num The system call number
+ * @param arg1 The first argument
+ * @param arg2 The second argument
+ * @param arg3 The third argument
+ * @param arg4 The fourth argument
+ * @return The return value of the system call
+ */
+static inline int syscall4(int num, int arg1, int arg2, int arg3, int arg4)
+{
+    int ret;
+    __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(num), "b"(arg1), "c"(arg2), "d"(arg3), "S"(arg4));
+    return ret;
+}
+
 /**
  * @brief Exit the current process
  * @param code The exit code
@@ -133,6 +281,8 @@ static inline int read(char* buf, int len)
 
 /**
  * @brief Yield the CPU to other processes
+ * @details In the deadline class this ends the current job and sleeps until
+ *          the next period.
  */
 static inline void yield(void)
 {
@@ -165,7 +315,8 @@ static inline int send(int port, struct message* msg, int flags)
  * @param port The port to receive the message from
  * @param msg The message buffer to receive into
  * @param flags Message flags
- * @return 0 on success, or a negative error code
+ * @return 0 on success, or a negative error code; -3 means the page window
+ *         was too small or not free and the message is still queued
  */
 static inline int recv(int port, struct message* msg, int flags)
 {
@@ -214,11 +365,499 @@ static inline int port_create(void)
 /**
  * @brief Destroy a port
  * @param port The port ID to destroy
- * @return 0 on success, or -1 on error
+ * @return 0 on success, or -1 on error or if the caller does not own the port
  */
 static inline int port_destroy(int port)
 {
     return syscall1(SYS_PORT_DESTROY, port);
 }
 
+/**
+ * @brief Create a thread in the current process
+ * @details The thread shares the address space and ports of the caller and
+ *          must terminate with thread_exit(), returning from fn is not allowed.
+ * @param fn The thread entry point
+ * @param arg Argument passed to fn
+ * @return Thread ID on success, or -1 on error
+ */
+static inline int thread_create(void (*fn)(void*), void* arg)
+{
+    return syscall2(SYS_THREAD_CREATE, (int)fn, (int)arg);
+}
+
+/**
+ * @brief Exit the calling thread
+ * @param code The exit code reported to thread_join()
+ */
+static inline void thread_exit(int code)
+{
+    syscall1(SYS_THREAD_EXIT, code);
+}
+
+/**
+ * @brief Wait for a thread of the current process to exit
+ * @param tid The thread ID to wait for
+ * @param status Pointer to store the thread exit code
+ * @return 0 on success, or -1 on error
+ */
+static inline int thread_join(int tid, int* status)
+{
+    return syscall2(SYS_THREAD_JOIN, tid, (int)status);
+}
+
+/**
+ * @brief Get the thread ID of the calling thread
+ * @return The thread ID
+ */
+static inline int gettid(void)
+{
+    return syscall0(SYS_GETTID);
+}
+
+/**
+ * @brief Sleep for at least the given number of milliseconds
+ * @param ms Milliseconds to sleep
+ * @return 0 on success
+ */
+static inline int msleep(unsigned int ms)
+{
+    return syscall1(SYS_SLEEP, (int)ms);
+}
+
+/**
+ * @brief Sleep for the interval in req
+ * @param req Requested interval
+ * @param rem Receives the unslept time (may be NULL)
+ * @return 0 on success, -1 on invalid interval
+ */
+static inline int nanosleep(const struct timespec* req, struct timespec* rem)
+{
+    return syscall2(SYS_NANOSLEEP, (int)req, (int)rem);
+}
+
+/**
+ * @brief Read a clock
+ * @param clock_id CLOCK_REALTIME or CLOCK_MONOTONIC
+ * @param ts Receives the time
+ * @return 0 on success, -1 on error
+ */
+static inline int clock_gettime(int clock_id, struct timespec* ts)
+{
+    return syscall2(SYS_CLOCK_GETTIME, clock_id, (int)ts);
+}
+
+/**
+ * @brief Move the calling thread into the deadline class
+ * @param runtime_us CPU time per period in microseconds, 0 to leave the class
+ * @param deadline_us Deadline relative to the period start
+ * @param period_us Period in microseconds
+ * @return 0 on success, -1 on invalid parameters or admission failure
+ */
+static inline int sched_deadline(unsigned int runtime_us, unsigned int deadline_us, unsigned int period_us)
+{
+    return syscall3(SYS_SCHED_DEADLINE, (int)runtime_us, (int)deadline_us, (int)period_us);
+}
+
+/**
+ * @brief Send a request to a port and wait for the reply
+ * @param port The server port
+ * @param msg The request; its sender field is set to the caller's PID
+ * @param reply The reply buffer
+ * @return 0 on success, -1 on failure or if the request was dropped
+ */
+static inline int ipc_call(int port, struct message* msg, struct message* reply)
+{
+    return syscall3(SYS_CALL, port, (int)msg, (int)reply);
+}
+
+/**
+ * @brief Answer the call being served on a port
+ * @param port The port the request was received on
+ * @param msg The reply
+ * @return 0 on success, -1 if no call is being served
+ */
+static inline int ipc_reply(int port, struct message* msg)
+{
+    return syscall2(SYS_REPLY, port, (int)msg);
+}
+
+/**
+ * @brief Set the queue capacity of a port
+ * @param port The port to configure, owned by the caller
+ * @param bytes Queue size in bytes; each message takes 24 bytes plus its
+ *              payload, and the queue must hold one full message
+ * @param messages Most queued messages, up to 16
+ * @return 0 on success, -1 on invalid limits, if messages are queued or
+ *         the port belongs to another process
+ */
+static inline int port_limits(int port, unsigned int bytes, unsigned int messages)
+{
+    return syscall3(SYS_PORT_LIMITS, port, (int)bytes, (int)messages);
+}
+
+/**
+ * @brief Send several inline messages with one system call
+ * @param port The port to send to
+ * @param msgs The messages, sent in order
+ * @param count Number of messages, up to IPC_BATCH_MAX
+ * @param flags Message flags; IPC_MOVE and IPC_SHARE are not allowed
+ * @return Number of messages queued, -2 if none fit without blocking, or -1
+ */
+static inline int send_batch(int port, struct message* msgs, int count, int flags)
+{
+    return syscall4(SYS_SEND_BATCH, port, (int)msgs, count, flags);
+}
+
+/**
+ * @brief Receive all queued messages, up to a limit, with one system call
+ * @param port The port to receive from
+ * @param msgs Buffer for up to max messages
+ * @param max Size of msgs, up to IPC_BATCH_MAX
+ * @param flags Message flags
+ * @return Number of messages received, -2 if none is queued and the call
+ *         would block, -3 if the oldest message carries pages and needs recv,
+ *         or -1
+ */
+static inline int recv_batch(int port, struct message* msgs, int max, int flags)
+{
+    return syscall4(SYS_RECV_BATCH, port, (int)msgs, max, flags);
+}
+
+/**
+ * @brief Create an empty port set
+ * @return The set ID, or -1 on error
+ */
+static inline int portset_create(void)
+{
+    return syscall0(SYS_PORTSET_CREATE);
+}
+
+/**
+ * @brief Destroy a port set; its ports stay open
+ * @param set The set to destroy, owned by the caller
+ * @return 0 on success, or -1
+ */
+static inline int portset_destroy(int set)
+{
+    return syscall1(SYS_PORTSET_DESTROY, set);
+}
+
+/**
+ * @brief Add a port to a port set
+ * @param set The set, owned by the caller
+ * @param port The port, owned by the caller; a port belongs to at most one set
+ * @return 0 on success, or -1
+ */
+static inline int portset_add(int set, int port)
+{
+    return syscall2(SYS_PORTSET_ADD, set, port);
+}
+
+/**
+ * @brief Remove a port from a port set
+ * @param set The set, owned by the caller
+ * @param port The port, owned by the caller
+ * @return 0 on success, or -1
+ */
+static inline int portset_remove(int set, int port)
+{
+    return syscall2(SYS_PORTSET_REMOVE, set, port);
+}
+
+/**
+ * @brief Wait until ports of a set have messages
+ * @details Edge triggered: a port is reported once for the messages that
+ *          arrived since it was last reported, so drain it with
+ *          IPC_NONBLOCK before waiting again.
+ * @param set The set to wait on, owned by the caller
+ * @param ready Filled with the IDs of ready ports
+ * @param max Number of entries in ready
+ * @param timeout_ms 0 to poll, PORT_WAIT_FOREVER to wait without a limit
+ * @return Number of ready ports, 0 on timeout, or -1
+ */
+static inline int port_wait(int set, int* ready, int max, unsigned int timeout_ms)
+{
+    return syscall4(SYS_PORT_WAIT, set, (int)ready, max, (int)timeout_ms);
+}
+
+/**
+ * @brief Post notification badges to a port without blocking
+ * @details Badges coalesce until the owner receives; it then gets one
+ *          message of type MSG_NOTIFY whose data holds their OR as an
+ *          unsigned int.
+ * @param port The port to notify
+ * @param badge Bits to post, not 0
+ * @return 0 on success, or -1
+ */
+static inline int notify(int port, unsigned int badge)
+{
+    return syscall2(SYS_NOTIFY, port, (int)badge);
+}
+
+/**
+ * @brief Create a shared-memory channel and map it
+ * @param pages Data pages, a power of two up to CHANNEL_MAX_PAGES
+ * @param addr Page aligned free window of pages + 1 pages
+ * @return The channel ID, or -1 on error
+ */
+static inline int chan_create(int pages, void* addr)
+{
+    return syscall2(SYS_CHAN_CREATE, pages, (int)addr);
+}
+
+/**
+ * @brief Name the one other process that may use a channel
+ * @details Without a grant the first other process to map the channel
+ *          becomes its other end.
+ * @param id A channel the caller created
+ * @param pid The other end
+ * @return 0 on success, or -1 if the caller is not the creator or the
+ *         other end is already set
+ */
+static inline int chan_grant(int id, int pid)
+{
+    return syscall2(SYS_CHAN_GRANT, id, pid);
+}
+
+/**
+ * @brief Map a channel created by another process
+ * @param id The channel ID, passed over IPC by its creator
+ * @param addr Page aligned free window
+ * @return 0 on success, or -1 if the caller is not one of the channel's
+ *         two ends
+ */
+static inline int chan_map(int id, void* addr)
+{
+    return syscall2(SYS_CHAN_MAP, id, (int)addr);
+}
+
+/**
+ * @brief Unmap a channel
+ * @param id The channel ID
+ * @param addr Where the channel is mapped
+ * @return 0 on success, or -1
+ */
+static inline int chan_unmap(int id, void* addr)
+{
+    return syscall2(SYS_CHAN_UNMAP, id, (int)addr);
+}
+
+/**
+ * @brief Destroy a channel; mapped pages stay valid until unmapped
+ * @param id A channel the caller created
+ * @return 0 on success, or -1
+ */
+static inline int chan_destroy(int id)
+{
+    return syscall1(SYS_CHAN_DESTROY, id);
+}
+
+/**
+ * @brief Sleep while the other end's index still equals expected
+ * @param id The channel ID
+ * @param hdr Where the caller mapped the channel
+ * @param side CHAN_PRODUCER waits on tail, CHAN_CONSUMER on head
+ * @param expected The index value the caller last saw
+ * @return 0 when the caller should recheck the ring, or -1
+ */
+static inline int chan_wait(int id, struct channel_header* hdr, int side, unsigned int expected)
+{
+    return syscall4(SYS_CHAN_WAIT, id, (int)hdr, side, (int)expected);
+}
+
+/**
+ * @brief Wake the end sleeping on one side of a channel
+ * @param id The channel ID
+ * @param side CHAN_PRODUCER or CHAN_CONSUMER
+ * @return 1 if a task was woken, 0 if none waited, or -1
+ */
+static inline int chan_wake(int id, int side)
+{
+    return syscall2(SYS_CHAN_WAKE, id, side);
+}
+
+/**
+ * @brief Publish one of the caller's ports under a name
+ * @param name Up to PORT_NAME_MAX - 1 characters
+ * @param port A port the caller created; a port has at most one name
+ * @return 0 on success, or -1 if the name is taken
+ */
+static inline int port_register(const char* name, int port)
+{
+    return syscall2(SYS_PORT_REGISTER, (int)name, port);
+}
+
+/**
+ * @brief Find the port of a service by name
+ * @param name The name the server registered
+ * @return The port ID, or -1 if no port has that name
+ */
+static inline int port_lookup(const char* name)
+{
+    return syscall1(SYS_PORT_LOOKUP, (int)name);
+}
+
+/**
+ * @brief Withdraw a name of one of the caller's ports
+ * @param name The registered name
+ * @return 0 on success, or -1
+ */
+static inline int port_unregister(const char* name)
+{
+    return syscall1(SYS_PORT_UNREGISTER, (int)name);
+}
+
+/**
+ * @brief Sleep while a futex word still holds an expected value
+ * @param addr The futex word; shared memory works across processes
+ * @param expected The value the caller last saw
+ * @param timeout_ms Most milliseconds to sleep, or FUTEX_WAIT_FOREVER
+ * @return 0 when woken, -1 on a bad address, -2 if the word changed, -3 on timeout
+ */
+static inline int futex_wait(volatile unsigned int* addr, unsigned int expected, unsigned int timeout_ms)
+{
+    return syscall3(SYS_FUTEX_WAIT, (int)addr, (int)expected, (int)timeout_ms);
+}
+
+/**
+ * @brief Wake tasks sleeping on a futex word
+ * @param addr The futex word
+ * @param count Most tasks to wake, or FUTEX_WAKE_ALL
+ * @return The number of tasks woken, or -1
+ */
+static inline int futex_wake(volatile unsigned int* addr, int count)
+{
+    return syscall2(SYS_FUTEX_WAKE, (int)addr, count);
+}
+
+/**
+ * @brief Create a pipe; both descriptors are inherited across fork
+ * @param fds Filled with the read end in fds[0] and the write end in fds[1]
+ * @param flags 0, or PIPE_NONBLOCK
+ * @return 0 on success, or -1
+ */
+static inline int pipe(int fds[2], int flags)
+{
+    return syscall2(SYS_PIPE, (int)fds, flags);
+}
+
+/**
+ * @brief Read from a pipe, blocking until data is there unless non-blocking
+ * @param fd A read end
+ * @param buf Buffer to fill
+ * @param len Size of buf; at most 16 KB is read per call
+ * @return Bytes read, 0 at end of file, -1 on a bad descriptor, -3 if it would block
+ */
+static inline int fd_read(int fd, void* buf, int len)
+{
+    return syscall3(SYS_FD_READ, fd, (int)buf, len);
+}
+
+/**
+ * @brief Write to a pipe, blocking until all is written unless non-blocking
+ * @param fd A write end
+ * @param buf Bytes to write
+ * @param len Number of bytes; at most 16 KB is written per call, so a
+ *        larger write returns a short count
+ * @return Bytes written, -1 on a bad descriptor, -2 if no reader is left,
+ *         -3 if it would block
+ */
+static inline int fd_write(int fd, const void* buf, int len)
+{
+    return syscall3(SYS_FD_WRITE, fd, (int)buf, len);
+}
+
+/**
+ * @brief Close a descriptor
+ * @param fd The descriptor
+ * @return 0 on success, or -1
+ */
+static inline int close(int fd)
+{
+    return syscall1(SYS_CLOSE, fd);
+}
+
+/**
+ * @brief Forward an IRQ line to a port as notification badges
+ * @details The caller must be an authorized driver. The line is masked
+ *          after every interrupt until irq_ack.
+ * @param irq ISA IRQ number
+ * @param port A port the caller owns
+ * @param badge Badge bits posted per interrupt, not 0
+ * @return 0 on success, or -1
+ */
+static inline int irq_bind(int irq, int port, unsigned int badge)
+{
+    return syscall3(SYS_IRQ_BIND, irq, port, (int)badge);
+}
+
+/**
+ * @brief Unmask a bound IRQ line once the device is serviced
+ * @param irq ISA IRQ number
+ * @return 0 on success, or -1
+ */
+static inline int irq_ack(int irq)
+{
+    return syscall1(SYS_IRQ_ACK, irq);
+}
+
+/**
+ * @brief Stop forwarding an IRQ line
+ * @param irq ISA IRQ number
+ * @return 0 on success, or -1
+ */
+static inline int irq_unbind(int irq)
+{
+    return syscall1(SYS_IRQ_UNBIND, irq);
+}
+
+/**
+ * @brief Let a process act as a driver
+ * @details Only the driver authority, the init the kernel spawned, may
+ *          authorize.
+ * @param pid The process to authorize
+ * @return 0 on success, or -1
+ */
+static inline int drv_authorize(int pid)
+{
+    return syscall1(SYS_DRV_AUTHORIZE, pid);
+}
+
+/**
+ * @brief Give a driver ring 3 access to a range of I/O ports
+ * @details Only the driver authority may grant.
+ * @param pid An authorized driver, or the caller itself
+ * @param base First port
+ * @param count Number of ports
+ * @return 0 on success, -1 if not allowed or a port is reserved or
+ *         granted elsewhere
+ */
+static inline int io_grant(int pid, int base, int count)
+{
+    return syscall3(SYS_IO_GRANT, pid, base, count);
+}
+
+/**
+ * @brief Map device memory uncached at a free user address
+ * @details The caller must be an authorized driver.
+ * @param phys Page aligned physical address above RAM
+ * @param pages Number of pages
+ * @param addr Page aligned address to map at
+ * @return 0 on success, or -1
+ */
+static inline int mmio_map(unsigned int phys, int pages, void* addr)
+{
+    return syscall3(SYS_MMIO_MAP, (int)phys, pages, (int)addr);
+}
+
+/**
+ * @brief Unmap device memory mapped with mmio_map
+ * @param addr Address the window was mapped at
+ * @return 0 on success, or -1
+ */
+static inline int mmio_unmap(void* addr)
+{
+    return syscall1(SYS_MMIO_UNMAP, (int)addr);
+}
+
 #endif